@@ -57,6 +57,7 @@
 # Build a custom project created by gpc.pl
 
 
+BENCHMARKS=0
 COMPILE=0
 COMPILE_VREP=0
 DOCS=0
@@ -72,10 +73,12 @@ SCRIPTS_DIR=`dirname $0`
 [ -d $SCRIPTS_DIR/src/algorithms/threads ] || mkdir $SCRIPTS_DIR/src/algorithms/threads
 [ -d $SCRIPTS_DIR/src/containers ] || mkdir $SCRIPTS_DIR/src/containers
 [ -d $SCRIPTS_DIR/src/filters ] || mkdir $SCRIPTS_DIR/src/filters
+[ -d $SCRIPTS_DIR/src/localization ] || mkdir $SCRIPTS_DIR/src/localization
 [ -d $SCRIPTS_DIR/src/platforms ] || mkdir $SCRIPTS_DIR/src/platforms
 [ -d $SCRIPTS_DIR/src/platforms/threads ] || mkdir $SCRIPTS_DIR/src/platforms/threads
 [ -d $SCRIPTS_DIR/src/threads ] || mkdir $SCRIPTS_DIR/src/threads
 [ -d $SCRIPTS_DIR/src/transports ] || mkdir $SCRIPTS_DIR/src/transports
+[ -d $SCRIPTS_DIR/src/utility ] || mkdir $SCRIPTS_DIR/src/utility
 
 if [ -z $CORES ] ; then
   echo "CORES unset, so setting it to default of 1"
@@ -86,7 +89,9 @@ fi
 
 for var in "$@"
 do
-  if [ "$var" = "compile" ]; then
+  if [ "$var" = "benchmarks" ]; then
+    BENCHMARKS=1
+  elif [ "$var" = "compile" ]; then
     COMPILE=1
   elif [ "$var" = "compile-vrep" ]; then
     COMPILE_VREP=1
@@ -105,6 +110,7 @@ do
   else
     echo "Invalid argument: $var"
     echo "  args can be zero or more of the following, space delimited"
+    echo "  benchmarks      also build the benchmarks in benchmarks/"
     echo "  compile         build the custom project"
     echo "  compile-vrep    compile with vrep support"
     echo "  prereqs         apt-get doxygen and other prereqs"
@@ -137,7 +143,7 @@ if [ $COMPILE -eq 1 ]; then
   fi
 
   cd $SCRIPTS_DIR
-  $ACE_ROOT/bin/mwc.pl -type gnuace -features vrep=$COMPILE_VREP,tests=0,docs=1 workspace.mwc
+  $ACE_ROOT/bin/mwc.pl -type gnuace -features vrep=$COMPILE_VREP,tests=0,docs=1,benchmarks=$BENCHMARKS workspace.mwc
   
   
   if [ $VERBOSE -eq 1 ]; then
@@ -151,7 +157,7 @@ if [ $COMPILE -eq 1 ]; then
     echo "Building project..."
   fi
 
-  make vrep=$COMPILE_VREP docs=$DOCS -j $CORES
+  make vrep=$COMPILE_VREP docs=$DOCS benchmarks=$BENCHMARKS -j $CORES
   
 fi
   
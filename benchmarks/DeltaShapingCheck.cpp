@@ -0,0 +1,202 @@
+/**
+ * Checks that a delta encoded vector survives send shaping. A drifting
+ * vector is sent through DeltaSendFilter and IntelligentSendFilter under
+ * budgets tight enough to defer most sends, with and without a deadline
+ * that drops deferred values, and restored by DeltaReceiveFilter. Every
+ * delta must find its keyframe, and once the vector holds still the
+ * receiver must have it to within the deadband. Prints each failure and
+ * exits nonzero if there was one.
+ **/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "madara/knowledge/KnowledgeBase.h"
+
+#include "filters/DeltaReceiveFilter.h"
+#include "filters/DeltaSendFilter.h"
+#include "filters/IntelligentSendFilter.h"
+#include "utility/Clock.h"
+
+typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+// check settings
+int iterations (3000);
+int elements (16);
+
+// nanoseconds between sends, and sends of a still vector at the end
+static const int64_t SEND_PERIOD (10000000);
+static const int SETTLE_SENDS (500);
+
+// filter settings the checks run with
+static const double DEADBAND (0.001);
+static const double RESOLUTION (0.0001);
+
+// checks run and failed
+static int checks (0);
+static int failures (0);
+
+void print_usage (char * prog_name)
+{
+  printf (
+"\nProgram summary for %s:\n\n"
+"     Checks that shaped delta encoded vectors are restored\n"
+" [-e |--elements num]          elements of the vector (def: 16)\n"
+" [-i |--iterations num]        sends of a drifting vector (def: 3000)\n"
+"\n",
+    prog_name);
+  exit (0);
+}
+
+/**
+ * Reads an integer argument
+ **/
+static void
+read_integer (int argc, char ** argv, int & i, int & value)
+{
+  if (i + 1 < argc && argv[i + 1][0] != '-')
+  {
+    std::stringstream buffer (argv[i + 1]);
+    buffer >> value;
+  }
+  else
+    print_usage (argv[0]);
+
+  ++i;
+}
+
+// handle command line arguments
+void handle_arguments (int argc, char ** argv)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg1 (argv[i]);
+
+    if (arg1 == "-e" || arg1 == "--elements")
+    {
+      read_integer (argc, argv, i, elements);
+    }
+    else if (arg1 == "-i" || arg1 == "--iterations")
+    {
+      read_integer (argc, argv, i, iterations);
+    }
+    else
+    {
+      print_usage (argv[0]);
+    }
+  }
+}
+
+/**
+ * Records a failed check
+ **/
+static void
+fail (const char * name, const char * what)
+{
+  printf ("FAILED %s: %s\n", name, what);
+  ++failures;
+}
+
+/**
+ * Sends a vector through the shaped delta filters and checks what the
+ * receiver restores
+ * @param  name      the case, for messages
+ * @param  budget    bytes per second of the shaper, 0 for unlimited
+ * @param  deadline  seconds a deferred value stays worth sending, 0 for
+ *                   no limit
+ **/
+static void
+check (const char * name, double budget, double deadline)
+{
+  ++checks;
+
+  madara::knowledge::KnowledgeBase knowledge;
+  madara::knowledge::Variables vars (&knowledge.get_context ());
+  vars.set (".send.budget", budget);
+  vars.set (".send.default.deadline", deadline);
+  vars.set (".delta.deadband", DEADBAND);
+  vars.set (".delta.resolution", RESOLUTION);
+
+  filters::IntelligentSendFilter shaper;
+  filters::DeltaSendFilter encoder (&shaper);
+  filters::DeltaReceiveFilter decoder;
+
+  const madara::transport::TransportContext sending (
+    madara::transport::TransportContext::SENDING_OPERATION, 0, 0, 0, 0,
+    "rislab", "agent.0");
+  const madara::transport::TransportContext receiving (
+    madara::transport::TransportContext::RECEIVING_OPERATION, 0, 0, 0, 0,
+    "rislab", "agent.0");
+
+  std::vector <double> values (elements, 0.0);
+  std::vector <double> restored;
+  int sent = 0;
+  int received = 0;
+
+  int64_t time = 1000000000;
+  for (int i = 0; i < iterations + SETTLE_SENDS; ++i, time += SEND_PERIOD)
+  {
+    // drift with pauses, in which deferred values reach their deadline,
+    // and a jump now and then that no delta can hold
+    const bool drifting = i < iterations && i % 50 < 40;
+    for (size_t j = 0; drifting && j < values.size (); ++j)
+    {
+      values[j] += (rand () % 2001 - 1000) * 0.00001;
+      if (i % 400 == 399)
+        values[j] += 5.0;
+    }
+
+    utility::Clock::set (time);
+
+    madara::knowledge::KnowledgeMap records;
+    records["pose"] = madara::knowledge::KnowledgeRecord (values);
+    encoder.filter (records, sending, vars);
+    shaper.filter (records, sending, vars);
+    sent += records.empty () ? 0 : 1;
+
+    decoder.filter (records, receiving, vars);
+    if (records.count ("pose"))
+    {
+      restored = records["pose"].to_doubles ();
+      ++received;
+    }
+  }
+
+  utility::Clock::set (0);
+
+  const Integer missing = vars.get (".delta.missing_keyframes").to_integer ();
+
+  double error = restored.size () == values.size () ? 0 : INFINITY;
+  for (size_t j = 0; j < restored.size () && j < values.size (); ++j)
+  {
+    error = std::max (error, fabs (restored[j] - values[j]));
+  }
+
+  printf ("%s: %d of %d sends restored, %lld expired, "
+    "%lld missing keyframes, final error %g\n", name, received, sent,
+    (long long)vars.get (".send.default.expired").to_integer (),
+    (long long)missing, error);
+
+  if (missing != 0)
+    fail (name, "deltas arrived without their keyframe");
+  if (!(error <= DEADBAND + 1e-9))
+    fail (name, "the receiver did not reach the vector");
+}
+
+int main (int argc, char ** argv)
+{
+  handle_arguments (argc, argv);
+  srand (1);
+
+  check ("unshaped", 0, 0);
+  check ("deferring", 2000, 0);
+  check ("deferring with deadline", 2000, 0.05);
+  check ("mostly expiring", 1000, 0.02);
+
+  printf ("%d of %d checks failed\n", failures, checks);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,411 @@
+/**
+ * Benchmarks the send and receive filters on synthetic packets. Each
+ * packet holds --records records of the --types given, spread over
+ * --senders agents, with values that drift from packet to packet. Every
+ * filter is run alone, and then the controller's send and receive chains
+ * are run whole, to report nanoseconds per record and heap allocations
+ * per call. Receive filters are fed packets encoded by the send chain, as
+ * they would arrive.
+ **/
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "madara/knowledge/KnowledgeBase.h"
+#include "madara/logger/GlobalLogger.h"
+#include "madara/utility/Utility.h"
+
+#include "filters/FilterChains.h"
+#include "filters/TrafficClasses.h"
+
+typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+// heap allocations made by the process, counted by operator new
+static std::atomic <uint64_t> allocations (0);
+
+void * operator new (size_t size)
+{
+  allocations.fetch_add (1, std::memory_order_relaxed);
+  if (void * result = std::malloc (size ? size : 1))
+    return result;
+  throw std::bad_alloc ();
+}
+
+void * operator new[] (size_t size)
+{
+  return operator new (size);
+}
+
+void operator delete (void * pointer) noexcept
+{
+  std::free (pointer);
+}
+
+void operator delete[] (void * pointer) noexcept
+{
+  std::free (pointer);
+}
+
+void operator delete (void * pointer, size_t) noexcept
+{
+  std::free (pointer);
+}
+
+void operator delete[] (void * pointer, size_t) noexcept
+{
+  std::free (pointer);
+}
+
+// benchmark settings
+std::string madara_commands;
+std::string types ("int,double,array,string,file");
+int records_per_packet (64);
+int senders (8);
+int binary_size (256);
+int elements (16);
+int iterations (20000);
+
+// distinct packets generated, cycled through by the iterations
+static const size_t PACKETS (256);
+
+void print_usage (char * prog_name)
+{
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+"\nProgram summary for %s:\n\n"
+"     Benchmarks the send and receive filters on synthetic packets\n"
+" [-b |--bytes num]             bytes per string and file record (def: 256)\n" \
+" [-e |--elements num]          elements per double array (def: 16)\n" \
+" [-i |--iterations num]        packets per filter (def: 20000)\n" \
+" [-M |--madara-file <file>]    file containing madara commands to execute\n" \
+"                               before the runs, e.g., filter settings\n" \
+" [-r |--records num]           records per packet (def: 64)\n" \
+" [-s |--senders num]           agents the records belong to (def: 8)\n" \
+" [-t |--types list]            comma separated record types to mix, of\n" \
+"                               int, double, array, string and file\n" \
+"                               (def: all)\n" \
+"\n",
+        prog_name);
+  exit (0);
+}
+
+/**
+ * Reads an integer argument
+ **/
+static void
+read_integer (int argc, char ** argv, int & i, int & value)
+{
+  if (i + 1 < argc && argv[i + 1][0] != '-')
+  {
+    std::stringstream buffer (argv[i + 1]);
+    buffer >> value;
+  }
+  else
+    print_usage (argv[0]);
+
+  ++i;
+}
+
+// handle command line arguments
+void handle_arguments (int argc, char ** argv)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg1 (argv[i]);
+
+    if (arg1 == "-b" || arg1 == "--bytes")
+    {
+      read_integer (argc, argv, i, binary_size);
+    }
+    else if (arg1 == "-e" || arg1 == "--elements")
+    {
+      read_integer (argc, argv, i, elements);
+    }
+    else if (arg1 == "-i" || arg1 == "--iterations")
+    {
+      read_integer (argc, argv, i, iterations);
+    }
+    else if (arg1 == "-M" || arg1 == "--madara-file")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        madara_commands += madara::utility::file_to_string (argv[i + 1]);
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-r" || arg1 == "--records")
+    {
+      read_integer (argc, argv, i, records_per_packet);
+    }
+    else if (arg1 == "-s" || arg1 == "--senders")
+    {
+      read_integer (argc, argv, i, senders);
+    }
+    else if (arg1 == "-t" || arg1 == "--types")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        types = argv[i + 1];
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else
+    {
+      print_usage (argv[0]);
+    }
+  }
+}
+
+/**
+ * A packet and the agent that sent it
+ **/
+struct Packet
+{
+  std::string originator;
+  madara::knowledge::KnowledgeMap records;
+};
+
+/**
+ * Generates packets whose values drift a little from one to the next
+ **/
+static bool
+generate (std::vector <Packet> & packets)
+{
+  std::vector <std::string> mix;
+  filters::TrafficClasses::split (types, mix);
+  if (mix.empty ())
+    return false;
+
+  packets.resize (PACKETS);
+  for (size_t p = 0; p < PACKETS; ++p)
+  {
+    const int sender = (int)(p % senders);
+    Packet & packet = packets[p];
+    packet.originator = "agent." + std::to_string (sender);
+
+    for (int r = 0; r < records_per_packet; ++r)
+    {
+      const std::string & type = mix[r % mix.size ()];
+      const std::string name = packet.originator + "." + type + "." +
+        std::to_string (r);
+      const double drift = std::sin (p * 0.05 + r);
+
+      madara::knowledge::KnowledgeRecord record;
+      if (type == "int")
+      {
+        record.set_value ((Integer)(p + r));
+      }
+      else if (type == "double")
+      {
+        record.set_value (drift);
+      }
+      else if (type == "array")
+      {
+        std::vector <double> values (elements);
+        for (int e = 0; e < elements; ++e)
+        {
+          values[e] = e + 0.01 * drift;
+        }
+        record.set_value (values);
+      }
+      else if (type == "string")
+      {
+        std::string value (binary_size, 'a');
+        for (int b = 0; b < binary_size; b += 16)
+        {
+          value[b] = (char)('a' + (p + b) % 26);
+        }
+        record.set_value (value);
+      }
+      else if (type == "file")
+      {
+        std::vector <unsigned char> value (binary_size);
+        for (int b = 0; b < binary_size; ++b)
+        {
+          value[b] = (unsigned char)((b * 7 + (b % 64 ? 0 : p)) & 0xff);
+        }
+        record.set_file (value.empty () ? 0 : &value[0], value.size ());
+      }
+      else
+      {
+        madara_logger_ptr_log (madara::logger::global_logger.get (),
+          madara::logger::LOG_ERROR,
+          "filter_benchmark: unknown record type %s\n", type.c_str ());
+        return false;
+      }
+
+      record.clock = p / senders + 1;
+      packet.records[name] = record;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Cost of running a filter or chain
+ **/
+struct Result
+{
+  double ns_per_record;
+  double allocations_per_call;
+  double records_out;
+};
+
+/**
+ * Runs filters in order over the packets, timing only the filters
+ **/
+static Result
+run (const std::vector <madara::filters::AggregateFilter *> & filters,
+  const std::vector <Packet> & packets, int64_t operation,
+  madara::knowledge::Variables & vars)
+{
+  int64_t nanoseconds = 0;
+  uint64_t allocated = 0;
+  uint64_t records_in = 0;
+  uint64_t records_out = 0;
+
+  for (int i = 0; i < iterations; ++i)
+  {
+    const Packet & packet = packets[i % packets.size ()];
+    madara::knowledge::KnowledgeMap records (packet.records);
+    madara::transport::TransportContext context (operation, 0, 0,
+      madara::utility::get_time (), madara::utility::get_time (),
+      "rislab", packet.originator);
+    records_in += records.size ();
+
+    const uint64_t allocations_before =
+      allocations.load (std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now ();
+
+    for (size_t f = 0; f < filters.size () && !records.empty (); ++f)
+    {
+      filters[f]->filter (records, context, vars);
+    }
+
+    nanoseconds += std::chrono::duration_cast <std::chrono::nanoseconds> (
+      std::chrono::steady_clock::now () - start).count ();
+    allocated += allocations.load (std::memory_order_relaxed) -
+      allocations_before;
+    records_out += records.size ();
+  }
+
+  Result result;
+  result.ns_per_record = records_in ? (double)nanoseconds / records_in : 0;
+  result.allocations_per_call = (double)allocated / iterations;
+  result.records_out = records_in ? (double)records_out / records_in : 0;
+  return result;
+}
+
+/**
+ * Prints one row of the report
+ **/
+static void
+report (const std::string & name, const Result & result)
+{
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+    "  %-26s %10.1f %12.1f %9.2f\n",
+    name.c_str (), result.ns_per_record, result.allocations_per_call,
+    result.records_out);
+}
+
+// perform main logic of program
+int main (int argc, char ** argv)
+{
+  handle_arguments (argc, argv);
+
+  if (records_per_packet <= 0 || senders <= 0 || iterations <= 0 ||
+    binary_size < 0 || elements < 0)
+  {
+    print_usage (argv[0]);
+  }
+
+  madara::knowledge::KnowledgeBase knowledge;
+  if (madara_commands != "")
+  {
+    knowledge.evaluate (madara_commands);
+  }
+  madara::knowledge::Variables vars (&knowledge.get_context ());
+
+  std::vector <Packet> packets;
+  if (!generate (packets))
+  {
+    print_usage (argv[0]);
+  }
+
+  // what the receive side sees: the packets after the send chain
+  std::vector <Packet> encoded;
+  {
+    filters::FilterChains chains;
+    const std::vector <madara::filters::AggregateFilter *> & chain =
+      chains.send;
+
+    for (size_t i = 0; i < packets.size (); ++i)
+    {
+      Packet packet (packets[i]);
+      madara::transport::TransportContext context (
+        madara::transport::TransportContext::SENDING_OPERATION, 0, 0,
+        madara::utility::get_time (), madara::utility::get_time (),
+        "rislab", packet.originator);
+
+      for (size_t f = 0; f < chain.size () && !packet.records.empty (); ++f)
+      {
+        chain[f]->filter (packet.records, context, vars);
+      }
+
+      if (!packet.records.empty ())
+        encoded.push_back (packet);
+    }
+
+    chains.destroy ();
+  }
+
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+    "filter_benchmark: %d packets of %d records (%s), %d senders\n"
+    "  filter                        ns/record  allocs/call    out/in\n",
+    iterations, records_per_packet, types.c_str (), senders);
+
+  const int64_t send = madara::transport::TransportContext::SENDING_OPERATION;
+  const int64_t receive =
+    madara::transport::TransportContext::RECEIVING_OPERATION;
+
+  // each filter alone, with fresh state
+  filters::FilterChains chains;
+  for (size_t i = 0; i < chains.send.size (); ++i)
+  {
+    std::vector <madara::filters::AggregateFilter *> single (1, chains.send[i]);
+    report (chains.send_names[i], run (single, packets, send, vars));
+  }
+  for (size_t i = 0; i < chains.receive.size () && !encoded.empty (); ++i)
+  {
+    std::vector <madara::filters::AggregateFilter *> single (
+      1, chains.receive[i]);
+    report (chains.receive_names[i], run (single, encoded, receive, vars));
+  }
+  chains.destroy ();
+
+  // the chains as the controller runs them
+  filters::FilterChains send_chains;
+  report ("send chain", run (send_chains.send, packets, send, vars));
+  send_chains.destroy ();
+
+  filters::FilterChains receive_chains;
+  if (!encoded.empty ())
+  {
+    report ("receive chain",
+      run (receive_chains.receive, encoded, receive, vars));
+  }
+  receive_chains.destroy ();
+
+  return 0;
+}
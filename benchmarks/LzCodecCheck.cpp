@@ -0,0 +1,185 @@
+/**
+ * Checks that utility::LzCodec blocks round trip: empty input,
+ * incompressible input, matches that overlap their own output, matches
+ * that run to the end of the input, and --iterations random inputs. Also
+ * checks that truncated blocks and sizes no block could expand to are
+ * rejected. Prints each failure and exits nonzero if there was one.
+ **/
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utility/LzCodec.h"
+
+typedef std::vector <unsigned char> Bytes;
+
+// check settings
+int iterations (2000);
+
+// checks run and failed
+static int checks (0);
+static int failures (0);
+
+void print_usage (char * prog_name)
+{
+  printf (
+"\nProgram summary for %s:\n\n"
+"     Checks that LzCodec blocks decompress to what was compressed\n"
+" [-i |--iterations num]        random inputs to check (def: 2000)\n"
+"\n",
+    prog_name);
+  exit (0);
+}
+
+// handle command line arguments
+void handle_arguments (int argc, char ** argv)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg1 (argv[i]);
+
+    if ((arg1 == "-i" || arg1 == "--iterations") &&
+      i + 1 < argc && argv[i + 1][0] != '-')
+    {
+      std::stringstream buffer (argv[i + 1]);
+      buffer >> iterations;
+      ++i;
+    }
+    else
+    {
+      print_usage (argv[0]);
+    }
+  }
+}
+
+/**
+ * Records a failed check
+ **/
+static void
+fail (const char * name, const char * what, size_t size)
+{
+  printf ("FAILED %s (%zu bytes): %s\n", name, size, what);
+  ++failures;
+}
+
+/**
+ * Compresses and decompresses an input, checking the result
+ * @param  name    the case, for failure messages
+ * @param  input   the input
+ * @return the compressed block
+ **/
+static Bytes
+round_trip (const char * name, const Bytes & input)
+{
+  ++checks;
+
+  const unsigned char * source = input.empty () ? 0 : &input[0];
+  Bytes block, output;
+
+  utility::LzCodec::compress (source, input.size (), block);
+
+  if (block.size () > utility::LzCodec::bound (input.size ()))
+    fail (name, "block is larger than bound", input.size ());
+  else if (!utility::LzCodec::decompress (
+    block.empty () ? 0 : &block[0], block.size (), output, input.size ()))
+    fail (name, "block was rejected", input.size ());
+  else if (output != input)
+    fail (name, "output differs from input", input.size ());
+
+  return block;
+}
+
+/**
+ * Checks that a malformed block is rejected
+ **/
+static void
+expect_rejected (const char * name, const Bytes & block, size_t size)
+{
+  ++checks;
+
+  Bytes output;
+  if (utility::LzCodec::decompress (
+    block.empty () ? 0 : &block[0], block.size (), output, size))
+    fail (name, "malformed block was accepted", size);
+}
+
+int main (int argc, char ** argv)
+{
+  handle_arguments (argc, argv);
+  srand (1);
+
+  // nothing to compress is a lone empty token
+  round_trip ("empty", Bytes ());
+
+  // random bytes are sent as literals, across the token nibble and the
+  // 255 steps of the extra length bytes
+  const size_t random_sizes[] = { 1, 3, 4, 14, 15, 16, 269, 270, 271, 4096 };
+  for (size_t i = 0; i < sizeof (random_sizes) / sizeof (size_t); ++i)
+  {
+    Bytes input (random_sizes[i]);
+    for (size_t j = 0; j < input.size (); ++j)
+      input[j] = (unsigned char)rand ();
+
+    round_trip ("incompressible", input);
+  }
+
+  // a run copies from one byte back, and short periods from two and
+  // three, so each match overlaps the output it is writing
+  const size_t periods[] = { 1, 2, 3 };
+  const size_t run_sizes[] = { 5, 19, 20, 274, 275, 65536 };
+  for (size_t p = 0; p < sizeof (periods) / sizeof (size_t); ++p)
+  {
+    for (size_t i = 0; i < sizeof (run_sizes) / sizeof (size_t); ++i)
+    {
+      Bytes input (run_sizes[i]);
+      for (size_t j = 0; j < input.size (); ++j)
+        input[j] = (unsigned char)('a' + j % periods[p]);
+
+      round_trip ("overlapping match", input);
+    }
+  }
+
+  // a repeat at the end leaves a last sequence with no literals
+  for (size_t tail = 4; tail < 300; tail += 37)
+  {
+    Bytes input (300);
+    for (size_t j = 0; j < input.size (); ++j)
+      input[j] = (unsigned char)rand ();
+    const Bytes head (input.begin (), input.begin () + tail);
+    input.insert (input.end (), head.begin (), head.end ());
+
+    const Bytes block = round_trip ("match to end", input);
+    if (block.empty () || block.back () != 0)
+      fail ("match to end", "last sequence has literals", input.size ());
+  }
+
+  // random mixes of literals and matches at every distance
+  for (int i = 0; i < iterations; ++i)
+  {
+    Bytes input (rand () % 5000);
+    const int alphabet = 1 + rand () % 255;
+    for (size_t j = 0; j < input.size (); ++j)
+      input[j] = (unsigned char)(rand () % alphabet);
+
+    const Bytes block = round_trip ("random", input);
+
+    // cutting off more than the empty last token loses bytes the size
+    // promised
+    if (block.size () > 2)
+    {
+      expect_rejected ("truncated", Bytes (block.begin (),
+        block.begin () + rand () % (block.size () - 1)), input.size ());
+    }
+  }
+
+  // a short block cannot claim a huge size, so no buffer is sized for it
+  Bytes block;
+  utility::LzCodec::compress ((const unsigned char *)"abcd", 4, block);
+  expect_rejected ("oversized", block, (size_t)1 << 40);
+
+  printf ("%d of %d checks failed\n", failures, checks);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+/**
+ * Benchmarks localization::ParticleFilter over a recorded scan sequence
+ * (see ScanSequence.h for the format). The sequence is tracked once per
+ * thread count from 1 to --threads to report likelihood throughput and
+ * scaling across cores. Without a map and recording, the synthetic room
+ * and trajectory from scan_matcher_benchmark are used.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "madara/logger/GlobalLogger.h"
+#include "madara/utility/Utility.h"
+
+#include "containers/LaserScan.h"
+#include "containers/OccupancyGrid.h"
+#include "localization/ParticleFilter.h"
+#include "utility/WorkerPool.h"
+
+#include "ScanSequence.h"
+
+using benchmarks::RecordedScan;
+
+// benchmark settings
+std::string map_file;
+std::string scans_file;
+double map_resolution (0.05);
+size_t threads (4);
+size_t particles (10000);
+int num_scans (200);
+bool global_start (false);
+
+void print_usage (char * prog_name)
+{
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+"\nProgram summary for %s:\n\n"
+"     Benchmarks particle filter localization over a scan sequence\n"
+" [-m |--map file.pgm]          occupancy map (P5 PGM, dark is occupied)\n" \
+" [-r |--resolution meters]     map resolution in meters per cell (def: 0.05)\n" \
+" [-s |--scans file]            recorded scan sequence to track\n" \
+" [-n |--num-scans num]         number of synthetic scans (def: 200)\n" \
+" [-p |--particles num]         number of particles (def: 10000)\n" \
+" [-t |--threads num]           most cores to evaluate with (def: 4)\n" \
+" [-g |--global]                start from a uniform distribution instead\n" \
+"                               of around the first known pose\n" \
+"\n",
+        prog_name);
+  exit (0);
+}
+
+// handle command line arguments
+void handle_arguments (int argc, char ** argv)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg1 (argv[i]);
+
+    if (arg1 == "-g" || arg1 == "--global")
+    {
+      global_start = true;
+    }
+    else if (arg1 == "-m" || arg1 == "--map")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        map_file = argv[i + 1];
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-n" || arg1 == "--num-scans")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> num_scans;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-p" || arg1 == "--particles")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> particles;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-r" || arg1 == "--resolution")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> map_resolution;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-s" || arg1 == "--scans")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        scans_file = argv[i + 1];
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-t" || arg1 == "--threads")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> threads;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else
+    {
+      print_usage (argv[0]);
+    }
+  }
+}
+
+/**
+ * Results of tracking the sequence once
+ **/
+struct Run
+{
+  double particles_per_second;
+  double update_ms;
+  double mean_error;
+  size_t resamples;
+};
+
+/**
+ * Tracks the sequence with a given number of threads
+ **/
+Run track (const containers::OccupancyGrid & grid,
+  const std::vector <RecordedScan> & scans, size_t concurrency)
+{
+  utility::WorkerPool pool (concurrency);
+  localization::ParticleFilter filter (&pool);
+  filter.set_map (grid);
+
+  if (global_start || !scans[0].has_truth)
+  {
+    filter.initialize_uniform (particles);
+  }
+  else
+  {
+    filter.initialize (particles, scans[0].truth, 0.2, 0.1);
+  }
+
+  Run run = {0.0, 0.0, 0.0, 0};
+  double throughput_sum = 0.0;
+  double update_sum = 0.0;
+  double error_sum = 0.0;
+  size_t error_count = 0;
+
+  for (size_t i = 0; i < scans.size (); ++i)
+  {
+    // odometry from the recorded truth, in the frame of the previous pose
+    if (i > 0 && scans[i].has_truth && scans[i - 1].has_truth)
+    {
+      const localization::Pose2D & from = scans[i - 1].truth;
+      const localization::Pose2D & to = scans[i].truth;
+      const double c = std::cos (from.yaw);
+      const double s = std::sin (from.yaw);
+      const double dx = to.x - from.x;
+      const double dy = to.y - from.y;
+
+      filter.predict (c * dx + s * dy, -s * dx + c * dy,
+        std::remainder (to.yaw - from.yaw, 2 * M_PI));
+    }
+
+    int64_t start = madara::utility::get_time ();
+    if (filter.update (scans[i].scan))
+    {
+      ++run.resamples;
+    }
+    update_sum += (madara::utility::get_time () - start) / 1000000.0;
+    throughput_sum += filter.get_particles_per_second ();
+
+    if (scans[i].has_truth)
+    {
+      const localization::Pose2D estimate = filter.estimate ();
+      error_sum += std::sqrt (
+        (estimate.x - scans[i].truth.x) * (estimate.x - scans[i].truth.x) +
+        (estimate.y - scans[i].truth.y) * (estimate.y - scans[i].truth.y));
+      ++error_count;
+    }
+  }
+
+  run.particles_per_second = throughput_sum / scans.size ();
+  run.update_ms = update_sum / scans.size ();
+  run.mean_error = error_count ? error_sum / error_count : 0.0;
+
+  return run;
+}
+
+// perform main logic of program
+int main (int argc, char ** argv)
+{
+  handle_arguments (argc, argv);
+
+  containers::OccupancyGrid grid;
+  std::vector <RecordedScan> scans;
+
+  if (map_file != "")
+  {
+    if (!benchmarks::load_map (map_file, map_resolution, grid))
+    {
+      madara_logger_ptr_log (madara::logger::global_logger.get (),
+        madara::logger::LOG_ERROR,
+        "particle_filter_benchmark: unable to load map %s\n",
+        map_file.c_str ());
+      return -1;
+    }
+  }
+  else
+  {
+    benchmarks::synthesize_map (map_resolution, grid);
+  }
+
+  if (scans_file != "")
+  {
+    if (!benchmarks::load_scans (scans_file, scans))
+    {
+      madara_logger_ptr_log (madara::logger::global_logger.get (),
+        madara::logger::LOG_ERROR,
+        "particle_filter_benchmark: unable to load scans %s\n",
+        scans_file.c_str ());
+      return -1;
+    }
+  }
+  else if (map_file == "")
+  {
+    benchmarks::synthesize_scans (grid, num_scans, 10.0, scans);
+  }
+
+  if (scans.empty () || particles == 0 || threads == 0)
+  {
+    print_usage (argv[0]);
+  }
+
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+    "particle_filter_benchmark: %d scans, %dx%d map, %d particles\n"
+    "  threads   particles/s    update ms   speedup   error m   resamples\n",
+    (int)scans.size (), grid.width, grid.height, (int)particles);
+
+  double baseline = 0.0;
+
+  for (size_t concurrency = 1; concurrency <= threads; ++concurrency)
+  {
+    const Run run = track (grid, scans, concurrency);
+
+    if (concurrency == 1)
+    {
+      baseline = run.particles_per_second;
+    }
+
+    madara_logger_ptr_log (madara::logger::global_logger.get (),
+      madara::logger::LOG_ALWAYS,
+      "  %7d   %11.0f   %10.3f   %7.2f   %7.3f   %9d\n",
+      (int)concurrency, run.particles_per_second, run.update_ms,
+      baseline > 0 ? run.particles_per_second / baseline : 0.0,
+      run.mean_error, (int)run.resamples);
+  }
+
+  return 0;
+}
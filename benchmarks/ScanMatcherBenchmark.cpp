@@ -0,0 +1,273 @@
+
+/**
+ * Benchmarks localization::ScanMatcher over a recorded scan sequence (see
+ * ScanSequence.h for the format). Without a map and recording, a synthetic
+ * room and trajectory are generated, and --record saves that sequence for
+ * reuse.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "madara/logger/GlobalLogger.h"
+#include "madara/utility/Utility.h"
+
+#include "containers/LaserScan.h"
+#include "containers/OccupancyGrid.h"
+#include "localization/ScanMatcher.h"
+#include "utility/WorkerPool.h"
+
+#include "ScanSequence.h"
+
+using benchmarks::RecordedScan;
+
+// benchmark settings
+std::string map_file;
+std::string scans_file;
+std::string record_file;
+double map_resolution (0.05);
+size_t threads (4);
+double scan_hertz (10.0);
+int num_scans (200);
+
+void print_usage (char * prog_name)
+{
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+"\nProgram summary for %s:\n\n"
+"     Benchmarks scan-to-map matching over a scan sequence\n"
+" [-m |--map file.pgm]          occupancy map (P5 PGM, dark is occupied)\n" \
+" [-r |--resolution meters]     map resolution in meters per cell (def: 0.05)\n" \
+" [-s |--scans file]            recorded scan sequence to match\n" \
+" [-n |--num-scans num]         number of synthetic scans (def: 200)\n" \
+" [-t |--threads num]           cores to match with (def: 4)\n" \
+" [-z |--hertz hz]              scan rate to compare against (def: 10)\n" \
+" [--record file]               save the synthetic sequence to a file\n" \
+"\n",
+        prog_name);
+  exit (0);
+}
+
+// handle command line arguments
+void handle_arguments (int argc, char ** argv)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg1 (argv[i]);
+
+    if (arg1 == "-m" || arg1 == "--map")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        map_file = argv[i + 1];
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-n" || arg1 == "--num-scans")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> num_scans;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-r" || arg1 == "--resolution")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> map_resolution;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "--record")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        record_file = argv[i + 1];
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-s" || arg1 == "--scans")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        scans_file = argv[i + 1];
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-t" || arg1 == "--threads")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> threads;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-z" || arg1 == "--hertz")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> scan_hertz;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else
+    {
+      print_usage (argv[0]);
+    }
+  }
+}
+
+// perform main logic of program
+int main (int argc, char ** argv)
+{
+  handle_arguments (argc, argv);
+
+  containers::OccupancyGrid grid;
+  std::vector <RecordedScan> scans;
+
+  if (map_file != "")
+  {
+    if (!benchmarks::load_map (map_file, map_resolution, grid))
+    {
+      madara_logger_ptr_log (madara::logger::global_logger.get (),
+        madara::logger::LOG_ERROR,
+        "scan_matcher_benchmark: unable to load map %s\n", map_file.c_str ());
+      return -1;
+    }
+  }
+  else
+  {
+    benchmarks::synthesize_map (map_resolution, grid);
+  }
+
+  if (scans_file != "")
+  {
+    if (!benchmarks::load_scans (scans_file, scans))
+    {
+      madara_logger_ptr_log (madara::logger::global_logger.get (),
+        madara::logger::LOG_ERROR,
+        "scan_matcher_benchmark: unable to load scans %s\n",
+        scans_file.c_str ());
+      return -1;
+    }
+  }
+  else if (map_file == "")
+  {
+    benchmarks::synthesize_scans (grid, num_scans, scan_hertz, scans);
+
+    if (record_file != "")
+    {
+      benchmarks::save_scans (record_file, scans);
+    }
+  }
+
+  if (scans.empty ())
+  {
+    print_usage (argv[0]);
+  }
+
+  utility::WorkerPool pool (threads);
+  localization::ScanMatcher matcher (&pool);
+
+  int64_t start = madara::utility::get_time ();
+  matcher.set_map (grid);
+  double precompute_ms = (madara::utility::get_time () - start) / 1000000.0;
+
+  // track the sequence, seeding with the first known pose
+  localization::Pose2D guess = {0.0, 0.0, 0.0};
+  if (scans[0].has_truth)
+  {
+    guess = scans[0].truth;
+  }
+
+  std::vector <double> latencies;
+  double error_sum = 0.0;
+  size_t error_count = 0;
+  size_t failures = 0;
+
+  for (size_t i = 0; i < scans.size (); ++i)
+  {
+    localization::Pose2D result;
+
+    start = madara::utility::get_time ();
+    double score = matcher.match (scans[i].scan, guess, result);
+    latencies.push_back ((madara::utility::get_time () - start) / 1000000.0);
+
+    if (score > 0)
+    {
+      guess = result;
+    }
+    else
+    {
+      ++failures;
+    }
+
+    if (scans[i].has_truth)
+    {
+      error_sum += std::sqrt (
+        (result.x - scans[i].truth.x) * (result.x - scans[i].truth.x) +
+        (result.y - scans[i].truth.y) * (result.y - scans[i].truth.y));
+      ++error_count;
+    }
+  }
+
+  const double period_ms = 1000.0 / scan_hertz;
+  size_t late = 0;
+  double total = 0.0;
+  for (size_t i = 0; i < latencies.size (); ++i)
+  {
+    total += latencies[i];
+    if (latencies[i] > period_ms)
+    {
+      ++late;
+    }
+  }
+
+  std::sort (latencies.begin (), latencies.end ());
+
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+    "scan_matcher_benchmark: %d scans, %dx%d map, %d threads\n"
+    "  precompute:  %.2f ms\n"
+    "  match:       %.3f ms mean, %.3f ms p50, %.3f ms p99, %.3f ms max\n"
+    "  throughput:  %.1f matches/s\n"
+    "  at %.1f Hz:  %d of %d matches exceeded the %.1f ms scan period\n"
+    "  failures:    %d\n"
+    "  mean error:  %.3f m\n",
+    (int)scans.size (), grid.width, grid.height, (int)pool.size (),
+    precompute_ms,
+    total / latencies.size (),
+    latencies[latencies.size () / 2],
+    latencies[latencies.size () * 99 / 100],
+    latencies.back (),
+    1000.0 * latencies.size () / total,
+    scan_hertz, (int)late, (int)latencies.size (), period_ms,
+    (int)failures,
+    error_count ? error_sum / error_count : 0.0);
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+
+#include "ScanSequence.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+bool
+benchmarks::load_map (const std::string & filename, double resolution,
+  containers::OccupancyGrid & grid)
+{
+  std::ifstream input (filename.c_str (), std::ios::binary);
+  std::string magic;
+  int width = 0, height = 0, max_value = 0;
+
+  input >> magic;
+  while (input >> std::ws && input.peek () == '#')
+  {
+    std::string comment;
+    std::getline (input, comment);
+  }
+  input >> width >> height >> max_value;
+  input.get ();
+
+  if (!input || magic != "P5" || width <= 0 || height <= 0 || max_value > 255)
+  {
+    return false;
+  }
+
+  grid.resize (width, height, resolution, 0.0, 0.0);
+
+  std::vector <unsigned char> pixels ((size_t)width * height);
+  input.read ((char *)pixels.data (), pixels.size ());
+
+  // PGM rows go top to bottom, grid rows go up in y
+  for (int y = 0; y < height; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      const double shade =
+        pixels[(size_t)(height - 1 - y) * width + x] / (double)max_value;
+
+      grid.set (x, y, shade < 0.35 ? 255 :
+        shade > 0.65 ? 0 : containers::OccupancyGrid::UNKNOWN);
+    }
+  }
+
+  return (bool)input;
+}
+
+bool
+benchmarks::load_scans (const std::string & filename,
+  std::vector <RecordedScan> & scans)
+{
+  std::ifstream input (filename.c_str ());
+  std::string line;
+
+  localization::Pose2D truth = {0.0, 0.0, 0.0};
+  bool has_truth = false;
+
+  while (std::getline (input, line))
+  {
+    std::stringstream buffer (line);
+    std::string type;
+    buffer >> type;
+
+    if (type == "pose")
+    {
+      buffer >> truth.x >> truth.y >> truth.yaw;
+      has_truth = true;
+    }
+    else if (type == "scan")
+    {
+      RecordedScan recorded;
+      size_t count = 0;
+
+      buffer >> recorded.scan.timestamp >> recorded.scan.angle_min >>
+        recorded.scan.angle_increment >> recorded.scan.range_max >> count;
+
+      recorded.scan.ranges.resize (count);
+      for (size_t i = 0; i < count; ++i)
+      {
+        buffer >> recorded.scan.ranges[i];
+      }
+
+      if (!buffer)
+      {
+        return false;
+      }
+
+      recorded.truth = truth;
+      recorded.has_truth = has_truth;
+      has_truth = false;
+
+      scans.push_back (recorded);
+    }
+  }
+
+  return !scans.empty ();
+}
+
+void
+benchmarks::synthesize_map (double resolution,
+  containers::OccupancyGrid & grid)
+{
+  const int size = (int)(22.0 / resolution);
+  grid.resize (size, size, resolution, -11.0, -11.0);
+
+  for (int y = 0; y < size; ++y)
+  {
+    for (int x = 0; x < size; ++x)
+    {
+      const double wx = grid.origin_x + (x + 0.5) * resolution;
+      const double wy = grid.origin_y + (y + 0.5) * resolution;
+
+      const bool wall = std::fabs (wx) > 10.0 || std::fabs (wy) > 10.0;
+      const bool column = wx > 7.0 && wx < 8.0 && wy > -1.0 && wy < 4.0;
+      const bool crate = wx > -6.0 && wx < -4.0 && wy > 5.0 && wy < 7.0;
+      const bool shelf = wx > -2.0 && wx < 6.0 && wy > -7.0 && wy < -6.5;
+
+      grid.set (x, y, wall || column || crate || shelf ? 255 : 0);
+    }
+  }
+}
+
+containers::LaserScan
+benchmarks::cast_scan (const containers::OccupancyGrid & grid,
+  const localization::Pose2D & pose, int64_t timestamp)
+{
+  containers::LaserScan scan;
+  scan.timestamp = timestamp;
+  scan.angle_min = -M_PI;
+  scan.angle_increment = 2 * M_PI / 720;
+  scan.range_max = 30.0;
+
+  const double step = grid.resolution / 2;
+
+  for (int i = 0; i < 720; ++i)
+  {
+    const double angle = pose.yaw + scan.angle_min + i * scan.angle_increment;
+    double range = step;
+
+    for (; range < scan.range_max; range += step)
+    {
+      int cx, cy;
+      grid.world_to_cell (pose.x + range * std::cos (angle),
+        pose.y + range * std::sin (angle), cx, cy);
+
+      if (!grid.contains (cx, cy) ||
+        grid.get (cx, cy) >= containers::OccupancyGrid::OCCUPIED_THRESHOLD)
+      {
+        break;
+      }
+    }
+
+    scan.ranges.push_back ((float)range);
+  }
+
+  return scan;
+}
+
+void
+benchmarks::synthesize_scans (const containers::OccupancyGrid & grid,
+  int count, double hertz, std::vector <RecordedScan> & scans)
+{
+  for (int i = 0; i < count; ++i)
+  {
+    const double t = 2 * M_PI * i / count;
+
+    RecordedScan recorded;
+    recorded.truth.x = 6.0 * std::sin (t);
+    recorded.truth.y = 3.0 * std::sin (2 * t);
+    recorded.truth.yaw =
+      std::atan2 (6.0 * std::cos (2 * t), 6.0 * std::cos (t));
+    recorded.has_truth = true;
+    recorded.scan = cast_scan (grid, recorded.truth,
+      (int64_t)(i * 1000000000.0 / hertz));
+
+    scans.push_back (recorded);
+  }
+}
+
+void
+benchmarks::save_scans (const std::string & filename,
+  const std::vector <RecordedScan> & scans)
+{
+  std::ofstream output (filename.c_str ());
+
+  output << "# synthetic localization benchmark sequence\n";
+
+  for (size_t i = 0; i < scans.size (); ++i)
+  {
+    const RecordedScan & recorded = scans[i];
+
+    if (recorded.has_truth)
+    {
+      output << "pose " << recorded.truth.x << " " << recorded.truth.y <<
+        " " << recorded.truth.yaw << "\n";
+    }
+
+    output << "scan " << recorded.scan.timestamp << " " <<
+      recorded.scan.angle_min << " " << recorded.scan.angle_increment <<
+      " " << recorded.scan.range_max << " " << recorded.scan.ranges.size ();
+
+    for (size_t j = 0; j < recorded.scan.ranges.size (); ++j)
+    {
+      output << " " << recorded.scan.ranges[j];
+    }
+    output << "\n";
+  }
+}
@@ -0,0 +1,93 @@
+
+#ifndef   _BENCHMARKS_SCANSEQUENCE_H_
+#define   _BENCHMARKS_SCANSEQUENCE_H_
+
+#include <string>
+#include <vector>
+
+#include "containers/LaserScan.h"
+#include "containers/OccupancyGrid.h"
+#include "localization/ScanMatcher.h"
+
+/**
+ * Maps and scan sequences shared by the localization benchmarks.
+ *
+ * Recordings are text files. Blank lines and lines starting with '#' are
+ * ignored. Every other line is one of:
+ *
+ *   pose <x> <y> <yaw>
+ *   scan <timestamp_ns> <angle_min> <angle_increment> <range_max> <n> <r0> ... <rn-1>
+ *
+ * A pose line gives the true pose for the scan that follows it and is only
+ * used to report error.
+ **/
+namespace benchmarks
+{
+  /**
+   * A scan and, if known, where it was taken from
+   **/
+  struct RecordedScan
+  {
+    containers::LaserScan scan;
+    localization::Pose2D truth;
+    bool has_truth;
+  };
+
+  /**
+   * Loads a binary PGM. Dark cells are occupied, light cells are free and
+   * anything in between is unknown (the ROS map_server convention).
+   * @param  filename    the P5 PGM file
+   * @param  resolution  meters per cell
+   * @param  grid        the loaded map
+   * @return true if the map was loaded
+   **/
+  bool load_map (const std::string & filename, double resolution,
+    containers::OccupancyGrid & grid);
+
+  /**
+   * Loads a recorded scan sequence
+   * @param  filename    the recording
+   * @param  scans       the loaded scans
+   * @return true if at least one scan was loaded
+   **/
+  bool load_scans (const std::string & filename,
+    std::vector <RecordedScan> & scans);
+
+  /**
+   * Saves a scan sequence in the recording format
+   * @param  filename    the recording to write
+   * @param  scans       the scans to save
+   **/
+  void save_scans (const std::string & filename,
+    const std::vector <RecordedScan> & scans);
+
+  /**
+   * Builds a 20x20m walled room with a few obstacles
+   * @param  resolution  meters per cell
+   * @param  grid        the synthesized map
+   **/
+  void synthesize_map (double resolution, containers::OccupancyGrid & grid);
+
+  /**
+   * Ray casts a 360 degree scan through a grid
+   * @param  grid        the map to cast through
+   * @param  pose        where the scan is taken from
+   * @param  timestamp   the scan timestamp in nanoseconds
+   * @return the simulated scan
+   **/
+  containers::LaserScan cast_scan (const containers::OccupancyGrid & grid,
+    const localization::Pose2D & pose, int64_t timestamp);
+
+  /**
+   * Drives a figure-eight through the synthetic room
+   * @param  grid        the synthesized map
+   * @param  count       number of scans over one lap
+   * @param  hertz       scan rate, for timestamps
+   * @param  scans       the synthesized scans
+   **/
+  void synthesize_scans (const containers::OccupancyGrid & grid,
+    int count, double hertz, std::vector <RecordedScan> & scans);
+
+} // end benchmarks namespace
+
+#endif // _BENCHMARKS_SCANSEQUENCE_H_
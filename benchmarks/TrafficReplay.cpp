@@ -0,0 +1,254 @@
+/**
+ * Replays a capture made with the controller's --capture option through
+ * the receive filters and into a knowledge base, without a network.
+ * Packets are fed at the captured pace times --speed, or as fast as
+ * possible with a speed of 0, to report records per second and the
+ * latency of filtering and applying each packet. The filters run on the
+ * captured time (see utility::Clock), so their rates and timers behave
+ * as they did live at any speed.
+ **/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "madara/knowledge/KnowledgeBase.h"
+#include "madara/logger/GlobalLogger.h"
+#include "madara/utility/Utility.h"
+
+#include "filters/FilterChains.h"
+#include "utility/CaptureLog.h"
+#include "utility/Clock.h"
+
+// benchmark settings
+std::string capture_file;
+std::string madara_commands;
+double speed (1.0);
+int repeat (1);
+
+void print_usage (char * prog_name)
+{
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+"\nProgram summary for %s:\n\n"
+"     Replays captured traffic through the receive filters\n"
+" [-c |--capture file]          capture made with controller --capture\n" \
+" [-M |--madara-file <file>]    file containing madara commands to execute\n" \
+"                               before replay, e.g., filter settings\n" \
+" [-r |--repeat num]            number of times to replay (def: 1)\n" \
+" [-s |--speed factor]          multiple of the captured pace, 0 for as\n" \
+"                               fast as possible (def: 1)\n" \
+"\n",
+        prog_name);
+  exit (0);
+}
+
+// handle command line arguments
+void handle_arguments (int argc, char ** argv)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg1 (argv[i]);
+
+    if (arg1 == "-c" || arg1 == "--capture")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        capture_file = argv[i + 1];
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-M" || arg1 == "--madara-file")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        madara_commands += madara::utility::file_to_string (argv[i + 1]);
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-r" || arg1 == "--repeat")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> repeat;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "-s" || arg1 == "--speed")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> speed;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else
+    {
+      print_usage (argv[0]);
+    }
+  }
+}
+
+/**
+ * Returns a percentile of sorted latencies in microseconds
+ **/
+static double
+percentile (const std::vector <int64_t> & sorted, double fraction)
+{
+  if (sorted.empty ())
+    return 0.0;
+
+  size_t index = (size_t)(fraction * (sorted.size () - 1) + 0.5);
+  return sorted[index] / 1000.0;
+}
+
+// perform main logic of program
+int main (int argc, char ** argv)
+{
+  handle_arguments (argc, argv);
+
+  utility::CaptureReader reader;
+  if (capture_file == "" || repeat <= 0 || speed < 0)
+  {
+    print_usage (argv[0]);
+  }
+
+  if (!reader.open (capture_file))
+  {
+    madara_logger_ptr_log (madara::logger::global_logger.get (),
+      madara::logger::LOG_ERROR,
+      "traffic_replay: unable to open capture %s\n",
+      capture_file.c_str ());
+    return -1;
+  }
+
+  madara::knowledge::KnowledgeBase knowledge;
+  if (madara_commands != "")
+  {
+    knowledge.evaluate (madara_commands);
+  }
+
+  // the receive filters of the controller. The knowledge base has no
+  // transport, so NACKs are never sent.
+  filters::FilterChains chains;
+  const std::vector <madara::filters::AggregateFilter *> & chain =
+    chains.receive;
+
+  madara::knowledge::Variables vars (&knowledge.get_context ());
+  madara::knowledge::KnowledgeUpdateSettings settings;
+
+  std::vector <int64_t> filter_times;
+  std::vector <int64_t> apply_times;
+  int64_t records_in = 0;
+  int64_t records_applied = 0;
+
+  const int64_t start = utility::now ();
+
+  // added to captured times, so each pass carries on from the last
+  int64_t time_offset = 0;
+
+  for (int pass = 0; pass < repeat; ++pass)
+  {
+    reader.rewind ();
+
+    utility::CaptureEntry entry;
+    int64_t first_time = 0;
+    int64_t last_time = 0;
+    const int64_t pass_start = utility::now ();
+
+    for (bool first = true; reader.next (entry); first = false)
+    {
+      if (first)
+        first_time = entry.time;
+
+      // the wall clock of the capture may have stepped back
+      last_time = std::max (last_time, entry.time);
+      utility::Clock::set (last_time + time_offset);
+
+      if (speed > 0)
+      {
+        const int64_t due = pass_start +
+          (int64_t)((entry.time - first_time) / speed);
+        const int64_t wait = due - utility::now ();
+        if (wait > 0)
+          std::this_thread::sleep_for (std::chrono::nanoseconds (wait));
+      }
+
+      madara::transport::TransportContext context (
+        madara::transport::TransportContext::RECEIVING_OPERATION,
+        entry.receive_bandwidth, entry.send_bandwidth,
+        entry.message_time, madara::utility::get_time (),
+        entry.domain, entry.originator);
+
+      records_in += entry.records.size ();
+
+      int64_t mark = utility::now ();
+      for (size_t i = 0; i < chain.size () && !entry.records.empty (); ++i)
+      {
+        chain[i]->filter (entry.records, context, vars);
+      }
+      filter_times.push_back (utility::now () - mark);
+
+      mark = utility::now ();
+      for (madara::knowledge::KnowledgeMap::const_iterator i =
+        entry.records.begin (); i != entry.records.end (); ++i)
+      {
+        knowledge.get_context ().update_record_from_external (
+          i->first, i->second, settings);
+      }
+      apply_times.push_back (utility::now () - mark);
+
+      records_applied += entry.records.size ();
+    }
+
+    time_offset += last_time - first_time + 1;
+  }
+
+  utility::Clock::set (0);
+  const double seconds = (utility::now () - start) / 1e9;
+
+  chains.destroy ();
+
+  if (filter_times.empty ())
+  {
+    madara_logger_ptr_log (madara::logger::global_logger.get (),
+      madara::logger::LOG_ERROR,
+      "traffic_replay: %s has no packets\n", capture_file.c_str ());
+    return -1;
+  }
+
+  const size_t packets = filter_times.size ();
+  std::sort (filter_times.begin (), filter_times.end ());
+  std::sort (apply_times.begin (), apply_times.end ());
+
+  madara_logger_ptr_log (madara::logger::global_logger.get (),
+    madara::logger::LOG_ALWAYS,
+    "traffic_replay: %d packets, %d records in, %d applied in %.3f s\n"
+    "  records/s: %.0f in, %.0f applied\n"
+    "             p50 us    p99 us    max us\n"
+    "  filter   %8.1f  %8.1f  %8.1f\n"
+    "  apply    %8.1f  %8.1f  %8.1f\n",
+    (int)packets, (int)records_in, (int)records_applied, seconds,
+    seconds > 0 ? records_in / seconds : 0.0,
+    seconds > 0 ? records_applied / seconds : 0.0,
+    percentile (filter_times, 0.5), percentile (filter_times, 0.99),
+    percentile (filter_times, 1.0),
+    percentile (apply_times, 0.5), percentile (apply_times, 0.99),
+    percentile (apply_times, 1.0));
+
+  return 0;
+}
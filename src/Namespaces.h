@@ -33,6 +33,14 @@ namespace filters
 {
 }
 
+/**
+ * @namespace localization
+ * Contains localization methods for GPS-denied flight
+ **/
+namespace localization
+{
+}
+
 /**
  * @namespace platforms
  * Contains platform drivers and platform threads
@@ -56,5 +64,13 @@ namespace threads
 {
 }
 
+/**
+ * @namespace utility
+ * Contains helpers shared by threads, filters and algorithms
+ **/
+namespace utility
+{
+}
+
 #endif
 
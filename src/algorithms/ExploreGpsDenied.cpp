@@ -61,6 +61,10 @@ algorithms::ExploreGpsDenied::ExploreGpsDenied (
 {
   status_.init_vars (*knowledge, "ExploreGpsDenied", self->agent.prefix);
   status_.init_variable_values ();
+
+  analyze_profile_.init ("mape.analyze", *knowledge);
+  plan_profile_.init ("mape.plan", *knowledge);
+  execute_profile_.init ("mape.execute", *knowledge);
 }
 
 algorithms::ExploreGpsDenied::~ExploreGpsDenied ()
@@ -70,6 +74,8 @@ algorithms::ExploreGpsDenied::~ExploreGpsDenied ()
 int
 algorithms::ExploreGpsDenied::analyze (void)
 {
+  utility::ScopedProfile timing (analyze_profile_);
+
   return 0;
 }
       
@@ -77,6 +83,8 @@ algorithms::ExploreGpsDenied::analyze (void)
 int
 algorithms::ExploreGpsDenied::execute (void)
 {
+  utility::ScopedProfile timing (execute_profile_);
+
   return 0;
 }
 
@@ -84,5 +92,7 @@ algorithms::ExploreGpsDenied::execute (void)
 int
 algorithms::ExploreGpsDenied::plan (void)
 {
+  utility::ScopedProfile timing (plan_profile_);
+
   return 0;
 }
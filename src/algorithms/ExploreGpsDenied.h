@@ -12,6 +12,7 @@
 #include "gams/variables/Self.h"
 #include "gams/algorithms/BaseAlgorithm.h"
 #include "gams/algorithms/AlgorithmFactory.h"
+#include "../utility/ExecutionProfile.h"
 
 namespace algorithms
 {
@@ -57,6 +58,12 @@ namespace algorithms
      * @return bitmask status of the platform. @see Status.
      **/
     virtual int plan (void);
+
+  private:
+    /// timing of the MAPE loop's analyze, plan and execute phases
+    utility::ExecutionProfile analyze_profile_;
+    utility::ExecutionProfile plan_profile_;
+    utility::ExecutionProfile execute_profile_;
   };
 
   /**
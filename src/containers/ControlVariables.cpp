@@ -1,7 +1,7 @@
 
 #include "ControlVariables.h"
 
-#include "madara/knowledge/ContextGuard.h"
+#include "../utility/LockProfiler.h"
 
 containers::ControlVariables::ControlVariables ()
 : context_ (0)
@@ -24,6 +24,11 @@ containers::ControlVariables::init (madara::knowledge::KnowledgeBase & knowledge
   orientation_.set_name (".orientation", knowledge);
   position_.set_name (".position", knowledge);
   controls_clock_.set_name (".controls_clock", knowledge);
+  autonomy_command_.set_name (".controls.autonomy_command", knowledge);
+  command_.set_name (".controls.command", knowledge);
+  command_source_.set_name (".controls.source", knowledge);
+  teleop_latency_.set_name (".teleop.latency", knowledge);
+  teleop_max_latency_.set_name (".teleop.max_latency", knowledge);
 }
 
 void
@@ -32,13 +37,19 @@ containers::ControlVariables::read (void)
   if (context_)
   {
     // lock the context for consistency
-    madara::knowledge::ContextGuard guard (*context_);
+    utility::ProfiledGuard guard (*context_,
+      UTILITY_LOCK_SITE ("ControlVariables::read"));
 
     // update user-facing variables. DO NOT REMOVE COMMENT
     imu_sigma_accel = imu_sigma_accel_.to_record ().to_doubles ();
     orientation = orientation_.to_record ().to_doubles ();
     position = position_.to_record ().to_doubles ();
     controls_clock = *controls_clock_;
+    autonomy_command = autonomy_command_.to_record ().to_doubles ();
+    command = command_.to_record ().to_doubles ();
+    command_source = *command_source_;
+    teleop_latency = *teleop_latency_;
+    teleop_max_latency = *teleop_max_latency_;
   }
 }
 
@@ -48,13 +59,19 @@ containers::ControlVariables::write (void)
   if (context_)
   {
     // lock the context for consistency
-    madara::knowledge::ContextGuard guard (*context_);
+    utility::ProfiledGuard guard (*context_,
+      UTILITY_LOCK_SITE ("ControlVariables::write"));
 
     // update knowledge base. DO NOT REMOVE COMMENT
     imu_sigma_accel_.set (imu_sigma_accel);
     orientation_.set (orientation);
     position_.set (position);
     controls_clock_ = controls_clock;
+    autonomy_command_.set (autonomy_command);
+    command_.set (command);
+    command_source_ = command_source;
+    teleop_latency_ = teleop_latency;
+    teleop_max_latency_ = teleop_max_latency;
   }
 }
 
@@ -66,5 +83,10 @@ containers::ControlVariables::modify (void)
   orientation_.modify ();
   position_.modify ();
   controls_clock_.modify ();
+  autonomy_command_.modify ();
+  command_.modify ();
+  command_source_.modify ();
+  teleop_latency_.modify ();
+  teleop_max_latency_.modify ();
 }
 
@@ -67,6 +67,21 @@ namespace containers
     /// a vector clock to count executions
     int controls_clock;
 
+    /// velocity x, y, z and yaw rate requested by autonomy
+    std::vector<double> autonomy_command;
+
+    /// velocity x, y, z and yaw rate applied on the last tick
+    std::vector<double> command;
+
+    /// where command came from: "autonomy" or "teleop"
+    std::string command_source;
+
+    /// seconds from a teleop command entering the KB to being applied
+    double teleop_latency;
+
+    /// worst teleop_latency seen
+    double teleop_max_latency;
+
   private:
 
     /// imu_sigma_accel that directly interfaces to the KnowledgeBase
@@ -81,6 +96,21 @@ namespace containers
     /// controls_clock that directly interfaces to the KnowledgeBase
     madara::knowledge::containers::Integer controls_clock_;
 
+    /// autonomy_command that directly interfaces to the KnowledgeBase
+    madara::knowledge::containers::NativeDoubleArray autonomy_command_;
+
+    /// command that directly interfaces to the KnowledgeBase
+    madara::knowledge::containers::NativeDoubleArray command_;
+
+    /// command_source that directly interfaces to the KnowledgeBase
+    madara::knowledge::containers::String command_source_;
+
+    /// teleop_latency that directly interfaces to the KnowledgeBase
+    madara::knowledge::containers::Double teleop_latency_;
+
+    /// teleop_max_latency that directly interfaces to the KnowledgeBase
+    madara::knowledge::containers::Double teleop_max_latency_;
+
 
     /// unmanaged context for locking. The knowledge base should stay in scope
     madara::knowledge::ThreadSafeContext * context_;
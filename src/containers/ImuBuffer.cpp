@@ -0,0 +1,109 @@
+
+#include "ImuBuffer.h"
+
+containers::ImuBuffer::ImuBuffer (size_t capacity)
+: mask_ (0), head_ (0), overflows_ (0),
+  tail_ (0), drops_ (0), high_water_ (0), last_timestamp_ (0)
+{
+  if (capacity < MIN_CAPACITY)
+    capacity = MIN_CAPACITY;
+  else if (capacity > MAX_CAPACITY)
+    capacity = MAX_CAPACITY;
+
+  // round up to a power of two so wrapping is a mask instead of a modulo
+  size_t rounded = 1;
+  while (rounded < capacity)
+  {
+    rounded <<= 1;
+  }
+
+  samples_.resize (rounded);
+  mask_ = rounded - 1;
+}
+
+bool
+containers::ImuBuffer::push (const ImuSample & sample)
+{
+  const size_t head = head_.load (std::memory_order_relaxed);
+  const size_t tail = tail_.load (std::memory_order_acquire);
+
+  // a full buffer rejects the newest sample. The consumer owns tail_.
+  if (head - tail > mask_)
+  {
+    overflows_.fetch_add (1, std::memory_order_relaxed);
+    return false;
+  }
+
+  samples_[head & mask_] = sample;
+
+  // publish the sample to the consumer
+  head_.store (head + 1, std::memory_order_release);
+
+  return true;
+}
+
+size_t
+containers::ImuBuffer::pop_batch (ImuSample * dest, size_t max_samples)
+{
+  size_t tail = tail_.load (std::memory_order_relaxed);
+  const size_t head = head_.load (std::memory_order_acquire);
+
+  const size_t available = head - tail;
+  if (available > high_water_.load (std::memory_order_relaxed))
+  {
+    high_water_.store (available, std::memory_order_relaxed);
+  }
+
+  size_t count = 0;
+
+  for (; tail != head && count < max_samples; ++tail)
+  {
+    const ImuSample & sample = samples_[tail & mask_];
+
+    // integration needs strictly increasing time, so discard stragglers
+    if (sample.timestamp <= last_timestamp_)
+    {
+      drops_.fetch_add (1, std::memory_order_relaxed);
+      continue;
+    }
+
+    dest[count++] = sample;
+    last_timestamp_ = sample.timestamp;
+  }
+
+  // release the consumed slots back to the producer
+  tail_.store (tail, std::memory_order_release);
+
+  return count;
+}
+
+size_t
+containers::ImuBuffer::size (void) const
+{
+  return head_.load (std::memory_order_acquire) -
+    tail_.load (std::memory_order_acquire);
+}
+
+size_t
+containers::ImuBuffer::capacity (void) const
+{
+  return samples_.size ();
+}
+
+uint64_t
+containers::ImuBuffer::get_overflows (void) const
+{
+  return overflows_.load (std::memory_order_relaxed);
+}
+
+uint64_t
+containers::ImuBuffer::get_drops (void) const
+{
+  return drops_.load (std::memory_order_relaxed);
+}
+
+size_t
+containers::ImuBuffer::get_high_water (void) const
+{
+  return high_water_.load (std::memory_order_relaxed);
+}
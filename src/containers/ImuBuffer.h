@@ -0,0 +1,136 @@
+
+#ifndef   _CONTAINERS_IMUBUFFER_H_
+#define   _CONTAINERS_IMUBUFFER_H_
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace containers
+{
+  /**
+  * A single timestamped IMU measurement
+  **/
+  struct ImuSample
+  {
+    /// time of the measurement in nanoseconds (madara::utility::get_time)
+    int64_t timestamp;
+
+    /// linear acceleration x, y, z in m/s^2
+    double accel[3];
+
+    /// angular rate x, y, z (roll, pitch, yaw) in rad/s
+    double gyro[3];
+  };
+
+  /**
+  * A lock-free single-producer, single-consumer ring buffer of IMU samples.
+  * The platform's sensor path is the only producer and the StateEstimation
+  * thread is the only consumer. Neither side touches the knowledge base, so
+  * kHz IMUs do not contend on the context lock.
+  **/
+  class ImuBuffer
+  {
+  public:
+    /// smallest and largest number of samples held
+    static const size_t MIN_CAPACITY = 2;
+    static const size_t MAX_CAPACITY = (size_t)1 << 20;
+
+    /**
+     * Constructor
+     * @param  capacity   number of samples to hold. Clamped to
+     *                    [MIN_CAPACITY, MAX_CAPACITY] and rounded up to
+     *                    the next power of two.
+     **/
+    ImuBuffer (size_t capacity = 1024);
+
+    /**
+     * Adds a sample to the buffer. Must only be called by the producer.
+     * If the buffer is full, the sample is discarded and the overflow
+     * counter is incremented.
+     * @param  sample     the sample to add
+     * @return true if the sample was added, false on overflow
+     **/
+    bool push (const ImuSample & sample);
+
+    /**
+     * Removes up to max_samples of the oldest samples from the buffer.
+     * Must only be called by the consumer. Samples whose timestamps are
+     * not newer than the last consumed sample are discarded and counted
+     * as drops.
+     * @param  dest         destination array of at least max_samples
+     * @param  max_samples  maximum number of samples to remove
+     * @return number of samples written to dest
+     **/
+    size_t pop_batch (ImuSample * dest, size_t max_samples);
+
+    /**
+     * Returns the number of samples currently buffered. This is a snapshot
+     * and may be stale by the time it is used.
+     * @return number of buffered samples
+     **/
+    size_t size (void) const;
+
+    /**
+     * Returns the number of samples the buffer can hold
+     * @return capacity in samples
+     **/
+    size_t capacity (void) const;
+
+    /**
+     * Returns the number of samples rejected because the buffer was full
+     * @return overflow count
+     **/
+    uint64_t get_overflows (void) const;
+
+    /**
+     * Returns the number of samples discarded by the consumer because they
+     * were out of order
+     * @return drop count
+     **/
+    uint64_t get_drops (void) const;
+
+    /**
+     * Returns the highest occupancy seen by the consumer. Useful for sizing
+     * the buffer for a given IMU rate and consumer period.
+     * @return maximum number of samples buffered at one time
+     **/
+    size_t get_high_water (void) const;
+
+  private:
+    /// sample storage, sized to a power of two
+    std::vector <ImuSample> samples_;
+
+    /// capacity - 1, for cheap index wrapping
+    size_t mask_;
+
+    /// keeps producer state and consumer state on separate cache lines
+    char pad0_[64];
+
+    /// next slot to write. Only modified by the producer
+    std::atomic <size_t> head_;
+
+    /// samples rejected on push due to a full buffer
+    std::atomic <uint64_t> overflows_;
+
+    char pad1_[64];
+
+    /// next slot to read. Only modified by the consumer
+    std::atomic <size_t> tail_;
+
+    /// samples discarded by the consumer as out of order
+    std::atomic <uint64_t> drops_;
+
+    /// highest occupancy seen by the consumer
+    std::atomic <size_t> high_water_;
+
+    /// timestamp of the last sample handed to the consumer
+    int64_t last_timestamp_;
+
+    char pad2_[64];
+  };
+
+} // end containers namespace
+
+#endif // _CONTAINERS_IMUBUFFER_H_
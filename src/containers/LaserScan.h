@@ -0,0 +1,34 @@
+
+#ifndef   _CONTAINERS_LASERSCAN_H_
+#define   _CONTAINERS_LASERSCAN_H_
+
+#include <vector>
+#include <stdint.h>
+
+namespace containers
+{
+  /**
+  * A planar range scan in the sensor frame. Beam i points at
+  * angle_min + i * angle_increment radians.
+  **/
+  struct LaserScan
+  {
+    /// time of the scan in nanoseconds (madara::utility::get_time)
+    int64_t timestamp;
+
+    /// angle of the first beam in radians
+    double angle_min;
+
+    /// angle between consecutive beams in radians
+    double angle_increment;
+
+    /// ranges at or beyond this value are treated as no return
+    double range_max;
+
+    /// measured ranges in meters
+    std::vector <float> ranges;
+  };
+
+} // end containers namespace
+
+#endif // _CONTAINERS_LASERSCAN_H_
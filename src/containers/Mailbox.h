@@ -0,0 +1,79 @@
+
+#ifndef   _CONTAINERS_MAILBOX_H_
+#define   _CONTAINERS_MAILBOX_H_
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+namespace containers
+{
+  /**
+  * Hands the latest version of a large, immutable object (e.g., a map
+  * snapshot or a scan) from one platform thread to others without copying
+  * it through the knowledge base. Readers hold a reference to the version
+  * they fetched, so publishing never invalidates data in use.
+  **/
+  template <typename T>
+  class Mailbox
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    Mailbox ()
+    : version_ (0)
+    {
+    }
+
+    /**
+     * Replaces the current value
+     * @param  value   the new value. Must not be modified after publishing.
+     **/
+    void publish (const std::shared_ptr <const T> & value)
+    {
+      std::lock_guard <std::mutex> guard (mutex_);
+      value_ = value;
+      ++version_;
+    }
+
+    /**
+     * Returns the current value
+     * @param  version   if not null, set to the version of the result.
+     *                   Versions start at 1 and increase on every publish.
+     * @return the latest published value, or null if none
+     **/
+    std::shared_ptr <const T> get (uint64_t * version = 0) const
+    {
+      std::lock_guard <std::mutex> guard (mutex_);
+      if (version)
+      {
+        *version = version_;
+      }
+      return value_;
+    }
+
+    /**
+     * Returns the version of the current value without fetching it
+     * @return version of the latest value, 0 if nothing was published
+     **/
+    uint64_t get_version (void) const
+    {
+      std::lock_guard <std::mutex> guard (mutex_);
+      return version_;
+    }
+
+  private:
+    /// protects value_ and version_. Held only for a pointer copy.
+    mutable std::mutex mutex_;
+
+    /// the latest value
+    std::shared_ptr <const T> value_;
+
+    /// number of times a value has been published
+    uint64_t version_;
+  };
+
+} // end containers namespace
+
+#endif // _CONTAINERS_MAILBOX_H_
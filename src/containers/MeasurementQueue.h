@@ -0,0 +1,87 @@
+
+#ifndef   _CONTAINERS_MEASUREMENTQUEUE_H_
+#define   _CONTAINERS_MEASUREMENTQUEUE_H_
+
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+
+namespace containers
+{
+  /**
+  * Hands low-rate measurements (e.g., position fixes) from any number of
+  * sensor callbacks to one consumer thread without loss. Unlike a Mailbox,
+  * every value is delivered. The consumer drains everything at once, so
+  * the lock is held only for a swap.
+  **/
+  template <typename T>
+  class MeasurementQueue
+  {
+  public:
+    /**
+     * Constructor
+     * @param  max_size   values beyond this are dropped until drained
+     **/
+    MeasurementQueue (size_t max_size = 1024)
+    : max_size_ (max_size), drops_ (0)
+    {
+    }
+
+    /**
+     * Adds a value
+     * @param  value      the value to add
+     * @return false if the queue was full and the value was dropped
+     **/
+    bool push (const T & value)
+    {
+      std::lock_guard <std::mutex> guard (mutex_);
+      if (values_.size () >= max_size_)
+      {
+        ++drops_;
+        return false;
+      }
+      values_.push_back (value);
+      return true;
+    }
+
+    /**
+     * Moves every queued value into dest, replacing its contents. Passing
+     * the same vector each time reuses its storage.
+     * @param  dest       receives the queued values in arrival order
+     * @return number of values drained
+     **/
+    size_t drain (std::vector <T> & dest)
+    {
+      dest.clear ();
+      std::lock_guard <std::mutex> guard (mutex_);
+      values_.swap (dest);
+      return dest.size ();
+    }
+
+    /**
+     * Returns the number of values dropped because the queue was full
+     * @return drop count
+     **/
+    size_t get_drops (void) const
+    {
+      std::lock_guard <std::mutex> guard (mutex_);
+      return drops_;
+    }
+
+  private:
+    /// protects values_ and drops_
+    mutable std::mutex mutex_;
+
+    /// queued values
+    std::vector <T> values_;
+
+    /// most values to queue before dropping
+    size_t max_size_;
+
+    /// values dropped on a full queue
+    size_t drops_;
+  };
+
+} // end containers namespace
+
+#endif // _CONTAINERS_MEASUREMENTQUEUE_H_
@@ -0,0 +1,124 @@
+
+#include "OccupancyGrid.h"
+
+#include <cmath>
+#include <cstdlib>
+
+// how much a single observation moves a cell toward free or occupied
+static const int FREE_STEP (8);
+static const int HIT_STEP (32);
+
+const uint8_t containers::OccupancyGrid::UNKNOWN;
+const uint8_t containers::OccupancyGrid::OCCUPIED_THRESHOLD;
+
+containers::OccupancyGrid::OccupancyGrid ()
+: width (0), height (0), resolution (1.0), origin_x (0.0), origin_y (0.0)
+{
+}
+
+containers::OccupancyGrid::OccupancyGrid (int width, int height,
+  double resolution, double origin_x, double origin_y)
+{
+  resize (width, height, resolution, origin_x, origin_y);
+}
+
+void
+containers::OccupancyGrid::resize (int width, int height,
+  double resolution, double origin_x, double origin_y)
+{
+  this->width = width;
+  this->height = height;
+  this->resolution = resolution;
+  this->origin_x = origin_x;
+  this->origin_y = origin_y;
+
+  cells.assign ((size_t)width * height, UNKNOWN);
+}
+
+void
+containers::OccupancyGrid::world_to_cell (
+  double x, double y, int & cell_x, int & cell_y) const
+{
+  cell_x = (int)std::floor ((x - origin_x) / resolution);
+  cell_y = (int)std::floor ((y - origin_y) / resolution);
+}
+
+bool
+containers::OccupancyGrid::contains (int cell_x, int cell_y) const
+{
+  return cell_x >= 0 && cell_y >= 0 && cell_x < width && cell_y < height;
+}
+
+uint8_t
+containers::OccupancyGrid::get (int cell_x, int cell_y) const
+{
+  return cells[(size_t)cell_y * width + cell_x];
+}
+
+void
+containers::OccupancyGrid::set (int cell_x, int cell_y, uint8_t value)
+{
+  cells[(size_t)cell_y * width + cell_x] = value;
+}
+
+void
+containers::OccupancyGrid::insert_scan (
+  const LaserScan & scan, double x, double y, double yaw)
+{
+  int start_x, start_y;
+  world_to_cell (x, y, start_x, start_y);
+
+  for (size_t i = 0; i < scan.ranges.size (); ++i)
+  {
+    const double range = scan.ranges[i];
+    const bool hit = range < scan.range_max;
+
+    // skip invalid ranges. A no-return still clears the path to max range.
+    if (!(range > 0))
+    {
+      continue;
+    }
+
+    const double angle = yaw + scan.angle_min + i * scan.angle_increment;
+    const double length = hit ? range : scan.range_max;
+
+    int end_x, end_y;
+    world_to_cell (x + length * std::cos (angle),
+      y + length * std::sin (angle), end_x, end_y);
+
+    // Bresenham walk from the sensor to the end of the beam
+    int cx = start_x, cy = start_y;
+    const int dx = std::abs (end_x - start_x);
+    const int dy = -std::abs (end_y - start_y);
+    const int sx = start_x < end_x ? 1 : -1;
+    const int sy = start_y < end_y ? 1 : -1;
+    int error = dx + dy;
+
+    while (cx != end_x || cy != end_y)
+    {
+      if (contains (cx, cy))
+      {
+        uint8_t & cell = cells[(size_t)cy * width + cx];
+        cell = (uint8_t)(cell > FREE_STEP ? cell - FREE_STEP : 0);
+      }
+
+      const int error2 = 2 * error;
+      if (error2 >= dy)
+      {
+        error += dy;
+        cx += sx;
+      }
+      if (error2 <= dx)
+      {
+        error += dx;
+        cy += sy;
+      }
+    }
+
+    if (hit && contains (end_x, end_y))
+    {
+      uint8_t & cell = cells[(size_t)end_y * width + end_x];
+      cell = (uint8_t)(cell < 255 - HIT_STEP ? cell + HIT_STEP : 255);
+    }
+  }
+}
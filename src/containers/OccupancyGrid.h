@@ -0,0 +1,120 @@
+
+#ifndef   _CONTAINERS_OCCUPANCYGRID_H_
+#define   _CONTAINERS_OCCUPANCYGRID_H_
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LaserScan.h"
+
+namespace containers
+{
+  /**
+  * A 2D occupancy grid with one byte per cell. 0 is free, 255 is occupied
+  * and UNKNOWN (128) has not been observed. Cell (0, 0) is at origin_x,
+  * origin_y and rows are laid out along x.
+  **/
+  class OccupancyGrid
+  {
+  public:
+    /// value of a cell that has never been observed
+    static const uint8_t UNKNOWN = 128;
+
+    /// cells at or above this value are considered occupied
+    static const uint8_t OCCUPIED_THRESHOLD = 192;
+
+    /**
+     * Default constructor. Creates an empty grid.
+     **/
+    OccupancyGrid ();
+
+    /**
+     * Constructor
+     * @param  width       number of cells along x
+     * @param  height      number of cells along y
+     * @param  resolution  meters per cell
+     * @param  origin_x    x coordinate of cell (0, 0) in meters
+     * @param  origin_y    y coordinate of cell (0, 0) in meters
+     **/
+    OccupancyGrid (int width, int height, double resolution,
+      double origin_x, double origin_y);
+
+    /**
+     * Resizes the grid and marks every cell as unknown
+     * @param  width       number of cells along x
+     * @param  height      number of cells along y
+     * @param  resolution  meters per cell
+     * @param  origin_x    x coordinate of cell (0, 0) in meters
+     * @param  origin_y    y coordinate of cell (0, 0) in meters
+     **/
+    void resize (int width, int height, double resolution,
+      double origin_x, double origin_y);
+
+    /**
+     * Converts a world coordinate to a cell coordinate. The result may be
+     * outside of the grid.
+     * @param  x       x in meters
+     * @param  y       y in meters
+     * @param  cell_x  resulting column
+     * @param  cell_y  resulting row
+     **/
+    void world_to_cell (double x, double y, int & cell_x, int & cell_y) const;
+
+    /**
+     * Checks if a cell coordinate is inside the grid
+     * @param  cell_x  column
+     * @param  cell_y  row
+     * @return true if the cell is inside the grid
+     **/
+    bool contains (int cell_x, int cell_y) const;
+
+    /**
+     * Returns a cell value. The cell must be inside the grid.
+     * @param  cell_x  column
+     * @param  cell_y  row
+     * @return the occupancy value of the cell
+     **/
+    uint8_t get (int cell_x, int cell_y) const;
+
+    /**
+     * Sets a cell value. The cell must be inside the grid.
+     * @param  cell_x  column
+     * @param  cell_y  row
+     * @param  value   the new occupancy value
+     **/
+    void set (int cell_x, int cell_y, uint8_t value);
+
+    /**
+     * Ray casts a laser scan from a pose into the grid. Cells along each
+     * beam become more likely free and cells at each hit become more
+     * likely occupied.
+     * @param  scan    the scan to insert, in the sensor frame
+     * @param  x       sensor x in meters
+     * @param  y       sensor y in meters
+     * @param  yaw     sensor heading in radians
+     **/
+    void insert_scan (const LaserScan & scan, double x, double y, double yaw);
+
+    /// number of cells along x
+    int width;
+
+    /// number of cells along y
+    int height;
+
+    /// meters per cell
+    double resolution;
+
+    /// x coordinate of cell (0, 0) in meters
+    double origin_x;
+
+    /// y coordinate of cell (0, 0) in meters
+    double origin_y;
+
+    /// row-major cell values, width * height bytes
+    std::vector <uint8_t> cells;
+  };
+
+} // end containers namespace
+
+#endif // _CONTAINERS_OCCUPANCYGRID_H_
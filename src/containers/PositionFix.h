@@ -0,0 +1,41 @@
+
+#ifndef   _CONTAINERS_POSITIONFIX_H_
+#define   _CONTAINERS_POSITIONFIX_H_
+
+#include <stdint.h>
+
+namespace containers
+{
+  /**
+  * A timestamped absolute position and/or heading measurement, e.g., from
+  * GPS, motion capture or scan localization. Sources only fill the axes
+  * they observe.
+  **/
+  struct PositionFix
+  {
+    /// axes flags
+    enum
+    {
+      X = 1,
+      Y = 2,
+      Z = 4,
+      YAW = 8,
+      XYZ = X | Y | Z
+    };
+
+    /// time the measurement was taken in nanoseconds, not when it arrived
+    int64_t timestamp;
+
+    /// position x, y, z in meters
+    double position[3];
+
+    /// heading in radians
+    double yaw;
+
+    /// which of the axes flags were measured
+    uint32_t axes;
+  };
+
+} // end containers namespace
+
+#endif // _CONTAINERS_POSITIONFIX_H_
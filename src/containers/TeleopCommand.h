@@ -0,0 +1,32 @@
+
+#ifndef   _CONTAINERS_TELEOPCOMMAND_H_
+#define   _CONTAINERS_TELEOPCOMMAND_H_
+
+#include <stdint.h>
+
+namespace containers
+{
+  /**
+  * An operator command handed from TeleopOverride to Controls
+  **/
+  struct TeleopCommand
+  {
+    /// true if the operator has taken over from autonomy
+    bool enabled;
+
+    /// commanded velocity x, y, z (m/s) and yaw rate (rad/s)
+    double command[4];
+
+    /// operator sequence number of the command
+    int64_t sequence;
+
+    /// when the command entered the knowledge base, in nanoseconds. This
+    /// is the operator's timestamp if a new one came with the command,
+    /// when TeleopOverride woke up for it if the operator never stamps
+    /// commands, and 0 if the timestamp was left from an earlier command.
+    int64_t issued;
+  };
+
+} // end containers namespace
+
+#endif // _CONTAINERS_TELEOPCOMMAND_H_
@@ -0,0 +1,277 @@
+
+#ifndef   _CONTAINERS_TIMEBUFFER_H_
+#define   _CONTAINERS_TIMEBUFFER_H_
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace containers
+{
+  /**
+  * A fixed-capacity circular buffer of timestamped values kept in time
+  * order, one per sensor stream. Lookups by time are binary searches over
+  * the ring. Late values are inserted in place, so streams with different
+  * rates and latencies can be merged by time regardless of arrival order.
+  * When full, the oldest value is overwritten.
+  *
+  * Not thread-safe. Meant to be owned by a single consumer thread, e.g.,
+  * StateEstimation.
+  **/
+  template <typename T>
+  class TimeBuffer
+  {
+  public:
+    /**
+     * Constructor
+     * @param  capacity   number of values to hold. Rounded up to the next
+     *                    power of two.
+     **/
+    TimeBuffer (size_t capacity = 256)
+    : head_ (0), size_ (0), late_inserts_ (0)
+    {
+      size_t rounded = 1;
+      while (rounded < capacity)
+      {
+        rounded <<= 1;
+      }
+
+      entries_.resize (rounded);
+      mask_ = rounded - 1;
+    }
+
+    /**
+     * Inserts a value in time order. Values with equal timestamps keep
+     * their arrival order.
+     * @param  timestamp  time of the value in nanoseconds
+     * @param  value      the value
+     * @return false if the buffer is full and the value is older than
+     *         everything in it, true otherwise
+     **/
+    bool insert (int64_t timestamp, const T & value)
+    {
+      if (size_ == entries_.size ())
+      {
+        if (timestamp < time_at (0))
+        {
+          return false;
+        }
+
+        head_ = (head_ + 1) & mask_;
+        --size_;
+      }
+
+      // the common case, an in-order value, needs no search or shift
+      size_t position = size_;
+      if (size_ > 0 && timestamp < time_at (size_ - 1))
+      {
+        position = upper_bound (timestamp);
+        ++late_inserts_;
+
+        for (size_t i = size_; i > position; --i)
+        {
+          slot (i) = slot (i - 1);
+        }
+      }
+
+      Entry & entry = slot (position);
+      entry.timestamp = timestamp;
+      entry.value = value;
+      ++size_;
+
+      return true;
+    }
+
+    /**
+     * Returns the index of the first value at or after a time
+     * @param  timestamp  time in nanoseconds
+     * @return index in [0, size ()]
+     **/
+    size_t lower_bound (int64_t timestamp) const
+    {
+      size_t low = 0, high = size_;
+      while (low < high)
+      {
+        const size_t middle = low + (high - low) / 2;
+        if (time_at (middle) < timestamp)
+          low = middle + 1;
+        else
+          high = middle;
+      }
+      return low;
+    }
+
+    /**
+     * Returns the index of the first value after a time
+     * @param  timestamp  time in nanoseconds
+     * @return index in [0, size ()]
+     **/
+    size_t upper_bound (int64_t timestamp) const
+    {
+      size_t low = 0, high = size_;
+      while (low < high)
+      {
+        const size_t middle = low + (high - low) / 2;
+        if (time_at (middle) <= timestamp)
+          low = middle + 1;
+        else
+          high = middle;
+      }
+      return low;
+    }
+
+    /**
+     * Computes the value at a time from the values around it
+     * @param  timestamp  time in nanoseconds
+     * @param  result     the value at timestamp
+     * @param  blend      callable as blend (before, after, ratio) that
+     *                    returns a T, with ratio in [0, 1)
+     * @return false if timestamp is outside of the buffered time span
+     **/
+    template <typename Blend>
+    bool interpolate (int64_t timestamp, T & result, Blend blend) const
+    {
+      const size_t after = lower_bound (timestamp);
+
+      if (after == size_)
+      {
+        return false;
+      }
+
+      if (time_at (after) == timestamp)
+      {
+        result = at (after);
+        return true;
+      }
+
+      if (after == 0)
+      {
+        return false;
+      }
+
+      const int64_t start = time_at (after - 1);
+      const double ratio =
+        (double)(timestamp - start) / (double)(time_at (after) - start);
+
+      result = blend (at (after - 1), at (after), ratio);
+      return true;
+    }
+
+    /**
+     * Removes every value from index onward, e.g., to discard state
+     * history that is about to be recomputed
+     * @param  index      first index to remove
+     **/
+    void truncate (size_t index)
+    {
+      if (index < size_)
+      {
+        size_ = index;
+      }
+    }
+
+    /**
+     * Removes every value
+     **/
+    void clear (void)
+    {
+      head_ = 0;
+      size_ = 0;
+    }
+
+    /**
+     * Returns a value by position, oldest first
+     * @param  index      position in [0, size ())
+     * @return the value
+     **/
+    const T & at (size_t index) const
+    {
+      return slot (index).value;
+    }
+
+    /**
+     * Returns the time of a value by position, oldest first
+     * @param  index      position in [0, size ())
+     * @return time in nanoseconds
+     **/
+    int64_t time_at (size_t index) const
+    {
+      return slot (index).timestamp;
+    }
+
+    /**
+     * Returns the number of buffered values
+     * @return number of values
+     **/
+    size_t size (void) const
+    {
+      return size_;
+    }
+
+    /**
+     * Checks if the buffer holds no values
+     * @return true if empty
+     **/
+    bool empty (void) const
+    {
+      return size_ == 0;
+    }
+
+    /**
+     * Returns the number of values the buffer can hold
+     * @return capacity in values
+     **/
+    size_t capacity (void) const
+    {
+      return entries_.size ();
+    }
+
+    /**
+     * Returns the number of values inserted out of order
+     * @return late insert count
+     **/
+    uint64_t get_late_inserts (void) const
+    {
+      return late_inserts_;
+    }
+
+  private:
+    /**
+     * A value and its time
+     **/
+    struct Entry
+    {
+      int64_t timestamp;
+      T value;
+    };
+
+    /// maps a logical index (0 is oldest) into the ring
+    Entry & slot (size_t index)
+    {
+      return entries_[(head_ + index) & mask_];
+    }
+
+    const Entry & slot (size_t index) const
+    {
+      return entries_[(head_ + index) & mask_];
+    }
+
+    /// value storage, sized to a power of two
+    std::vector <Entry> entries_;
+
+    /// capacity - 1, for cheap index wrapping
+    size_t mask_;
+
+    /// ring index of the oldest value
+    size_t head_;
+
+    /// number of buffered values
+    size_t size_;
+
+    /// values inserted before the newest value
+    uint64_t late_inserts_;
+  };
+
+} // end containers namespace
+
+#endif // _CONTAINERS_TIMEBUFFER_H_
@@ -1,9 +1,19 @@
 
 
+#include <chrono>
+#include <memory>
+#include <thread>
+
 #include "madara/knowledge/KnowledgeBase.h"
 #include "madara/threads/Threader.h"
 #include "gams/controllers/BaseController.h"
 #include "gams/loggers/GlobalLogger.h"
+#include "utility/AsyncLogger.h"
+#include "utility/LockProfiler.h"
+#include "utility/ProfiledThread.h"
+#include "utility/TaskScheduler.h"
+#include "utility/ThreadPlacement.h"
+#include "utility/Trace.h"
 
 // DO NOT DELETE THIS SECTION
 
@@ -13,17 +23,25 @@
 
 // begin platform includes
 #include "platforms/RisQuadcopterSim.h"
+#include "platforms/threads/Governor.h"
+#include "platforms/threads/LockReport.h"
+#include "platforms/threads/TraceControl.h"
 // end platform includes
 
 // begin thread includes
+#include "threads/ChunkFlush.h"
+#include "threads/CoalescerFlush.h"
+#include "threads/MapeLoop.h"
+#include "threads/ShaperFlush.h"
 // end thread includes
 
 // begin transport includes
+#include "transports/InProcessTransport.h"
+#include "transports/SharedMemoryTransport.h"
 // end transport includes
 
 // begin filter includes
-#include "filters/IntelligentReceiveFilter.h"
-#include "filters/IntelligentSendFilter.h"
+#include "filters/FilterChains.h"
 // end filter includes
 
 // END DO NOT DELETE THIS SECTION
@@ -34,6 +52,18 @@ std::string host ("");
 const std::string default_multicast ("239.255.0.1:4150");
 madara::transport::QoSTransportSettings settings;
 
+// use the shared memory transport instead of a network transport
+bool shared_memory (false);
+
+// file to capture received packets to for replay
+std::string capture_file;
+
+// number of agents to host in this process, from the id up
+int in_process (0);
+
+// prefix of the per agent madara files, e.g., sim/agent_ for sim/agent_3.mf
+std::string agent_files;
+
 // create shortcuts to MADARA classes and namespaces
 namespace controllers = gams::controllers;
 typedef madara::knowledge::KnowledgeRecord   Record;
@@ -76,7 +106,11 @@ void print_usage (char * prog_name)
 "     Loop controller setup for gams\n" 
 " [-A |--algorithm type]        algorithm to start with\n" \
 " [-a |--accent type]           accent algorithm to start with\n" \
+" [--agent-files prefix]        per agent madara files for --in-process,\n" \
+"                               e.g., sim/agent_ loads sim/agent_3.mf\n" \
 " [-b |--broadcast ip:port]     the broadcast ip to send and listen to\n" \
+" [--capture file]             capture received packets to a file for replay,\n" \
+"                               or to file.{id} per --in-process agent\n" \
 " [--checkpoint-on-loop]        save checkpoint after each control loop\n" \
 " [--checkpoint-on-send]        save checkpoint before send of updates\n" \
 " [-c |--checkpoint prefix]     the filename prefix for checkpointing\n" \
@@ -86,6 +120,8 @@ void print_usage (char * prog_name)
 " [-i |--id id]                 the id of this agent (should be non-negative)\n" \
 " [--madara-level level]        the MADARA logger level (0+, higher is higher detail)\n" \
 " [--gams-level level]          the GAMS logger level (0+, higher is higher detail)\n" \
+" [--in-process count]          host count agents, from the id up, in this\n" \
+"                               process on a shared scheduler\n" \
 " [-L |--loop-time time]        time to execute loop\n"\
 " [--loop-hertz hz]             hertz to run the MAPE loop\n"\
 " [-lt|--load-transport file] a file to load transport settings from\n" \
@@ -101,6 +137,9 @@ void print_usage (char * prog_name)
 " [-q |--queue-length length]   length of transport queue in bytes\n" \
 " [-r |--reduced]               use the reduced message header\n" \
 " [-s |--send-hertz hertz]      send hertz rate for modifications\n" \
+" [--shm name[:slots]]          share memory with agents on this host, in\n" \
+"                               the slot of the agent id (def: 64 slots).\n" \
+"                               Only agents of the same user can join\n" \
 " [-st|--save-transport file] a file to save transport settings to\n" \
 " [-stp|--save-transport-prefix prfx] prefix to save settings at\n" \
 " [-stt|--save-transport-text file] a text file to save transport settings to\n" \
@@ -149,6 +188,15 @@ void handle_arguments (int argc, char ** argv)
 
       ++i;
     }
+    else if (arg1 == "--capture")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        capture_file = argv[i + 1];
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
     else if (arg1 == "-c" || arg1 == "--checkpoint")
     {
       if (i + 1 < argc && argv[i + 1][0] != '-')
@@ -208,6 +256,29 @@ void handle_arguments (int argc, char ** argv)
       ++i;
     }
 
+    else if (arg1 == "--in-process")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        std::stringstream buffer (argv[i + 1]);
+        buffer >> in_process;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
+    else if (arg1 == "--agent-files")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        agent_files = argv[i + 1];
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
     else if (arg1 == "-i" || arg1 == "--id")
     {
       if (i + 1 < argc && argv[i +1][0] != '-')
@@ -455,6 +526,19 @@ void handle_arguments (int argc, char ** argv)
 
       ++i;
     }
+    else if (arg1 == "--shm")
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        settings.hosts.push_back (argv[i + 1]);
+        settings.type = madara::transport::NO_TRANSPORT;
+        shared_memory = true;
+      }
+      else
+        print_usage (argv[0]);
+
+      ++i;
+    }
     else if (arg1 == "--zmq")
     {
       if (i + 1 < argc && argv[i + 1][0] != '-')
@@ -474,6 +558,342 @@ void handle_arguments (int argc, char ** argv)
   }
 }
 
+/**
+ * Adds an agent's filter chains to transport settings
+ * @param  target     the settings to add the filters to
+ * @param  chains     the chains, which target then owns
+ **/
+void add_filters (madara::transport::QoSTransportSettings & target,
+  const filters::FilterChains & chains)
+{
+  // the chains are built in one place, shared with the benchmarks
+  chains.add_to (target);
+
+  // begin on receive filters
+  // end on receive filters
+
+  // begin on send filters
+  // end on send filters
+}
+
+/**
+ * Adds the algorithm and platform factories of this project
+ * @param  controller  the controller to add the factories to
+ **/
+void add_factories (controllers::BaseController & controller)
+{
+  std::vector <std::string> aliases;
+
+  // begin adding custom algorithm factories
+
+  // add ExploreGpsDenied factory
+  aliases.clear ();
+  aliases.push_back ("ExploreGpsDenied");
+
+  controller.add_algorithm_factory (aliases,
+    new algorithms::ExploreGpsDeniedFactory ());
+  // end adding custom algorithm factories
+
+  // begin adding custom platform factories
+
+  // add RisQuadcopterSim factory
+  aliases.clear ();
+  aliases.push_back ("RisQuadcopterSim");
+
+  controller.add_platform_factory (aliases,
+    new platforms::RisQuadcopterSimFactory ());
+  // end adding custom platform factories
+}
+
+/**
+ * Starts the async logger and the trace, as configured
+ * @param  knowledge  the knowledge base with the .log and .trace settings
+ **/
+void start_diagnostics (madara::knowledge::KnowledgeBase & knowledge)
+{
+  // format hot path log calls on a background thread if asked to
+  if (knowledge.get (".log.async").is_true ())
+  {
+    double period = 0.01;
+    size_t capacity = 1024;
+    if (knowledge.exists (".log.async_period"))
+      period = knowledge.get (".log.async_period").to_double ();
+    if (knowledge.exists (".log.async_capacity"))
+      capacity = (size_t)knowledge.get (".log.async_capacity").to_integer ();
+
+    utility::AsyncLogger::start (period, capacity);
+  }
+
+  // record a timeline from the start if asked to. .trace.enabled and
+  // .trace.dump also control it at runtime.
+  if (knowledge.exists (".trace.capacity"))
+    utility::Trace::set_capacity (
+      (size_t)knowledge.get (".trace.capacity").to_integer ());
+  if (knowledge.get (".trace.enabled").is_true ())
+    utility::Trace::set_enabled (true);
+}
+
+/**
+ * Reports lock use, writes the trace and flushes the async logger
+ * @param  knowledge  the knowledge base with the .trace settings
+ **/
+void stop_diagnostics (madara::knowledge::KnowledgeBase & knowledge)
+{
+  // report which code held the knowledge base lock, and for how long
+  utility::LockProfiler::log_report (gams::loggers::LOG_ALWAYS);
+
+  // write the timeline of this run
+  if (knowledge.get (".trace.enabled").is_true ())
+  {
+    std::string trace_file ("trace.json");
+    if (knowledge.exists (".trace.file"))
+      trace_file = knowledge.get (".trace.file").to_string ();
+
+    utility::Trace::set_enabled (false);
+    utility::Trace::write (trace_file);
+  }
+
+  // write any queued log records
+  utility::AsyncLogger::stop ();
+}
+
+/**
+ * An agent hosted by run_in_process
+ **/
+struct Agent
+{
+  /// transport settings, with this agent's filters
+  madara::transport::QoSTransportSettings settings;
+
+  /// the agent's knowledge base
+  madara::knowledge::KnowledgeBase knowledge;
+
+  /// the agent's controller
+  std::unique_ptr <controllers::BaseController> controller;
+
+  /// the agent's filters, flushed by its jobs and owned by settings
+  std::unique_ptr <filters::FilterChains> chains;
+};
+
+/**
+ * Hosts in_process agents in this process, with ids from settings.id up.
+ * Each has its own knowledge base and controller, and they exchange
+ * updates through an InProcessTransport named by the first host. Their
+ * MAPE loops, platform jobs and received updates share the workers of
+ * one TaskScheduler.
+ * @return the exit code of the program
+ **/
+int run_in_process (void)
+{
+  // the scheduler is sized and placed by the common madara files
+  madara::knowledge::KnowledgeBase profile;
+  if (madara_commands != "")
+  {
+    profile.evaluate (madara_commands,
+      madara::knowledge::EvalSettings(false, true));
+  }
+
+  size_t workers = 0;
+  if (profile.exists (".scheduler.workers"))
+    workers = (size_t)profile.get (".scheduler.workers").to_integer ();
+
+  utility::TaskScheduler scheduler (workers);
+  utility::TaskScheduler::set_shared (&scheduler);
+
+  utility::ThreadPlacement placement;
+  std::vector <int> cores;
+  placement.load (profile);
+  if (placement.get_cores ("scheduler", cores))
+    scheduler.pin ("scheduler", cores);
+
+  if (num_agents < 0)
+    num_agents = settings.id + in_process;
+
+  if (gams_debug_level >= 0)
+  {
+    gams::loggers::global_logger->set_level (gams_debug_level);
+  }
+
+  std::vector <std::unique_ptr <Agent> > agents;
+  for (int i = 0; i < in_process; ++i)
+  {
+    std::unique_ptr <Agent> agent (new Agent ());
+    const Integer id = settings.id + i;
+
+    agent->settings = settings;
+    agent->settings.id = (uint32_t)id;
+    agent->settings.type = madara::transport::NO_TRANSPORT;
+    // each agent captures what it receives to its own file
+    std::string agent_capture;
+    if (capture_file != "")
+    {
+      std::stringstream path;
+      path << capture_file << "." << id;
+      agent_capture = path.str ();
+    }
+
+    agent->chains.reset (new filters::FilterChains (agent_capture));
+    add_filters (agent->settings, *agent->chains);
+
+    madara::knowledge::KnowledgeBase & knowledge = agent->knowledge;
+    knowledge.attach_transport (host, agent->settings);
+    knowledge.attach_transport (new transports::InProcessTransport (
+      knowledge.get_id (), agent->settings, knowledge, scheduler));
+
+    agent->controller.reset (
+      new controllers::BaseController (knowledge, controller_settings));
+    controllers::BaseController & controller = *agent->controller;
+    add_factories (controller);
+    controller.init_vars (id, num_agents);
+
+    // the agent's own file is applied over the common ones
+    if (madara_commands != "")
+    {
+      knowledge.evaluate (madara_commands,
+        madara::knowledge::EvalSettings(false, true));
+    }
+    if (agent_files != "")
+    {
+      std::stringstream filename;
+      filename << agent_files << id << ".mf";
+
+      if (madara::utility::file_exists (filename.str ()))
+      {
+        knowledge.evaluate (madara::utility::file_to_string (filename.str ()),
+          madara::knowledge::EvalSettings(false, true));
+      }
+      else
+      {
+        madara_logger_ptr_log (gams::loggers::global_logger.get (),
+          gams::loggers::LOG_MAJOR,
+          "run_in_process:" \
+          " no agent file %s\n", filename.str ().c_str ());
+      }
+    }
+
+    std::string agent_platform (platform);
+    if (!plat_set && knowledge.exists (KNOWLEDGE_BASE_PLATFORM_KEY))
+      agent_platform = knowledge.get (KNOWLEDGE_BASE_PLATFORM_KEY).to_string ();
+    controller.init_platform (agent_platform);
+    controller.init_algorithm (algorithm);
+
+    for (unsigned int j = 0; j < accents.size (); ++j)
+    {
+      controller.init_accent (accents[j]);
+    }
+
+    // jobs are named by agent, so they can be stopped by agent
+    std::stringstream prefix;
+    prefix << "agent." << id << ".";
+
+    // a loop as fast as possible would starve the other agents
+    double loop_hertz = controller_settings.loop_hertz;
+    if (loop_hertz <= 0)
+      loop_hertz = 1.0;
+    scheduler.run (loop_hertz, prefix.str () + "MapeLoop",
+      new threads::MapeLoop (&controller), utility::TaskScheduler::NORMAL,
+      0, &knowledge);
+
+    double coalesce_hertz = 20;
+    if (knowledge.exists (".send.coalesce_hertz"))
+      coalesce_hertz = knowledge.get (".send.coalesce_hertz").to_double ();
+    if (coalesce_hertz > 0)
+    {
+      scheduler.run (coalesce_hertz, prefix.str () + "CoalescerFlush",
+        new threads::CoalescerFlush (agent->chains->coalescer),
+        utility::TaskScheduler::NORMAL, 0, &knowledge);
+    }
+
+    double chunk_hertz = 50;
+    if (knowledge.exists (".chunk.hertz"))
+      chunk_hertz = knowledge.get (".chunk.hertz").to_double ();
+    if (chunk_hertz > 0)
+    {
+      scheduler.run (chunk_hertz, prefix.str () + "ChunkFlush",
+        new threads::ChunkFlush (agent->chains->chunker),
+        utility::TaskScheduler::NORMAL, 0, &knowledge);
+    }
+
+    double shaper_hertz = 10;
+    if (knowledge.exists (".send.flush_hertz"))
+      shaper_hertz = knowledge.get (".send.flush_hertz").to_double ();
+    if (shaper_hertz > 0)
+    {
+      scheduler.run (shaper_hertz, prefix.str () + "ShaperFlush",
+        new threads::ShaperFlush (agent->chains->shaper),
+        utility::TaskScheduler::NORMAL, 0, &knowledge);
+    }
+
+    agents.push_back (std::move (agent));
+  }
+
+  if (agents.empty ())
+    return 0;
+
+  // the process wide jobs report through the first agent
+  madara::knowledge::KnowledgeBase & first = agents[0]->knowledge;
+  start_diagnostics (first);
+
+  scheduler.run (1.0, "Governor", new utility::ProfiledThread (
+    new platforms::threads::Governor (&scheduler), 1.0),
+    utility::TaskScheduler::HIGH, 0, &first);
+
+  double lock_report_hertz = 0.1;
+  if (first.exists (".perf.locks.report_hertz"))
+    lock_report_hertz = first.get (".perf.locks.report_hertz").to_double ();
+  if (lock_report_hertz > 0)
+  {
+    scheduler.run (lock_report_hertz, "LockReport",
+      new platforms::threads::LockReport (), utility::TaskScheduler::LOW, 0,
+      &first);
+  }
+
+  scheduler.run (1.0, "TraceControl", new platforms::threads::TraceControl (),
+    utility::TaskScheduler::LOW, 0, &first);
+
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_MAJOR,
+    "run_in_process:" \
+    " hosting %d agents from id %d\n", (int)agents.size (), (int)settings.id);
+
+  if (controller_settings.run_time > 0)
+  {
+    std::this_thread::sleep_for (
+      std::chrono::duration <double> (controller_settings.run_time));
+  }
+  else
+  {
+    for (;;)
+      std::this_thread::sleep_for (std::chrono::seconds (1));
+  }
+
+  // stop the loops before their controllers, then the platforms' jobs
+  // with the controllers, then the transports still delivering updates
+  for (size_t i = 0; i < agents.size (); ++i)
+  {
+    std::stringstream prefix;
+    prefix << "agent." << agents[i]->settings.id << ".";
+    scheduler.stop (prefix.str ());
+  }
+  for (size_t i = 0; i < agents.size (); ++i)
+  {
+    agents[i]->controller.reset ();
+  }
+  for (size_t i = 0; i < agents.size (); ++i)
+  {
+    agents[i]->knowledge.close_transport ();
+    if (agents[i]->chains->capture)
+      agents[i]->chains->capture->close ();
+  }
+
+  scheduler.terminate ();
+  utility::TaskScheduler::set_shared (0);
+
+  stop_diagnostics (first);
+
+  return 0;
+}
+
 // perform main logic of program
 int main (int argc, char ** argv)
 {
@@ -513,21 +933,45 @@ int main (int argc, char ** argv)
       settings.save_text (save_transport_text, save_transport_prefix);
   }
 
+  if (in_process > 0)
+    return run_in_process ();
+
   // create knowledge base and a control loop
   madara::knowledge::KnowledgeBase knowledge;
   
-  // begin on receive filters
-  settings.add_receive_filter (new filters::IntelligentReceiveFilter ());
-  // end on receive filters
-  
-  // begin on send filters
-  settings.add_send_filter (new filters::IntelligentSendFilter ());
-  // end on send filters
+  // the chunk receive filter passes NACKs to the chunk send filter
+  filters::FilterChains chains (capture_file);
+  add_filters (settings, chains);
   
+  // threads inherit the creator's CPU mask, so place this thread where
+  // the transport threads belong before they are started. The -M file is
+  // only fully applied below, so read the .affinity profile from a scratch
+  // knowledge base first.
+  utility::ThreadPlacement placement;
+  if (madara_commands != "")
+  {
+    madara::knowledge::KnowledgeBase profile;
+    profile.evaluate (madara_commands,
+      madara::knowledge::EvalSettings(false, true));
+    placement.load (profile);
+  }
+  placement.apply ("transport", &knowledge);
+
   // if you only want to use custom transports, delete following
   knowledge.attach_transport (host, settings);
+
+  // the MAPE loop runs on this thread from here on
+  placement.apply ("controller", &knowledge);
+  utility::Trace::set_thread_name ("controller");
   
   // begin transport creation 
+
+  // add SharedMemoryTransport for agents on this host
+  if (shared_memory)
+  {
+    knowledge.attach_transport (new transports::SharedMemoryTransport (
+      knowledge.get_id (), settings, knowledge));
+  }
   // end transport creation
   
   // set this once to allow for debugging controller creation
@@ -542,27 +986,7 @@ int main (int argc, char ** argv)
   // initialize variables and function stubs
   controller.init_vars (settings.id, num_agents);
   
-  std::vector <std::string> aliases;
-  
-  // begin adding custom algorithm factories
-
-  // add ExploreGpsDenied factory
-  aliases.clear ();
-  aliases.push_back ("ExploreGpsDenied");
-
-  controller.add_algorithm_factory (aliases,
-    new algorithms::ExploreGpsDeniedFactory ());
-  // end adding custom algorithm factories
-
-  // begin adding custom platform factories
-
-  // add RisQuadcopterSim factory
-  aliases.clear ();
-  aliases.push_back ("RisQuadcopterSim");
-
-  controller.add_platform_factory (aliases,
-    new platforms::RisQuadcopterSimFactory ());
-  // end adding custom platform factories
+  add_factories (controller);
   
   // read madara initialization
   if (madara_commands != "")
@@ -570,6 +994,8 @@ int main (int argc, char ** argv)
     knowledge.evaluate (madara_commands,
       madara::knowledge::EvalSettings(false, true));
   }
+
+  start_diagnostics (knowledge);
   
   // set debug levels if they have been set through command line
   if (madara_debug_level >= 0)
@@ -620,6 +1046,32 @@ int main (int argc, char ** argv)
    **/
 
   // begin thread creation
+  double coalesce_hertz = 20;
+  if (knowledge.exists (".send.coalesce_hertz"))
+    coalesce_hertz = knowledge.get (".send.coalesce_hertz").to_double ();
+  if (coalesce_hertz > 0)
+  {
+    threader.run (coalesce_hertz, "CoalescerFlush",
+      new threads::CoalescerFlush (chains.coalescer));
+  }
+
+  double chunk_hertz = 50;
+  if (knowledge.exists (".chunk.hertz"))
+    chunk_hertz = knowledge.get (".chunk.hertz").to_double ();
+  if (chunk_hertz > 0)
+  {
+    threader.run (chunk_hertz, "ChunkFlush",
+      new threads::ChunkFlush (chains.chunker));
+  }
+
+  double shaper_hertz = 10;
+  if (knowledge.exists (".send.flush_hertz"))
+    shaper_hertz = knowledge.get (".send.flush_hertz").to_double ();
+  if (shaper_hertz > 0)
+  {
+    threader.run (shaper_hertz, "ShaperFlush",
+      new threads::ShaperFlush (chains.shaper));
+  }
   // end thread creation
   
   /**
@@ -634,7 +1086,14 @@ int main (int argc, char ** argv)
   
   // wait for all threads
   threader.wait ();
-  
+
+  // the transport never deletes its filters, so the capture is trimmed
+  // here
+  if (chains.capture)
+    chains.capture->close ();
+
+  stop_diagnostics (knowledge);
+
   // print all knowledge values
   knowledge.print ();
 
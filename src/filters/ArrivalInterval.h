@@ -0,0 +1,88 @@
+
+#ifndef   _FILTER_ARRIVALINTERVAL_H_
+#define   _FILTER_ARRIVALINTERVAL_H_
+
+#include <stdint.h>
+
+#include "madara/knowledge/Variables.h"
+
+namespace filters
+{
+  /**
+  * The average time between arrivals of one variable. A variable that
+  * arrives less often than every .receive.heartbeat seconds (default 1)
+  * is a heartbeat, which receive filters pass even when they sample
+  * faster variables down. Sharing it keeps the filters in agreement on
+  * which variables those are.
+  **/
+  class ArrivalInterval
+  {
+  public:
+    /// default nanoseconds between arrivals that make a heartbeat
+    static const int64_t HEARTBEAT = 1000000000;
+
+    /**
+     * Constructor
+     **/
+    ArrivalInterval ()
+    : last_arrival_ (0), interval_ (0)
+    {
+    }
+
+    /**
+     * Returns .receive.heartbeat in nanoseconds
+     * @param  vars    the knowledge base
+     * @return the setting, or HEARTBEAT if it is unset
+     **/
+    static int64_t get_heartbeat (madara::knowledge::Variables & vars)
+    {
+      if (!vars.exists (".receive.heartbeat"))
+        return HEARTBEAT;
+
+      return (int64_t)(vars.get (".receive.heartbeat").to_double () * 1e9);
+    }
+
+    /**
+     * Returns true if the variable has arrived before
+     **/
+    bool seen (void) const
+    {
+      return last_arrival_ != 0;
+    }
+
+    /**
+     * Records an arrival
+     * @param  current  now in nanoseconds
+     **/
+    void arrive (int64_t current)
+    {
+      if (last_arrival_)
+      {
+        const double interval = (double)(current - last_arrival_);
+        interval_ = interval_ > 0 ?
+          0.8 * interval_ + 0.2 * interval : interval;
+      }
+      last_arrival_ = current;
+    }
+
+    /**
+     * Returns true if the variable is a heartbeat. It is one until a
+     * second arrival gives it an interval.
+     * @param  heartbeat  nanoseconds between arrivals that make one
+     **/
+    bool is_heartbeat (int64_t heartbeat) const
+    {
+      return interval_ <= 0 || interval_ >= heartbeat;
+    }
+
+  private:
+    /// when the variable last arrived
+    int64_t last_arrival_;
+
+    /// average nanoseconds between arrivals
+    double interval_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_ARRIVALINTERVAL_H_
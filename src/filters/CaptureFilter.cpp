@@ -0,0 +1,32 @@
+
+#include "CaptureFilter.h"
+
+filters::CaptureFilter::CaptureFilter (const std::string & path)
+{
+  writer_.open (path);
+}
+
+filters::CaptureFilter::~CaptureFilter ()
+{
+}
+
+void
+filters::CaptureFilter::close (void)
+{
+  writer_.close ();
+}
+
+void
+filters::CaptureFilter::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext & transport_context,
+  madara::knowledge::Variables & vars)
+{
+  if (records.empty ())
+    return;
+
+  writer_.append (records, transport_context);
+
+  vars.set (".capture.entries",
+    (madara::knowledge::KnowledgeRecord::Integer)writer_.get_entries ());
+}
@@ -0,0 +1,56 @@
+#ifndef   _FILTER_CAPTUREFILTER_H_
+#define   _FILTER_CAPTUREFILTER_H_
+
+#include <string>
+
+#include "madara/filters/AggregateFilter.h"
+#include "utility/CaptureLog.h"
+
+namespace filters
+{
+  /**
+  * Appends every received packet, with its transport context, to a
+  * capture file (see utility::CaptureWriter) for replay without a
+  * network. It goes first in the receive filters, so the capture holds
+  * packets as they arrived, before any decoding or dropping. The number
+  * of packets captured is exported to .capture.entries.
+  **/
+  class CaptureFilter : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     * @param   path   the capture file, which is truncated
+     **/
+    CaptureFilter (const std::string & path);
+
+    /**
+     * Destructor, which closes the capture
+     **/
+    virtual ~CaptureFilter ();
+
+    /**
+     * Trims and closes the capture. Transports do not delete their
+     * filters, so this must be called at shutdown for the file to be
+     * trimmed. Packets received afterwards are not captured.
+     **/
+    void close (void);
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+  protected:
+    /// the capture file
+    utility::CaptureWriter writer_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_CAPTUREFILTER_H_
@@ -0,0 +1,135 @@
+#include "ChunkCodec.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string.h>
+
+const std::string filters::ChunkCodec::PREFIX ("~chunk.");
+const std::string filters::ChunkCodec::NACK_PREFIX ("~nack.");
+
+// bytes before the chunk
+static const size_t HEADER (1 + 5 * 4);
+
+std::string
+filters::ChunkCodec::chunk_name (const std::string & name, uint32_t index)
+{
+  std::stringstream buffer;
+  buffer << PREFIX << name << '~' << index;
+  return buffer.str ();
+}
+
+std::string
+filters::ChunkCodec::variable_name (const std::string & key)
+{
+  const size_t end = key.rfind ('~');
+  if (key.compare (0, PREFIX.size (), PREFIX) != 0 ||
+    end == std::string::npos || end < PREFIX.size ())
+    return "";
+
+  return key.substr (PREFIX.size (), end - PREFIX.size ());
+}
+
+std::string
+filters::ChunkCodec::nack_name (const std::string & name,
+  const std::string & originator)
+{
+  return NACK_PREFIX + name + '~' + originator;
+}
+
+std::string
+filters::ChunkCodec::nacked_variable (const std::string & key)
+{
+  const size_t end = key.rfind ('~');
+  if (key.compare (0, NACK_PREFIX.size (), NACK_PREFIX) != 0 ||
+    end == std::string::npos || end < NACK_PREFIX.size ())
+    return "";
+
+  return key.substr (NACK_PREFIX.size (), end - NACK_PREFIX.size ());
+}
+
+void
+filters::ChunkCodec::encode_chunk (const Chunk & header,
+  const std::vector <unsigned char> & data,
+  std::vector <unsigned char> & scratch,
+  madara::knowledge::KnowledgeRecord & result)
+{
+  const size_t offset = (size_t)header.index * header.chunk_bytes;
+  const size_t size = std::min <size_t> (header.chunk_bytes,
+    data.size () - offset);
+
+  scratch.resize (HEADER + size);
+
+  unsigned char * cursor = &scratch[0];
+  *cursor++ = CHUNK;
+  memcpy (cursor, &header.version, 4);
+  memcpy (cursor + 4, &header.index, 4);
+  memcpy (cursor + 8, &header.count, 4);
+  memcpy (cursor + 12, &header.total, 4);
+  memcpy (cursor + 16, &header.chunk_bytes, 4);
+  if (size)
+    memcpy (cursor + 20, &data[offset], size);
+
+  result.set_file (&scratch[0], scratch.size ());
+}
+
+bool
+filters::ChunkCodec::decode_chunk (
+  const madara::knowledge::KnowledgeRecord & record,
+  Chunk & header, unsigned char *& buffer, const unsigned char *& payload)
+{
+  buffer = 0;
+  if (!record.is_binary_file_type ())
+    return false;
+
+  size_t size = 0;
+  buffer = record.to_unmanaged_buffer (size);
+  if (!buffer || size < HEADER || buffer[0] != CHUNK)
+    return false;
+
+  memcpy (&header.version, buffer + 1, 4);
+  memcpy (&header.index, buffer + 5, 4);
+  memcpy (&header.count, buffer + 9, 4);
+  memcpy (&header.total, buffer + 13, 4);
+  memcpy (&header.chunk_bytes, buffer + 17, 4);
+  payload = buffer + HEADER;
+
+  // every chunk but the last is full
+  const uint64_t offset = (uint64_t)header.index * header.chunk_bytes;
+  return header.chunk_bytes > 0 && header.index < header.count &&
+    header.count == (header.total + (uint64_t)header.chunk_bytes - 1) /
+      header.chunk_bytes &&
+    offset + (size - HEADER) == std::min <uint64_t> (
+      offset + header.chunk_bytes, header.total);
+}
+
+std::string
+filters::ChunkCodec::encode_nack (uint32_t version,
+  const std::string & originator, const std::vector <uint32_t> & missing)
+{
+  std::stringstream buffer;
+  buffer << version << ' ' << originator;
+  for (size_t i = 0; i < missing.size (); ++i)
+  {
+    buffer << ' ' << missing[i];
+  }
+  return buffer.str ();
+}
+
+bool
+filters::ChunkCodec::decode_nack (
+  const madara::knowledge::KnowledgeRecord & record,
+  uint32_t & version, std::string & originator,
+  std::vector <uint32_t> & missing)
+{
+  std::stringstream buffer (record.to_string ());
+  if (!(buffer >> version >> originator))
+    return false;
+
+  missing.clear ();
+  uint32_t index;
+  while (buffer >> index)
+  {
+    missing.push_back (index);
+  }
+  return true;
+}
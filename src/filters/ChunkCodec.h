@@ -0,0 +1,127 @@
+#ifndef   _FILTER_CHUNKCODEC_H_
+#define   _FILTER_CHUNKCODEC_H_
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeRecord.h"
+
+namespace filters
+{
+  /**
+  * Wire format shared by ChunkSendFilter and ChunkReceiveFilter. A large
+  * record is serialized with its name and split into chunks, each sent
+  * as a binary record named PREFIX + name + '~' + index:
+  *
+  *   'C', uint32 version, uint32 index, uint32 count, uint32 total bytes,
+  *   uint32 bytes per chunk, the chunk
+  *
+  * Missing chunks are requested with a string record named NACK_PREFIX +
+  * name + '~' + the sender's transport id, so NACKs to different senders
+  * of a name do not replace each other. It holds the version, the
+  * sender's transport id and the missing indices, separated by spaces.
+  * Numbers in chunks are in host byte order, so agents must share a byte
+  * order.
+  **/
+  class ChunkCodec
+  {
+  public:
+    /// prefixes of chunk and NACK names
+    static const std::string PREFIX;
+    static const std::string NACK_PREFIX;
+
+    /// record kind
+    static const unsigned char CHUNK = 'C';
+
+    /**
+    * The header of a chunk
+    **/
+    struct Chunk
+    {
+      uint32_t version;
+      uint32_t index;
+      uint32_t count;
+      uint32_t total;
+      uint32_t chunk_bytes;
+    };
+
+    /**
+     * Returns the name of a chunk
+     * @param  name      the variable
+     * @param  index     chunk index
+     **/
+    static std::string chunk_name (const std::string & name, uint32_t index);
+
+    /**
+     * Returns the variable a chunk belongs to
+     * @param  key       the chunk name
+     * @return the variable, or an empty string if key is not a chunk
+     **/
+    static std::string variable_name (const std::string & key);
+
+    /**
+     * Returns the name of a NACK
+     * @param  name        the variable
+     * @param  originator  transport id of the sender
+     **/
+    static std::string nack_name (const std::string & name,
+      const std::string & originator);
+
+    /**
+     * Returns the variable a NACK asks for
+     * @param  key       the NACK name
+     * @return the variable, or an empty string if key is not a NACK
+     **/
+    static std::string nacked_variable (const std::string & key);
+
+    /**
+     * Encodes a chunk
+     * @param  header    version, index, count, total and chunk_bytes
+     * @param  data      the serialized record
+     * @param  scratch   buffer to encode into, reused between calls
+     * @param  result    the encoded record
+     **/
+    static void encode_chunk (const Chunk & header,
+      const std::vector <unsigned char> & data,
+      std::vector <unsigned char> & scratch,
+      madara::knowledge::KnowledgeRecord & result);
+
+    /**
+     * Decodes a chunk
+     * @param  record    the encoded record
+     * @param  header    the header
+     * @param  buffer    the record's bytes, to delete [] after use
+     * @param  payload   the chunk within buffer
+     * @return true if the chunk was well formed
+     **/
+    static bool decode_chunk (const madara::knowledge::KnowledgeRecord & record,
+      Chunk & header, unsigned char *& buffer, const unsigned char *& payload);
+
+    /**
+     * Encodes a NACK
+     * @param  version     version the chunks are missing from
+     * @param  originator  transport id of the sender
+     * @param  missing     missing chunk indices
+     * @return the record
+     **/
+    static std::string encode_nack (uint32_t version,
+      const std::string & originator, const std::vector <uint32_t> & missing);
+
+    /**
+     * Decodes a NACK
+     * @param  record      the encoded record
+     * @param  version     version the chunks are missing from
+     * @param  originator  transport id of the sender
+     * @param  missing     missing chunk indices
+     * @return true if the NACK was well formed
+     **/
+    static bool decode_nack (const madara::knowledge::KnowledgeRecord & record,
+      uint32_t & version, std::string & originator,
+      std::vector <uint32_t> & missing);
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_CHUNKCODEC_H_
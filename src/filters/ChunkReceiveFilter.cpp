@@ -0,0 +1,265 @@
+
+#include "ChunkReceiveFilter.h"
+#include "ChunkCodec.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "madara/transport/TransportContext.h"
+
+// most chunks one NACK asks for
+static const size_t MAX_NACKED (256);
+
+// timeouts after which a finished assembly and its buffer are released
+static const int64_t RELEASE_TIMEOUTS (10);
+
+filters::ChunkReceiveFilter::ChunkReceiveFilter (ChunkSendFilter * sender)
+: sender_ (sender), nack_delay_ (100000000), timeout_ (5000000000),
+  max_total_ (16777216), completed_ (0), stale_ (0), oversized_ (0),
+  misnamed_ (0), nacks_ (0), abandoned_ (0),
+  last_configure_ (0), last_check_ (0), last_publish_ (0)
+{
+}
+
+filters::ChunkReceiveFilter::~ChunkReceiveFilter ()
+{
+}
+
+void
+filters::ChunkReceiveFilter::configure (madara::knowledge::Variables & vars)
+{
+  if (vars.exists (".chunk.nack_delay"))
+    nack_delay_ = (int64_t)(vars.get (".chunk.nack_delay").to_double () * 1e9);
+
+  if (vars.exists (".chunk.timeout"))
+    timeout_ = (int64_t)(vars.get (".chunk.timeout").to_double () * 1e9);
+
+  if (vars.exists (".chunk.max_total"))
+  {
+    const int64_t max_total = vars.get (".chunk.max_total").to_integer ();
+    max_total_ = (uint32_t)std::max <int64_t> (0,
+      std::min <int64_t> (max_total, UINT32_MAX));
+  }
+}
+
+void
+filters::ChunkReceiveFilter::add (Assembly & assembly,
+  const madara::knowledge::KnowledgeRecord & record, int64_t current,
+  madara::knowledge::KnowledgeMap & restored)
+{
+  ChunkCodec::Chunk header;
+  unsigned char * buffer;
+  const unsigned char * payload;
+
+  const bool decoded =
+    ChunkCodec::decode_chunk (record, header, buffer, payload);
+
+  if (decoded && header.total > max_total_)
+  {
+    // the total comes from the wire, so it is checked before the buffer
+    // is sized for it
+    ++oversized_;
+  }
+  else if (decoded)
+  {
+    // versions start from the sender's clock, so a restarted sender may
+    // count from below an abandoned one
+    const bool newer = assembly.count == 0 ||
+      (int32_t)(header.version - assembly.version) > 0 ||
+      (header.version != assembly.version &&
+        current - assembly.last_arrival >= timeout_);
+
+    if (newer)
+    {
+      assembly.version = header.version;
+      assembly.done = false;
+      assembly.buffer.resize (header.total);
+      assembly.received.assign (header.count, false);
+      assembly.count = header.count;
+      assembly.remaining = header.count;
+      assembly.last_nack = current;
+    }
+
+    if (header.version != assembly.version ||
+      header.count != assembly.count ||
+      header.total != assembly.buffer.size ())
+    {
+      ++stale_;
+    }
+    else if (!assembly.done && !assembly.received[header.index])
+    {
+      const size_t offset = (size_t)header.index * header.chunk_bytes;
+      const size_t size = std::min <size_t> (header.chunk_bytes,
+        header.total - offset);
+      if (size)
+        memcpy (&assembly.buffer[offset], payload, size);
+
+      assembly.received[header.index] = true;
+      assembly.last_arrival = current;
+
+      if (--assembly.remaining == 0)
+      {
+        assembly.done = true;
+
+        // the key comes from the payload, so a chunk stream may only
+        // restore the variable it is named for
+        std::string key;
+        madara::knowledge::KnowledgeRecord result;
+        int64_t bytes = (int64_t)assembly.buffer.size ();
+        const bool read =
+          result.read ((const char *)&assembly.buffer[0], key, bytes) != 0;
+        if (read && key != assembly.name)
+        {
+          ++misnamed_;
+        }
+        else if (read)
+        {
+          result.clock = record.clock;
+          result.quality = record.quality;
+          restored[key] = result;
+          ++completed_;
+        }
+      }
+    }
+  }
+
+  delete [] buffer;
+}
+
+void
+filters::ChunkReceiveFilter::check (madara::knowledge::Variables & vars,
+  int64_t current)
+{
+  for (std::unordered_map <std::string, Assembly>::iterator i =
+    assemblies_.begin (); i != assemblies_.end (); )
+  {
+    Assembly & assembly = i->second;
+
+    if (assembly.done)
+    {
+      if (current - assembly.last_arrival >= timeout_ * RELEASE_TIMEOUTS)
+        i = assemblies_.erase (i);
+      else
+        ++i;
+      continue;
+    }
+
+    if (current - assembly.last_arrival >= timeout_)
+    {
+      assembly.done = true;
+      ++abandoned_;
+    }
+    else if (current - assembly.last_arrival >= nack_delay_ &&
+      current - assembly.last_nack >= nack_delay_)
+    {
+      missing_.clear ();
+      for (uint32_t j = 0; j < assembly.count && missing_.size () < MAX_NACKED;
+        ++j)
+      {
+        if (!assembly.received[j])
+          missing_.push_back (j);
+      }
+
+      // sent with our next update
+      vars.set (ChunkCodec::nack_name (assembly.name, assembly.originator),
+        ChunkCodec::encode_nack (
+          assembly.version, assembly.originator, missing_));
+
+      assembly.last_nack = current;
+      ++nacks_;
+    }
+
+    ++i;
+  }
+}
+
+void
+filters::ChunkReceiveFilter::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext & transport_context,
+  madara::knowledge::Variables & vars)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  // NACKs are for senders, and never reach the knowledge base
+  std::string id;
+  if (sender_)
+    id = sender_->get_id ();
+
+  for (madara::knowledge::KnowledgeMap::iterator i =
+    records.lower_bound (ChunkCodec::NACK_PREFIX); i != records.end () &&
+    i->first.compare (0, ChunkCodec::NACK_PREFIX.size (),
+      ChunkCodec::NACK_PREFIX) == 0; )
+  {
+    uint32_t version;
+    std::string originator;
+    const std::string name = ChunkCodec::nacked_variable (i->first);
+    if (!name.empty () &&
+      ChunkCodec::decode_nack (i->second, version, originator, missing_) &&
+      !id.empty () && originator == id)
+    {
+      sender_->retransmit (name, version, missing_);
+    }
+
+    records.erase (i++);
+  }
+
+  madara::knowledge::KnowledgeMap restored;
+  for (madara::knowledge::KnowledgeMap::iterator i =
+    records.lower_bound (ChunkCodec::PREFIX); i != records.end () &&
+    i->first.compare (0, ChunkCodec::PREFIX.size (), ChunkCodec::PREFIX) == 0; )
+  {
+    const std::string name = ChunkCodec::variable_name (i->first);
+    if (!name.empty ())
+    {
+      Assembly & assembly =
+        assemblies_[transport_context.get_originator () + "/" + name];
+      if (assembly.name.empty ())
+      {
+        assembly.originator = transport_context.get_originator ();
+        assembly.name = name;
+        assembly.version = 0;
+        assembly.count = 0;
+        assembly.last_arrival = current;
+      }
+
+      add (assembly, i->second, current, restored);
+    }
+
+    records.erase (i++);
+  }
+
+  for (madara::knowledge::KnowledgeMap::iterator i = restored.begin ();
+    i != restored.end (); ++i)
+  {
+    records[i->first] = i->second;
+  }
+
+  if (current - last_check_ >= nack_delay_ / 2)
+  {
+    check (vars, current);
+    last_check_ = current;
+  }
+
+  if (current - last_publish_ >= PUBLISH_PERIOD)
+  {
+    vars.set (".chunk.completed", (Integer)completed_);
+    vars.set (".chunk.stale", (Integer)stale_);
+    vars.set (".chunk.oversized", (Integer)oversized_);
+    vars.set (".chunk.misnamed", (Integer)misnamed_);
+    vars.set (".chunk.nacks", (Integer)nacks_);
+    vars.set (".chunk.abandoned", (Integer)abandoned_);
+    last_publish_ = current;
+  }
+}
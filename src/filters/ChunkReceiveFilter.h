@@ -0,0 +1,145 @@
+#ifndef   _FILTER_CHUNKRECEIVEFILTER_H_
+#define   _FILTER_CHUNKRECEIVEFILTER_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+#include "ChunkSendFilter.h"
+
+namespace filters
+{
+  /**
+  * Reassembles records chunked by ChunkSendFilter, per sender, into
+  * buffers sized once per version and reused. A chunk of a newer version
+  * discards the one being assembled, and chunks of older versions are
+  * dropped. Missing chunks are requested with a NACK once no chunk has
+  * arrived for .chunk.nack_delay seconds. NACKs for our own ChunkSendFilter
+  * are passed to it, and no NACK reaches the knowledge base.
+  *
+  * Settings, reread once per second:
+  *
+  *   .chunk.nack_delay  seconds without chunks before a NACK, and between
+  *                      NACKs (default 0.1)
+  *   .chunk.timeout     seconds without chunks before a version is
+  *                      abandoned (default 5)
+  *   .chunk.max_total   largest record in bytes a chunk may claim to be
+  *                      part of (default 16 MB). Chunks of larger ones
+  *                      are dropped before any buffer is sized for them.
+  *
+  * A reassembled record is only restored under the name its chunks were
+  * sent as, so chunks cannot write other variables, e.g. locals.
+  *
+  * Exported once per second to .chunk.*: completed, stale, oversized,
+  * misnamed, nacks and abandoned.
+  **/
+  class ChunkReceiveFilter : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     * @param   sender   the send filter of this agent, for NACKs
+     **/
+    ChunkReceiveFilter (ChunkSendFilter * sender);
+
+    /**
+     * Destructor
+     **/
+    virtual ~ChunkReceiveFilter ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+  protected:
+    /**
+    * A version being assembled from one sender
+    **/
+    struct Assembly
+    {
+      /// the sender, and the record's name
+      std::string originator;
+      std::string name;
+
+      /// version, and whether it is complete or abandoned
+      uint32_t version;
+      bool done;
+
+      /// the serialized record, and which chunks have arrived
+      std::vector <unsigned char> buffer;
+      std::vector <bool> received;
+      uint32_t count;
+      uint32_t remaining;
+
+      /// when a chunk last arrived and a NACK was last sent
+      int64_t last_arrival;
+      int64_t last_nack;
+    };
+
+    /**
+     * Reads the settings from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Adds a chunk to its assembly
+     * @param   assembly  the assembly
+     * @param   record    the chunk
+     * @param   current   now in nanoseconds
+     * @param   restored  receives the record once complete
+     **/
+    void add (Assembly & assembly,
+      const madara::knowledge::KnowledgeRecord & record, int64_t current,
+      madara::knowledge::KnowledgeMap & restored);
+
+    /**
+     * Sends NACKs for stalled assemblies and abandons timed out ones
+     * @param   vars      the knowledge base
+     * @param   current   now in nanoseconds
+     **/
+    void check (madara::knowledge::Variables & vars, int64_t current);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// our send filter
+    ChunkSendFilter * sender_;
+
+    /// settings
+    int64_t nack_delay_;
+    int64_t timeout_;
+    uint32_t max_total_;
+
+    /// assemblies by sender and name
+    std::unordered_map <std::string, Assembly> assemblies_;
+
+    /// scratch space for NACKed indices
+    std::vector <uint32_t> missing_;
+
+    /// totals
+    int64_t completed_;
+    int64_t stale_;
+    int64_t oversized_;
+    int64_t misnamed_;
+    int64_t nacks_;
+    int64_t abandoned_;
+
+    /// last configuration, check and export in nanoseconds
+    int64_t last_configure_;
+    int64_t last_check_;
+    int64_t last_publish_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_CHUNKRECEIVEFILTER_H_
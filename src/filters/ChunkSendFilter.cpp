@@ -0,0 +1,264 @@
+
+#include "ChunkSendFilter.h"
+#include "ChunkCodec.h"
+#include "TrafficClasses.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include "madara/transport/TransportContext.h"
+
+filters::ChunkSendFilter::ChunkSendFilter ()
+: threshold_ (8192), chunk_bytes_ (1024), per_send_ (8),
+  keep_ (10000000000), next_version_ ((uint32_t)(utility::now () / 1000000)),
+  versions_ (0), chunks_sent_ (0), retransmits_ (0), last_configure_ (0),
+  last_publish_ (0)
+{
+}
+
+filters::ChunkSendFilter::~ChunkSendFilter ()
+{
+}
+
+void
+filters::ChunkSendFilter::configure (madara::knowledge::Variables & vars)
+{
+  if (vars.exists (".chunk.threshold"))
+    threshold_ = vars.get (".chunk.threshold").to_integer ();
+
+  if (vars.exists (".chunk.size") &&
+    vars.get (".chunk.size").to_integer () > 0)
+    chunk_bytes_ = (uint32_t)vars.get (".chunk.size").to_integer ();
+
+  if (vars.exists (".chunk.per_send"))
+    per_send_ = (size_t)vars.get (".chunk.per_send").to_integer ();
+
+  if (vars.exists (".chunk.keep"))
+    keep_ = (int64_t)(vars.get (".chunk.keep").to_double () * 1e9);
+}
+
+std::string
+filters::ChunkSendFilter::get_id (void)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+  return id_;
+}
+
+void
+filters::ChunkSendFilter::start (const std::string & name,
+  const madara::knowledge::KnowledgeRecord & record,
+  Transfer & transfer, int64_t current)
+{
+  transfer.version = ++next_version_;
+  transfer.clock = record.clock;
+  transfer.last_active = current;
+
+  // the record keeps its name, so receivers restore it as it was sent
+  int64_t remaining = TrafficClasses::encoded_size (name, record) + 64;
+  transfer.data.resize ((size_t)remaining);
+  char * begin = (char *)&transfer.data[0];
+  char * end = record.write (begin, name, remaining);
+  transfer.data.resize (end ? end - begin : 0);
+
+  transfer.count = (uint32_t)(
+    (transfer.data.size () + chunk_bytes_ - 1) / chunk_bytes_);
+
+  // chunks of the last version are no longer worth sending
+  transfer.pending.clear ();
+  transfer.queued.assign (transfer.count, true);
+  for (uint32_t i = 0; i < transfer.count; ++i)
+  {
+    transfer.pending.push_back (i);
+  }
+
+  ++versions_;
+}
+
+void
+filters::ChunkSendFilter::fill (madara::knowledge::KnowledgeMap & records)
+{
+  if (transfers_.empty ())
+    return;
+
+  // start after the transfer served last, so large records take turns
+  std::vector <std::map <std::string, Transfer>::iterator> order;
+  order.reserve (transfers_.size ());
+  std::map <std::string, Transfer>::iterator first =
+    transfers_.upper_bound (cursor_);
+  for (std::map <std::string, Transfer>::iterator i = first;
+    i != transfers_.end (); ++i)
+  {
+    order.push_back (i);
+  }
+  for (std::map <std::string, Transfer>::iterator i = transfers_.begin ();
+    i != first; ++i)
+  {
+    order.push_back (i);
+  }
+
+  size_t added = 0;
+  bool progress = true;
+  while (added < per_send_ && progress)
+  {
+    progress = false;
+    for (size_t i = 0; i < order.size () && added < per_send_; ++i)
+    {
+      Transfer & transfer = order[i]->second;
+      if (transfer.pending.empty ())
+        continue;
+
+      ChunkCodec::Chunk header;
+      header.version = transfer.version;
+      header.index = transfer.pending.front ();
+      header.count = transfer.count;
+      header.total = (uint32_t)transfer.data.size ();
+      header.chunk_bytes = chunk_bytes_;
+
+      transfer.pending.pop_front ();
+      transfer.queued[header.index] = false;
+
+      madara::knowledge::KnowledgeRecord result;
+      ChunkCodec::encode_chunk (header, transfer.data, scratch_, result);
+      result.clock = transfer.clock;
+      records[ChunkCodec::chunk_name (order[i]->first, header.index)] = result;
+
+      cursor_ = order[i]->first;
+      ++added;
+      progress = true;
+    }
+  }
+
+  chunks_sent_ += added;
+}
+
+void
+filters::ChunkSendFilter::publish (madara::knowledge::Variables & vars)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  Integer pending = 0;
+  for (std::map <std::string, Transfer>::const_iterator i =
+    transfers_.begin (); i != transfers_.end (); ++i)
+  {
+    pending += (Integer)i->second.pending.size ();
+  }
+
+  vars.set (".chunk.versions", (Integer)versions_);
+  vars.set (".chunk.chunks_sent", (Integer)chunks_sent_);
+  vars.set (".chunk.retransmits", (Integer)retransmits_);
+  vars.set (".chunk.pending", pending);
+}
+
+void
+filters::ChunkSendFilter::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext & transport_context,
+  madara::knowledge::Variables & vars)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    id_ = transport_context.get_originator ();
+    last_configure_ = current;
+  }
+
+  for (madara::knowledge::KnowledgeMap::iterator i = records.begin ();
+    i != records.end (); )
+  {
+    std::map <std::string, Transfer>::iterator found =
+      transfers_.find (i->first);
+
+    if (threshold_ <= 0 ||
+      TrafficClasses::encoded_size (i->first, i->second) < threshold_)
+    {
+      // a small new version replaces a chunked one
+      if (found != transfers_.end ())
+        transfers_.erase (found);
+      ++i;
+      continue;
+    }
+
+    // a record resent with the same clock is the version being chunked
+    if (found == transfers_.end () || found->second.clock != i->second.clock)
+    {
+      Transfer & transfer = transfers_[i->first];
+      start (i->first, i->second, transfer, current);
+    }
+
+    records.erase (i++);
+  }
+
+  // versions nobody asked for within keep are released
+  for (std::map <std::string, Transfer>::iterator i = transfers_.begin ();
+    i != transfers_.end (); )
+  {
+    if (i->second.pending.empty () &&
+      current - i->second.last_active >= keep_)
+      transfers_.erase (i++);
+    else
+      ++i;
+  }
+
+  fill (records);
+
+  if (current - last_publish_ >= PUBLISH_PERIOD)
+  {
+    publish (vars);
+    last_publish_ = current;
+  }
+}
+
+void
+filters::ChunkSendFilter::retransmit (const std::string & name,
+  uint32_t version, const std::vector <uint32_t> & missing)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  std::map <std::string, Transfer>::iterator found = transfers_.find (name);
+  if (found == transfers_.end () || found->second.version != version)
+    return;
+
+  Transfer & transfer = found->second;
+  transfer.last_active = utility::Clock::now ();
+  for (size_t i = 0; i < missing.size (); ++i)
+  {
+    const uint32_t index = missing[i];
+    if (index < transfer.count && !transfer.queued[index])
+    {
+      transfer.queued[index] = true;
+      transfer.pending.push_back (index);
+      ++retransmits_;
+    }
+  }
+}
+
+void
+filters::ChunkSendFilter::flush (madara::knowledge::KnowledgeBase & knowledge)
+{
+  std::vector <std::string> names;
+  {
+    std::lock_guard <std::mutex> guard (mutex_);
+    for (std::map <std::string, Transfer>::const_iterator i =
+      transfers_.begin (); i != transfers_.end (); ++i)
+    {
+      // the variable is sent as encoded by earlier filters, e.g. ~lz.map
+      if (!i->second.pending.empty ())
+        names.push_back (
+          i->first.substr (TrafficClasses::skip_encodings (i->first)));
+    }
+  }
+
+  if (names.empty ())
+    return;
+
+  // the send runs this filter, which sees the same version and adds its
+  // waiting chunks
+  for (size_t i = 0; i < names.size (); ++i)
+  {
+    if (knowledge.exists (names[i]))
+      knowledge.mark_modified (knowledge.get_ref (names[i]));
+  }
+  knowledge.send_modifieds ("ChunkSendFilter::flush");
+}
@@ -0,0 +1,166 @@
+#ifndef   _FILTER_CHUNKSENDFILTER_H_
+#define   _FILTER_CHUNKSENDFILTER_H_
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+#include "madara/knowledge/KnowledgeBase.h"
+
+namespace filters
+{
+  /**
+  * Sends records too large for one datagram as versioned chunks, a few
+  * per send, which ChunkReceiveFilter reassembles (see ChunkCodec for
+  * the format). A record with a new clock starts a new version and
+  * discards the chunks of the last one still waiting. Chunks a receiver
+  * reports missing are sent again, for as long as the version is kept.
+  *
+  * Settings, reread once per second:
+  *
+  *   .chunk.threshold  smallest record in bytes to chunk (default 8192),
+  *                     0 to chunk nothing
+  *   .chunk.size       bytes per chunk (default 1024)
+  *   .chunk.per_send   most chunks per send (default 8)
+  *   .chunk.keep       seconds a sent version is kept for retransmits
+  *                     (default 10)
+  *   .chunk.hertz      rate the controller runs flush at (default 50)
+  *
+  * When nothing else sends, flush must be called periodically to send
+  * waiting chunks. Exported once per second to .chunk.*: versions,
+  * chunks_sent, retransmits and pending.
+  **/
+  class ChunkSendFilter : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    ChunkSendFilter ();
+
+    /**
+     * Destructor
+     **/
+    virtual ~ChunkSendFilter ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+    /**
+     * Queues chunks a receiver is missing to be sent again
+     * @param   name      the chunked record
+     * @param   version   the version they are missing from
+     * @param   missing   chunk indices
+     **/
+    void retransmit (const std::string & name, uint32_t version,
+      const std::vector <uint32_t> & missing);
+
+    /**
+     * Returns the transport id chunks are sent from, as receivers see it
+     **/
+    std::string get_id (void);
+
+    /**
+     * Sends waiting chunks, by marking the variables they belong to
+     * modified and sending modifieds
+     * @param   knowledge  the knowledge base the filter sends for
+     **/
+    void flush (madara::knowledge::KnowledgeBase & knowledge);
+
+  protected:
+    /**
+    * The latest version of one chunked record
+    **/
+    struct Transfer
+    {
+      /// version, and the clock of the record it holds
+      uint32_t version;
+      uint64_t clock;
+
+      /// the serialized record, and its chunk count
+      std::vector <unsigned char> data;
+      uint32_t count;
+
+      /// chunks waiting to be sent, and which are waiting
+      std::deque <uint32_t> pending;
+      std::vector <bool> queued;
+
+      /// when the version started or was last asked for
+      int64_t last_active;
+    };
+
+    /**
+     * Reads the settings from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Serializes a record as a new version
+     * @param   name      the record's name
+     * @param   record    the record
+     * @param   transfer  its transfer
+     * @param   current   now in nanoseconds
+     **/
+    void start (const std::string & name,
+      const madara::knowledge::KnowledgeRecord & record,
+      Transfer & transfer, int64_t current);
+
+    /**
+     * Adds waiting chunks to a packet, one per transfer in turn
+     * @param   records   the packet
+     **/
+    void fill (madara::knowledge::KnowledgeMap & records);
+
+    /**
+     * Exports the totals
+     * @param   vars   the knowledge base
+     **/
+    void publish (madara::knowledge::Variables & vars);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// settings
+    int64_t threshold_;
+    uint32_t chunk_bytes_;
+    size_t per_send_;
+    int64_t keep_;
+
+    /// our transport id
+    std::string id_;
+
+    /// transfers by record name, and where the next fill starts
+    std::map <std::string, Transfer> transfers_;
+    std::string cursor_;
+
+    /// the next version, which starts from the time so restarts differ
+    uint32_t next_version_;
+
+    /// scratch space reused between chunks
+    std::vector <unsigned char> scratch_;
+
+    /// totals
+    int64_t versions_;
+    int64_t chunks_sent_;
+    int64_t retransmits_;
+
+    /// last configuration and export in nanoseconds
+    int64_t last_configure_;
+    int64_t last_publish_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_CHUNKSENDFILTER_H_
@@ -0,0 +1,90 @@
+
+#include "CompressReceiveFilter.h"
+#include "CompressionCodec.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <vector>
+
+filters::CompressReceiveFilter::CompressReceiveFilter ()
+: bytes_out_ (0), nanoseconds_ (0), decompressed_ (0), errors_ (0),
+  max_size_ (CompressionCodec::MAX_SIZE), last_configure_ (0),
+  last_publish_ (0)
+{
+}
+
+filters::CompressReceiveFilter::~CompressReceiveFilter ()
+{
+}
+
+void
+filters::CompressReceiveFilter::configure (madara::knowledge::Variables & vars)
+{
+  if (vars.exists (".compress.max_size"))
+    max_size_ = (size_t)vars.get (".compress.max_size").to_integer ();
+}
+
+void
+filters::CompressReceiveFilter::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext &,
+  madara::knowledge::Variables & vars)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  std::vector <std::pair <std::string, madara::knowledge::KnowledgeRecord> >
+    decoded;
+
+  // encoded names sort together, so only that range is visited
+  for (madara::knowledge::KnowledgeMap::iterator i =
+    records.lower_bound (CompressionCodec::PREFIX);
+    i != records.end () && i->first.compare (
+      0, CompressionCodec::PREFIX.size (), CompressionCodec::PREFIX) == 0; )
+  {
+    madara::knowledge::KnowledgeRecord result;
+
+    const int64_t start = utility::now ();
+    const bool restored =
+      CompressionCodec::decode (i->second, result, max_size_);
+    nanoseconds_ += utility::now () - start;
+
+    if (restored)
+    {
+      result.clock = i->second.clock;
+      result.quality = i->second.quality;
+      bytes_out_ += result.size ();
+      ++decompressed_;
+      decoded.push_back (std::make_pair (
+        i->first.substr (CompressionCodec::PREFIX.size ()), result));
+    }
+    else
+    {
+      ++errors_;
+    }
+
+    records.erase (i++);
+  }
+
+  for (size_t i = 0; i < decoded.size (); ++i)
+  {
+    records[decoded[i].first] = decoded[i].second;
+  }
+
+  if (decompressed_ + errors_ > 0 && current - last_publish_ >= PUBLISH_PERIOD)
+  {
+    vars.set (".compress.decompressed", (Integer)decompressed_);
+    vars.set (".compress.errors", (Integer)errors_);
+    if (bytes_out_ > 0)
+      vars.set (".compress.decode_us_per_mb", nanoseconds_ * 1e3 / bytes_out_);
+    last_publish_ = current;
+  }
+}
@@ -0,0 +1,76 @@
+#ifndef   _FILTER_COMPRESSRECEIVEFILTER_H_
+#define   _FILTER_COMPRESSRECEIVEFILTER_H_
+
+#include <mutex>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+
+namespace filters
+{
+  /**
+  * Restores records compressed by CompressSendFilter. Malformed records
+  * are dropped and counted. It runs before any other receive filter, so
+  * they see the original records.
+  *
+  * Settings, reread once per second:
+  *
+  *   .compress.max_size     largest original size in bytes a record may
+  *                          claim (default CompressionCodec::MAX_SIZE).
+  *                          Larger claims are errors.
+  *
+  * Exported once per second to .compress.*: decompressed, errors and
+  * decode_us_per_mb (decompression time per MB out).
+  **/
+  class CompressReceiveFilter : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    CompressReceiveFilter ();
+
+    /**
+     * Destructor
+     **/
+    virtual ~CompressReceiveFilter ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+  protected:
+    /**
+     * Reads the settings from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// totals
+    int64_t bytes_out_;
+    int64_t nanoseconds_;
+    int64_t decompressed_;
+    int64_t errors_;
+
+    /// largest original size accepted
+    size_t max_size_;
+
+    /// last configuration and export in nanoseconds
+    int64_t last_configure_;
+    int64_t last_publish_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_COMPRESSRECEIVEFILTER_H_
@@ -0,0 +1,131 @@
+
+#include "CompressSendFilter.h"
+#include "CompressionCodec.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <algorithm>
+#include <vector>
+
+filters::CompressSendFilter::CompressSendFilter ()
+: threshold_ (1024), min_saving_ (0.1), max_backoff_ (64), bytes_in_ (0),
+  bytes_out_ (0), nanoseconds_ (0), compressed_ (0), unprofitable_ (0),
+  skipped_ (0), last_configure_ (0), last_publish_ (0)
+{
+}
+
+filters::CompressSendFilter::~CompressSendFilter ()
+{
+}
+
+void
+filters::CompressSendFilter::configure (madara::knowledge::Variables & vars)
+{
+  if (vars.exists (".compress.threshold"))
+    threshold_ = (size_t)vars.get (".compress.threshold").to_integer ();
+
+  if (vars.exists (".compress.min_saving"))
+    min_saving_ = vars.get (".compress.min_saving").to_double ();
+
+  if (vars.exists (".compress.max_backoff"))
+    max_backoff_ = (uint32_t)vars.get (".compress.max_backoff").to_integer ();
+}
+
+void
+filters::CompressSendFilter::publish (madara::knowledge::Variables & vars)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  vars.set (".compress.bytes_in", (Integer)bytes_in_);
+  vars.set (".compress.bytes_out", (Integer)bytes_out_);
+  vars.set (".compress.compressed", (Integer)compressed_);
+  vars.set (".compress.unprofitable", (Integer)unprofitable_);
+  vars.set (".compress.skipped", (Integer)skipped_);
+
+  if (bytes_in_ > 0)
+  {
+    vars.set (".compress.ratio", (double)bytes_out_ / bytes_in_);
+    vars.set (".compress.us_per_mb", nanoseconds_ * 1e3 / bytes_in_);
+  }
+}
+
+void
+filters::CompressSendFilter::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext &,
+  madara::knowledge::Variables & vars)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  std::vector <std::pair <std::string, madara::knowledge::KnowledgeRecord> >
+    encoded;
+
+  for (madara::knowledge::KnowledgeMap::iterator i = records.begin ();
+    threshold_ > 0 && i != records.end (); )
+  {
+    const madara::knowledge::KnowledgeRecord & record = i->second;
+    if (record.size () < threshold_ ||
+      !CompressionCodec::is_compressible (record))
+    {
+      ++i;
+      continue;
+    }
+
+    VariableState & state = variables_[i->first];
+    if (state.skips > 0)
+    {
+      --state.skips;
+      ++skipped_;
+      ++i;
+      continue;
+    }
+
+    madara::knowledge::KnowledgeRecord result;
+    size_t original = 0;
+
+    const int64_t start = utility::now ();
+    const size_t size = CompressionCodec::encode (record, result, original);
+    nanoseconds_ += utility::now () - start;
+    bytes_in_ += original;
+
+    // values that do not compress are sent as is, and the variable is
+    // retried after a backoff
+    if (size > original * (1 - min_saving_))
+    {
+      state.failures = std::min <uint32_t> (state.failures + 1, 31);
+      state.skips = std::min <uint32_t> (
+        (1u << (state.failures - 1)), max_backoff_);
+      ++unprofitable_;
+      bytes_out_ += original;
+      ++i;
+      continue;
+    }
+
+    state.failures = 0;
+
+    // keep the original clock and quality for conflict resolution
+    result.clock = record.clock;
+    result.quality = record.quality;
+
+    encoded.push_back (
+      std::make_pair (CompressionCodec::PREFIX + i->first, result));
+    ++compressed_;
+    bytes_out_ += size;
+    records.erase (i++);
+  }
+
+  records.insert (encoded.begin (), encoded.end ());
+
+  if (current - last_publish_ >= PUBLISH_PERIOD)
+  {
+    publish (vars);
+    last_publish_ = current;
+  }
+}
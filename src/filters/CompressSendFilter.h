@@ -0,0 +1,105 @@
+#ifndef   _FILTER_COMPRESSSENDFILTER_H_
+#define   _FILTER_COMPRESSSENDFILTER_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+
+namespace filters
+{
+  /**
+  * Compresses large string, text, xml and binary records with LzCodec.
+  * CompressReceiveFilter restores them on the other side (see
+  * CompressionCodec for the format). A variable whose values do not
+  * compress well is sent as is for a number of sends that doubles each
+  * time it fails again, then retried.
+  *
+  * Settings, reread once per second:
+  *
+  *   .compress.threshold    smallest record in bytes to compress
+  *                          (default 1024), 0 to compress nothing
+  *   .compress.min_saving   fraction of the bytes compression must save
+  *                          to be used (default 0.1)
+  *   .compress.max_backoff  most sends a variable is skipped for
+  *                          (default 64)
+  *
+  * Exported once per second to .compress.*: bytes_in, bytes_out, ratio
+  * (bytes_out / bytes_in), us_per_mb (compression time per MB in),
+  * compressed, unprofitable and skipped.
+  **/
+  class CompressSendFilter : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    CompressSendFilter ();
+
+    /**
+     * Destructor
+     **/
+    virtual ~CompressSendFilter ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+  protected:
+    /**
+    * How well one variable compresses
+    **/
+    struct VariableState
+    {
+      /// failures in a row, and sends left to skip
+      uint32_t failures;
+      uint32_t skips;
+    };
+
+    /**
+     * Reads the settings from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Exports the totals
+     * @param   vars   the knowledge base
+     **/
+    void publish (madara::knowledge::Variables & vars);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// settings
+    size_t threshold_;
+    double min_saving_;
+    uint32_t max_backoff_;
+
+    /// state by variable
+    std::unordered_map <std::string, VariableState> variables_;
+
+    /// totals
+    int64_t bytes_in_;
+    int64_t bytes_out_;
+    int64_t nanoseconds_;
+    int64_t compressed_;
+    int64_t unprofitable_;
+    int64_t skipped_;
+
+    /// last configuration and export in nanoseconds
+    int64_t last_configure_;
+    int64_t last_publish_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_COMPRESSSENDFILTER_H_
@@ -0,0 +1,115 @@
+#include "CompressionCodec.h"
+#include "utility/LzCodec.h"
+
+#include <string.h>
+#include <vector>
+
+const std::string filters::CompressionCodec::PREFIX ("~lz.");
+
+// bytes before the compressed block
+static const size_t HEADER (1 + 4 + 4);
+
+// buffers of the current thread: the LZ block or restored value, and
+// the encoded value
+static thread_local std::vector <unsigned char> block;
+static thread_local std::vector <unsigned char> encoded;
+
+bool
+filters::CompressionCodec::is_compressible (
+  const madara::knowledge::KnowledgeRecord & record)
+{
+  return record.is_string_type () || record.is_file_type ();
+}
+
+size_t
+filters::CompressionCodec::encode (
+  const madara::knowledge::KnowledgeRecord & record,
+  madara::knowledge::KnowledgeRecord & result, size_t & original)
+{
+  const uint32_t type = record.type ();
+
+  std::string text;
+  unsigned char * buffer = 0;
+  const unsigned char * source;
+
+  if (record.is_string_type ())
+  {
+    text = record.to_string ();
+    source = (const unsigned char *)text.c_str ();
+    original = text.size ();
+  }
+  else
+  {
+    buffer = record.to_unmanaged_buffer (original);
+    source = buffer;
+  }
+
+  utility::LzCodec::compress (source, original, block);
+  delete [] buffer;
+
+  encoded.resize (HEADER + block.size ());
+  const uint32_t size = (uint32_t)original;
+
+  unsigned char * cursor = &encoded[0];
+  *cursor++ = COMPRESSED;
+  memcpy (cursor, &type, 4);
+  cursor += 4;
+  memcpy (cursor, &size, 4);
+  cursor += 4;
+  if (!block.empty ())
+    memcpy (cursor, &block[0], block.size ());
+
+  result.set_file (&encoded[0], encoded.size ());
+  return encoded.size ();
+}
+
+bool
+filters::CompressionCodec::decode (
+  const madara::knowledge::KnowledgeRecord & record,
+  madara::knowledge::KnowledgeRecord & result, size_t max_size)
+{
+  if (!record.is_binary_file_type ())
+    return false;
+
+  size_t size = 0;
+  unsigned char * buffer = record.to_unmanaged_buffer (size);
+  bool restored = false;
+
+  if (buffer && size >= HEADER && buffer[0] == COMPRESSED)
+  {
+    uint32_t type, original;
+    memcpy (&type, buffer + 1, 4);
+    memcpy (&original, buffer + 5, 4);
+
+    if (original <= max_size && utility::LzCodec::decompress (
+      buffer + HEADER, size - HEADER, block, original))
+    {
+      const char * value = original ? (const char *)&block[0] : "";
+      restored = true;
+
+      switch (type)
+      {
+      case madara::knowledge::KnowledgeRecord::STRING:
+        result.set_value (std::string (value, original));
+        break;
+      case madara::knowledge::KnowledgeRecord::TEXT_FILE:
+        result.set_text (value, original);
+        break;
+      case madara::knowledge::KnowledgeRecord::XML:
+        result.set_xml (value, original);
+        break;
+      case madara::knowledge::KnowledgeRecord::IMAGE_JPEG:
+        result.set_jpeg ((const unsigned char *)value, original);
+        break;
+      case madara::knowledge::KnowledgeRecord::UNKNOWN_FILE_TYPE:
+        result.set_file ((const unsigned char *)value, original);
+        break;
+      default:
+        restored = false;
+      }
+    }
+  }
+
+  delete [] buffer;
+  return restored;
+}
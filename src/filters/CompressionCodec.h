@@ -0,0 +1,67 @@
+#ifndef   _FILTER_COMPRESSIONCODEC_H_
+#define   _FILTER_COMPRESSIONCODEC_H_
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeRecord.h"
+
+namespace filters
+{
+  /**
+  * Wire format shared by CompressSendFilter and CompressReceiveFilter. A
+  * compressed string, text, xml or binary record travels as a binary
+  * record under PREFIX + its variable name:
+  *
+  *   'Z', uint32 original type, uint32 original size, LzCodec block
+  *
+  * Numbers are in host byte order, so agents must share a byte order.
+  * Buffers are kept per thread and reused between calls.
+  **/
+  class CompressionCodec
+  {
+  public:
+    /// prefix of compressed variable names
+    static const std::string PREFIX;
+
+    /// record kind
+    static const unsigned char COMPRESSED = 'Z';
+
+    /// default largest original size decode accepts, in bytes
+    static const size_t MAX_SIZE = 16777216;
+
+    /**
+     * Returns true if a record is of a type that can be compressed
+     * @param  record    the record
+     **/
+    static bool is_compressible (
+      const madara::knowledge::KnowledgeRecord & record);
+
+    /**
+     * Compresses a record
+     * @param  record    a compressible record
+     * @param  result    the encoded record
+     * @param  original  bytes of the value before compression
+     * @return bytes of the encoded value
+     **/
+    static size_t encode (const madara::knowledge::KnowledgeRecord & record,
+      madara::knowledge::KnowledgeRecord & result, size_t & original);
+
+    /**
+     * Restores a compressed record
+     * @param  record    the encoded record
+     * @param  result    the original record
+     * @param  max_size  largest original size accepted. The size is read
+     *                   from the wire, so larger claims are rejected
+     *                   before any buffer is sized for them.
+     * @return true if the record was well formed
+     **/
+    static bool decode (const madara::knowledge::KnowledgeRecord & record,
+      madara::knowledge::KnowledgeRecord & result,
+      size_t max_size = MAX_SIZE);
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_COMPRESSIONCODEC_H_
@@ -0,0 +1,105 @@
+
+#include "DeltaCodec.h"
+
+#include <string.h>
+
+const std::string filters::DeltaCodec::PREFIX ("~delta.");
+
+// bytes before the values of each kind
+static const size_t KEYFRAME_HEADER (1 + 4 + 4);
+static const size_t DELTA_HEADER (1 + 4 + 8);
+
+void
+filters::DeltaCodec::encode_keyframe (uint32_t sequence,
+  const std::vector <double> & values,
+  std::vector <unsigned char> & scratch,
+  madara::knowledge::KnowledgeRecord & result)
+{
+  const uint32_t size = (uint32_t)values.size ();
+  scratch.resize (KEYFRAME_HEADER + size * sizeof (double));
+
+  unsigned char * cursor = &scratch[0];
+  *cursor++ = KEYFRAME;
+  memcpy (cursor, &sequence, 4);
+  cursor += 4;
+  memcpy (cursor, &size, 4);
+  cursor += 4;
+  if (size)
+    memcpy (cursor, &values[0], size * sizeof (double));
+
+  result.set_file (&scratch[0], scratch.size ());
+}
+
+void
+filters::DeltaCodec::encode_delta (uint32_t sequence, double resolution,
+  const std::vector <int16_t> & steps,
+  std::vector <unsigned char> & scratch,
+  madara::knowledge::KnowledgeRecord & result)
+{
+  scratch.resize (DELTA_HEADER + steps.size () * sizeof (int16_t));
+
+  unsigned char * cursor = &scratch[0];
+  *cursor++ = DELTA;
+  memcpy (cursor, &sequence, 4);
+  cursor += 4;
+  memcpy (cursor, &resolution, 8);
+  cursor += 8;
+  if (!steps.empty ())
+    memcpy (cursor, &steps[0], steps.size () * sizeof (int16_t));
+
+  result.set_file (&scratch[0], scratch.size ());
+}
+
+bool
+filters::DeltaCodec::decode (
+  const madara::knowledge::KnowledgeRecord & record,
+  unsigned char & kind, uint32_t & sequence, double & resolution,
+  std::vector <double> & values)
+{
+  if (!record.is_binary_file_type ())
+    return false;
+
+  size_t size = 0;
+  unsigned char * buffer = record.to_unmanaged_buffer (size);
+  bool result = false;
+
+  if (buffer && size >= 5)
+  {
+    kind = buffer[0];
+    memcpy (&sequence, buffer + 1, 4);
+
+    if (kind == KEYFRAME && size >= KEYFRAME_HEADER)
+    {
+      uint32_t count = 0;
+      memcpy (&count, buffer + 5, 4);
+      if (size == KEYFRAME_HEADER + count * sizeof (double))
+      {
+        values.resize (count);
+        if (count)
+          memcpy (&values[0], buffer + KEYFRAME_HEADER,
+            count * sizeof (double));
+        resolution = 0;
+        result = true;
+      }
+    }
+    else if (kind == DELTA && size >= DELTA_HEADER &&
+      (size - DELTA_HEADER) % sizeof (int16_t) == 0)
+    {
+      memcpy (&resolution, buffer + 5, 8);
+
+      const size_t count = (size - DELTA_HEADER) / sizeof (int16_t);
+      values.resize (count);
+      for (size_t i = 0; i < count; ++i)
+      {
+        int16_t step;
+        memcpy (&step, buffer + DELTA_HEADER + i * sizeof (int16_t),
+          sizeof (int16_t));
+        values[i] = step;
+      }
+      result = true;
+    }
+  }
+
+  delete [] buffer;
+  return result;
+}
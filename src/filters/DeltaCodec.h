@@ -0,0 +1,77 @@
+#ifndef   _FILTER_DELTACODEC_H_
+#define   _FILTER_DELTACODEC_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeRecord.h"
+
+namespace filters
+{
+  /**
+  * Wire format shared by DeltaSendFilter and DeltaReceiveFilter. An
+  * encoded vector travels as a binary record under PREFIX + its variable
+  * name, in one of two forms:
+  *
+  *   keyframe   'K', uint32 sequence, uint32 size, size doubles
+  *   delta      'D', uint32 sequence, double resolution,
+  *              size int16 steps of resolution from the keyframe
+  *
+  * Numbers are in host byte order, so agents must share a byte order.
+  **/
+  class DeltaCodec
+  {
+  public:
+    /// prefix of encoded variable names
+    static const std::string PREFIX;
+
+    /// record kinds
+    static const unsigned char KEYFRAME = 'K';
+    static const unsigned char DELTA = 'D';
+
+    /// largest step a delta can hold
+    static const int32_t MAX_STEP = 32767;
+
+    /**
+     * Encodes a keyframe
+     * @param  sequence  keyframe sequence number
+     * @param  values    the vector
+     * @param  scratch   buffer to encode into, reused between calls
+     * @param  result    the encoded record
+     **/
+    static void encode_keyframe (uint32_t sequence,
+      const std::vector <double> & values,
+      std::vector <unsigned char> & scratch,
+      madara::knowledge::KnowledgeRecord & result);
+
+    /**
+     * Encodes a delta from a keyframe
+     * @param  sequence   sequence number of the keyframe
+     * @param  resolution value of one step
+     * @param  steps      steps from the keyframe, one per element
+     * @param  scratch    buffer to encode into, reused between calls
+     * @param  result     the encoded record
+     **/
+    static void encode_delta (uint32_t sequence, double resolution,
+      const std::vector <int16_t> & steps,
+      std::vector <unsigned char> & scratch,
+      madara::knowledge::KnowledgeRecord & result);
+
+    /**
+     * Decodes a record
+     * @param  record     the encoded record
+     * @param  kind       KEYFRAME or DELTA
+     * @param  sequence   keyframe sequence number
+     * @param  resolution value of one step, for deltas
+     * @param  values     keyframe values, or delta steps
+     * @return true if the record was well formed
+     **/
+    static bool decode (const madara::knowledge::KnowledgeRecord & record,
+      unsigned char & kind, uint32_t & sequence, double & resolution,
+      std::vector <double> & values);
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_DELTACODEC_H_
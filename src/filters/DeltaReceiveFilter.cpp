@@ -0,0 +1,92 @@
+
+#include "DeltaReceiveFilter.h"
+#include "DeltaCodec.h"
+
+filters::DeltaReceiveFilter::DeltaReceiveFilter ()
+: missing_keyframes_ (0)
+{
+}
+
+filters::DeltaReceiveFilter::~DeltaReceiveFilter ()
+{
+}
+
+void
+filters::DeltaReceiveFilter::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext & transport_context,
+  madara::knowledge::Variables & vars)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t missing = missing_keyframes_;
+  std::vector <std::pair <std::string, madara::knowledge::KnowledgeRecord> >
+    decoded;
+
+  // encoded names sort together, so only that range is visited
+  for (madara::knowledge::KnowledgeMap::iterator i =
+    records.lower_bound (DeltaCodec::PREFIX);
+    i != records.end () &&
+    i->first.compare (0, DeltaCodec::PREFIX.size (), DeltaCodec::PREFIX) == 0; )
+  {
+    const std::string name = i->first.substr (DeltaCodec::PREFIX.size ());
+    const std::string key = transport_context.get_originator () + "/" + name;
+
+    unsigned char kind;
+    uint32_t sequence;
+    double resolution;
+    bool restored = false;
+
+    if (DeltaCodec::decode (i->second, kind, sequence, resolution, values_))
+    {
+      if (kind == DeltaCodec::KEYFRAME)
+      {
+        Keyframe & keyframe = keyframes_[key];
+        keyframe.sequence = sequence;
+        keyframe.values = values_;
+        restored = true;
+      }
+      else
+      {
+        std::unordered_map <std::string, Keyframe>::const_iterator found =
+          keyframes_.find (key);
+
+        if (found != keyframes_.end () &&
+          found->second.sequence == sequence &&
+          found->second.values.size () == values_.size ())
+        {
+          for (size_t j = 0; j < values_.size (); ++j)
+          {
+            values_[j] = found->second.values[j] + values_[j] * resolution;
+          }
+          restored = true;
+        }
+        else
+        {
+          ++missing_keyframes_;
+        }
+      }
+    }
+
+    if (restored)
+    {
+      madara::knowledge::KnowledgeRecord result (values_);
+      result.clock = i->second.clock;
+      result.quality = i->second.quality;
+      decoded.push_back (std::make_pair (name, result));
+    }
+
+    records.erase (i++);
+  }
+
+  for (size_t i = 0; i < decoded.size (); ++i)
+  {
+    records[decoded[i].first] = decoded[i].second;
+  }
+
+  if (missing_keyframes_ != missing)
+  {
+    vars.set (".delta.missing_keyframes",
+      (madara::knowledge::KnowledgeRecord::Integer)missing_keyframes_);
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef   _FILTER_DELTARECEIVEFILTER_H_
+#define   _FILTER_DELTARECEIVEFILTER_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+
+namespace filters
+{
+  /**
+  * Restores vectors encoded by DeltaSendFilter. Keyframes are kept per
+  * sender and variable. A delta whose keyframe has not arrived is dropped
+  * until the next keyframe, and counted in .delta.missing_keyframes.
+  **/
+  class DeltaReceiveFilter : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    DeltaReceiveFilter ();
+
+    /**
+     * Destructor
+     **/
+    virtual ~DeltaReceiveFilter ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+  protected:
+    /**
+    * The latest keyframe of one variable from one sender
+    **/
+    struct Keyframe
+    {
+      uint32_t sequence;
+      std::vector <double> values;
+    };
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// keyframes by originator and variable
+    std::unordered_map <std::string, Keyframe> keyframes_;
+
+    /// scratch space reused between records
+    std::vector <double> values_;
+
+    /// deltas dropped for a missing keyframe
+    int64_t missing_keyframes_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_DELTARECEIVEFILTER_H_
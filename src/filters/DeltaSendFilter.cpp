@@ -0,0 +1,196 @@
+
+#include "DeltaSendFilter.h"
+#include "DeltaCodec.h"
+#include "TrafficClasses.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <algorithm>
+#include <math.h>
+
+filters::DeltaSendFilter::DeltaSendFilter (IntelligentSendFilter * shaper)
+: shaper_ (shaper), deadband_ (0.001), resolution_ (0.0001),
+  keyframe_period_ (1000000000), max_size_ (64), bytes_in_ (0),
+  bytes_out_ (0), keyframes_ (0), deltas_ (0), suppressed_ (0),
+  expired_ (0), last_configure_ (0), last_publish_ (0)
+{
+}
+
+filters::DeltaSendFilter::~DeltaSendFilter ()
+{
+}
+
+void
+filters::DeltaSendFilter::configure (madara::knowledge::Variables & vars)
+{
+  prefixes_.clear ();
+  if (vars.exists (".delta.prefixes"))
+    TrafficClasses::split (
+      vars.get (".delta.prefixes").to_string (), prefixes_);
+
+  if (vars.exists (".delta.deadband"))
+    deadband_ = vars.get (".delta.deadband").to_double ();
+
+  if (vars.exists (".delta.resolution") &&
+    vars.get (".delta.resolution").to_double () > 0)
+    resolution_ = vars.get (".delta.resolution").to_double ();
+
+  if (vars.exists (".delta.keyframe_period"))
+    keyframe_period_ =
+      (int64_t)(vars.get (".delta.keyframe_period").to_double () * 1e9);
+
+  if (vars.exists (".delta.max_size"))
+    max_size_ = (size_t)vars.get (".delta.max_size").to_integer ();
+}
+
+bool
+filters::DeltaSendFilter::is_encoded (const std::string & key) const
+{
+  if (prefixes_.empty ())
+    return true;
+
+  for (size_t i = 0; i < prefixes_.size (); ++i)
+  {
+    if (key.compare (0, prefixes_[i].size (), prefixes_[i]) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+void
+filters::DeltaSendFilter::publish (madara::knowledge::Variables & vars)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  vars.set (".delta.bytes_in", (Integer)bytes_in_);
+  vars.set (".delta.bytes_out", (Integer)bytes_out_);
+  vars.set (".delta.keyframes", (Integer)keyframes_);
+  vars.set (".delta.deltas", (Integer)deltas_);
+  vars.set (".delta.suppressed", (Integer)suppressed_);
+  vars.set (".delta.expired", (Integer)expired_);
+}
+
+void
+filters::DeltaSendFilter::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext &,
+  madara::knowledge::Variables & vars)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  // receivers of a dropped value have a keyframe or value we no longer
+  // know, so the next send starts over from a keyframe
+  if (shaper_)
+  {
+    shaper_->unsent_deltas (deferred_names_, expired_names_);
+    for (size_t i = 0; i < expired_names_.size (); ++i)
+    {
+      std::unordered_map <std::string, VariableState>::iterator found =
+        variables_.find (expired_names_[i]);
+      if (found != variables_.end ())
+        found->second.keyframe.clear ();
+    }
+    expired_ += (int64_t)expired_names_.size ();
+  }
+
+  std::vector <std::pair <std::string, madara::knowledge::KnowledgeRecord> >
+    encoded;
+
+  for (madara::knowledge::KnowledgeMap::iterator i = records.begin ();
+    i != records.end (); )
+  {
+    const madara::knowledge::KnowledgeRecord & record = i->second;
+    if (record.type () != madara::knowledge::KnowledgeRecord::DOUBLE_ARRAY ||
+      record.size () > max_size_ || !is_encoded (i->first))
+    {
+      ++i;
+      continue;
+    }
+
+    const std::vector <double> values (record.to_doubles ());
+    VariableState & state = variables_[i->first];
+    bytes_in_ += TrafficClasses::encoded_size (i->first, record);
+
+    // a delta would replace a deferred keyframe, and be useless without
+    // it, so a keyframe replaces it instead
+    bool keyframe = state.keyframe.size () != values.size () ||
+      current - state.keyframe_time >= keyframe_period_ ||
+      (state.sent_keyframe && deferred_names_.count (i->first));
+
+    if (!keyframe)
+    {
+      // skip changes receivers would not notice
+      double change = 0;
+      for (size_t j = 0; j < values.size (); ++j)
+      {
+        change = std::max (change, fabs (values[j] - state.sent[j]));
+      }
+
+      if (change <= deadband_)
+      {
+        ++suppressed_;
+        records.erase (i++);
+        continue;
+      }
+
+      steps_.resize (values.size ());
+      for (size_t j = 0; j < values.size () && !keyframe; ++j)
+      {
+        const double step =
+          floor ((values[j] - state.keyframe[j]) / resolution_ + 0.5);
+        if (fabs (step) > DeltaCodec::MAX_STEP)
+          keyframe = true;
+        else
+          steps_[j] = (int16_t)step;
+      }
+    }
+
+    madara::knowledge::KnowledgeRecord result;
+    if (keyframe)
+    {
+      ++state.sequence;
+      state.keyframe = values;
+      state.keyframe_time = current;
+      state.sent = values;
+      state.sent_keyframe = true;
+      DeltaCodec::encode_keyframe (state.sequence, values, scratch_, result);
+      ++keyframes_;
+    }
+    else
+    {
+      for (size_t j = 0; j < values.size (); ++j)
+      {
+        state.sent[j] = state.keyframe[j] + steps_[j] * resolution_;
+      }
+      state.sent_keyframe = false;
+      DeltaCodec::encode_delta (state.sequence, resolution_, steps_,
+        scratch_, result);
+      ++deltas_;
+    }
+
+    // keep the original clock and quality for conflict resolution
+    result.clock = record.clock;
+    result.quality = record.quality;
+
+    encoded.push_back (std::make_pair (DeltaCodec::PREFIX + i->first, result));
+    bytes_out_ += TrafficClasses::encoded_size (
+      encoded.back ().first, result);
+    records.erase (i++);
+  }
+
+  records.insert (encoded.begin (), encoded.end ());
+
+  if (current - last_publish_ >= PUBLISH_PERIOD)
+  {
+    publish (vars);
+    last_publish_ = current;
+  }
+}
@@ -0,0 +1,142 @@
+#ifndef   _FILTER_DELTASENDFILTER_H_
+#define   _FILTER_DELTASENDFILTER_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+#include "IntelligentSendFilter.h"
+
+namespace filters
+{
+  /**
+  * Sends numeric vectors as quantized deltas from a periodic keyframe,
+  * and suppresses changes within a deadband. DeltaReceiveFilter restores
+  * the vectors on the other side (see DeltaCodec for the format).
+  *
+  * Deltas are only useful to receivers that have their keyframe, so this
+  * follows what the shaper does with the records: while a keyframe is
+  * deferred, each new value is sent as a keyframe that replaces it, and
+  * once a value is dropped at its deadline the next one is a keyframe.
+  *
+  * Settings, reread once per second:
+  *
+  *   .delta.prefixes         comma separated variables to encode. Empty
+  *                           encodes every double array.
+  *   .delta.deadband         largest change per element that is not
+  *                           sent (default 0.001)
+  *   .delta.resolution       value of one delta step (default 0.0001).
+  *                           Larger changes from the keyframe than
+  *                           32767 steps send a keyframe.
+  *   .delta.keyframe_period  seconds between keyframes (default 1), so
+  *                           late joiners and lost keyframes recover
+  *   .delta.max_size         most elements of an encoded vector
+  *                           (default 64)
+  *
+  * Exported once per second to .delta.*: bytes_in, bytes_out, keyframes,
+  * deltas, suppressed and expired, the values the shaper dropped.
+  **/
+  class DeltaSendFilter : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     * @param   shaper   the send shaper after this filter, or 0 if none
+     **/
+    DeltaSendFilter (IntelligentSendFilter * shaper);
+
+    /**
+     * Destructor
+     **/
+    virtual ~DeltaSendFilter ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+  protected:
+    /**
+    * What receivers have of one variable
+    **/
+    struct VariableState
+    {
+      /// the last keyframe, its sequence number and when it was sent
+      std::vector <double> keyframe;
+      uint32_t sequence;
+      int64_t keyframe_time;
+
+      /// the values receivers reconstruct from the last send
+      std::vector <double> sent;
+
+      /// true if the last send was a keyframe
+      bool sent_keyframe;
+    };
+
+    /**
+     * Reads the settings from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Returns true if a variable is encoded
+     * @param   key    variable name
+     **/
+    bool is_encoded (const std::string & key) const;
+
+    /**
+     * Exports the totals
+     * @param   vars   the knowledge base
+     **/
+    void publish (madara::knowledge::Variables & vars);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// the shaper, which reports the values it has not sent
+    IntelligentSendFilter * shaper_;
+
+    /// encoded variable prefixes
+    std::vector <std::string> prefixes_;
+
+    /// settings
+    double deadband_;
+    double resolution_;
+    int64_t keyframe_period_;
+    size_t max_size_;
+
+    /// state by variable
+    std::unordered_map <std::string, VariableState> variables_;
+
+    /// scratch space reused between records and sends
+    std::vector <unsigned char> scratch_;
+    std::vector <int16_t> steps_;
+    std::unordered_set <std::string> deferred_names_;
+    std::vector <std::string> expired_names_;
+
+    /// totals
+    int64_t bytes_in_;
+    int64_t bytes_out_;
+    int64_t keyframes_;
+    int64_t deltas_;
+    int64_t suppressed_;
+    int64_t expired_;
+
+    /// last configuration and export in nanoseconds
+    int64_t last_configure_;
+    int64_t last_publish_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_DELTASENDFILTER_H_
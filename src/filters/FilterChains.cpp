@@ -0,0 +1,86 @@
+
+#include "FilterChains.h"
+#include "ChunkReceiveFilter.h"
+#include "CompressReceiveFilter.h"
+#include "CompressSendFilter.h"
+#include "DeltaReceiveFilter.h"
+#include "DeltaSendFilter.h"
+#include "IntelligentReceiveFilter.h"
+#include "SpatialReceiveFilter.h"
+#include "TrafficAccounting.h"
+
+filters::FilterChains::FilterChains (const std::string & capture_file)
+: chunker (new ChunkSendFilter ()), coalescer (new SendCoalescer ()),
+  shaper (new IntelligentSendFilter ()), capture (0)
+{
+  if (capture_file != "")
+  {
+    capture = new CaptureFilter (capture_file);
+    receive.push_back (capture);
+    receive_names.push_back ("CaptureFilter");
+  }
+
+  receive.push_back (new TrafficAccounting (".receive.accounting"));
+  receive_names.push_back ("TrafficAccounting");
+  receive.push_back (new ChunkReceiveFilter (chunker));
+  receive_names.push_back ("ChunkReceiveFilter");
+  receive.push_back (new CompressReceiveFilter ());
+  receive_names.push_back ("CompressReceiveFilter");
+  receive.push_back (new DeltaReceiveFilter ());
+  receive_names.push_back ("DeltaReceiveFilter");
+  receive.push_back (new SpatialReceiveFilter ());
+  receive_names.push_back ("SpatialReceiveFilter");
+  receive.push_back (new IntelligentReceiveFilter ());
+  receive_names.push_back ("IntelligentReceiveFilter");
+
+  send.push_back (coalescer);
+  send_names.push_back ("SendCoalescer");
+  send.push_back (new DeltaSendFilter (shaper));
+  send_names.push_back ("DeltaSendFilter");
+  send.push_back (new CompressSendFilter ());
+  send_names.push_back ("CompressSendFilter");
+  send.push_back (chunker);
+  send_names.push_back ("ChunkSendFilter");
+  send.push_back (shaper);
+  send_names.push_back ("IntelligentSendFilter");
+  send.push_back (new TrafficAccounting (".send.accounting"));
+  send_names.push_back ("TrafficAccounting");
+}
+
+void
+filters::FilterChains::add_to (
+  madara::transport::QoSTransportSettings & target) const
+{
+  for (size_t i = 0; i < receive.size (); ++i)
+  {
+    target.add_receive_filter (receive[i]);
+  }
+
+  for (size_t i = 0; i < send.size (); ++i)
+  {
+    target.add_send_filter (send[i]);
+  }
+}
+
+void
+filters::FilterChains::destroy (void)
+{
+  for (size_t i = 0; i < receive.size (); ++i)
+  {
+    delete receive[i];
+  }
+
+  for (size_t i = 0; i < send.size (); ++i)
+  {
+    delete send[i];
+  }
+
+  receive.clear ();
+  receive_names.clear ();
+  send.clear ();
+  send_names.clear ();
+  chunker = 0;
+  coalescer = 0;
+  shaper = 0;
+  capture = 0;
+}
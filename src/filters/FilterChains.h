@@ -0,0 +1,75 @@
+
+#ifndef   _FILTER_FILTERCHAINS_H_
+#define   _FILTER_FILTERCHAINS_H_
+
+#include <string>
+#include <vector>
+
+#include "madara/filters/AggregateFilter.h"
+#include "madara/transport/QoSTransportSettings.h"
+#include "CaptureFilter.h"
+#include "ChunkSendFilter.h"
+#include "IntelligentSendFilter.h"
+#include "SendCoalescer.h"
+
+namespace filters
+{
+  /**
+  * The receive and send filter chains of an agent, built in one place so
+  * the controller, filter_benchmark and traffic_replay run the same
+  * filters in the same order:
+  *
+  *   receive  [CaptureFilter], TrafficAccounting, ChunkReceiveFilter,
+  *            CompressReceiveFilter, DeltaReceiveFilter,
+  *            SpatialReceiveFilter, IntelligentReceiveFilter
+  *   send     SendCoalescer, DeltaSendFilter, CompressSendFilter,
+  *            ChunkSendFilter, IntelligentSendFilter, TrafficAccounting
+  *
+  * The filters that the controller's flush jobs and shutdown need are
+  * kept by type.
+  **/
+  class FilterChains
+  {
+  public:
+    /**
+     * Constructor, which builds the chains
+     * @param   capture_file  file to capture received packets to, or
+     *                        empty to not capture
+     **/
+    FilterChains (const std::string & capture_file = "");
+
+    /**
+     * Adds the chains to transport settings, which then own the filters
+     * @param   target   the settings to add the filters to
+     **/
+    void add_to (madara::transport::QoSTransportSettings & target) const;
+
+    /**
+     * Deletes the filters, if they were not added to transport settings
+     **/
+    void destroy (void);
+
+    /// the receive filters in order, and their names for reports
+    std::vector <madara::filters::AggregateFilter *> receive;
+    std::vector <std::string> receive_names;
+
+    /// the send filters in order, and their names for reports
+    std::vector <madara::filters::AggregateFilter *> send;
+    std::vector <std::string> send_names;
+
+    /// the chunk send filter, which ChunkReceiveFilter passes NACKs to
+    ChunkSendFilter * chunker;
+
+    /// the send coalescer, for CoalescerFlush
+    SendCoalescer * coalescer;
+
+    /// the send shaper, for ShaperFlush
+    IntelligentSendFilter * shaper;
+
+    /// the capture filter, to close at shutdown, or 0 if not capturing
+    CaptureFilter * capture;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_FILTERCHAINS_H_
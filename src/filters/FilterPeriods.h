@@ -0,0 +1,16 @@
+
+#ifndef   _FILTER_FILTERPERIODS_H_
+#define   _FILTER_FILTERPERIODS_H_
+
+#include <stdint.h>
+
+namespace filters
+{
+  /// nanoseconds between a filter rereading its configuration
+  const int64_t CONFIGURE_PERIOD (1000000000);
+
+  /// nanoseconds between a filter exporting its totals
+  const int64_t PUBLISH_PERIOD (1000000000);
+} // end filters namespace
+
+#endif // _FILTER_FILTERPERIODS_H_
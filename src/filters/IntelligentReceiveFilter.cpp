@@ -1,38 +1,249 @@
- 
 #include "IntelligentReceiveFilter.h"
+#include "TrafficClasses.h"
+#include "../utility/Trace.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <algorithm>
+
+// nanoseconds between rate updates
+static const int64_t WINDOW (1000000000);
+
+// nanoseconds of silence after which a sender is forgotten
+static const int64_t SENDER_TIMEOUT (10000000000LL);
 
 filters::IntelligentReceiveFilter::IntelligentReceiveFilter ()
+: budget_ (1000000), heartbeat_ (ArrivalInterval::HEARTBEAT), min_interval_ (0),
+  overloaded_ (false), dropped_domain_ (0),
+  window_start_ (0), last_configure_ (0), last_publish_ (0)
 {
-  // note that we could have provided parameters for domain and bandwidth
 }
 
 filters::IntelligentReceiveFilter::~IntelligentReceiveFilter ()
 {
 }
 
+void
+filters::IntelligentReceiveFilter::configure (
+  madara::knowledge::Variables & vars)
+{
+  std::string domains;
+  if (vars.exists (".receive.domains"))
+    domains = vars.get (".receive.domains").to_string ();
+  if (domains != domain_config_)
+  {
+    std::vector <std::string> entries;
+    TrafficClasses::split (domains, entries);
+
+    domains_.clear ();
+    domain_prefixes_.clear ();
+    for (size_t i = 0; i < entries.size (); ++i)
+    {
+      const std::string & entry = entries[i];
+      if (entry[entry.size () - 1] == '*')
+        domain_prefixes_.push_back (entry.substr (0, entry.size () - 1));
+      else
+        domains_.insert (entry);
+    }
+    domain_config_ = domains;
+  }
+
+  if (vars.exists (".receive.budget"))
+    budget_ = vars.get (".receive.budget").to_double ();
+
+  heartbeat_ = ArrivalInterval::get_heartbeat (vars);
+
+  const double max_hertz = vars.get (".receive.max_hertz").to_double ();
+  min_interval_ = max_hertz > 0 ? (int64_t)(1e9 / max_hertz) : 0;
+}
+
+bool
+filters::IntelligentReceiveFilter::accepts_domain (
+  const std::string & domain) const
+{
+  if (domains_.empty () && domain_prefixes_.empty ())
+    return true;
+
+  if (domains_.find (domain) != domains_.end ())
+    return true;
+
+  for (size_t i = 0; i < domain_prefixes_.size (); ++i)
+  {
+    if (domain.compare (0, domain_prefixes_[i].size (),
+      domain_prefixes_[i]) == 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void
+filters::IntelligentReceiveFilter::update_shares (int64_t current)
+{
+  const double elapsed = (current - window_start_) / 1e9;
+  window_start_ = current;
+
+  std::vector <Sender *> active;
+  double total = 0;
+
+  for (auto i = senders_.begin (); i != senders_.end (); )
+  {
+    Sender & sender = i->second;
+    if (current - sender.last_seen > SENDER_TIMEOUT)
+    {
+      senders_.erase (i++);
+      continue;
+    }
+
+    const double instant = sender.window_bytes / elapsed;
+    sender.rate = sender.rate > 0 ? 0.5 * sender.rate + 0.5 * instant : instant;
+    sender.window_bytes = 0;
+    sender.share = sender.rate;
+
+    total += sender.rate;
+    if (sender.rate > 0)
+      active.push_back (&sender);
+    ++i;
+  }
+
+  overloaded_ = budget_ > 0 && total > budget_;
+  if (!overloaded_)
+    return;
+
+  // max-min fairness: the quietest senders get all they send, and what
+  // they leave is split evenly among the rest
+  std::sort (active.begin (), active.end (),
+    [] (const Sender * lhs, const Sender * rhs)
+    {
+      return lhs->rate < rhs->rate;
+    });
+
+  double remaining = budget_;
+  for (size_t i = 0; i < active.size (); ++i)
+  {
+    const double fair = remaining / (active.size () - i);
+    active[i]->share = std::min (active[i]->rate, fair);
+    remaining -= active[i]->share;
+  }
+}
+
+void
+filters::IntelligentReceiveFilter::publish (
+  madara::knowledge::Variables & vars)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  vars.set (".receive.senders", (Integer)senders_.size ());
+  vars.set (".receive.overloaded", (Integer)overloaded_);
+  vars.set (".receive.dropped_domain", (Integer)dropped_domain_);
+
+  for (auto i = senders_.begin (); i != senders_.end (); ++i)
+  {
+    const std::string prefix = ".receive.sender." + i->first;
+    vars.set (prefix + ".rate", i->second.rate);
+    vars.set (prefix + ".share", i->second.share);
+    vars.set (prefix + ".accepted", (Integer)i->second.accepted);
+    vars.set (prefix + ".dropped", (Integer)i->second.dropped);
+  }
+}
+
 void
 filters::IntelligentReceiveFilter::filter (
   madara::knowledge::KnowledgeMap & records,
   const madara::transport::TransportContext & transport_context,
   madara::knowledge::Variables & vars)
 {
-  // assume we need to drop everything
-  bool drop_it_all = true;
+  UTILITY_TRACE_SCOPE ("IntelligentReceiveFilter::filter");
+  UTILITY_TRACE_COUNTER ("receive.records", records.size ());
+
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  if (!window_start_)
+    window_start_ = current;
 
   // domain is similar to pub/sub topics but doesn't indicate type of data
-  if (transport_context.get_domain () == "Mosul Mission")
+  if (!accepts_domain (transport_context.get_domain ()))
+  {
+    ++dropped_domain_;
+    records.clear ();
+  }
+  else
   {
-    // check that the total perceived bandwidth usage is less than 1MB/s
-    if (transport_context.get_receive_bandwidth () < 1000000)
+    Sender & sender = senders_[transport_context.get_originator ()];
+    if (!sender.last_seen)
+    {
+      sender.window_bytes = 0;
+      sender.rate = 0;
+      sender.share = 0;
+      sender.accepted = 0;
+      sender.dropped = 0;
+    }
+    sender.last_seen = current;
+
+    for (auto i = records.begin (); i != records.end (); ++i)
+    {
+      sender.window_bytes += TrafficClasses::encoded_size (i->first, i->second);
+    }
+
+    if (current - window_start_ >= WINDOW)
+      update_shares (current);
+
+    // fraction of this sender's updates that fit its share
+    const double ratio = overloaded_ && sender.rate > sender.share ?
+      sender.share / sender.rate : 1.0;
+
+    for (auto i = records.begin (); i != records.end (); )
     {
-      drop_it_all = false;
+      VariableState & state = sender.variables[i->first];
+      if (!state.arrivals.seen ())
+      {
+        state.last_accepted = 0;
+        state.credit = 1.0;
+      }
+      state.arrivals.arrive (current);
+
+      bool accept = true;
+      if (min_interval_ > 0 && state.last_accepted &&
+        current - state.last_accepted < min_interval_)
+      {
+        accept = false;
+      }
+      else if (ratio < 1.0 && !state.arrivals.is_heartbeat (heartbeat_))
+      {
+        // spread the accepted updates evenly over the variable's arrivals
+        state.credit += ratio;
+        if (state.credit >= 1.0)
+          state.credit -= 1.0;
+        else
+          accept = false;
+      }
+
+      if (accept)
+      {
+        state.last_accepted = current;
+        ++sender.accepted;
+        ++i;
+      }
+      else
+      {
+        ++sender.dropped;
+        records.erase (i++);
+      }
     }
   }
-  
-  // are we supposed to drop it all?
-  if (drop_it_all)
+
+  if (current - last_publish_ >= PUBLISH_PERIOD)
   {
-    records.clear ();
+    publish (vars);
+    last_publish_ = current;
   }
 }
-
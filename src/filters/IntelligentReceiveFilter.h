@@ -1,15 +1,40 @@
-
 #ifndef   _FILTER_INTELLIGENTRECEIVEFILTER_H_
 #define   _FILTER_INTELLIGENTRECEIVEFILTER_H_
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <stdint.h>
 
 #include "madara/filters/AggregateFilter.h"
+#include "ArrivalInterval.h"
 
 namespace filters
 {
   /**
-  * A stateful filter generated by gpc.pl
+  * Degrades incoming updates in proportion to each sender's share of the
+  * receive budget, instead of dropping whole updates.
+  *
+  * Every sender's byte rate is measured. When the senders together exceed
+  * .receive.budget bytes per second (default 1MB/s), the budget is split
+  * max-min fairly: senders under their share keep everything, and the
+  * rest are sampled down to their share. Sampling is per variable, so
+  * every variable of a sender keeps updating at a reduced rate. Variables
+  * a sender updates less often than every .receive.heartbeat seconds
+  * (default 1) always pass.
+  *
+  * Other settings, reread once per second:
+  *
+  *   .receive.domains    comma separated domains to accept. A trailing *
+  *                       matches a prefix. Empty accepts every domain.
+  *   .receive.max_hertz  most updates per second of any one variable
+  *                       from one sender, 0 for no limit
+  *
+  * Exported once per second: .receive.senders, .receive.overloaded,
+  * .receive.dropped_domain and .receive.sender.{originator}.rate,
+  * .share, .accepted and .dropped.
   **/
   class IntelligentReceiveFilter : public madara::filters::AggregateFilter
   {
@@ -25,7 +50,7 @@ namespace filters
     virtual ~IntelligentReceiveFilter ();
 
     /**
-     * The method that filters incoming or outgoing 
+     * The method that filters incoming or outgoing
      * @param   records           the aggregated packet being evaluated
      * @param   transport_context context for querying transport state
      * @param   vars              context for querying current program state
@@ -33,13 +58,100 @@ namespace filters
     virtual void filter (madara::knowledge::KnowledgeMap & records,
       const madara::transport::TransportContext & transport_context,
       madara::knowledge::Variables & vars);
-      
+
   protected:
     /**
-     * any variables needed for filtering decisions can go here. Note that
-     * the knowledge base will be provided via the filter method's Variables
-     * input.
+    * Sampling state of one variable from one sender
+    **/
+    struct VariableState
+    {
+      /// when the variable was last accepted
+      int64_t last_accepted;
+
+      /// how often the variable arrives
+      ArrivalInterval arrivals;
+
+      /// accumulated acceptance. An update is accepted at 1.
+      double credit;
+    };
+
+    /**
+    * Traffic of one sender
+    **/
+    struct Sender
+    {
+      /// bytes received in the current window
+      int64_t window_bytes;
+
+      /// average bytes per second, and the fair share of it
+      double rate;
+      double share;
+
+      /// when the sender was last heard from
+      int64_t last_seen;
+
+      /// records accepted and dropped
+      int64_t accepted;
+      int64_t dropped;
+
+      /// sampling state by variable
+      std::unordered_map <std::string, VariableState> variables;
+    };
+
+    /**
+     * Reads the settings from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Returns true if the domain is accepted
+     * @param   domain the domain
      **/
+    bool accepts_domain (const std::string & domain) const;
+
+    /**
+     * Updates sender rates and recomputes fair shares
+     * @param   current   now in nanoseconds
+     **/
+    void update_shares (int64_t current);
+
+    /**
+     * Exports sender statistics
+     * @param   vars   the knowledge base
+     **/
+    void publish (madara::knowledge::Variables & vars);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// accepted domains, and accepted domain prefixes
+    std::unordered_set <std::string> domains_;
+    std::vector <std::string> domain_prefixes_;
+    std::string domain_config_;
+
+    /// receive budget in bytes per second
+    double budget_;
+
+    /// nanoseconds between arrivals that make a variable a heartbeat
+    int64_t heartbeat_;
+
+    /// least nanoseconds between accepted updates of a variable
+    int64_t min_interval_;
+
+    /// true while the senders exceed the budget
+    bool overloaded_;
+
+    /// updates dropped for their domain
+    int64_t dropped_domain_;
+
+    /// traffic by originator
+    std::unordered_map <std::string, Sender> senders_;
+
+    /// start of the rate window, last configuration and export
+    int64_t window_start_;
+    int64_t last_configure_;
+    int64_t last_publish_;
   };
 
 } // end filters namespace
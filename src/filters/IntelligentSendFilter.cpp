@@ -1,37 +1,348 @@
- 
+
 #include "IntelligentSendFilter.h"
+#include "ChunkCodec.h"
+#include "DeltaCodec.h"
+#include "../utility/Trace.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <algorithm>
+#include <set>
+
+// upper bounds of the age histogram buckets in nanoseconds. The last
+// bucket holds everything older.
+static const int64_t AGE_BOUNDS[] = {
+  1000000, 2000000, 5000000, 10000000, 20000000, 50000000, 100000000,
+  200000000, 500000000, 1000000000, 2000000000 };
+static const size_t AGE_BUCKETS (sizeof (AGE_BOUNDS) / sizeof (int64_t) + 1);
+
+/**
+ * A record waiting for admission
+ **/
+struct Candidate
+{
+  size_t traffic_class;
+  int64_t size;
+  madara::knowledge::KnowledgeMap::iterator record;
+
+  /// when the value reached the filter, and when it is no longer worth
+  /// sending (INT64_MAX for never), in nanoseconds
+  int64_t arrival;
+  int64_t deadline;
+};
+
+/**
+ * Returns the variable a record carries. Deferred records may be encoded
+ * by earlier filters, e.g. ~lz.map or a chunk of it.
+ * @param  key     the record's key
+ * @param  delta   set to true if DeltaSendFilter encoded the variable
+ **/
+static std::string
+carried_variable (const std::string & key, bool & delta)
+{
+  std::string name = filters::ChunkCodec::variable_name (key);
+  if (name.empty ())
+    name = key;
+
+  // DeltaSendFilter runs first, so its prefix is the innermost
+  const std::string & prefix = filters::DeltaCodec::PREFIX;
+  const size_t start = filters::TrafficClasses::skip_encodings (name);
+  delta = start >= prefix.size () &&
+    name.compare (start - prefix.size (), prefix.size (), prefix) == 0;
+
+  return name.substr (start);
+}
 
 filters::IntelligentSendFilter::IntelligentSendFilter ()
+: last_refill_ (0), last_configure_ (0), last_publish_ (0)
 {
+  static_assert (sizeof (ClassStats::ages) == AGE_BUCKETS * sizeof (int64_t),
+    "one count per age bucket");
+
+  budget_.rate = 0;
+  budget_.capacity = 0;
+  budget_.tokens = 0;
+
+  class_buckets_.resize (classes_.size (), budget_);
+  critical_.resize (classes_.size (), false);
+  deadlines_.resize (classes_.size (), 0);
+  stats_.resize (classes_.size (), ClassStats ());
 }
 
 filters::IntelligentSendFilter::~IntelligentSendFilter ()
 {
 }
 
+void
+filters::IntelligentSendFilter::refill (Bucket & bucket, double elapsed)
+{
+  if (bucket.rate > 0)
+  {
+    bucket.tokens =
+      std::min (bucket.tokens + bucket.rate * elapsed, bucket.capacity);
+  }
+}
+
+bool
+filters::IntelligentSendFilter::admits (const Bucket & bucket, int64_t size)
+{
+  // a full bucket admits anything, so records larger than the bucket are
+  // not deferred forever
+  return bucket.rate <= 0 || bucket.tokens >= size ||
+    bucket.tokens >= bucket.capacity;
+}
+
+void
+filters::IntelligentSendFilter::configure (madara::knowledge::Variables & vars)
+{
+  double burst = 1.0;
+  if (vars.exists (".send.burst"))
+    burst = std::max (vars.get (".send.burst").to_double (), 0.001);
+
+  const double rate = vars.get (".send.budget").to_double ();
+  if (rate != budget_.rate)
+  {
+    budget_.tokens = rate * burst;
+  }
+  budget_.rate = rate;
+  budget_.capacity = rate * burst;
+
+  if (classes_.load (vars, ".send"))
+  {
+    // totals of renamed classes no longer mean anything
+    class_buckets_.assign (classes_.size (), Bucket ());
+    critical_.assign (classes_.size (), false);
+    deadlines_.assign (classes_.size (), 0);
+    stats_.assign (classes_.size (), ClassStats ());
+  }
+
+  for (size_t i = 0; i < classes_.size (); ++i)
+  {
+    const std::string prefix = ".send." + classes_.get_name (i);
+    Bucket & bucket = class_buckets_[i];
+    const double class_rate = vars.get (prefix + ".rate").to_double ();
+
+    if (class_rate != bucket.rate)
+    {
+      bucket.tokens = class_rate * burst;
+    }
+    bucket.rate = class_rate;
+    bucket.capacity = class_rate * burst;
+
+    critical_[i] = vars.get (prefix + ".critical").is_true ();
+    deadlines_[i] =
+      (int64_t)(vars.get (prefix + ".deadline").to_double () * 1e9);
+  }
+}
+
+void
+filters::IntelligentSendFilter::publish (madara::knowledge::Variables & vars)
+{
+  std::vector <int64_t> pending (classes_.size (), 0);
+  for (madara::knowledge::KnowledgeMap::const_iterator i = deferred_.begin ();
+    i != deferred_.end (); ++i)
+  {
+    ++pending[classes_.classify (i->first)];
+  }
+
+  for (size_t i = 0; i < classes_.size (); ++i)
+  {
+    const std::string prefix = ".send." + classes_.get_name (i);
+    const ClassStats & stats = stats_[i];
+
+    vars.set (prefix + ".admitted_bytes",
+      (madara::knowledge::KnowledgeRecord::Integer)stats.admitted_bytes);
+    vars.set (prefix + ".deferred_bytes",
+      (madara::knowledge::KnowledgeRecord::Integer)stats.deferred_bytes);
+    vars.set (prefix + ".admitted",
+      (madara::knowledge::KnowledgeRecord::Integer)stats.admitted);
+    vars.set (prefix + ".deferred",
+      (madara::knowledge::KnowledgeRecord::Integer)stats.deferred);
+    vars.set (prefix + ".expired",
+      (madara::knowledge::KnowledgeRecord::Integer)stats.expired);
+    vars.set (prefix + ".pending",
+      (madara::knowledge::KnowledgeRecord::Integer)pending[i]);
+
+    vars.set (prefix + ".age_mean",
+      stats.admitted ? stats.age_sum / 1e9 / stats.admitted : 0.0);
+    vars.set (prefix + ".age_histogram",
+      std::vector <double> (stats.ages, stats.ages + AGE_BUCKETS));
+  }
+}
+
 void
 filters::IntelligentSendFilter::filter (
   madara::knowledge::KnowledgeMap & records,
-  const madara::transport::TransportContext & transport_context,
+  const madara::transport::TransportContext &,
   madara::knowledge::Variables & vars)
 {
-  // if we're using greater than 1MB/s, let's do something smarter
-  if (transport_context.get_receive_bandwidth () > 1000000)
+  UTILITY_TRACE_SCOPE ("IntelligentSendFilter::filter");
+  UTILITY_TRACE_COUNTER ("send.records", records.size ());
+
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  const double elapsed = last_refill_ ? (current - last_refill_) / 1e9 : 0;
+  last_refill_ = current;
+  refill (budget_, elapsed);
+  for (size_t i = 0; i < class_buckets_.size (); ++i)
+  {
+    refill (class_buckets_[i], elapsed);
+  }
+
+  // retry deferred records, unless this send has a newer value
+  std::unordered_map <std::string, int64_t> arrivals;
+  arrivals.swap (arrivals_);
+  for (madara::knowledge::KnowledgeMap::const_iterator i = deferred_.begin ();
+    i != deferred_.end (); ++i)
   {
-    // iterate through and erase any variables that are binary blobs
-    for (auto i = records.begin (); i != records.end (); )
+    if (!records.insert (*i).second)
+      arrivals.erase (i->first);
+  }
+  deferred_.clear ();
+
+  std::vector <Candidate> candidates;
+  candidates.reserve (records.size ());
+  for (madara::knowledge::KnowledgeMap::iterator i = records.begin ();
+    i != records.end (); ++i)
+  {
+    Candidate candidate;
+    candidate.traffic_class = classes_.classify (i->first);
+    candidate.size = TrafficClasses::encoded_size (i->first, i->second);
+    candidate.record = i;
+
+    std::unordered_map <std::string, int64_t>::const_iterator arrival =
+      arrivals.find (i->first);
+    candidate.arrival = arrival != arrivals.end () ? arrival->second : current;
+
+    const int64_t deadline = deadlines_[candidate.traffic_class];
+    candidate.deadline = deadline > 0 ?
+      candidate.arrival + deadline : INT64_MAX;
+
+    candidates.push_back (candidate);
+  }
+
+  // highest priority class first, so a deadline never lets a class
+  // overtake a higher one. Within a class, earliest deadline first, and
+  // in variable order without deadlines.
+  std::stable_sort (candidates.begin (), candidates.end (),
+    [] (const Candidate & lhs, const Candidate & rhs)
     {
-      // if binary, erase
-      if (i->second.is_binary_file_type ())
-      {
-        records.erase (i++);
-      }
-      // else, keep it by continuing to next record
-      else
+      if (lhs.traffic_class != rhs.traffic_class)
+        return lhs.traffic_class < rhs.traffic_class;
+      return lhs.deadline < rhs.deadline;
+    });
+
+  for (size_t i = 0; i < candidates.size (); ++i)
+  {
+    const Candidate & candidate = candidates[i];
+    Bucket & class_bucket = class_buckets_[candidate.traffic_class];
+    ClassStats & stats = stats_[candidate.traffic_class];
+
+    if (current >= candidate.deadline)
+    {
+      // a stale value is worth less than the bandwidth it takes
+      bool delta;
+      const std::string name =
+        carried_variable (candidate.record->first, delta);
+      if (delta)
+        expired_deltas_.push_back (name);
+
+      records.erase (candidate.record);
+      ++stats.expired;
+    }
+    else if (critical_[candidate.traffic_class] ||
+      (admits (budget_, candidate.size) &&
+       admits (class_bucket, candidate.size)))
+    {
+      budget_.tokens -= candidate.size;
+      class_bucket.tokens -= candidate.size;
+      stats.admitted_bytes += candidate.size;
+      ++stats.admitted;
+
+      const int64_t age = current - candidate.arrival;
+      size_t bucket = 0;
+      while (bucket + 1 < AGE_BUCKETS && age > AGE_BOUNDS[bucket])
       {
-        ++i;
+        ++bucket;
       }
+      ++stats.ages[bucket];
+      stats.age_sum += age;
+    }
+    else
+    {
+      arrivals_[candidate.record->first] = candidate.arrival;
+      deferred_.insert (*candidate.record);
+      records.erase (candidate.record);
+      stats.deferred_bytes += candidate.size;
+      ++stats.deferred;
     }
   }
+
+  if (current - last_publish_ >= PUBLISH_PERIOD)
+  {
+    publish (vars);
+    last_publish_ = current;
+  }
 }
 
+void
+filters::IntelligentSendFilter::flush (
+  madara::knowledge::KnowledgeBase & knowledge)
+{
+  std::set <std::string> names;
+  {
+    std::lock_guard <std::mutex> guard (mutex_);
+    if (deferred_.empty ())
+      return;
+
+    // a send with no budget would only defer everything again
+    const double elapsed = (utility::Clock::now () - last_refill_) / 1e9;
+    if (budget_.rate > 0 && budget_.tokens + budget_.rate * elapsed <= 0)
+      return;
+
+    // sends start from the variables the deferred records carry
+    for (madara::knowledge::KnowledgeMap::const_iterator i =
+      deferred_.begin (); i != deferred_.end (); ++i)
+    {
+      bool delta;
+      names.insert (carried_variable (i->first, delta));
+    }
+  }
+
+  // the send runs this filter, which adds the deferred records
+  for (std::set <std::string>::const_iterator i = names.begin ();
+    i != names.end (); ++i)
+  {
+    if (knowledge.exists (*i))
+      knowledge.mark_modified (knowledge.get_ref (*i));
+  }
+  knowledge.send_modifieds ("IntelligentSendFilter::flush");
+}
+
+void
+filters::IntelligentSendFilter::unsent_deltas (
+  std::unordered_set <std::string> & deferred,
+  std::vector <std::string> & expired)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  deferred.clear ();
+  for (madara::knowledge::KnowledgeMap::const_iterator i = deferred_.begin ();
+    i != deferred_.end (); ++i)
+  {
+    bool delta;
+    const std::string name = carried_variable (i->first, delta);
+    if (delta)
+      deferred.insert (name);
+  }
+
+  expired.clear ();
+  expired.swap (expired_deltas_);
+}
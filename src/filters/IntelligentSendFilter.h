@@ -1,15 +1,49 @@
-
 #ifndef   _FILTER_INTELLIGENTSENDFILTER_H_
 #define   _FILTER_INTELLIGENTSENDFILTER_H_
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <stdint.h>
 
 #include "madara/filters/AggregateFilter.h"
+#include "madara/knowledge/KnowledgeBase.h"
+#include "TrafficClasses.h"
 
 namespace filters
 {
   /**
-  * A stateful filter generated by gpc.pl
+  * Shapes outgoing updates to a byte budget by traffic class. Records are
+  * admitted in class priority order from a shared token bucket refilled
+  * at .send.budget bytes per second, holding up to .send.burst seconds
+  * (default 1) of budget. A budget of 0 admits everything.
+  *
+  * Records that do not fit are deferred, not dropped: the latest value of
+  * each deferred variable goes out with a later send, unless a newer
+  * value replaces it first. If nothing else sends, flush starts a send,
+  * from threads::ShaperFlush at .send.flush_hertz (default 10). Per
+  * class, configured under .send.{class}:
+  *
+  *   prefixes   variables in the class (see TrafficClasses)
+  *   rate       bytes per second cap of the class, 0 for none
+  *   critical   nonzero to always admit, even over budget
+  *   deadline   seconds a value stays worth sending, 0 for no limit
+  *
+  * Records are admitted in class priority order, so a deadline never
+  * puts a lower class ahead of a higher one. Within a class with a
+  * deadline, the earliest deadline goes first, i.e. the oldest value. A
+  * deferred value still waiting at its deadline is dropped instead of
+  * sent. Ages count from when a value reached this filter. Values that
+  * DeltaSendFilter encoded are reported to it while deferred and once
+  * dropped (see unsent_deltas), so receivers are not left with deltas
+  * from a keyframe they never got.
+  *
+  * Exported once per second to .send.{class}.*: admitted_bytes,
+  * deferred_bytes, admitted, deferred, expired, pending, age_mean in
+  * seconds and age_histogram, the count of records sent within 1, 2, 5,
+  * 10, 20, 50, 100, 200, 500, 1000 and 2000 ms of arriving, and later.
   **/
   class IntelligentSendFilter : public madara::filters::AggregateFilter
   {
@@ -25,7 +59,7 @@ namespace filters
     virtual ~IntelligentSendFilter ();
 
     /**
-     * The method that filters incoming or outgoing 
+     * The method that filters incoming or outgoing
      * @param   records           the aggregated packet being evaluated
      * @param   transport_context context for querying transport state
      * @param   vars              context for querying current program state
@@ -33,13 +67,114 @@ namespace filters
     virtual void filter (madara::knowledge::KnowledgeMap & records,
       const madara::transport::TransportContext & transport_context,
       madara::knowledge::Variables & vars);
-      
+
+    /**
+     * Starts a send for the deferred records, if there are any and the
+     * budget has room. The send retries them all.
+     * @param   knowledge  the knowledge base to send from
+     **/
+    void flush (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+     * Returns the variables encoded by DeltaSendFilter that have a value
+     * deferred, and those whose values were dropped at their deadline
+     * since the last call
+     * @param   deferred  variables with a value waiting
+     * @param   expired   variables whose values were dropped, moved out
+     **/
+    void unsent_deltas (std::unordered_set <std::string> & deferred,
+      std::vector <std::string> & expired);
+
   protected:
     /**
-     * any variables needed for filtering decisions can go here. Note that
-     * the knowledge base will be provided via the filter method's Variables
-     * input.
+    * A token bucket
+    **/
+    struct Bucket
+    {
+      /// bytes per second, 0 for unlimited
+      double rate;
+
+      /// most tokens held
+      double capacity;
+
+      /// bytes that may be sent now. Negative after critical sends.
+      double tokens;
+    };
+
+    /**
+    * Totals of one class
+    **/
+    struct ClassStats
+    {
+      int64_t admitted_bytes;
+      int64_t deferred_bytes;
+      int64_t admitted;
+      int64_t deferred;
+      int64_t expired;
+
+      /// nanoseconds from arrival to send, summed and bucketed
+      int64_t age_sum;
+      int64_t ages[12];
+    };
+
+    /**
+     * Reads the budget and classes from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Adds tokens for the time since the last refill
+     * @param   bucket   the bucket
+     * @param   elapsed  seconds since the last refill
      **/
+    static void refill (Bucket & bucket, double elapsed);
+
+    /**
+     * Returns true if a bucket admits a record
+     * @param   bucket   the bucket
+     * @param   size     bytes of the record
+     **/
+    static bool admits (const Bucket & bucket, int64_t size);
+
+    /**
+     * Exports the class totals
+     * @param   vars   the knowledge base
+     **/
+    void publish (madara::knowledge::Variables & vars);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// variable to class mapping
+    TrafficClasses classes_;
+
+    /// the shared budget, and the cap of each class
+    Bucket budget_;
+    std::vector <Bucket> class_buckets_;
+
+    /// classes that are always admitted
+    std::vector <bool> critical_;
+
+    /// nanoseconds each class's values stay worth sending, 0 for no limit
+    std::vector <int64_t> deadlines_;
+
+    /// totals by class
+    std::vector <ClassStats> stats_;
+
+    /// latest deferred value of each variable
+    madara::knowledge::KnowledgeMap deferred_;
+
+    /// when each deferred value reached the filter, in nanoseconds
+    std::unordered_map <std::string, int64_t> arrivals_;
+
+    /// delta encoded variables dropped at their deadline, for unsent_deltas
+    std::vector <std::string> expired_deltas_;
+
+    /// last refill, configuration and export in nanoseconds
+    int64_t last_refill_;
+    int64_t last_configure_;
+    int64_t last_publish_;
   };
 
 } // end filters namespace
@@ -0,0 +1,164 @@
+
+#include "SendCoalescer.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * A held record waiting for a packet
+ **/
+struct Candidate
+{
+  size_t traffic_class;
+  int64_t size;
+  madara::knowledge::KnowledgeMap::iterator record;
+};
+
+filters::SendCoalescer::SendCoalescer ()
+: window_ (0), packet_bytes_ (1400), packets_ (0), records_ (0),
+  carried_ (0), window_start_ (0), last_configure_ (0), last_publish_ (0)
+{
+}
+
+filters::SendCoalescer::~SendCoalescer ()
+{
+}
+
+void
+filters::SendCoalescer::configure (madara::knowledge::Variables & vars)
+{
+  window_ = (int64_t)(vars.get (".send.window").to_double () * 1e9);
+
+  if (vars.exists (".send.packet_bytes"))
+    packet_bytes_ = vars.get (".send.packet_bytes").to_integer ();
+
+  classes_.load (vars, ".send");
+}
+
+double
+filters::SendCoalescer::get_window (void)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+  return window_ / 1e9;
+}
+
+void
+filters::SendCoalescer::fill (madara::knowledge::KnowledgeMap & records)
+{
+  std::vector <Candidate> candidates;
+  candidates.reserve (held_.size ());
+  for (madara::knowledge::KnowledgeMap::iterator i = held_.begin ();
+    i != held_.end (); ++i)
+  {
+    Candidate candidate;
+    candidate.traffic_class = classes_.classify (i->first);
+    candidate.size = TrafficClasses::encoded_size (i->first, i->second);
+    candidate.record = i;
+    candidates.push_back (candidate);
+  }
+
+  std::stable_sort (candidates.begin (), candidates.end (),
+    [] (const Candidate & lhs, const Candidate & rhs)
+    {
+      return lhs.traffic_class < rhs.traffic_class;
+    });
+
+  // the first record always goes, so an oversized record is not stuck
+  int64_t bytes = 0;
+  for (size_t i = 0; i < candidates.size (); ++i)
+  {
+    const Candidate & candidate = candidates[i];
+    if (packet_bytes_ > 0 && !records.empty () &&
+      bytes + candidate.size > packet_bytes_)
+    {
+      ++carried_;
+      continue;
+    }
+
+    bytes += candidate.size;
+    records.insert (*candidate.record);
+    held_.erase (candidate.record);
+  }
+
+  ++packets_;
+  records_ += records.size ();
+}
+
+void
+filters::SendCoalescer::publish (madara::knowledge::Variables & vars)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  vars.set (".send.coalescer.packets", (Integer)packets_);
+  vars.set (".send.coalescer.records", (Integer)records_);
+  vars.set (".send.coalescer.held", (Integer)held_.size ());
+  vars.set (".send.coalescer.carried", (Integer)carried_);
+}
+
+void
+filters::SendCoalescer::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext &,
+  madara::knowledge::Variables & vars)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  if (window_ <= 0 && held_.empty ())
+    return;
+
+  // newer values replace held ones
+  for (madara::knowledge::KnowledgeMap::iterator i = records.begin ();
+    i != records.end (); ++i)
+  {
+    held_[i->first] = i->second;
+  }
+  records.clear ();
+
+  // an empty packet is not sent
+  if (current - window_start_ >= window_)
+  {
+    window_start_ = current;
+    fill (records);
+  }
+
+  if (current - last_publish_ >= PUBLISH_PERIOD)
+  {
+    publish (vars);
+    last_publish_ = current;
+  }
+}
+
+void
+filters::SendCoalescer::flush (madara::knowledge::KnowledgeBase & knowledge)
+{
+  std::vector <std::string> names;
+  {
+    std::lock_guard <std::mutex> guard (mutex_);
+    if (held_.empty () || utility::Clock::now () - window_start_ < window_)
+      return;
+
+    names.reserve (held_.size ());
+    for (madara::knowledge::KnowledgeMap::const_iterator i = held_.begin ();
+      i != held_.end (); ++i)
+    {
+      names.push_back (i->first);
+    }
+  }
+
+  // the send runs this filter, which adds the held records. Marking them
+  // modified makes sure there is a send.
+  for (size_t i = 0; i < names.size (); ++i)
+  {
+    knowledge.mark_modified (knowledge.get_ref (names[i]));
+  }
+  knowledge.send_modifieds ("SendCoalescer::flush");
+}
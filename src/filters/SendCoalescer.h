@@ -0,0 +1,117 @@
+#ifndef   _FILTER_SENDCOALESCER_H_
+#define   _FILTER_SENDCOALESCER_H_
+
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+#include "madara/knowledge/KnowledgeBase.h"
+#include "TrafficClasses.h"
+
+namespace filters
+{
+  /**
+  * Coalesces the updates of every send within a window into one packet.
+  * Records sent before the window ends are held, keeping only the latest
+  * value of each variable, and go out together with the first send after
+  * it. A packet takes records in .send class priority order (see
+  * TrafficClasses) up to .send.packet_bytes; the rest are carried to the
+  * next window.
+  *
+  * Settings, reread once per second:
+  *
+  *   .send.window        seconds per packet, 0 to pass sends through
+  *   .send.packet_bytes  most record bytes per packet (default 1400), 0
+  *                       for no limit
+  *   .send.coalesce_hertz  rate the controller runs flush at (default 20)
+  *
+  * When nothing else sends, flush must be called about once per window
+  * to send held records. The controller runs it whatever the window is
+  * at startup, so a window set later is still flushed.
+  *
+  * Exported once per second to .send.coalescer.*: packets, records, held
+  * and carried.
+  **/
+  class SendCoalescer : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    SendCoalescer ();
+
+    /**
+     * Destructor
+     **/
+    virtual ~SendCoalescer ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+    /**
+     * Sends held records if their window has ended, by marking them
+     * modified and sending modifieds
+     * @param   knowledge  the knowledge base the filter sends for
+     **/
+    void flush (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+     * Returns the window
+     * @return seconds per packet, 0 if disabled
+     **/
+    double get_window (void);
+
+  protected:
+    /**
+     * Reads the settings from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Moves held records into a packet, highest priority first
+     * @param   records   the packet
+     **/
+    void fill (madara::knowledge::KnowledgeMap & records);
+
+    /**
+     * Exports the totals
+     * @param   vars   the knowledge base
+     **/
+    void publish (madara::knowledge::Variables & vars);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// variable to class mapping
+    TrafficClasses classes_;
+
+    /// settings
+    int64_t window_;
+    int64_t packet_bytes_;
+
+    /// the latest held value of each variable
+    madara::knowledge::KnowledgeMap held_;
+
+    /// totals
+    int64_t packets_;
+    int64_t records_;
+    int64_t carried_;
+
+    /// start of the window, last configuration and export in nanoseconds
+    int64_t window_start_;
+    int64_t last_configure_;
+    int64_t last_publish_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_SENDCOALESCER_H_
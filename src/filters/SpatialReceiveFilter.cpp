@@ -0,0 +1,218 @@
+
+#include "SpatialReceiveFilter.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <math.h>
+#include <sstream>
+
+// nanoseconds between rereading the configuration. Our own location is
+// reread with it, so this is shorter than the shared CONFIGURE_PERIOD.
+static const int64_t LOCATION_PERIOD (100000000);
+
+// mean earth radius in meters
+static const double EARTH_RADIUS (6371000.0);
+
+static const std::string AGENT_PREFIX ("agent.");
+static const std::string LOCATION (".location");
+
+/**
+ * Returns the agent id of an agent.{id}.* variable, or an empty string
+ **/
+static std::string
+get_agent (const std::string & key)
+{
+  if (key.compare (0, AGENT_PREFIX.size (), AGENT_PREFIX) != 0)
+    return "";
+
+  const size_t end = key.find ('.', AGENT_PREFIX.size ());
+  if (end == std::string::npos)
+    return "";
+
+  return key.substr (AGENT_PREFIX.size (), end - AGENT_PREFIX.size ());
+}
+
+/**
+ * Returns true if a variable is the location of its agent
+ **/
+static bool
+is_location (const std::string & key, const std::string & agent)
+{
+  return key.size () == AGENT_PREFIX.size () + agent.size () +
+    LOCATION.size () &&
+    key.compare (key.size () - LOCATION.size (), LOCATION.size (),
+      LOCATION) == 0;
+}
+
+filters::SpatialReceiveFilter::SpatialReceiveFilter ()
+: radius_ (0), far_interval_ (1000000000),
+  heartbeat_ (ArrivalInterval::HEARTBEAT), cartesian_ (false),
+  accepted_ (0), dropped_ (0), last_configure_ (0), last_publish_ (0)
+{
+}
+
+filters::SpatialReceiveFilter::~SpatialReceiveFilter ()
+{
+}
+
+void
+filters::SpatialReceiveFilter::configure (madara::knowledge::Variables & vars)
+{
+  radius_ = vars.get (".spatial.radius").to_double ();
+  cartesian_ = vars.get (".spatial.cartesian").is_true ();
+
+  if (vars.exists (".spatial.far_hertz"))
+  {
+    const double hertz = vars.get (".spatial.far_hertz").to_double ();
+    far_interval_ = hertz > 0 ? (int64_t)(1e9 / hertz) : -1;
+  }
+
+  heartbeat_ = ArrivalInterval::get_heartbeat (vars);
+
+  if (radius_ > 0 && vars.exists (".id"))
+  {
+    std::stringstream buffer;
+    buffer << vars.get (".id").to_integer ();
+    id_ = buffer.str ();
+    location_ = vars.get (AGENT_PREFIX + id_ + LOCATION).to_doubles ();
+  }
+}
+
+bool
+filters::SpatialReceiveFilter::is_far (const std::string & agent) const
+{
+  if (agent.empty () || agent == id_ || location_.size () < 2)
+    return false;
+
+  std::unordered_map <std::string, std::vector <double> >::const_iterator
+    found = locations_.find (agent);
+  if (found == locations_.end () || found->second.size () < 2)
+    return false;
+
+  const std::vector <double> & other = found->second;
+  double dx, dy;
+  if (cartesian_)
+  {
+    dx = other[0] - location_[0];
+    dy = other[1] - location_[1];
+  }
+  else
+  {
+    // equirectangular, which is accurate at relevance radius scales
+    const double radians = M_PI / 180;
+    dy = (other[0] - location_[0]) * radians * EARTH_RADIUS;
+    dx = (other[1] - location_[1]) * radians * EARTH_RADIUS *
+      cos ((other[0] + location_[0]) / 2 * radians);
+  }
+
+  double dz = 0;
+  if (other.size () > 2 && location_.size () > 2)
+    dz = other[2] - location_[2];
+
+  return dx * dx + dy * dy + dz * dz > radius_ * radius_;
+}
+
+void
+filters::SpatialReceiveFilter::publish (madara::knowledge::Variables & vars)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  Integer far_agents = 0;
+  for (std::unordered_map <std::string, std::vector <double> >::const_iterator
+    i = locations_.begin (); i != locations_.end (); ++i)
+  {
+    if (is_far (i->first))
+      ++far_agents;
+  }
+
+  vars.set (".spatial.far_agents", far_agents);
+  vars.set (".spatial.accepted", (Integer)accepted_);
+  vars.set (".spatial.dropped", (Integer)dropped_);
+}
+
+void
+filters::SpatialReceiveFilter::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext & transport_context,
+  madara::knowledge::Variables & vars)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= LOCATION_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  if (radius_ <= 0)
+    return;
+
+  // agent variables sort together, so only that range is visited to
+  // learn locations and who the sender speaks for
+  std::string sender;
+  for (madara::knowledge::KnowledgeMap::const_iterator i =
+    records.lower_bound (AGENT_PREFIX); i != records.end () &&
+    i->first.compare (0, AGENT_PREFIX.size (), AGENT_PREFIX) == 0; ++i)
+  {
+    const std::string agent = get_agent (i->first);
+    if (agent.empty ())
+      continue;
+
+    if (sender.empty ())
+      sender = agent;
+
+    if (is_location (i->first, agent))
+      locations_[agent] = i->second.to_doubles ();
+  }
+
+  if (!sender.empty ())
+    senders_[transport_context.get_originator ()] = sender;
+  else
+  {
+    std::unordered_map <std::string, std::string>::const_iterator found =
+      senders_.find (transport_context.get_originator ());
+    if (found != senders_.end ())
+      sender = found->second;
+  }
+
+  for (madara::knowledge::KnowledgeMap::iterator i = records.begin ();
+    i != records.end (); )
+  {
+    const std::string owner = get_agent (i->first);
+    const std::string & agent = owner.empty () ? sender : owner;
+
+    if (!is_far (agent) || (!owner.empty () && is_location (i->first, owner)))
+    {
+      ++accepted_;
+      ++i;
+      continue;
+    }
+
+    // far agents' variables are sampled down to far_hertz, but their
+    // heartbeats pass
+    const std::string key = owner.empty () ? agent + "/" + i->first : i->first;
+
+    VariableState & state = variables_[key];
+    state.arrivals.arrive (current);
+
+    if (state.arrivals.is_heartbeat (heartbeat_) || (far_interval_ >= 0 &&
+      current - state.last_accepted >= far_interval_))
+    {
+      state.last_accepted = current;
+      ++accepted_;
+      ++i;
+    }
+    else
+    {
+      ++dropped_;
+      records.erase (i++);
+    }
+  }
+
+  if (current - last_publish_ >= PUBLISH_PERIOD)
+  {
+    publish (vars);
+    last_publish_ = current;
+  }
+}
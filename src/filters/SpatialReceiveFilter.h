@@ -0,0 +1,129 @@
+#ifndef   _FILTER_SPATIALRECEIVEFILTER_H_
+#define   _FILTER_SPATIALRECEIVEFILTER_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+#include "ArrivalInterval.h"
+
+namespace filters
+{
+  /**
+  * Downsamples updates from agents outside a relevance radius, so the
+  * cost of receiving scales with the agents nearby rather than with the
+  * swarm. Agent positions are agent.{id}.location, as GPS (latitude,
+  * longitude, altitude) unless .spatial.cartesian is set. They are
+  * learned from received records, and ours is read from the knowledge
+  * base using .id every 100 ms.
+  *
+  * A record belongs to agent N if it is named agent.N.*, and otherwise
+  * to the agent whose variables its sender last sent. Records of a far
+  * agent are accepted at most .spatial.far_hertz times per second per
+  * variable. Far agents' locations and heartbeats (see ArrivalInterval
+  * and .receive.heartbeat) always pass, and records of agents with no
+  * known location are never dropped.
+  *
+  * Settings, reread with our location every 100 ms:
+  *
+  *   .spatial.radius     meters within which agents are relevant, 0 to
+  *                       accept everything (default)
+  *   .spatial.far_hertz  most updates per second of a variable of a far
+  *                       agent (default 1), 0 to drop all but locations
+  *                       and heartbeats
+  *   .spatial.cartesian  1 if locations are x, y, z in meters
+  *
+  * Exported once per second to .spatial.*: far_agents, accepted and
+  * dropped.
+  **/
+  class SpatialReceiveFilter : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    SpatialReceiveFilter ();
+
+    /**
+     * Destructor
+     **/
+    virtual ~SpatialReceiveFilter ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+  protected:
+    /**
+    * Sampling state of one variable of a far agent
+    **/
+    struct VariableState
+    {
+      /// when the variable was last accepted
+      int64_t last_accepted;
+
+      /// how often the variable arrives
+      ArrivalInterval arrivals;
+    };
+
+    /**
+     * Reads the settings and our location from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Returns true if an agent is known to be outside the radius
+     * @param   agent  the agent id
+     **/
+    bool is_far (const std::string & agent) const;
+
+    /**
+     * Exports the totals
+     * @param   vars   the knowledge base
+     **/
+    void publish (madara::knowledge::Variables & vars);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// settings
+    double radius_;
+    int64_t far_interval_;
+    int64_t heartbeat_;
+    bool cartesian_;
+
+    /// our id and location
+    std::string id_;
+    std::vector <double> location_;
+
+    /// last known location by agent id
+    std::unordered_map <std::string, std::vector <double> > locations_;
+
+    /// the agent each sender last sent variables of
+    std::unordered_map <std::string, std::string> senders_;
+
+    /// sampling state by variable of far agents
+    std::unordered_map <std::string, VariableState> variables_;
+
+    /// totals
+    int64_t accepted_;
+    int64_t dropped_;
+
+    /// last configuration and export in nanoseconds
+    int64_t last_configure_;
+    int64_t last_publish_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_SPATIALRECEIVEFILTER_H_
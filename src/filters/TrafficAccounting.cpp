@@ -0,0 +1,216 @@
+
+#include "TrafficAccounting.h"
+#include "TrafficClasses.h"
+#include "FilterPeriods.h"
+#include "../utility/Clock.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "gams/loggers/GlobalLogger.h"
+
+// nanoseconds between rate updates and exports
+static const int64_t WINDOW (1000000000);
+
+// bytes per second under which a silent talker is forgotten
+static const double FORGET_RATE (1.0);
+
+filters::TrafficAccounting::TrafficAccounting (const std::string & root)
+: root_ (root), depth_ (3), alpha_ (0.3), top_ (10),
+  log_period_ (10000000000LL), total_ (), last_update_ (0),
+  last_configure_ (0), last_log_ (0)
+{
+}
+
+filters::TrafficAccounting::~TrafficAccounting ()
+{
+}
+
+void
+filters::TrafficAccounting::configure (madara::knowledge::Variables & vars)
+{
+  if (vars.exists (root_ + ".depth"))
+    depth_ = (int)vars.get (root_ + ".depth").to_integer ();
+
+  if (vars.exists (root_ + ".alpha"))
+    alpha_ = std::min (1.0,
+      std::max (0.0, vars.get (root_ + ".alpha").to_double ()));
+
+  if (vars.exists (root_ + ".top"))
+    top_ = (size_t)std::max ((madara::knowledge::KnowledgeRecord::Integer)0,
+      vars.get (root_ + ".top").to_integer ());
+
+  if (vars.exists (root_ + ".log_period"))
+    log_period_ = (int64_t)(
+      vars.get (root_ + ".log_period").to_double () * 1e9);
+}
+
+std::string
+filters::TrafficAccounting::prefix_of (const std::string & key) const
+{
+  const size_t start = TrafficClasses::skip_encodings (key);
+
+  // chunks are named {variable}~{index}
+  size_t end = key.find ('~', start);
+  if (end == std::string::npos)
+    end = key.size ();
+
+  if (depth_ > 0)
+  {
+    size_t dot = start;
+    for (int i = 0; i < depth_; ++i)
+    {
+      dot = key.find ('.', dot);
+      if (dot == std::string::npos || dot >= end)
+        break;
+      if (i + 1 == depth_)
+        end = dot;
+      ++dot;
+    }
+  }
+
+  return key.substr (start, end - start);
+}
+
+void
+filters::TrafficAccounting::account (Talker & talker, int64_t bytes)
+{
+  talker.window_bytes += bytes;
+  ++talker.window_records;
+}
+
+bool
+filters::TrafficAccounting::smooth (Talker & talker, double elapsed)
+{
+  const double bytes = talker.window_bytes / elapsed;
+  const double records = talker.window_records / elapsed;
+
+  talker.bytes_per_second += alpha_ * (bytes - talker.bytes_per_second);
+  talker.records_per_second +=
+    alpha_ * (records - talker.records_per_second);
+  talker.window_bytes = 0;
+  talker.window_records = 0;
+
+  return bytes > 0 || talker.bytes_per_second >= FORGET_RATE;
+}
+
+void
+filters::TrafficAccounting::update (Talkers & talkers, double elapsed)
+{
+  for (Talkers::iterator i = talkers.begin (); i != talkers.end (); )
+  {
+    if (smooth (i->second, elapsed))
+      ++i;
+    else
+      talkers.erase (i++);
+  }
+}
+
+void
+filters::TrafficAccounting::publish (madara::knowledge::Variables & vars,
+  const Talkers & talkers, const std::string & kind, bool log)
+{
+  typedef madara::knowledge::KnowledgeRecord::Integer Integer;
+
+  std::vector <Talkers::const_iterator> ranked;
+  ranked.reserve (talkers.size ());
+  for (Talkers::const_iterator i = talkers.begin (); i != talkers.end (); ++i)
+  {
+    ranked.push_back (i);
+  }
+
+  const size_t count = std::min (top_, ranked.size ());
+  std::partial_sort (ranked.begin (), ranked.begin () + count, ranked.end (),
+    [] (Talkers::const_iterator lhs, Talkers::const_iterator rhs)
+    {
+      return lhs->second.bytes_per_second > rhs->second.bytes_per_second;
+    });
+
+  std::stringstream report;
+  report << std::fixed;
+  report.precision (1);
+  for (size_t i = 0; i < count; ++i)
+  {
+    const Talker & talker = ranked[i]->second;
+    const double share = total_.bytes_per_second > 0 ?
+      talker.bytes_per_second / total_.bytes_per_second : 0.0;
+
+    std::stringstream prefix;
+    prefix << root_ << "." << kind << "." << i;
+    vars.set (prefix.str () + ".name", ranked[i]->first);
+    vars.set (prefix.str () + ".bytes_per_second", talker.bytes_per_second);
+    vars.set (prefix.str () + ".records_per_second",
+      talker.records_per_second);
+    vars.set (prefix.str () + ".share", share);
+
+    if (log)
+    {
+      report << "  " << (i + 1) << ". " << ranked[i]->first << ": " <<
+        (Integer)talker.bytes_per_second << " B/s, " <<
+        talker.records_per_second << " records/s, " <<
+        (int)(share * 100 + 0.5) << "%\n";
+    }
+  }
+  vars.set (root_ + "." + kind + ".size", (Integer)count);
+
+  if (log && count > 0)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_MAJOR,
+      "filters::TrafficAccounting::publish:"
+      " %s top %s of %d B/s:\n%s",
+      root_.c_str (), kind.c_str (), (int)total_.bytes_per_second,
+      report.str ().c_str ());
+  }
+}
+
+void
+filters::TrafficAccounting::filter (
+  madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext & transport_context,
+  madara::knowledge::Variables & vars)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  const int64_t current = utility::Clock::now ();
+  if (current - last_configure_ >= CONFIGURE_PERIOD)
+  {
+    configure (vars);
+    last_configure_ = current;
+  }
+
+  if (!last_update_)
+  {
+    last_update_ = current;
+    last_log_ = current;
+  }
+
+  Talker & agent = agents_[transport_context.get_originator ()];
+  for (madara::knowledge::KnowledgeMap::const_iterator i = records.begin ();
+    i != records.end (); ++i)
+  {
+    const int64_t bytes = TrafficClasses::encoded_size (i->first, i->second);
+    account (prefixes_[prefix_of (i->first)], bytes);
+    account (agent, bytes);
+    account (total_, bytes);
+  }
+
+  if (current - last_update_ >= WINDOW)
+  {
+    const double elapsed = (current - last_update_) / 1e9;
+    last_update_ = current;
+
+    update (prefixes_, elapsed);
+    update (agents_, elapsed);
+    smooth (total_, elapsed);
+
+    const bool log = log_period_ > 0 && current - last_log_ >= log_period_;
+    if (log)
+      last_log_ = current;
+
+    vars.set (root_ + ".bytes_per_second", total_.bytes_per_second);
+    vars.set (root_ + ".records_per_second", total_.records_per_second);
+    publish (vars, prefixes_, "prefixes", log);
+    publish (vars, agents_, "agents", log);
+  }
+}
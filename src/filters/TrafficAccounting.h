@@ -0,0 +1,151 @@
+#ifndef   _FILTER_TRAFFICACCOUNTING_H_
+#define   _FILTER_TRAFFICACCOUNTING_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include "madara/filters/AggregateFilter.h"
+
+namespace filters
+{
+  /**
+  * Accounts the bytes and records passing a filter chain per variable
+  * prefix and per originating agent, as rates smoothed once per second
+  * with an exponentially weighted moving average. It changes nothing, and
+  * goes last on send to see what went out and first on receive to see
+  * what arrived. Settings, reread once per second under {root}:
+  *
+  *   .depth       dot separated parts of a name that form its prefix
+  *                (default 3, e.g., agent.0.map), 0 for whole names
+  *   .alpha       weight of the latest second in a rate (default 0.3)
+  *   .top         talkers to report (default 10)
+  *   .log_period  seconds between logging the report (default 10), 0
+  *                to not log
+  *
+  * Codec prefixes such as ~lz. and chunk indices are stripped, so encoded
+  * records count toward their variable. Exported once per second:
+  *
+  *   {root}.bytes_per_second, {root}.records_per_second  totals
+  *   {root}.prefixes.{rank}.*, {root}.agents.{rank}.*     the top talkers
+  *     by bytes, with name, bytes_per_second, records_per_second and
+  *     share of the total bytes
+  *   {root}.prefixes.size, {root}.agents.size             talkers listed
+  **/
+  class TrafficAccounting : public madara::filters::AggregateFilter
+  {
+  public:
+    /**
+     * Constructor
+     * @param   root   prefix of the settings and exports, e.g.,
+     *                 ".send.accounting"
+     **/
+    TrafficAccounting (const std::string & root);
+
+    /**
+     * Destructor
+     **/
+    virtual ~TrafficAccounting ();
+
+    /**
+     * The method that filters incoming or outgoing
+     * @param   records           the aggregated packet being evaluated
+     * @param   transport_context context for querying transport state
+     * @param   vars              context for querying current program state
+     **/
+    virtual void filter (madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & transport_context,
+      madara::knowledge::Variables & vars);
+
+  protected:
+    /**
+    * Traffic of one prefix or agent
+    **/
+    struct Talker
+    {
+      /// bytes and records since the last rate update
+      int64_t window_bytes;
+      int64_t window_records;
+
+      /// smoothed rates per second
+      double bytes_per_second;
+      double records_per_second;
+    };
+
+    typedef std::unordered_map <std::string, Talker> Talkers;
+
+    /**
+     * Reads the settings from the knowledge base
+     * @param   vars   the knowledge base
+     **/
+    void configure (madara::knowledge::Variables & vars);
+
+    /**
+     * Adds a record to a talker's window
+     * @param   talker   the prefix, agent or totals
+     * @param   bytes    bytes the record takes on the wire
+     **/
+    void account (Talker & talker, int64_t bytes);
+
+    /**
+     * Folds a talker's window into its rates
+     * @param   talker   the prefix, agent or totals
+     * @param   elapsed  seconds since the last update
+     * @return  false if the talker went silent and can be forgotten
+     **/
+    bool smooth (Talker & talker, double elapsed);
+
+    /**
+     * Returns the prefix a variable is accounted under
+     * @param   key    variable name, possibly encoded
+     * @return  the prefix
+     **/
+    std::string prefix_of (const std::string & key) const;
+
+    /**
+     * Folds the window into the rates, forgetting silent talkers
+     * @param   talkers  prefixes or agents
+     * @param   elapsed  seconds since the last update
+     **/
+    void update (Talkers & talkers, double elapsed);
+
+    /**
+     * Exports the busiest talkers, and logs them if requested
+     * @param   vars     the knowledge base
+     * @param   talkers  prefixes or agents
+     * @param   kind     "prefixes" or "agents"
+     * @param   log      true to also log them
+     **/
+    void publish (madara::knowledge::Variables & vars,
+      const Talkers & talkers, const std::string & kind, bool log);
+
+    /// guards the filter state
+    std::mutex mutex_;
+
+    /// prefix of the settings and exports
+    std::string root_;
+
+    /// settings
+    int depth_;
+    double alpha_;
+    size_t top_;
+    int64_t log_period_;
+
+    /// traffic by variable prefix and by originator
+    Talkers prefixes_;
+    Talkers agents_;
+
+    /// totals, as a talker
+    Talker total_;
+
+    /// last rate update, configuration and log in nanoseconds
+    int64_t last_update_;
+    int64_t last_configure_;
+    int64_t last_log_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_TRAFFICACCOUNTING_H_
@@ -0,0 +1,155 @@
+
+#include "TrafficClasses.h"
+
+#include <algorithm>
+
+// name of the class for unmatched variables
+static const std::string DEFAULT_CLASS ("default");
+
+// variables whose class is cached before the cache is reset
+static const size_t MAX_CACHED (65536);
+
+filters::TrafficClasses::TrafficClasses ()
+: names_ (1, DEFAULT_CLASS)
+{
+}
+
+bool
+filters::TrafficClasses::load (madara::knowledge::Variables & vars,
+  const std::string & root)
+{
+  // unset variables read as "0", so only read what exists
+  std::vector <std::string> names;
+  if (vars.exists (root + ".classes"))
+    split (vars.get (root + ".classes").to_string (), names);
+
+  // rebuild only if the class list or a prefix list changed
+  std::string config;
+  std::vector <std::string> prefix_lists (names.size ());
+  for (size_t i = 0; i < names.size (); ++i)
+  {
+    const std::string key = root + "." + names[i] + ".prefixes";
+    if (vars.exists (key))
+      prefix_lists[i] = vars.get (key).to_string ();
+    config += names[i] + "=" + prefix_lists[i] + ";";
+  }
+
+  if (config == config_)
+    return false;
+
+  config_ = config;
+  names_ = names;
+  names_.push_back (DEFAULT_CLASS);
+  prefixes_.clear ();
+  cache_.clear ();
+
+  for (size_t i = 0; i < names.size (); ++i)
+  {
+    std::vector <std::string> prefixes;
+    split (prefix_lists[i], prefixes);
+
+    for (size_t j = 0; j < prefixes.size (); ++j)
+    {
+      prefixes_.push_back (std::make_pair (prefixes[j], i));
+    }
+  }
+
+  // longest prefix first. Ties go to the higher priority class.
+  std::stable_sort (prefixes_.begin (), prefixes_.end (),
+    [] (const std::pair <std::string, size_t> & lhs,
+        const std::pair <std::string, size_t> & rhs)
+    {
+      return lhs.first.size () > rhs.first.size ();
+    });
+
+  return true;
+}
+
+size_t
+filters::TrafficClasses::size (void) const
+{
+  return names_.size ();
+}
+
+const std::string &
+filters::TrafficClasses::get_name (size_t index) const
+{
+  return names_[std::min (index, names_.size () - 1)];
+}
+
+size_t
+filters::TrafficClasses::classify (const std::string & key)
+{
+  std::unordered_map <std::string, size_t>::const_iterator found =
+    cache_.find (key);
+  if (found != cache_.end ())
+    return found->second;
+
+  // encoded records are classified by the variable they carry
+  const size_t start = skip_encodings (key);
+
+  size_t result = names_.size () - 1;
+  for (size_t i = 0; i < prefixes_.size (); ++i)
+  {
+    if (key.compare (start, prefixes_[i].first.size (),
+      prefixes_[i].first) == 0)
+    {
+      result = prefixes_[i].second;
+      break;
+    }
+  }
+
+  if (cache_.size () >= MAX_CACHED)
+    cache_.clear ();
+  cache_[key] = result;
+
+  return result;
+}
+
+size_t
+filters::TrafficClasses::skip_encodings (const std::string & key)
+{
+  size_t start = 0;
+  while (start < key.size () && key[start] == '~')
+  {
+    const size_t dot = key.find ('.', start);
+    if (dot == std::string::npos)
+      break;
+    start = dot + 1;
+  }
+
+  return start;
+}
+
+int64_t
+filters::TrafficClasses::encoded_size (const std::string & key,
+  const madara::knowledge::KnowledgeRecord & record)
+{
+  // key, its length and the record's own encoding
+  return (int64_t)key.size () + 2 + record.get_encoded_size ();
+}
+
+void
+filters::TrafficClasses::split (const std::string & list,
+  std::vector <std::string> & result)
+{
+  result.clear ();
+
+  size_t start = 0;
+  while (start <= list.size ())
+  {
+    size_t end = list.find (',', start);
+    if (end == std::string::npos)
+      end = list.size ();
+
+    size_t first = list.find_first_not_of (" \t", start);
+    size_t last = list.find_last_not_of (" \t", end ? end - 1 : 0);
+    if (first != std::string::npos && first < end &&
+      last != std::string::npos && last >= first)
+    {
+      result.push_back (list.substr (first, last - first + 1));
+    }
+
+    start = end + 1;
+  }
+}
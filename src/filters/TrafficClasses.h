@@ -0,0 +1,105 @@
+#ifndef   _FILTER_TRAFFICCLASSES_H_
+#define   _FILTER_TRAFFICCLASSES_H_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeRecord.h"
+#include "madara/knowledge/Variables.h"
+
+namespace filters
+{
+  /**
+  * Maps variable names to traffic classes by prefix. Classes are listed in
+  * priority order, highest first, in {root}.classes, e.g.:
+  *
+  *   .send.classes = "control,state,map";
+  *   .send.control.prefixes = "agent.0.location,agent.0.orientation";
+  *   .send.map.prefixes = "agent.0.map";
+  *
+  * The longest matching prefix wins. Names that match no prefix belong to
+  * a last, lowest priority class named "default".
+  **/
+  class TrafficClasses
+  {
+  public:
+    /**
+     * Constructor. Starts with only the default class.
+     **/
+    TrafficClasses ();
+
+    /**
+     * Reads the classes from the knowledge base
+     * @param  vars    the knowledge base
+     * @param  root    prefix of the configuration, e.g., ".send"
+     * @return true if the classes changed
+     **/
+    bool load (madara::knowledge::Variables & vars, const std::string & root);
+
+    /**
+     * Returns the number of classes, including the default class
+     * @return number of classes
+     **/
+    size_t size (void) const;
+
+    /**
+     * Returns the name of a class
+     * @param  index   class index, 0 is the highest priority
+     * @return the name
+     **/
+    const std::string & get_name (size_t index) const;
+
+    /**
+     * Returns the class of a variable
+     * @param  key     variable name
+     * @return class index, 0 is the highest priority
+     **/
+    size_t classify (const std::string & key);
+
+    /**
+     * Returns the approximate bytes a record takes on the wire
+     * @param  key     variable name
+     * @param  record  the record
+     * @return bytes
+     **/
+    static int64_t encoded_size (const std::string & key,
+      const madara::knowledge::KnowledgeRecord & record);
+
+    /**
+     * Returns where the variable name starts in a key encoded by a filter,
+     * after prefixes such as ~delta. or ~lz.
+     * @param  key     variable name, possibly encoded
+     * @return index of the variable name
+     **/
+    static size_t skip_encodings (const std::string & key);
+
+    /**
+     * Splits a comma separated list, trimming spaces and skipping empty
+     * entries
+     * @param  list    the list
+     * @param  result  the entries
+     **/
+    static void split (const std::string & list,
+      std::vector <std::string> & result);
+
+  private:
+    /// class names in priority order. The last is "default".
+    std::vector <std::string> names_;
+
+    /// prefixes and their class, longest first
+    std::vector <std::pair <std::string, size_t> > prefixes_;
+
+    /// classes of variables already seen
+    std::unordered_map <std::string, size_t> cache_;
+
+    /// the configuration the classes were built from
+    std::string config_;
+  };
+
+} // end filters namespace
+
+#endif // _FILTER_TRAFFICCLASSES_H_
@@ -0,0 +1,130 @@
+
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+
+// stands in for infinite squared distance in the distance transform
+static const float EDT_INFINITY (1e20f);
+
+/**
+ * One-dimensional squared Euclidean distance transform (Felzenszwalb and
+ * Huttenlocher). f holds 0 for sites and EDT_INFINITY elsewhere.
+ **/
+static void
+distance_transform (const float * f, int n, float * d, int * v, float * z)
+{
+  int k = 0;
+  v[0] = 0;
+  z[0] = -EDT_INFINITY;
+  z[1] = EDT_INFINITY;
+
+  for (int q = 1; q < n; ++q)
+  {
+    float s = ((f[q] + (float)q * q) - (f[v[k]] + (float)v[k] * v[k])) /
+      (2.0f * q - 2.0f * v[k]);
+    while (s <= z[k])
+    {
+      --k;
+      s = ((f[q] + (float)q * q) - (f[v[k]] + (float)v[k] * v[k])) /
+        (2.0f * q - 2.0f * v[k]);
+    }
+    ++k;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = EDT_INFINITY;
+  }
+
+  k = 0;
+  for (int q = 0; q < n; ++q)
+  {
+    while (z[k + 1] < q)
+    {
+      ++k;
+    }
+    d[q] = (float)(q - v[k]) * (q - v[k]) + f[v[k]];
+  }
+}
+
+localization::DistanceField::DistanceField ()
+: width (0), height (0), resolution (1.0), origin_x (0.0), origin_y (0.0)
+{
+}
+
+void
+localization::DistanceField::compute (const containers::OccupancyGrid & grid,
+  utility::WorkerPool * pool)
+{
+  width = grid.width;
+  height = grid.height;
+  resolution = grid.resolution;
+  origin_x = grid.origin_x;
+  origin_y = grid.origin_y;
+
+  const size_t cells = (size_t)width * height;
+  const int longest = std::max (width, height);
+
+  squared_distances.resize (cells);
+  for (size_t i = 0; i < cells; ++i)
+  {
+    squared_distances[i] =
+      grid.cells[i] >= containers::OccupancyGrid::OCCUPIED_THRESHOLD ?
+      0.0f : EDT_INFINITY;
+  }
+
+  if (cells == 0)
+  {
+    return;
+  }
+
+  // columns, then rows. Every column (and row) is independent.
+  auto columns = [this, longest] (size_t begin, size_t end)
+  {
+    std::vector <float> f (longest), d (longest), z (longest + 1);
+    std::vector <int> v (longest);
+
+    for (int x = (int)begin; x < (int)end; ++x)
+    {
+      for (int y = 0; y < height; ++y)
+      {
+        f[y] = squared_distances[(size_t)y * width + x];
+      }
+      distance_transform (f.data (), height, d.data (), v.data (), z.data ());
+      for (int y = 0; y < height; ++y)
+      {
+        squared_distances[(size_t)y * width + x] = d[y];
+      }
+    }
+  };
+
+  auto rows = [this, longest] (size_t begin, size_t end)
+  {
+    std::vector <float> f (longest), z (longest + 1);
+    std::vector <int> v (longest);
+
+    for (int y = (int)begin; y < (int)end; ++y)
+    {
+      float * row = &squared_distances[(size_t)y * width];
+      std::copy (row, row + width, f.begin ());
+      distance_transform (f.data (), width, row, v.data (), z.data ());
+    }
+  };
+
+  if (pool)
+  {
+    pool->parallel_for ((size_t)width, columns);
+    pool->parallel_for ((size_t)height, rows);
+  }
+  else
+  {
+    columns (0, (size_t)width);
+    rows (0, (size_t)height);
+  }
+}
+
+double
+localization::DistanceField::distance (int cell_x, int cell_y) const
+{
+  return std::sqrt (squared_distances[(size_t)cell_y * width + cell_x]) *
+    resolution;
+}
@@ -0,0 +1,64 @@
+
+#ifndef   _LOCALIZATION_DISTANCEFIELD_H_
+#define   _LOCALIZATION_DISTANCEFIELD_H_
+
+#include <vector>
+
+#include "../containers/OccupancyGrid.h"
+#include "../utility/WorkerPool.h"
+
+namespace localization
+{
+  /**
+  * Squared distance from every cell of an occupancy grid to the nearest
+  * occupied cell, computed with an exact linear-time Euclidean distance
+  * transform. The basis for likelihood lookups used by localization.
+  **/
+  class DistanceField
+  {
+  public:
+    /**
+     * Default constructor
+     **/
+    DistanceField ();
+
+    /**
+     * Computes the field for a grid. Unknown cells count as unoccupied.
+     * @param  grid   the occupancy grid
+     * @param  pool   workers to split columns and rows across. If null,
+     *                runs on the calling thread.
+     **/
+    void compute (const containers::OccupancyGrid & grid,
+      utility::WorkerPool * pool = 0);
+
+    /**
+     * Returns the distance of a cell in meters. The cell must be inside the
+     * field.
+     * @param  cell_x  column
+     * @param  cell_y  row
+     * @return distance to the nearest occupied cell in meters
+     **/
+    double distance (int cell_x, int cell_y) const;
+
+    /// number of cells along x
+    int width;
+
+    /// number of cells along y
+    int height;
+
+    /// meters per cell
+    double resolution;
+
+    /// x coordinate of cell (0, 0) in meters
+    double origin_x;
+
+    /// y coordinate of cell (0, 0) in meters
+    double origin_y;
+
+    /// row-major squared distances in cells^2. Huge if no cell is occupied.
+    std::vector <float> squared_distances;
+  };
+
+} // end localization namespace
+
+#endif // _LOCALIZATION_DISTANCEFIELD_H_
@@ -0,0 +1,431 @@
+
+#include "ParticleFilter.h"
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+localization::ParticleFilter::ParticleFilter (utility::WorkerPool * pool)
+: sigma (0.1), z_hit (0.9), max_beams (60), linear_noise (0.1),
+  angular_noise (0.05), resample_threshold (0.5),
+  width_ (0), height_ (0), resolution_ (1.0), origin_x_ (0.0),
+  origin_y_ (0.0), outside_log_likelihood_ (0.0f),
+  particles_per_second_ (0.0), random_ (std::random_device () ()),
+  pool_ (pool)
+{
+}
+
+void
+localization::ParticleFilter::set_map (const containers::OccupancyGrid & grid)
+{
+  width_ = grid.width;
+  height_ = grid.height;
+  resolution_ = grid.resolution;
+  origin_x_ = grid.origin_x;
+  origin_y_ = grid.origin_y;
+
+  const size_t cells = (size_t)width_ * height_;
+
+  DistanceField distance;
+  distance.compute (grid, pool_);
+
+  // mixture of a Gaussian around the nearest obstacle and uniform noise
+  const double hit = std::min (std::max (z_hit, 0.01), 1.0);
+  const double random = (1.0 - hit) + 1e-3;
+  const double scale = resolution_ * resolution_ / (2 * sigma * sigma);
+
+  log_likelihood_.resize (cells);
+  free_cells_.clear ();
+  for (size_t i = 0; i < cells; ++i)
+  {
+    const double exponent = distance.squared_distances[i] * scale;
+    log_likelihood_[i] = (float)std::log (
+      (exponent > 50.0 ? 0.0 : hit * std::exp (-exponent)) + random);
+
+    if (grid.cells[i] < containers::OccupancyGrid::UNKNOWN)
+    {
+      free_cells_.push_back ((uint32_t)i);
+    }
+  }
+
+  outside_log_likelihood_ = (float)std::log (random);
+}
+
+bool
+localization::ParticleFilter::has_map (void) const
+{
+  return !log_likelihood_.empty () && width_ > 0 && height_ > 0;
+}
+
+void
+localization::ParticleFilter::reserve (size_t count)
+{
+  x_.resize (count);
+  y_.resize (count);
+  yaw_.resize (count);
+  weight_.assign (count, count > 0 ? 1.0f / count : 0.0f);
+
+  next_x_.resize (count);
+  next_y_.resize (count);
+  next_yaw_.resize (count);
+
+  cos_.resize (count);
+  sin_.resize (count);
+  log_weight_.resize (count);
+}
+
+void
+localization::ParticleFilter::initialize (size_t count, const Pose2D & pose,
+  double linear_sigma, double angular_sigma)
+{
+  reserve (count);
+
+  std::normal_distribution <double> linear (0.0, linear_sigma);
+  std::normal_distribution <double> angular (0.0, angular_sigma);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    x_[i] = (float)(pose.x + linear (random_));
+    y_[i] = (float)(pose.y + linear (random_));
+    yaw_[i] = (float)(pose.yaw + angular (random_));
+  }
+}
+
+void
+localization::ParticleFilter::initialize_uniform (size_t count)
+{
+  if (free_cells_.empty ())
+  {
+    return;
+  }
+
+  reserve (count);
+
+  std::uniform_int_distribution <size_t> cell (0, free_cells_.size () - 1);
+  std::uniform_real_distribution <double> offset (0.0, 1.0);
+  std::uniform_real_distribution <double> heading (-M_PI, M_PI);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    const uint32_t index = free_cells_[cell (random_)];
+    x_[i] = (float)(origin_x_ +
+      ((index % width_) + offset (random_)) * resolution_);
+    y_[i] = (float)(origin_y_ +
+      ((index / width_) + offset (random_)) * resolution_);
+    yaw_[i] = (float)heading (random_);
+  }
+}
+
+void
+localization::ParticleFilter::predict (double dx, double dy, double dyaw)
+{
+  const double travel = std::sqrt (dx * dx + dy * dy);
+
+  // a small floor keeps the set from collapsing while stationary
+  std::normal_distribution <double> linear (0.0,
+    linear_noise * travel + 0.002);
+  std::normal_distribution <double> angular (0.0,
+    angular_noise * (std::fabs (dyaw) + travel) + 0.001);
+
+  for (size_t i = 0; i < x_.size (); ++i)
+  {
+    const double c = std::cos (yaw_[i]);
+    const double s = std::sin (yaw_[i]);
+    const double mx = dx + linear (random_);
+    const double my = dy + linear (random_);
+
+    x_[i] += (float)(c * mx - s * my);
+    y_[i] += (float)(s * mx + c * my);
+    yaw_[i] = (float)std::remainder (
+      yaw_[i] + dyaw + angular (random_), 2 * M_PI);
+  }
+}
+
+void
+localization::ParticleFilter::evaluate (size_t begin, size_t end)
+{
+  const float * table = log_likelihood_.data ();
+  const float outside = outside_log_likelihood_;
+  const float * beam_x = beam_x_.data ();
+  const float * beam_y = beam_y_.data ();
+  const size_t beams = beam_x_.size ();
+  const float inverse = (float)(1.0 / resolution_);
+  const float origin_x = (float)origin_x_;
+  const float origin_y = (float)origin_y_;
+
+  size_t i = begin;
+
+#if defined (__SSE2__)
+  // four particles per iteration. Cell indices are formed in float, which
+  // is exact for maps below 2^24 cells, then gathered with scalar loads.
+  const __m128 zero = _mm_setzero_ps ();
+  const __m128 width = _mm_set1_ps ((float)width_);
+  const __m128 height = _mm_set1_ps ((float)height_);
+
+  for (; i + 4 <= end; i += 4)
+  {
+    const __m128 px = _mm_mul_ps (_mm_sub_ps (
+      _mm_loadu_ps (&x_[i]), _mm_set1_ps (origin_x)), _mm_set1_ps (inverse));
+    const __m128 py = _mm_mul_ps (_mm_sub_ps (
+      _mm_loadu_ps (&y_[i]), _mm_set1_ps (origin_y)), _mm_set1_ps (inverse));
+    const __m128 c = _mm_loadu_ps (&cos_[i]);
+    const __m128 s = _mm_loadu_ps (&sin_[i]);
+
+    __m128 sum = zero;
+
+    for (size_t j = 0; j < beams; ++j)
+    {
+      const __m128 bx = _mm_set1_ps (beam_x[j]);
+      const __m128 by = _mm_set1_ps (beam_y[j]);
+
+      const __m128 gx = _mm_add_ps (px,
+        _mm_sub_ps (_mm_mul_ps (c, bx), _mm_mul_ps (s, by)));
+      const __m128 gy = _mm_add_ps (py,
+        _mm_add_ps (_mm_mul_ps (s, bx), _mm_mul_ps (c, by)));
+
+      const __m128 inside = _mm_and_ps (
+        _mm_and_ps (_mm_cmpge_ps (gx, zero), _mm_cmplt_ps (gx, width)),
+        _mm_and_ps (_mm_cmpge_ps (gy, zero), _mm_cmplt_ps (gy, height)));
+
+      // truncation is floor for the in-bounds, non-negative lanes
+      const __m128 cx = _mm_cvtepi32_ps (_mm_cvttps_epi32 (gx));
+      const __m128 cy = _mm_cvtepi32_ps (_mm_cvttps_epi32 (gy));
+      const __m128 index = _mm_and_ps (inside,
+        _mm_add_ps (_mm_mul_ps (cy, width), cx));
+
+      int lanes[4];
+      _mm_storeu_si128 ((__m128i *)lanes, _mm_cvttps_epi32 (index));
+
+      const __m128 values = _mm_setr_ps (table[lanes[0]], table[lanes[1]],
+        table[lanes[2]], table[lanes[3]]);
+
+      sum = _mm_add_ps (sum, _mm_or_ps (_mm_and_ps (inside, values),
+        _mm_andnot_ps (inside, _mm_set1_ps (outside))));
+    }
+
+    _mm_storeu_ps (&log_weight_[i], sum);
+  }
+#endif
+
+  const unsigned width_cells = (unsigned)width_;
+  const unsigned height_cells = (unsigned)height_;
+
+  for (; i < end; ++i)
+  {
+    const float px = (x_[i] - origin_x) * inverse;
+    const float py = (y_[i] - origin_y) * inverse;
+    const float c = cos_[i];
+    const float s = sin_[i];
+
+    float sum = 0.0f;
+
+    for (size_t j = 0; j < beams; ++j)
+    {
+      const float gx = px + c * beam_x[j] - s * beam_y[j];
+      const float gy = py + s * beam_x[j] + c * beam_y[j];
+      const bool inside = gx >= 0 && gy >= 0 &&
+        (unsigned)gx < width_cells && (unsigned)gy < height_cells;
+
+      sum += inside ? table[(size_t)(unsigned)gy * width_cells +
+        (unsigned)gx] : outside;
+    }
+
+    log_weight_[i] = sum;
+  }
+}
+
+bool
+localization::ParticleFilter::update (const containers::LaserScan & scan)
+{
+  const size_t count = x_.size ();
+
+  if (!has_map () || count == 0)
+  {
+    return false;
+  }
+
+  // decimate valid returns into sensor frame points
+  size_t valid = 0;
+  for (size_t i = 0; i < scan.ranges.size (); ++i)
+  {
+    if (scan.ranges[i] > 0 && scan.ranges[i] < scan.range_max)
+    {
+      ++valid;
+    }
+  }
+
+  if (valid == 0)
+  {
+    return false;
+  }
+
+  const size_t stride = max_beams > 0 && valid > max_beams ?
+    (valid + max_beams - 1) / max_beams : 1;
+
+  beam_x_.clear ();
+  beam_y_.clear ();
+
+  // beams are kept in cells so evaluation needs no per-beam scaling
+  const double inverse = 1.0 / resolution_;
+
+  size_t seen = 0;
+  for (size_t i = 0; i < scan.ranges.size (); ++i)
+  {
+    const float range = scan.ranges[i];
+    if (range > 0 && range < scan.range_max && seen++ % stride == 0)
+    {
+      const double angle = scan.angle_min + i * scan.angle_increment;
+      beam_x_.push_back ((float)(range * inverse * std::cos (angle)));
+      beam_y_.push_back ((float)(range * inverse * std::sin (angle)));
+    }
+  }
+
+  // rotations are shared by every beam of a particle, so hoist them
+  for (size_t i = 0; i < count; ++i)
+  {
+    cos_[i] = std::cos (yaw_[i]);
+    sin_[i] = std::sin (yaw_[i]);
+  }
+
+  const std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now ();
+
+  if (pool_)
+  {
+    // hand out whole groups of four so every SIMD lane stays full
+    const size_t groups = (count + 3) / 4;
+    pool_->parallel_for (groups, [this, count] (size_t begin, size_t end) {
+      evaluate (begin * 4, std::min (end * 4, count));
+    });
+  }
+  else
+  {
+    evaluate (0, count);
+  }
+
+  const double elapsed = std::chrono::duration <double> (
+    std::chrono::steady_clock::now () - start).count ();
+  particles_per_second_ = elapsed > 0 ? count / elapsed : 0.0;
+
+  // normalize in log space to avoid underflow
+  const float best = *std::max_element (
+    log_weight_.begin (), log_weight_.end ());
+
+  double total = 0.0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const double weight = weight_[i] * std::exp (log_weight_[i] - best);
+    weight_[i] = (float)weight;
+    total += weight;
+  }
+
+  if (!(total > 0))
+  {
+    weight_.assign (count, 1.0f / count);
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    weight_[i] = (float)(weight_[i] / total);
+  }
+
+  if (effective_size () < resample_threshold * count)
+  {
+    resample ();
+    return true;
+  }
+
+  return false;
+}
+
+void
+localization::ParticleFilter::resample (void)
+{
+  const size_t count = x_.size ();
+
+  if (count == 0)
+  {
+    return;
+  }
+
+  const double step = 1.0 / count;
+  std::uniform_real_distribution <double> start (0.0, step);
+
+  double target = start (random_);
+  double cumulative = weight_[0];
+  size_t source = 0;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    while (target > cumulative && source + 1 < count)
+    {
+      cumulative += weight_[++source];
+    }
+
+    next_x_[i] = x_[source];
+    next_y_[i] = y_[source];
+    next_yaw_[i] = yaw_[source];
+
+    target += step;
+  }
+
+  x_.swap (next_x_);
+  y_.swap (next_y_);
+  yaw_.swap (next_yaw_);
+  std::fill (weight_.begin (), weight_.end (), (float)step);
+}
+
+localization::Pose2D
+localization::ParticleFilter::estimate (void) const
+{
+  Pose2D result = { 0.0, 0.0, 0.0 };
+  double c = 0.0, s = 0.0, total = 0.0;
+
+  for (size_t i = 0; i < x_.size (); ++i)
+  {
+    result.x += weight_[i] * x_[i];
+    result.y += weight_[i] * y_[i];
+    c += weight_[i] * std::cos (yaw_[i]);
+    s += weight_[i] * std::sin (yaw_[i]);
+    total += weight_[i];
+  }
+
+  if (total > 0)
+  {
+    result.x /= total;
+    result.y /= total;
+    result.yaw = std::atan2 (s, c);
+  }
+
+  return result;
+}
+
+size_t
+localization::ParticleFilter::size (void) const
+{
+  return x_.size ();
+}
+
+double
+localization::ParticleFilter::effective_size (void) const
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < weight_.size (); ++i)
+  {
+    sum += (double)weight_[i] * weight_[i];
+  }
+
+  return sum > 0 ? 1.0 / sum : 0.0;
+}
+
+double
+localization::ParticleFilter::get_particles_per_second (void) const
+{
+  return particles_per_second_;
+}
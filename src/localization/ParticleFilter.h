@@ -0,0 +1,192 @@
+
+#ifndef   _LOCALIZATION_PARTICLEFILTER_H_
+#define   _LOCALIZATION_PARTICLEFILTER_H_
+
+#include <random>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../containers/LaserScan.h"
+#include "../containers/OccupancyGrid.h"
+#include "../utility/WorkerPool.h"
+#include "ScanMatcher.h"
+
+namespace localization
+{
+  /**
+  * Monte Carlo localization against an occupancy grid, for environments
+  * where a single pose hypothesis (e.g., ScanMatcher) can lock onto the
+  * wrong place.
+  *
+  * Particles are stored as structure-of-arrays. Beam likelihoods come from
+  * a precomputed per-cell log-likelihood table built on a DistanceField,
+  * and are evaluated four particles at a time with SSE2 where available.
+  * Particles are partitioned across a WorkerPool. Low-variance resampling
+  * swaps between two preallocated particle sets, so steady-state updates
+  * never allocate.
+  **/
+  class ParticleFilter
+  {
+  public:
+    /**
+     * Constructor
+     * @param  pool   workers to evaluate particles across. If null, all
+     *                particles are evaluated on the calling thread.
+     **/
+    ParticleFilter (utility::WorkerPool * pool = 0);
+
+    /**
+     * Precomputes the likelihood table for a map
+     * @param  grid   the occupancy grid to localize in
+     **/
+    void set_map (const containers::OccupancyGrid & grid);
+
+    /**
+     * Checks if a map has been set
+     * @return true if update can be called
+     **/
+    bool has_map (void) const;
+
+    /**
+     * Spreads particles around a pose with Gaussian noise
+     * @param  count          number of particles
+     * @param  pose           the center of the distribution
+     * @param  linear_sigma   standard deviation in x and y (m)
+     * @param  angular_sigma  standard deviation in yaw (rad)
+     **/
+    void initialize (size_t count, const Pose2D & pose,
+      double linear_sigma, double angular_sigma);
+
+    /**
+     * Spreads particles uniformly over the free cells of the map, for
+     * global localization. Requires a map.
+     * @param  count          number of particles
+     **/
+    void initialize_uniform (size_t count);
+
+    /**
+     * Moves every particle by a motion in the robot frame, plus noise
+     * proportional to linear_noise and angular_noise
+     * @param  dx     forward motion (m)
+     * @param  dy     leftward motion (m)
+     * @param  dyaw   rotation (rad)
+     **/
+    void predict (double dx, double dy, double dyaw);
+
+    /**
+     * Weights every particle by the likelihood of a scan and resamples if
+     * the effective sample size drops below resample_threshold
+     * @param  scan   the scan in the sensor frame
+     * @return true if the particles were resampled
+     **/
+    bool update (const containers::LaserScan & scan);
+
+    /**
+     * Draws a new particle set with low-variance resampling
+     **/
+    void resample (void);
+
+    /**
+     * Returns the weighted mean pose
+     * @return the pose estimate
+     **/
+    Pose2D estimate (void) const;
+
+    /**
+     * Returns the number of particles
+     * @return particle count
+     **/
+    size_t size (void) const;
+
+    /**
+     * Returns the effective sample size, 1 / sum (w^2)
+     * @return effective number of particles
+     **/
+    double effective_size (void) const;
+
+    /**
+     * Returns the likelihood evaluation throughput of the last update
+     * @return particles evaluated per second
+     **/
+    double get_particles_per_second (void) const;
+
+    /// standard deviation of the hit model in meters
+    double sigma;
+
+    /// weight of the hit model versus uniform noise, in (0, 1]
+    double z_hit;
+
+    /// scans are decimated to at most this many beams
+    size_t max_beams;
+
+    /// motion noise per meter traveled (m)
+    double linear_noise;
+
+    /// motion noise per radian turned (rad)
+    double angular_noise;
+
+    /// resample when effective size falls below this fraction of size ()
+    double resample_threshold;
+
+  private:
+    /**
+     * Sizes every particle array for count particles with uniform weights
+     **/
+    void reserve (size_t count);
+
+    /**
+     * Computes the log-likelihood of the current beams for particles in
+     * [begin, end)
+     **/
+    void evaluate (size_t begin, size_t end);
+
+    /// lookup placement, copied from the map
+    int width_;
+    int height_;
+    double resolution_;
+    double origin_x_;
+    double origin_y_;
+
+    /// per-cell beam log-likelihood
+    std::vector <float> log_likelihood_;
+
+    /// log-likelihood of a beam ending outside of the map
+    float outside_log_likelihood_;
+
+    /// indices of known free cells, for global initialization
+    std::vector <uint32_t> free_cells_;
+
+    /// particle poses and normalized weights
+    std::vector <float> x_;
+    std::vector <float> y_;
+    std::vector <float> yaw_;
+    std::vector <float> weight_;
+
+    /// resampling destination, swapped with the particle arrays
+    std::vector <float> next_x_;
+    std::vector <float> next_y_;
+    std::vector <float> next_yaw_;
+
+    /// per-particle scratch for the update
+    std::vector <float> cos_;
+    std::vector <float> sin_;
+    std::vector <float> log_weight_;
+
+    /// decimated beam endpoints in the sensor frame, in cells
+    std::vector <float> beam_x_;
+    std::vector <float> beam_y_;
+
+    /// throughput of the last update
+    double particles_per_second_;
+
+    /// noise source for prediction and resampling
+    std::mt19937 random_;
+
+    /// workers for evaluation. Not owned.
+    utility::WorkerPool * pool_;
+  };
+
+} // end localization namespace
+
+#endif // _LOCALIZATION_PARTICLEFILTER_H_
@@ -0,0 +1,326 @@
+
+#include "ScanMatcher.h"
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+
+localization::ScanMatcher::ScanMatcher (utility::WorkerPool * pool)
+: levels (5), linear_window (1.0), angular_window (0.35), sigma (0.1),
+  max_points (360), min_score (0.3),
+  width_ (0), height_ (0), resolution_ (1.0), origin_x_ (0.0),
+  origin_y_ (0.0), pad_ (0), stride_ (0), rows_ (0), num_points_ (0), window_cells_ (0), num_rotations_ (0),
+  best_score_ (0), pool_ (pool)
+{
+}
+
+void
+localization::ScanMatcher::set_map (const containers::OccupancyGrid & grid)
+{
+  width_ = grid.width;
+  height_ = grid.height;
+  resolution_ = grid.resolution;
+  origin_x_ = grid.origin_x;
+  origin_y_ = grid.origin_y;
+
+  DistanceField distance;
+  distance.compute (grid, pool_);
+
+  if (levels < 1)
+  {
+    levels = 1;
+  }
+  lookups_.resize (levels);
+
+  // windows starting before the grid but reaching into it must bound the
+  // cells they cover, or the branch holding the best pose can be pruned.
+  // Padding before the grid holds those windows. Windows running past
+  // the far edge are clamped below.
+  pad_ = (1 << (levels - 1)) - 1;
+  stride_ = width_ + pad_;
+  rows_ = height_ + pad_;
+  const size_t cells = (size_t)stride_ * rows_;
+
+  // level 0 is the likelihood field, truncated at three sigma. Cells
+  // outside the grid score 0.
+  const double scale = resolution_ * resolution_ / (2 * sigma * sigma);
+  std::vector <uint8_t> & field = lookups_[0];
+  field.assign (cells, 0);
+  for (int y = 0; y < height_; ++y)
+  {
+    for (int x = 0; x < width_; ++x)
+    {
+      const double exponent =
+        distance.squared_distances[(size_t)y * width_ + x] * scale;
+      field[(size_t)(y + pad_) * stride_ + x + pad_] = exponent > 4.5 ? 0 :
+        (uint8_t)(255.0 * std::exp (-exponent) + 0.5);
+    }
+  }
+
+  // level k holds the max over the 2^k x 2^k window starting at each cell
+  for (int level = 1; level < levels; ++level)
+  {
+    const int half = 1 << (level - 1);
+    const std::vector <uint8_t> & previous = lookups_[level - 1];
+    std::vector <uint8_t> & current = lookups_[level];
+    current.resize (cells);
+
+    for (int y = 0; y < rows_; ++y)
+    {
+      const bool has_up = y + half < rows_;
+      for (int x = 0; x < stride_; ++x)
+      {
+        const bool has_right = x + half < stride_;
+        const size_t index = (size_t)y * stride_ + x;
+
+        uint8_t value = previous[index];
+        if (has_right)
+        {
+          value = std::max (value, previous[index + half]);
+        }
+        if (has_up)
+        {
+          value = std::max (value, previous[index + (size_t)half * stride_]);
+          if (has_right)
+          {
+            value = std::max (value,
+              previous[index + (size_t)half * stride_ + half]);
+          }
+        }
+        current[index] = value;
+      }
+    }
+  }
+}
+
+bool
+localization::ScanMatcher::has_map (void) const
+{
+  return !lookups_.empty () && width_ > 0 && height_ > 0;
+}
+
+uint32_t
+localization::ScanMatcher::score (
+  int level, int rotation, int x, int y) const
+{
+  const uint8_t * lookup = lookups_[level].data ();
+  const int * cell_x = &cell_x_[(size_t)rotation * num_points_];
+  const int * cell_y = &cell_y_[(size_t)rotation * num_points_];
+  const unsigned width = (unsigned)stride_;
+  const unsigned height = (unsigned)rows_;
+
+  // lookups start pad_ cells before the grid
+  x += pad_;
+  y += pad_;
+
+  uint32_t sum = 0;
+
+  for (size_t i = 0; i < num_points_; ++i)
+  {
+    // negative coordinates wrap to large unsigned values and fail the test
+    const unsigned cx = (unsigned)(cell_x[i] + x);
+    const unsigned cy = (unsigned)(cell_y[i] + y);
+    const bool inside = (cx < width) & (cy < height);
+    const size_t index = inside ? (size_t)cy * width + cx : 0;
+    sum += inside ? lookup[index] : 0;
+  }
+
+  return sum;
+}
+
+void
+localization::ScanMatcher::branch (const Candidate & candidate, int level)
+{
+  if (candidate.score <= best_score_.load (std::memory_order_relaxed))
+  {
+    return;
+  }
+
+  if (level == 0)
+  {
+    std::lock_guard <std::mutex> guard (best_mutex_);
+    if (candidate.score > best_score_.load (std::memory_order_relaxed))
+    {
+      best_ = candidate;
+      best_score_.store (candidate.score, std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  const int child_level = level - 1;
+  const int step = 1 << child_level;
+
+  Candidate children[4];
+  int num_children = 0;
+
+  for (int dy = 0; dy < 2; ++dy)
+  {
+    for (int dx = 0; dx < 2; ++dx)
+    {
+      Candidate child;
+      child.rotation = candidate.rotation;
+      child.x = candidate.x + dx * step;
+      child.y = candidate.y + dy * step;
+
+      if (child.x > window_cells_ || child.y > window_cells_)
+      {
+        continue;
+      }
+
+      child.score = score (child_level, child.rotation, child.x, child.y);
+      children[num_children++] = child;
+    }
+  }
+
+  std::sort (children, children + num_children);
+
+  for (int i = 0; i < num_children; ++i)
+  {
+    branch (children[i], child_level);
+  }
+}
+
+void
+localization::ScanMatcher::search (size_t begin, size_t end)
+{
+  const int top = (int)lookups_.size () - 1;
+  const int step = 1 << top;
+
+  std::vector <Candidate> candidates;
+
+  for (size_t rotation = begin; rotation < end; ++rotation)
+  {
+    for (int y = -window_cells_; y <= window_cells_; y += step)
+    {
+      for (int x = -window_cells_; x <= window_cells_; x += step)
+      {
+        Candidate candidate;
+        candidate.rotation = (int)rotation;
+        candidate.x = x;
+        candidate.y = y;
+        candidate.score = score (top, candidate.rotation, x, y);
+        candidates.push_back (candidate);
+      }
+    }
+  }
+
+  // exploring the most promising branches first makes pruning effective
+  std::sort (candidates.begin (), candidates.end ());
+
+  for (size_t i = 0; i < candidates.size (); ++i)
+  {
+    branch (candidates[i], top);
+  }
+}
+
+double
+localization::ScanMatcher::match (const containers::LaserScan & scan,
+  const Pose2D & guess, Pose2D & result)
+{
+  result = guess;
+
+  if (!has_map ())
+  {
+    return 0.0;
+  }
+
+  // decimate valid returns into sensor frame points
+  size_t valid = 0;
+  for (size_t i = 0; i < scan.ranges.size (); ++i)
+  {
+    if (scan.ranges[i] > 0 && scan.ranges[i] < scan.range_max)
+    {
+      ++valid;
+    }
+  }
+
+  const size_t stride = max_points > 0 && valid > max_points ?
+    (valid + max_points - 1) / max_points : 1;
+
+  point_x_.clear ();
+  point_y_.clear ();
+
+  double max_range = 0.0;
+  size_t seen = 0;
+  for (size_t i = 0; i < scan.ranges.size (); ++i)
+  {
+    const float range = scan.ranges[i];
+    if (range > 0 && range < scan.range_max && seen++ % stride == 0)
+    {
+      const double angle = scan.angle_min + i * scan.angle_increment;
+      point_x_.push_back ((float)(range * std::cos (angle)));
+      point_y_.push_back ((float)(range * std::sin (angle)));
+      max_range = std::max (max_range, (double)range);
+    }
+  }
+
+  num_points_ = point_x_.size ();
+  if (num_points_ == 0)
+  {
+    return 0.0;
+  }
+
+  // the rotation step moves the farthest point by about one cell
+  double angular_step = std::acos (1.0 -
+    resolution_ * resolution_ / (2.0 * max_range * max_range));
+  if (!(angular_step > 0))
+  {
+    angular_step = angular_window > 0 ? angular_window : 1.0;
+  }
+
+  const int rotation_steps = (int)std::ceil (angular_window / angular_step);
+  num_rotations_ = 2 * rotation_steps + 1;
+  window_cells_ = (int)std::ceil (linear_window / resolution_);
+
+  // place the scan at every rotation, in map cells relative to the guess
+  cell_x_.resize ((size_t)num_rotations_ * num_points_);
+  cell_y_.resize ((size_t)num_rotations_ * num_points_);
+
+  for (int rotation = 0; rotation < num_rotations_; ++rotation)
+  {
+    const double yaw = guess.yaw + (rotation - rotation_steps) * angular_step;
+    const float c = (float)std::cos (yaw);
+    const float s = (float)std::sin (yaw);
+    const float base_x = (float)((guess.x - origin_x_) / resolution_);
+    const float base_y = (float)((guess.y - origin_y_) / resolution_);
+    const float inverse = (float)(1.0 / resolution_);
+
+    int * cell_x = &cell_x_[(size_t)rotation * num_points_];
+    int * cell_y = &cell_y_[(size_t)rotation * num_points_];
+
+    for (size_t i = 0; i < num_points_; ++i)
+    {
+      cell_x[i] = (int)std::floor (base_x +
+        (c * point_x_[i] - s * point_y_[i]) * inverse);
+      cell_y[i] = (int)std::floor (base_y +
+        (s * point_x_[i] + c * point_y_[i]) * inverse);
+    }
+  }
+
+  // anything below the minimum score is pruned from the start
+  const uint32_t threshold =
+    (uint32_t)(min_score * 255.0 * num_points_);
+  best_score_.store (threshold, std::memory_order_relaxed);
+  best_.score = 0;
+
+  if (pool_)
+  {
+    pool_->parallel_for ((size_t)num_rotations_,
+      [this] (size_t begin, size_t end) { search (begin, end); });
+  }
+  else
+  {
+    search (0, (size_t)num_rotations_);
+  }
+
+  if (best_.score == 0)
+  {
+    return 0.0;
+  }
+
+  result.x = guess.x + best_.x * resolution_;
+  result.y = guess.y + best_.y * resolution_;
+  result.yaw = guess.yaw + (best_.rotation - rotation_steps) * angular_step;
+
+  return best_.score / (255.0 * num_points_);
+}
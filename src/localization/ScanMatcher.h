@@ -0,0 +1,189 @@
+
+#ifndef   _LOCALIZATION_SCANMATCHER_H_
+#define   _LOCALIZATION_SCANMATCHER_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../containers/LaserScan.h"
+#include "../containers/OccupancyGrid.h"
+#include "../utility/WorkerPool.h"
+
+namespace localization
+{
+  /**
+  * A planar pose
+  **/
+  struct Pose2D
+  {
+    /// x in meters
+    double x;
+
+    /// y in meters
+    double y;
+
+    /// heading in radians
+    double yaw;
+  };
+
+  /**
+  * Correlative scan-to-map matcher for GPS-denied localization.
+  *
+  * set_map precomputes a likelihood field from the occupancy grid (a
+  * Gaussian of the distance to the nearest occupied cell) and a stack of
+  * lower resolution lookups where each cell holds the maximum of a
+  * 2^k x 2^k window, clamped to the grid. match then runs a
+  * branch-and-bound search over the rotation and translation window:
+  * coarse lookups give upper bounds that prune most of the window, and
+  * only surviving branches are refined down to full resolution.
+  * Rotations are split across a WorkerPool.
+  **/
+  class ScanMatcher
+  {
+  public:
+    /**
+     * Constructor
+     * @param  pool   workers to parallelize the search across. If null,
+     *                the search runs on the calling thread.
+     **/
+    ScanMatcher (utility::WorkerPool * pool = 0);
+
+    /**
+     * Precomputes the likelihood lookups for a map. Call again whenever
+     * the map changes enough to matter.
+     * @param  grid   the occupancy grid to match against
+     **/
+    void set_map (const containers::OccupancyGrid & grid);
+
+    /**
+     * Checks if a map has been set
+     * @return true if match can be called
+     **/
+    bool has_map (void) const;
+
+    /**
+     * Finds the pose within the search window around guess that best
+     * aligns the scan with the map. Not reentrant.
+     * @param  scan    the scan in the sensor frame
+     * @param  guess   the initial pose estimate
+     * @param  result  the best pose found, or guess if no pose scored at
+     *                 least min_score
+     * @return score of the result in [0, 1], or 0 if nothing matched
+     **/
+    double match (const containers::LaserScan & scan,
+      const Pose2D & guess, Pose2D & result);
+
+    /// number of lookup resolutions. Level k cells cover 2^k map cells.
+    int levels;
+
+    /// half-width of the translation search window in meters
+    double linear_window;
+
+    /// half-width of the rotation search window in radians
+    double angular_window;
+
+    /// standard deviation of the likelihood field in meters
+    double sigma;
+
+    /// scans are decimated to at most this many points
+    size_t max_points;
+
+    /// minimum score in [0, 1] for a match to be accepted
+    double min_score;
+
+  private:
+    /**
+     * A search candidate. A candidate at level k stands for every
+     * translation in [x, x + 2^k) x [y, y + 2^k) cells.
+     **/
+    struct Candidate
+    {
+      /// rotation index
+      int rotation;
+
+      /// translation offset in cells along x
+      int x;
+
+      /// translation offset in cells along y
+      int y;
+
+      /// sum of lookup values over all scan points
+      uint32_t score;
+
+      /// sorts candidates best first
+      bool operator< (const Candidate & rhs) const
+      {
+        return score > rhs.score;
+      }
+    };
+
+    /**
+     * Scores a candidate against a lookup level. The loop is branch-free
+     * over structure-of-arrays cell coordinates so it vectorizes.
+     **/
+    uint32_t score (int level, int rotation, int x, int y) const;
+
+    /**
+     * Runs branch-and-bound over a range of rotations
+     **/
+    void search (size_t begin, size_t end);
+
+    /**
+     * Recursively refines a candidate at a level down to full resolution
+     **/
+    void branch (const Candidate & candidate, int level);
+
+    /// grid dimensions and placement, copied from the map
+    int width_;
+    int height_;
+    double resolution_;
+    double origin_x_;
+    double origin_y_;
+
+    /// cells of padding before the grid on each axis. A coarse window
+    /// starting up to this far outside the grid still covers cells in it.
+    int pad_;
+
+    /// lookup dimensions, grid plus padding
+    int stride_;
+    int rows_;
+
+    /// likelihood lookups, full resolution, one per level
+    std::vector <std::vector <uint8_t> > lookups_;
+
+    /// decimated scan points in the sensor frame
+    std::vector <float> point_x_;
+    std::vector <float> point_y_;
+
+    /// scan points in map cells for each rotation, rotation-major
+    std::vector <int> cell_x_;
+    std::vector <int> cell_y_;
+
+    /// number of points in the current scan
+    size_t num_points_;
+
+    /// translation window in cells
+    int window_cells_;
+
+    /// number of rotations in the current search
+    int num_rotations_;
+
+    /// best score found so far by any worker, used for pruning
+    std::atomic <uint32_t> best_score_;
+
+    /// protects best_
+    std::mutex best_mutex_;
+
+    /// best full-resolution candidate found so far
+    Candidate best_;
+
+    /// workers for the search. Not owned.
+    utility::WorkerPool * pool_;
+  };
+
+} // end localization namespace
+
+#endif // _LOCALIZATION_SCANMATCHER_H_
@@ -0,0 +1,364 @@
+
+#include "SensorFusion.h"
+
+#include <cmath>
+#include <limits>
+
+/**
+ * Linear interpolation between two IMU samples
+ **/
+static containers::ImuSample
+blend_imu (const containers::ImuSample & before,
+  const containers::ImuSample & after, double ratio)
+{
+  containers::ImuSample result;
+  result.timestamp = before.timestamp +
+    (int64_t)((after.timestamp - before.timestamp) * ratio);
+
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    result.accel[axis] = before.accel[axis] +
+      (after.accel[axis] - before.accel[axis]) * ratio;
+    result.gyro[axis] = before.gyro[axis] +
+      (after.gyro[axis] - before.gyro[axis]) * ratio;
+  }
+
+  return result;
+}
+
+/**
+ * Returns the shortest signed angle from one heading to another
+ **/
+static double
+angle_difference (double from, double to)
+{
+  return std::remainder (to - from, 2 * M_PI);
+}
+
+localization::SensorFusion::SensorFusion (size_t imu_capacity,
+  size_t fix_capacity, size_t history_capacity)
+: replay_window (1000000000), position_gain (0.3), velocity_gain (0.5),
+  yaw_gain (0.3),
+  imu_ (imu_capacity), fixes_ (fix_capacity), history_ (history_capacity),
+  initialized_ (false), have_imu_ (false), have_fix_ (false),
+  pending_ (false),
+  earliest_pending_ (std::numeric_limits <int64_t>::max ()),
+  newest_ (std::numeric_limits <int64_t>::min ()),
+  replays_ (0), replayed_ (0), late_drops_ (0)
+{
+  state_ = FusedState ();
+  last_imu_ = containers::ImuSample ();
+}
+
+bool
+localization::SensorFusion::accept (int64_t timestamp)
+{
+  if (newest_ != std::numeric_limits <int64_t>::min () &&
+    timestamp < newest_ - replay_window)
+  {
+    ++late_drops_;
+    return false;
+  }
+
+  if (timestamp > newest_)
+  {
+    newest_ = timestamp;
+  }
+  if (timestamp < earliest_pending_)
+  {
+    earliest_pending_ = timestamp;
+  }
+  pending_ = true;
+
+  return true;
+}
+
+bool
+localization::SensorFusion::add_imu (const containers::ImuSample & sample)
+{
+  if (!accept (sample.timestamp))
+  {
+    return false;
+  }
+
+  return imu_.insert (sample.timestamp, sample);
+}
+
+bool
+localization::SensorFusion::add_fix (const containers::PositionFix & fix)
+{
+  if (!accept (fix.timestamp))
+  {
+    return false;
+  }
+
+  return fixes_.insert (fix.timestamp, fix);
+}
+
+void
+localization::SensorFusion::propagate (const containers::ImuSample & sample)
+{
+  const double dt = (sample.timestamp - state_.timestamp) / 1000000000.0;
+  if (dt <= 0)
+  {
+    return;
+  }
+
+  const containers::ImuSample & previous = have_imu_ ? last_imu_ : sample;
+
+  // rotate the mean body acceleration by the midpoint heading
+  const double rate = (previous.gyro[2] + sample.gyro[2]) / 2;
+  const double heading = state_.yaw + rate * dt / 2;
+  const double c = std::cos (heading);
+  const double s = std::sin (heading);
+
+  const double ax = (previous.accel[0] + sample.accel[0]) / 2;
+  const double ay = (previous.accel[1] + sample.accel[1]) / 2;
+  const double accel[3] = {
+    c * ax - s * ay, s * ax + c * ay, (previous.accel[2] + sample.accel[2]) / 2
+  };
+
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    state_.position[axis] +=
+      state_.velocity[axis] * dt + accel[axis] * dt * dt / 2;
+    state_.velocity[axis] += accel[axis] * dt;
+  }
+
+  state_.yaw = std::remainder (state_.yaw + rate * dt, 2 * M_PI);
+  state_.timestamp = sample.timestamp;
+}
+
+void
+localization::SensorFusion::correct (const containers::PositionFix & fix)
+{
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    if (fix.axes & (containers::PositionFix::X << axis))
+    {
+      const double innovation = fix.position[axis] - state_.position[axis];
+
+      // the first fix anchors the position outright
+      state_.position[axis] += have_fix_ ?
+        position_gain * innovation : innovation;
+      if (have_fix_)
+      {
+        state_.velocity[axis] += velocity_gain * innovation;
+      }
+    }
+  }
+
+  if (fix.axes & containers::PositionFix::YAW)
+  {
+    state_.yaw = std::remainder (state_.yaw +
+      (have_fix_ ? yaw_gain : 1.0) * angle_difference (state_.yaw, fix.yaw),
+      2 * M_PI);
+  }
+
+  have_fix_ = true;
+}
+
+void
+localization::SensorFusion::save (void)
+{
+  Snapshot snapshot;
+  snapshot.state = state_;
+  snapshot.last_imu = last_imu_;
+  snapshot.have_imu = have_imu_;
+  snapshot.have_fix = have_fix_;
+
+  history_.insert (state_.timestamp, snapshot);
+}
+
+size_t
+localization::SensorFusion::update (void)
+{
+  if (!pending_)
+  {
+    return 0;
+  }
+
+  const int64_t start = earliest_pending_;
+  pending_ = false;
+  earliest_pending_ = std::numeric_limits <int64_t>::max ();
+
+  // a measurement at or before the estimate invalidates everything since
+  const int64_t replay_until = state_.timestamp;
+  const bool replay = initialized_ && start <= replay_until;
+
+  if (replay)
+  {
+    ++replays_;
+
+    const size_t index = history_.lower_bound (start);
+    if (index > 0)
+    {
+      const Snapshot & snapshot = history_.at (index - 1);
+      state_ = snapshot.state;
+      last_imu_ = snapshot.last_imu;
+      have_imu_ = snapshot.have_imu;
+      have_fix_ = snapshot.have_fix;
+      history_.truncate (index);
+    }
+    else
+    {
+      // the history does not reach back far enough, so start over from
+      // everything still buffered
+      state_ = FusedState ();
+      have_imu_ = false;
+      have_fix_ = false;
+      initialized_ = false;
+      history_.clear ();
+    }
+  }
+
+  size_t next_imu = initialized_ ? imu_.upper_bound (state_.timestamp) : 0;
+  size_t next_fix = initialized_ ? fixes_.upper_bound (state_.timestamp) : 0;
+  size_t applied = 0;
+
+  // merge the sensor streams by time. IMU samples go first on ties.
+  while (next_imu < imu_.size () || next_fix < fixes_.size ())
+  {
+    const bool take_fix = next_fix < fixes_.size () &&
+      (next_imu == imu_.size () ||
+       fixes_.time_at (next_fix) < imu_.time_at (next_imu));
+
+    int64_t timestamp;
+
+    if (take_fix)
+    {
+      const containers::PositionFix & fix = fixes_.at (next_fix++);
+      timestamp = fix.timestamp;
+
+      if (!initialized_)
+      {
+        state_.timestamp = fix.timestamp;
+        initialized_ = true;
+      }
+      else
+      {
+        // propagate to the fix time with the IMU interpolated at that time
+        containers::ImuSample sample;
+        if (!imu_.interpolate (fix.timestamp, sample, blend_imu))
+        {
+          sample = have_imu_ ? last_imu_ : containers::ImuSample ();
+        }
+        sample.timestamp = fix.timestamp;
+
+        propagate (sample);
+        last_imu_ = sample;
+      }
+
+      correct (fix);
+    }
+    else
+    {
+      const containers::ImuSample & sample = imu_.at (next_imu++);
+      timestamp = sample.timestamp;
+
+      if (!initialized_)
+      {
+        state_.timestamp = sample.timestamp;
+        initialized_ = true;
+      }
+      else
+      {
+        propagate (sample);
+      }
+
+      last_imu_ = sample;
+      have_imu_ = true;
+    }
+
+    save ();
+    ++applied;
+
+    if (replay && timestamp <= replay_until)
+    {
+      ++replayed_;
+    }
+  }
+
+  return applied;
+}
+
+const localization::FusedState &
+localization::SensorFusion::get_state (void) const
+{
+  return state_;
+}
+
+bool
+localization::SensorFusion::get_state_at (
+  int64_t timestamp, FusedState & state) const
+{
+  if (!initialized_)
+  {
+    return false;
+  }
+
+  if (timestamp >= state_.timestamp)
+  {
+    const double dt = (timestamp - state_.timestamp) / 1000000000.0;
+
+    state = state_;
+    state.timestamp = timestamp;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      state.position[axis] += state.velocity[axis] * dt;
+    }
+    return true;
+  }
+
+  Snapshot snapshot;
+  const bool found = history_.interpolate (timestamp, snapshot,
+    [] (const Snapshot & before, const Snapshot & after, double ratio)
+    {
+      Snapshot result = before;
+      FusedState & state = result.state;
+
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        state.position[axis] += ratio *
+          (after.state.position[axis] - before.state.position[axis]);
+        state.velocity[axis] += ratio *
+          (after.state.velocity[axis] - before.state.velocity[axis]);
+      }
+      state.yaw = std::remainder (state.yaw + ratio *
+        angle_difference (before.state.yaw, after.state.yaw), 2 * M_PI);
+
+      return result;
+    });
+
+  if (found)
+  {
+    state = snapshot.state;
+    state.timestamp = timestamp;
+  }
+
+  return found;
+}
+
+bool
+localization::SensorFusion::has_fix (void) const
+{
+  return have_fix_;
+}
+
+uint64_t
+localization::SensorFusion::get_replays (void) const
+{
+  return replays_;
+}
+
+uint64_t
+localization::SensorFusion::get_replayed (void) const
+{
+  return replayed_;
+}
+
+uint64_t
+localization::SensorFusion::get_late_drops (void) const
+{
+  return late_drops_;
+}
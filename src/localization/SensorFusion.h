@@ -0,0 +1,203 @@
+
+#ifndef   _LOCALIZATION_SENSORFUSION_H_
+#define   _LOCALIZATION_SENSORFUSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../containers/ImuBuffer.h"
+#include "../containers/PositionFix.h"
+#include "../containers/TimeBuffer.h"
+
+namespace localization
+{
+  /**
+  * A fused estimate at a point in time
+  **/
+  struct FusedState
+  {
+    /// time of the estimate in nanoseconds
+    int64_t timestamp;
+
+    /// position x, y, z in meters
+    double position[3];
+
+    /// velocity x, y, z in m/s
+    double velocity[3];
+
+    /// heading in radians
+    double yaw;
+  };
+
+  /**
+  * Fuses IMU samples with absolute position fixes that arrive at different
+  * rates and with different latencies.
+  *
+  * Every measurement is kept in a per-sensor TimeBuffer, and the estimate
+  * after every applied measurement is kept in a history buffer. update
+  * applies measurements in timestamp order, not arrival order. When a
+  * measurement arrives older than the current estimate, the estimator
+  * rolls back to the last estimate before it and replays everything since.
+  * The estimator never waits for the slowest sensor. Replay is bounded by
+  * replay_window, and anything older is dropped.
+  *
+  * IMU samples propagate the estimate. Accelerations are in the body frame
+  * with gravity removed. Fixes correct it with complementary gains.
+  **/
+  class SensorFusion
+  {
+  public:
+    /**
+     * Constructor
+     * @param  imu_capacity      IMU samples to keep for replay
+     * @param  fix_capacity      position fixes to keep for replay
+     * @param  history_capacity  past estimates to keep for rollback
+     **/
+    SensorFusion (size_t imu_capacity = 4096, size_t fix_capacity = 256,
+      size_t history_capacity = 8192);
+
+    /**
+     * Buffers an IMU sample for the next update
+     * @param  sample   the sample
+     * @return false if the sample is older than the replay window
+     **/
+    bool add_imu (const containers::ImuSample & sample);
+
+    /**
+     * Buffers a position fix for the next update
+     * @param  fix      the fix, timestamped when it was measured
+     * @return false if the fix is older than the replay window
+     **/
+    bool add_fix (const containers::PositionFix & fix);
+
+    /**
+     * Applies buffered measurements in time order, replaying from the
+     * oldest new measurement if it predates the current estimate
+     * @return number of measurements applied, including replayed ones
+     **/
+    size_t update (void);
+
+    /**
+     * Returns the latest estimate
+     * @return the estimate at the newest applied measurement
+     **/
+    const FusedState & get_state (void) const;
+
+    /**
+     * Returns the estimate at a time, interpolated from the history or
+     * extrapolated at constant velocity past the latest estimate
+     * @param  timestamp  time in nanoseconds
+     * @param  state      the estimate at timestamp
+     * @return false if timestamp predates the history
+     **/
+    bool get_state_at (int64_t timestamp, FusedState & state) const;
+
+    /**
+     * Checks if any position fix has been applied. Until then, the
+     * position is dead reckoned from the origin.
+     * @return true if the position is anchored by a fix
+     **/
+    bool has_fix (void) const;
+
+    /**
+     * Returns the number of rollbacks caused by late measurements
+     * @return replay count
+     **/
+    uint64_t get_replays (void) const;
+
+    /**
+     * Returns the number of measurements applied again during replays
+     * @return replayed measurement count
+     **/
+    uint64_t get_replayed (void) const;
+
+    /**
+     * Returns the number of measurements dropped as older than the window
+     * @return late drop count
+     **/
+    uint64_t get_late_drops (void) const;
+
+    /// how far back (ns) a late measurement may be fused
+    int64_t replay_window;
+
+    /// fraction of the position innovation applied per fix, in [0, 1]
+    double position_gain;
+
+    /// velocity correction per meter of position innovation (1/s)
+    double velocity_gain;
+
+    /// fraction of the heading innovation applied per fix, in [0, 1]
+    double yaw_gain;
+
+  private:
+    /**
+     * An estimate and the propagation state needed to resume from it
+     **/
+    struct Snapshot
+    {
+      FusedState state;
+      containers::ImuSample last_imu;
+      bool have_imu;
+      bool have_fix;
+    };
+
+    /**
+     * Notes that a measurement at timestamp needs to be applied
+     **/
+    bool accept (int64_t timestamp);
+
+    /**
+     * Integrates the IMU from the current estimate to the sample time
+     **/
+    void propagate (const containers::ImuSample & sample);
+
+    /**
+     * Applies a position fix at the current estimate time
+     **/
+    void correct (const containers::PositionFix & fix);
+
+    /**
+     * Records the current estimate in the history
+     **/
+    void save (void);
+
+    /// buffered measurements, per sensor
+    containers::TimeBuffer <containers::ImuSample> imu_;
+    containers::TimeBuffer <containers::PositionFix> fixes_;
+
+    /// estimates after each applied measurement
+    containers::TimeBuffer <Snapshot> history_;
+
+    /// the latest estimate
+    FusedState state_;
+
+    /// last IMU sample integrated, for the trapezoidal rule
+    containers::ImuSample last_imu_;
+
+    /// true once state_ has a timestamp
+    bool initialized_;
+
+    /// true once last_imu_ holds a sample
+    bool have_imu_;
+
+    /// true once a fix has been applied
+    bool have_fix_;
+
+    /// true if measurements were added since the last update
+    bool pending_;
+
+    /// oldest measurement added since the last update
+    int64_t earliest_pending_;
+
+    /// newest measurement time seen, for the replay window
+    int64_t newest_;
+
+    /// statistics
+    uint64_t replays_;
+    uint64_t replayed_;
+    uint64_t late_drops_;
+  };
+
+} // end localization namespace
+
+#endif // _LOCALIZATION_SENSORFUSION_H_
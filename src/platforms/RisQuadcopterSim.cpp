@@ -1,13 +1,98 @@
 
 #include "madara/knowledge/containers/NativeDoubleVector.h"
+#include "madara/utility/Utility.h"
 #include "RisQuadcopterSim.h"
 #include "threads/Controls.h"
+#include "threads/Governor.h"
+#include "threads/LockReport.h"
+#include "threads/TraceControl.h"
 #include "threads/Mapping.h"
 #include "threads/StateEstimation.h"
 #include "threads/TeleopOverride.h"
+#include "../utility/PinnedThread.h"
+#include "../utility/ProfiledThread.h"
+#include "../utility/ThreadPlacement.h"
 
 gams::pose::CartesianFrame  platforms::RisQuadcopterSim::cartesian_frame;   
 gams::pose::GPSFrame  platforms::RisQuadcopterSim::gps_frame;         
+
+/**
+ * Returns the IMU buffer size from .imu.buffer.size, if set (e.g., in a
+ * MADARA file passed with -M). Size it for at least IMU hertz times the
+ * StateEstimation period. Clamped to the sizes ImuBuffer supports.
+ **/
+static size_t
+imu_buffer_size (madara::knowledge::KnowledgeBase * knowledge)
+{
+  int64_t result (4096);
+
+  if (knowledge && knowledge->exists (".imu.buffer.size"))
+  {
+    result = knowledge->get (".imu.buffer.size").to_integer ();
+  }
+
+  if (result < (int64_t)containers::ImuBuffer::MIN_CAPACITY)
+    result = containers::ImuBuffer::MIN_CAPACITY;
+  else if (result > (int64_t)containers::ImuBuffer::MAX_CAPACITY)
+    result = containers::ImuBuffer::MAX_CAPACITY;
+
+  return (size_t)result;
+}
+
+/**
+ * Returns the control rate from .controls.hertz, if set. Teleop commands
+ * trigger a Controls run at once when it is on the scheduler. A Controls
+ * with its own pinned thread applies them within one control period, so
+ * give it a rate that meets the teleop latency needed.
+ **/
+static double
+controls_hertz (madara::knowledge::KnowledgeBase * knowledge)
+{
+  double result (0.2);
+
+  if (knowledge && knowledge->exists (".controls.hertz"))
+  {
+    result = knowledge->get (".controls.hertz").to_double ();
+  }
+
+  return result;
+}
+        
+ 
+/**
+ * Returns how often the lock contention report is made, from
+ * .perf.locks.report_hertz, if set
+ **/
+static double
+lock_report_hertz (madara::knowledge::KnowledgeBase * knowledge)
+{
+  double result (0.1);
+
+  if (knowledge && knowledge->exists (".perf.locks.report_hertz"))
+  {
+    result = knowledge->get (".perf.locks.report_hertz").to_double ();
+  }
+
+  return result;
+}
+        
+ 
+/**
+ * Returns the scheduler worker count from .scheduler.workers, if set.
+ * 0 uses all hardware threads.
+ **/
+static size_t
+scheduler_workers (madara::knowledge::KnowledgeBase * knowledge)
+{
+  size_t result (0);
+
+  if (knowledge && knowledge->exists (".scheduler.workers"))
+  {
+    result = (size_t)knowledge->get (".scheduler.workers").to_integer ();
+  }
+
+  return result;
+}
         
  
 // factory class for creating a RisQuadcopterSim 
@@ -27,12 +112,28 @@ platforms::RisQuadcopterSim::RisQuadcopterSim (
   madara::knowledge::KnowledgeBase * knowledge,
   gams::variables::Sensors * sensors,
   gams::variables::Self * self)
-: gams::platforms::BasePlatform (knowledge, sensors, self)
+: gams::platforms::BasePlatform (knowledge, sensors, self),
+  imu_buffer_ (imu_buffer_size (knowledge)),
+  scheduler_ (utility::TaskScheduler::get_shared ())
 {
+  // agents hosted in one process share a scheduler, and prefix their job
+  // names with the agent so each can stop its own
+  if (!scheduler_)
+  {
+    own_scheduler_.reset (
+      new utility::TaskScheduler (scheduler_workers (knowledge)));
+    scheduler_ = own_scheduler_.get ();
+  }
+  else if (knowledge)
+  {
+    job_prefix_ = "agent." + knowledge->get (".id").to_string () + ".";
+  }
+
   // as an example of what to do here, create a coverage sensor
   if (knowledge && sensors)
   {
-    // set the data plane for the threader
+    // set the data plane for the threader. Scheduler jobs are given the
+    // knowledge base as they are started.
     threader_.set_data_plane (*knowledge);
   
     // create a coverage sensor
@@ -52,12 +153,81 @@ platforms::RisQuadcopterSim::RisQuadcopterSim (
     }
     (*sensors_)["coverage"] = (*sensors)["coverage"];
     status_.init_vars (*knowledge, get_id ());
+
+    imu_accel_.set_name (".imu.sigma.accel", *knowledge);
+    position_.set_name (".position", *knowledge);
+
+    sense_profile_.init ("mape.monitor", *knowledge);
+    analyze_profile_.init ("mape.platform_analyze", *knowledge);
     
-    // create threads
-    threader_.run(0.2, "Controls", new threads::Controls());
-    threader_.run(1.0, "Mapping", new threads::Mapping());
-    threader_.run(0.2, "StateEstimation", new threads::StateEstimation());
-    threader_.run(0.2, "TeleopOverride", new threads::TeleopOverride());
+    // place threads per the .affinity profile, if any (see
+    // utility::ThreadPlacement). Threads the profile does not name stay
+    // off isolated cores.
+    utility::ThreadPlacement placement;
+    placement.load (*knowledge);
+
+    std::vector <int> cores;
+    if (own_scheduler_ && placement.get_cores ("scheduler", cores))
+      scheduler_->pin ("scheduler", cores, knowledge);
+
+    // a shared worker cannot stay on an isolated core, so a placed
+    // Controls gets its own thread. It defaults to the isolated cores.
+    std::vector <int> control_cores;
+    if (placement.has_placement ("Controls"))
+      placement.get_cores ("Controls", control_cores);
+    else
+      control_cores = placement.get_isolated ();
+
+    // create threads. The last argument is the lowest rate the governor
+    // may shed a thread to under load. Controls is never shed. Every run
+    // is profiled under .perf.{thread}, with a budget of one period.
+    const double control_hertz = controls_hertz (knowledge);
+    madara::threads::BaseThread * controls = new utility::ProfiledThread (
+      new threads::Controls(&teleop_), control_hertz);
+    if (control_cores.empty ())
+    {
+      scheduler_->run(control_hertz, job_prefix_ + "Controls", controls,
+        utility::TaskScheduler::HIGH, 0, knowledge);
+    }
+    else
+    {
+      threader_.run(control_hertz, "Controls",
+        new utility::PinnedThread (controls, control_cores));
+    }
+    scheduler_->run(1.0, job_prefix_ + "Mapping",
+      new utility::ProfiledThread (new threads::Mapping(&scans_, &map_), 1.0),
+      utility::TaskScheduler::LOW, 0.1, knowledge);
+    scheduler_->run(0.2, job_prefix_ + "StateEstimation",
+      new utility::ProfiledThread (new threads::StateEstimation(
+        &imu_buffer_, &scans_, &map_, &fixes_, scheduler_), 0.2),
+      utility::TaskScheduler::NORMAL, 0.05, knowledge);
+
+    // the governor, lock report and trace control cover the whole
+    // process, so with a shared scheduler the controller runs them once
+    if (own_scheduler_)
+    {
+      scheduler_->run(1.0, "Governor", new utility::ProfiledThread (
+        new threads::Governor(scheduler_), 1.0),
+        utility::TaskScheduler::HIGH, 0, knowledge);
+      if (lock_report_hertz (knowledge) > 0)
+      {
+        scheduler_->run(lock_report_hertz (knowledge), "LockReport",
+          new threads::LockReport(), utility::TaskScheduler::LOW, 0,
+          knowledge);
+      }
+      scheduler_->run(1.0, "TraceControl", new threads::TraceControl(),
+        utility::TaskScheduler::LOW, 0, knowledge);
+    }
+
+    // TeleopOverride blocks on knowledge base changes inside run, so this
+    // rate only bounds how soon it waits again after handling a command.
+    // Its run time is mostly waiting, so it is not profiled.
+    madara::threads::BaseThread * teleop =
+      new threads::TeleopOverride(&teleop_,
+        control_cores.empty () ? scheduler_ : 0, job_prefix_ + "Controls");
+    if (placement.get_cores ("TeleopOverride", cores))
+      teleop = new utility::PinnedThread (teleop, cores);
+    threader_.run(100.0, "TeleopOverride", teleop);
     // end create threads
     
     
@@ -77,7 +247,20 @@ platforms::RisQuadcopterSim::RisQuadcopterSim (
 // Destructor
 platforms::RisQuadcopterSim::~RisQuadcopterSim ()
 {
+  // a shared scheduler keeps running the other agents' jobs. Without a
+  // knowledge base we started none, and the empty prefix matches them all.
+  if (own_scheduler_)
+    own_scheduler_->terminate ();
+  else if (!job_prefix_.empty ())
+    scheduler_->stop (job_prefix_);
   threader_.terminate ();
+
+  // wake threads blocked in knowledge base waits so they see termination
+  if (knowledge_)
+  {
+    knowledge_->get_context ().signal ();
+  }
+
   threader_.wait ();
 }
 
@@ -85,6 +268,45 @@ platforms::RisQuadcopterSim::~RisQuadcopterSim ()
 // Polls the sensor environment for useful information. Required.
 int platforms::RisQuadcopterSim::sense (void)
 {
+  utility::ScopedProfile timing (sense_profile_);
+
+  /**
+   * The simulator only exposes the accelerometer through the knowledge base.
+   * A real IMU driver should call push_imu_sample from its own callback at
+   * the IMU rate instead.
+   **/
+  if (knowledge_)
+  {
+    std::vector <double> accel (imu_accel_.to_record ().to_doubles ());
+
+    if (accel.size () == 3)
+    {
+      containers::ImuSample sample = {};
+      sample.timestamp = madara::utility::get_time ();
+      sample.accel[0] = accel[0];
+      sample.accel[1] = accel[1];
+      sample.accel[2] = accel[2];
+
+      push_imu_sample (sample);
+    }
+
+    // the simulator reports ground truth position. Only queue changes.
+    std::vector <double> position (position_.to_record ().to_doubles ());
+
+    if (position.size () == 3 && position != last_position_)
+    {
+      containers::PositionFix fix = {};
+      fix.timestamp = madara::utility::get_time ();
+      fix.position[0] = position[0];
+      fix.position[1] = position[1];
+      fix.position[2] = position[2];
+      fix.axes = containers::PositionFix::XYZ;
+
+      push_position_fix (fix);
+      last_position_ = position;
+    }
+  }
+
   return gams::platforms::PLATFORM_OK;
 }
 
@@ -93,6 +315,8 @@ int platforms::RisQuadcopterSim::sense (void)
 int
 platforms::RisQuadcopterSim::analyze (void)
 {
+  utility::ScopedProfile timing (analyze_profile_);
+
   return gams::platforms::PLATFORM_OK;
 }
 
@@ -263,3 +487,26 @@ platforms::RisQuadcopterSim::get_frame (void) const
 {
   return gps_frame;
 }
+
+// Queues an IMU sample for the StateEstimation thread.
+bool
+platforms::RisQuadcopterSim::push_imu_sample (
+  const containers::ImuSample & sample)
+{
+  return imu_buffer_.push (sample);
+}
+
+// Hands a range scan to the Mapping and StateEstimation threads.
+void
+platforms::RisQuadcopterSim::push_scan (const containers::LaserScan & scan)
+{
+  scans_.publish (std::make_shared <const containers::LaserScan> (scan));
+}
+
+// Queues an absolute position fix for the StateEstimation thread.
+bool
+platforms::RisQuadcopterSim::push_position_fix (
+  const containers::PositionFix & fix)
+{
+  return fixes_.push (fix);
+}
@@ -2,11 +2,24 @@
 #ifndef   _PLATFORM_RISQUADCOPTERSIM_H_
 #define   _PLATFORM_RISQUADCOPTERSIM_H_
 
+#include <memory>
+#include <string>
+
 #include "gams/platforms/BasePlatform.h"
 #include "gams/platforms/PlatformFactory.h"
 #include "madara/threads/Threader.h"
+#include "madara/knowledge/containers/NativeDoubleVector.h"
 #include "gams/pose/GPSFrame.h"
 #include "gams/pose/CartesianFrame.h"
+#include "../containers/ImuBuffer.h"
+#include "../containers/LaserScan.h"
+#include "../containers/Mailbox.h"
+#include "../containers/MeasurementQueue.h"
+#include "../containers/OccupancyGrid.h"
+#include "../containers/PositionFix.h"
+#include "../containers/TeleopCommand.h"
+#include "../utility/ExecutionProfile.h"
+#include "../utility/TaskScheduler.h"
 
 namespace platforms
 {        
@@ -163,9 +176,72 @@ namespace platforms
      * Returns the reference frame for the platform (e.g. GPS or cartesian)
      **/
     virtual const gams::pose::ReferenceFrame & get_frame (void) const;
+
+    /**
+     * Queues an IMU sample for the StateEstimation thread. This is the
+     * producer side of a single-producer ring buffer, so only one thread
+     * (e.g., the IMU driver callback) may call it.
+     * @param  sample   the timestamped IMU sample
+     * @return true if queued, false if the buffer was full
+     **/
+    bool push_imu_sample (const containers::ImuSample & sample);
+
+    /**
+     * Hands a range scan to the Mapping and StateEstimation threads. Only
+     * the latest scan is kept, so a slow consumer skips scans instead of
+     * falling behind.
+     * @param  scan     the scan in the sensor frame
+     **/
+    void push_scan (const containers::LaserScan & scan);
+
+    /**
+     * Queues an absolute position fix for the StateEstimation thread. Fixes
+     * may arrive late and out of order, as long as they are timestamped
+     * with when they were measured. Any thread may call this.
+     * @param  fix      the fix
+     * @return true if queued, false if the queue was full
+     **/
+    bool push_position_fix (const containers::PositionFix & fix);
     
   private:
-    // a threader for managing platform threads
+    // IMU samples handed from the sensor path to StateEstimation
+    containers::ImuBuffer imu_buffer_;
+
+    // latest range scan handed to Mapping and StateEstimation
+    containers::Mailbox <containers::LaserScan> scans_;
+
+    // map snapshots handed from Mapping to StateEstimation
+    containers::Mailbox <containers::OccupancyGrid> map_;
+
+    // operator commands handed from TeleopOverride to Controls
+    containers::Mailbox <containers::TeleopCommand> teleop_;
+
+    // position fixes handed from the sensor path to StateEstimation
+    containers::MeasurementQueue <containers::PositionFix> fixes_;
+
+    // simulated position
+    madara::knowledge::containers::NativeDoubleArray position_;
+
+    // last simulated position queued as a fix
+    std::vector <double> last_position_;
+
+    // simulated accelerometer reading
+    madara::knowledge::containers::NativeDoubleArray imu_accel_;
+
+    // timing of the MAPE loop's monitor and platform analyze phases
+    utility::ExecutionProfile sense_profile_;
+    utility::ExecutionProfile analyze_profile_;
+
+    // shared workers that run the periodic platform threads by priority.
+    // Either our own, or the one shared by every agent in the process.
+    std::unique_ptr <utility::TaskScheduler> own_scheduler_;
+    utility::TaskScheduler * scheduler_;
+
+    // prefix of our job names on a shared scheduler, e.g., "agent.3.".
+    // Empty if we have our own scheduler or no knowledge base.
+    std::string job_prefix_;
+
+    // dedicated threads for platform threads that block, e.g., in waits
     madara::threads::Threader threader_;    
     
     // a default GPS frame
@@ -1,11 +1,18 @@
 
 #include "gams/loggers/GlobalLogger.h"
+#include "madara/utility/Utility.h"
 #include "Controls.h"
+#include "../../utility/AsyncLogger.h"
 
 namespace knowledge = madara::knowledge;
 
+// number of values in a velocity command: x, y, z and yaw rate
+static const size_t COMMAND_SIZE (4);
+
 // constructor
-platforms::threads::Controls::Controls ()
+platforms::threads::Controls::Controls (
+  ::containers::Mailbox < ::containers::TeleopCommand> * teleop)
+: teleop_ (teleop), teleop_version_ (0)
 {
 }
 
@@ -33,6 +40,58 @@ platforms::threads::Controls::init (knowledge::KnowledgeBase & knowledge)
   knowledge.set (".orientation", orientation);
 }
 
+void
+platforms::threads::Controls::select_command (void)
+{
+  uint64_t version = 0;
+  std::shared_ptr <const ::containers::TeleopCommand> teleop;
+  if (teleop_)
+  {
+    teleop = teleop_->get (&version);
+  }
+
+  const std::string previous_source = control_vars_.command_source;
+
+  if (teleop && teleop->enabled)
+  {
+    control_vars_.command.assign (
+      teleop->command, teleop->command + COMMAND_SIZE);
+    control_vars_.command_source = "teleop";
+  }
+  else
+  {
+    control_vars_.command = control_vars_.autonomy_command;
+    control_vars_.command.resize (COMMAND_SIZE, 0.0);
+    control_vars_.command_source = "autonomy";
+  }
+
+  // latency covers the wakeup, the handoff and the wait for this tick
+  if (teleop && version != teleop_version_)
+  {
+    teleop_version_ = version;
+
+    if (teleop->issued > 0)
+    {
+      control_vars_.teleop_latency =
+        ((int64_t)madara::utility::get_time () - teleop->issued) /
+        1000000000.0;
+      if (control_vars_.teleop_latency > control_vars_.teleop_max_latency)
+      {
+        control_vars_.teleop_max_latency = control_vars_.teleop_latency;
+      }
+    }
+  }
+
+  if (control_vars_.command_source != previous_source)
+  {
+    utility_async_log (gams::loggers::LOG_MAJOR,
+      "platforms::threads::Controls::select_command:" 
+      " command source is now %s (teleop latency %.4f s)\n",
+      control_vars_.command_source.c_str (),
+      control_vars_.teleop_latency);
+  }
+}
+
 /**
  * Executes the actual thread logic. Best practice is to simply do one loop
  * iteration. If you want a long running thread that executes something
@@ -42,8 +101,7 @@ platforms::threads::Controls::init (knowledge::KnowledgeBase & knowledge)
 void
 platforms::threads::Controls::run (void)
 {
-  madara_logger_ptr_log (gams::loggers::global_logger.get (),
-    gams::loggers::LOG_MINOR,
+  utility_async_log (gams::loggers::LOG_MINOR,
     "platforms::threads::Controls::run:" 
     " reading from knowledge base\n");
   control_vars_.read ();
@@ -59,6 +117,8 @@ platforms::threads::Controls::run (void)
 
   ++control_vars_.controls_clock;
 
+  select_command ();
+
   /**
    * In the Hivemind: Edge to Analytics deck, the Controls thread state
    * machine is diagramed like this:
@@ -76,8 +136,7 @@ platforms::threads::Controls::run (void)
 
   if (control_vars_.orientation.size () == 3)
   {
-    madara_logger_ptr_log (gams::loggers::global_logger.get (),
-      gams::loggers::LOG_ALWAYS,
+    utility_async_log (gams::loggers::LOG_ALWAYS,
       "platforms::threads::Controls::run: %d: " 
       " orientation = [%.4f, %.4f, %.4f]\n",
         control_vars_.controls_clock,
@@ -92,8 +151,7 @@ platforms::threads::Controls::run (void)
    * to others
    **/
 
-  madara_logger_ptr_log (gams::loggers::global_logger.get (),
-    gams::loggers::LOG_MINOR,
+  utility_async_log (gams::loggers::LOG_MINOR,
     "platforms::threads::Controls::run:" 
     " writing to knowledge base\n");
   control_vars_.write ();
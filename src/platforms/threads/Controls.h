@@ -6,6 +6,8 @@
 
 #include "madara/threads/BaseThread.h"
 #include "../../containers/ControlVariables.h"
+#include "../../containers/Mailbox.h"
+#include "../../containers/TeleopCommand.h"
 
 namespace platforms
 {
@@ -18,9 +20,13 @@ namespace platforms
     {
     public:
       /**
-       * Default constructor
+       * Constructor
+       * @param  teleop   operator commands from TeleopOverride. While the
+       *                  latest command is enabled, it replaces the
+       *                  autonomy command on every tick.
        **/
-      Controls ();
+      Controls (
+        ::containers::Mailbox < ::containers::TeleopCommand> * teleop = 0);
       
       /**
        * Destructor
@@ -39,11 +45,23 @@ namespace platforms
       virtual void run (void);
 
     private:
+      /**
+        * Picks the command to apply this tick, autonomy or teleop, and
+        * measures how long new teleop commands took to be applied
+        **/
+      void select_command (void);
+
       /// data plane if we want to access the knowledge base
       madara::knowledge::KnowledgeBase data_;
 
       /// control variables for staged knowledge base access
       ::containers::ControlVariables control_vars_;
+
+      /// operator commands from TeleopOverride. Not owned.
+      ::containers::Mailbox < ::containers::TeleopCommand> * teleop_;
+
+      /// version of the last teleop command applied
+      uint64_t teleop_version_;
     };
   } // end namespace threads
 } // end namespace platforms
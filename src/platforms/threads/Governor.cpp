@@ -0,0 +1,185 @@
+
+#include "gams/loggers/GlobalLogger.h"
+#include "madara/utility/Utility.h"
+#include "Governor.h"
+#include "../../utility/Trace.h"
+
+namespace knowledge = madara::knowledge;
+
+// constructor
+platforms::threads::Governor::Governor (utility::TaskScheduler * scheduler)
+: scheduler_ (scheduler), last_run_ (0)
+{
+}
+
+// destructor
+platforms::threads::Governor::~Governor ()
+{
+}
+
+void
+platforms::threads::Governor::init (knowledge::KnowledgeBase & knowledge)
+{
+  // point our data plane to the knowledge base initializing the thread
+  data_ = knowledge;
+
+  const bool has_budget = knowledge.exists (".governor.budget");
+  const bool has_shed_factor = knowledge.exists (".governor.shed_factor");
+  const bool has_restore = knowledge.exists (".governor.restore");
+
+  budget_.set_name (".governor.budget", knowledge);
+  shed_factor_.set_name (".governor.shed_factor", knowledge);
+  restore_.set_name (".governor.restore", knowledge);
+  utilization_.set_name (".governor.utilization", knowledge);
+  sheds_.set_name (".governor.sheds", knowledge);
+  restores_.set_name (".governor.restores", knowledge);
+  last_decision_.set_name (".governor.last_decision", knowledge);
+
+  // leave a fifth of the workers for the transport and the controller
+  if (!has_budget)
+    budget_ = 0.8;
+  if (!has_shed_factor)
+    shed_factor_ = 0.5;
+  if (!has_restore)
+    restore_ = 0.75;
+}
+
+void
+platforms::threads::Governor::run (void)
+{
+  if (!scheduler_)
+  {
+    return;
+  }
+
+  const int64_t now = (int64_t)madara::utility::get_time ();
+  const double elapsed = last_run_ > 0 ? (now - last_run_) / 1e9 : 0.0;
+  last_run_ = now;
+
+  double used = 0.0;
+  bool missed = false;
+
+  // lowest priority job that can still be slowed down
+  std::string shed_name;
+  utility::TaskScheduler::JobStats shed;
+  double shed_cpu = 0.0;
+
+  // highest priority job that is running below its target
+  std::string restore_name;
+  utility::TaskScheduler::JobStats restore;
+  double restore_cpu = 0.0;
+
+  scheduler_->get_job_names (names_);
+
+  for (size_t i = 0; i < names_.size (); ++i)
+  {
+    utility::TaskScheduler::JobStats stats;
+    if (!scheduler_->get_job_stats (names_[i], stats))
+    {
+      continue;
+    }
+
+    const bool is_new = jobs_.find (names_[i]) == jobs_.end ();
+    JobState & state = jobs_[names_[i]];
+
+    if (is_new)
+    {
+      const std::string prefix (".governor." + names_[i]);
+      state.hertz.set_name (prefix + ".hertz", data_);
+      state.cpu.set_name (prefix + ".cpu", data_);
+      state.total_misses.set_name (prefix + ".misses", data_);
+    }
+    else if (elapsed > 0)
+    {
+      const double cpu = stats.cpu_time - state.cpu_time;
+      const uint64_t misses = (stats.misses - state.misses) +
+        (stats.overruns - state.overruns);
+
+      used += cpu;
+      missed = missed || misses > 0;
+      state.cpu = cpu / elapsed;
+
+      if (stats.hertz > stats.min_hertz && (shed_name.empty () ||
+        stats.priority > shed.priority ||
+        (stats.priority == shed.priority && cpu > shed_cpu)))
+      {
+        shed_name = names_[i];
+        shed = stats;
+        shed_cpu = cpu;
+      }
+
+      if (stats.hertz < stats.target_hertz &&
+        (restore_name.empty () || stats.priority < restore.priority))
+      {
+        restore_name = names_[i];
+        restore = stats;
+        restore_cpu = cpu;
+      }
+    }
+
+    state.cpu_time = stats.cpu_time;
+    state.misses = stats.misses;
+    state.overruns = stats.overruns;
+    state.hertz = stats.hertz;
+    state.total_misses = (knowledge::KnowledgeRecord::Integer)
+      (stats.misses + stats.overruns);
+  }
+
+  if (elapsed <= 0)
+  {
+    return;
+  }
+
+  const double capacity = elapsed * scheduler_->size ();
+  const double utilization = used / capacity;
+  const double factor = *shed_factor_;
+  utilization_ = utilization;
+  UTILITY_TRACE_COUNTER ("governor.utilization", utilization);
+
+  if (factor <= 0 || factor >= 1)
+  {
+    return;
+  }
+
+  if ((utilization > *budget_ || missed) && !shed_name.empty ())
+  {
+    scheduler_->set_rate (shed_name, shed.hertz * factor);
+    scheduler_->get_job_stats (shed_name, shed);
+    jobs_[shed_name].hertz = shed.hertz;
+    ++sheds_;
+
+    const std::string decision ("shed " + shed_name + " " +
+      std::to_string (shed.hertz));
+    last_decision_ = decision;
+
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_MAJOR,
+      "platforms::threads::Governor::run:"
+      " utilization %.2f, misses %d. Slowed %s to %.3f hz\n",
+      utilization, (int)missed, shed_name.c_str (), shed.hertz);
+  }
+  else if (!missed && !restore_name.empty ())
+  {
+    // a job's CPU use scales with its rate
+    const double predicted =
+      utilization + restore_cpu * (1.0 / factor - 1.0) / capacity;
+
+    if (predicted < *budget_ * *restore_)
+    {
+      scheduler_->set_rate (restore_name, restore.hertz / factor);
+      scheduler_->get_job_stats (restore_name, restore);
+      jobs_[restore_name].hertz = restore.hertz;
+      ++restores_;
+
+      const std::string decision ("restore " + restore_name + " " +
+        std::to_string (restore.hertz));
+      last_decision_ = decision;
+
+      madara_logger_ptr_log (gams::loggers::global_logger.get (),
+        gams::loggers::LOG_MAJOR,
+        "platforms::threads::Governor::run:"
+        " utilization %.2f. Restored %s to %.3f hz\n",
+        utilization, restore_name.c_str (), restore.hertz);
+    }
+  }
+}
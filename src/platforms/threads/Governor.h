@@ -0,0 +1,117 @@
+
+#ifndef   _PLATFORM_THREAD_GOVERNOR_H_
+#define   _PLATFORM_THREAD_GOVERNOR_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "madara/threads/BaseThread.h"
+#include "madara/knowledge/containers/Double.h"
+#include "madara/knowledge/containers/Integer.h"
+#include "madara/knowledge/containers/String.h"
+#include "../../utility/TaskScheduler.h"
+
+namespace platforms
+{
+  namespace threads
+  {
+    /**
+    * Adapts platform thread rates to the CPU budget of the companion
+    * computer.
+    *
+    * Each run measures the CPU time and deadline misses of every job on
+    * the TaskScheduler since the last run. If the jobs use more than
+    * .governor.budget of the workers, or any job misses a deadline, one
+    * job is shed: the lowest priority job still above its minimum rate
+    * has its rate cut by .governor.shed_factor. Once usage falls below
+    * .governor.restore of the budget with no misses, the highest priority
+    * shed job is raised by the same factor, back toward its target rate.
+    * Jobs started without a minimum rate (e.g., Controls) are never shed.
+    *
+    * Rates and decisions are exported under .governor.
+    **/
+    class Governor : public madara::threads::BaseThread
+    {
+    public:
+      /**
+       * Constructor
+       * @param  scheduler  the scheduler whose jobs are governed
+       **/
+      Governor (utility::TaskScheduler * scheduler = 0);
+
+      /**
+       * Destructor
+       **/
+      virtual ~Governor ();
+
+      /**
+        * Initializes thread with MADARA context
+        * @param   context   context for querying current program state
+        **/
+      virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+      /**
+        * Executes the main thread logic
+        **/
+      virtual void run (void);
+
+    private:
+      /**
+       * Measurements and exports of one job
+       **/
+      struct JobState
+      {
+        /// totals at the last run, to difference against
+        double cpu_time;
+        uint64_t misses;
+        uint64_t overruns;
+
+        /// .governor.{name}.hertz, the current rate
+        madara::knowledge::containers::Double hertz;
+
+        /// .governor.{name}.cpu, fraction of one worker used
+        madara::knowledge::containers::Double cpu;
+
+        /// .governor.{name}.misses, total deadline misses and overruns
+        madara::knowledge::containers::Integer total_misses;
+      };
+
+      /// data plane if we want to access the knowledge base
+      madara::knowledge::KnowledgeBase data_;
+
+      /// the governed scheduler. Not owned.
+      utility::TaskScheduler * scheduler_;
+
+      /// per-job state by name
+      std::map <std::string, JobState> jobs_;
+
+      /// scratch space for job names
+      std::vector <std::string> names_;
+
+      /// wall time of the last run in nanoseconds
+      int64_t last_run_;
+
+      /// fraction of all workers the jobs may use
+      madara::knowledge::containers::Double budget_;
+
+      /// rate multiplier when shedding, in (0, 1)
+      madara::knowledge::containers::Double shed_factor_;
+
+      /// fraction of the budget below which shed rates are restored
+      madara::knowledge::containers::Double restore_;
+
+      /// fraction of all workers used since the last run
+      madara::knowledge::containers::Double utilization_;
+
+      /// times a job was slowed or sped back up
+      madara::knowledge::containers::Integer sheds_;
+      madara::knowledge::containers::Integer restores_;
+
+      /// the last decision, e.g., "shed Mapping 0.5"
+      madara::knowledge::containers::String last_decision_;
+    };
+  } // end namespace threads
+} // end namespace platforms
+
+#endif // _PLATFORM_THREAD_GOVERNOR_H_
@@ -0,0 +1,35 @@
+
+#include "gams/loggers/GlobalLogger.h"
+#include "LockReport.h"
+#include "../../utility/LockProfiler.h"
+
+namespace knowledge = madara::knowledge;
+
+// constructor
+platforms::threads::LockReport::LockReport ()
+{
+}
+
+// destructor
+platforms::threads::LockReport::~LockReport ()
+{
+}
+
+void
+platforms::threads::LockReport::init (knowledge::KnowledgeBase & knowledge)
+{
+  report_.set_name (".perf.locks.report", knowledge);
+}
+
+void
+platforms::threads::LockReport::run (void)
+{
+  const std::string report (utility::LockProfiler::report ());
+
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_MAJOR,
+    "platforms::threads::LockReport::run:"
+    " knowledge base lock contention by call site\n%s", report.c_str ());
+
+  report_ = report;
+}
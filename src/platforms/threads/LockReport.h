@@ -0,0 +1,49 @@
+
+#ifndef   _PLATFORM_THREAD_LOCKREPORT_H_
+#define   _PLATFORM_THREAD_LOCKREPORT_H_
+
+#include <string>
+
+#include "madara/threads/BaseThread.h"
+#include "madara/knowledge/containers/String.h"
+
+namespace platforms
+{
+  namespace threads
+  {
+    /**
+    * Periodically logs the knowledge base lock contention report of
+    * utility::LockProfiler and exports it to .perf.locks.report
+    **/
+    class LockReport : public madara::threads::BaseThread
+    {
+    public:
+      /**
+       * Constructor
+       **/
+      LockReport ();
+
+      /**
+       * Destructor
+       **/
+      virtual ~LockReport ();
+
+      /**
+        * Initializes thread with MADARA context
+        * @param   context   context for querying current program state
+        **/
+      virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+      /**
+        * Executes the main thread logic
+        **/
+      virtual void run (void);
+
+    private:
+      /// the latest report
+      madara::knowledge::containers::String report_;
+    };
+  } // end namespace threads
+} // end namespace platforms
+
+#endif // _PLATFORM_THREAD_LOCKREPORT_H_
@@ -1,6 +1,8 @@
 
 #include "gams/loggers/GlobalLogger.h"
+#include "madara/utility/Utility.h"
 #include "Mapping.h"
+#include "../../utility/AsyncLogger.h"
 #include "ace/High_Res_Timer.h"
 
 #include <stdlib.h>
@@ -10,7 +12,11 @@
 namespace knowledge = madara::knowledge;
 
 // constructor
-platforms::threads::Mapping::Mapping ()
+platforms::threads::Mapping::Mapping (
+  ::containers::Mailbox < ::containers::LaserScan> * scans,
+  ::containers::Mailbox < ::containers::OccupancyGrid> * map)
+: scans_ (scans), map_ (map), scan_version_ (0),
+  publish_period_ (1000000000), last_publish_ (0), dirty_ (false)
 {
 }
 
@@ -79,6 +85,65 @@ platforms::threads::Mapping::init (knowledge::KnowledgeBase & knowledge)
 
   // reasonably random seed
   srand (time (NULL));
+
+  pose_.set_name (".localization.pose", knowledge, 3);
+  copy_benchmark_.set_name (".mapping.copy_benchmark", knowledge);
+
+  // 100x100m @ 5cm cells, centered on the origin, unless configured
+  knowledge::KnowledgeRecord::Integer width = 2000, height = 2000;
+  double resolution = 0.05;
+
+  if (knowledge.exists (".mapping.width"))
+    width = knowledge.get (".mapping.width").to_integer ();
+  if (knowledge.exists (".mapping.height"))
+    height = knowledge.get (".mapping.height").to_integer ();
+  if (knowledge.exists (".mapping.resolution"))
+    resolution = knowledge.get (".mapping.resolution").to_double ();
+
+  grid_.resize ((int)width, (int)height, resolution,
+    -width * resolution / 2, -height * resolution / 2);
+
+  if (knowledge.exists (".mapping.publish_period"))
+    publish_period_ = (int64_t)(1000000000.0 *
+      knowledge.get (".mapping.publish_period").to_double ());
+}
+
+void
+platforms::threads::Mapping::update_map (void)
+{
+  if (!scans_ || !map_)
+  {
+    return;
+  }
+
+  uint64_t version;
+  std::shared_ptr <const ::containers::LaserScan> scan =
+    scans_->get (&version);
+
+  if (scan && version != scan_version_)
+  {
+    scan_version_ = version;
+
+    std::vector <double> pose (pose_.to_record ().to_doubles ());
+    pose.resize (3, 0.0);
+
+    grid_.insert_scan (*scan, pose[0], pose[1], pose[2]);
+    dirty_ = true;
+  }
+
+  // a snapshot copies the whole grid and makes localization rebuild its
+  // lookups, so every scan is inserted but snapshots are rate limited
+  const int64_t now = madara::utility::get_time ();
+  if (!dirty_ || now - last_publish_ < publish_period_)
+  {
+    return;
+  }
+
+  dirty_ = false;
+  last_publish_ = now;
+
+  // readers keep their own snapshot, so publish a copy
+  map_->publish (std::make_shared <const ::containers::OccupancyGrid> (grid_));
 }
 
 /**
@@ -89,10 +154,21 @@ platforms::threads::Mapping::init (knowledge::KnowledgeBase & knowledge)
  **/
 void
 platforms::threads::Mapping::run (void)
+{
+  update_map ();
+
+  if (copy_benchmark_.is_true ())
+  {
+    run_copy_benchmark ();
+  }
+}
+
+void
+platforms::threads::Mapping::run_copy_benchmark (void)
 {
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " testing map creation and copying.\n");
 
   /**
@@ -109,7 +185,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " creating arrays of %d bytes and %d bytes\n",
     (int)BIG_ARRAY, (int)NUM_BITS);
 
@@ -137,7 +213,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " arrays of %d size and %d size have been created and initialized.\n",
     BIG_ARRAY, NUM_BITS);
 
@@ -159,7 +235,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " running Test 1: Full malloc, memcpy %d KB, free. 10k iterations\n",
     BYTECELL_IN_KB);
 
@@ -182,7 +258,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " running Test 2: memcpy %d KB. 10k iterations\n",
     BYTECELL_IN_KB);
 
@@ -203,7 +279,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " running Test 3: %d KB malloc, memcpy %d KB, free. 10k iterations\n",
     BITCELL_IN_KB, BITCELL_IN_KB);
 
@@ -226,7 +302,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " running Test 4: memcpy %d KB. 10k iterations\n",
     BITCELL_IN_KB);
 
@@ -247,7 +323,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " running Test 5: duffcopy %d KB. 10k iterations\n",
     BYTECELL_IN_KB);
 
@@ -268,7 +344,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " running Test 6: duffcopy %d KB. 10k iterations\n",
     BITCELL_IN_KB);
 
@@ -289,7 +365,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " running Test 7: Dumb copy %d KB. 10k iterations\n",
     BYTECELL_IN_KB);
 
@@ -313,9 +389,9 @@ platforms::threads::Mapping::run (void)
   }
 
 
-  madara_logger_ptr_log (gams::loggers::global_logger.get (),
-    gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+  // formatted off this thread when the AsyncLogger is running
+  utility_async_log (gams::loggers::LOG_ALWAYS,
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " Results (4MB 8bit map, 500KB 1bit map, 10k iterations):\n"
     "  Test 1: malloc_memcpy_8bitcells: total (%u time, %u avg).\n"
     "  Test 2: memcpy_8bitcells: total (%u time, %u avg).\n"
@@ -366,7 +442,7 @@ platforms::threads::Mapping::run (void)
 
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_ALWAYS,
-    "platforms::threads::Mapping::run:" 
+    "platforms::threads::Mapping::run_copy_benchmark:" 
     " duff copy test for the doubters:\n%s\n",
     dest_buffer);
   
@@ -5,6 +5,11 @@
 #include <string>
 
 #include "madara/threads/BaseThread.h"
+#include "madara/knowledge/containers/Integer.h"
+#include "madara/knowledge/containers/NativeDoubleVector.h"
+#include "../../containers/LaserScan.h"
+#include "../../containers/Mailbox.h"
+#include "../../containers/OccupancyGrid.h"
 
 namespace platforms
 {
@@ -17,9 +22,14 @@ namespace platforms
     {
     public:
       /**
-       * Default constructor
+       * Constructor
+       * @param  scans   latest scan from the platform's sensor path
+       * @param  map     where map snapshots are published for other
+       *                 threads, e.g., scan matching in StateEstimation
        **/
-      Mapping ();
+      Mapping (
+        ::containers::Mailbox < ::containers::LaserScan> * scans = 0,
+        ::containers::Mailbox < ::containers::OccupancyGrid> * map = 0);
       
       /**
        * Destructor
@@ -38,8 +48,47 @@ namespace platforms
       virtual void run (void);
 
     private:
+      /**
+        * Inserts the latest scan at the current pose estimate and publishes
+        * a snapshot of the map
+        **/
+      void update_map (void);
+
+      /**
+        * Times map-sized allocations and copies. Enabled with
+        * .mapping.copy_benchmark
+        **/
+      void run_copy_benchmark (void);
+
       /// data plane if we want to access the knowledge base
       madara::knowledge::KnowledgeBase data_;
+
+      /// latest scan from the platform. Not owned.
+      ::containers::Mailbox < ::containers::LaserScan> * scans_;
+
+      /// published map snapshots. Not owned.
+      ::containers::Mailbox < ::containers::OccupancyGrid> * map_;
+
+      /// the map being built
+      ::containers::OccupancyGrid grid_;
+
+      /// version of the last scan inserted
+      uint64_t scan_version_;
+
+      /// nanoseconds between map snapshots, from .mapping.publish_period
+      int64_t publish_period_;
+
+      /// time of the last snapshot in nanoseconds
+      int64_t last_publish_;
+
+      /// true if scans were inserted since the last snapshot
+      bool dirty_;
+
+      /// current pose estimate (x, y, yaw) from StateEstimation
+      madara::knowledge::containers::NativeDoubleArray pose_;
+
+      /// if true, run the copy benchmark every iteration
+      madara::knowledge::containers::Integer copy_benchmark_;
     };
   } // end namespace threads
 } // end namespace platforms
@@ -1,12 +1,32 @@
 
+#include <cmath>
+
 #include "gams/loggers/GlobalLogger.h"
+#include "madara/utility/Utility.h"
 #include "StateEstimation.h"
+#include "../../utility/LockProfiler.h"
 
 namespace knowledge = madara::knowledge;
 
+// number of samples drained from the IMU buffer per batch
+static const size_t IMU_BATCH_SIZE (256);
+
 // constructor
-platforms::threads::StateEstimation::StateEstimation ()
+platforms::threads::StateEstimation::StateEstimation (
+  ::containers::ImuBuffer * imu_buffer,
+  ::containers::Mailbox < ::containers::LaserScan> * scans,
+  ::containers::Mailbox < ::containers::OccupancyGrid> * map,
+  ::containers::MeasurementQueue < ::containers::PositionFix> * fixes,
+  utility::TaskScheduler * scheduler)
+: imu_buffer_ (imu_buffer), imu_batch_ (IMU_BATCH_SIZE),
+  have_last_imu_sample_ (false), scans_ (scans), map_ (map),
+  scan_version_ (0), map_version_ (0), map_period_ (2000000000),
+  last_map_load_ (0), scheduler_ (scheduler),
+  particle_count_ (5000), last_scan_time_ (0), fixes_ (fixes)
 {
+  pose_estimate_.x = 0.0;
+  pose_estimate_.y = 0.0;
+  pose_estimate_.yaw = 0.0;
 }
 
 // destructor
@@ -25,6 +45,352 @@ platforms::threads::StateEstimation::init (knowledge::KnowledgeBase & knowledge)
 {
   // point our data plane to the knowledge base initializing the thread
   data_ = knowledge;
+
+  delta_velocity_.set_name (".imu.preintegrated.delta_velocity", knowledge, 3);
+  delta_position_.set_name (".imu.preintegrated.delta_position", knowledge, 3);
+  delta_angle_.set_name (".imu.preintegrated.delta_angle", knowledge, 3);
+  preintegrated_dt_.set_name (".imu.preintegrated.dt", knowledge);
+  preintegrated_samples_.set_name (".imu.preintegrated.samples", knowledge);
+  imu_overflows_.set_name (".imu.buffer.overflows", knowledge);
+  imu_drops_.set_name (".imu.buffer.drops", knowledge);
+  imu_high_water_.set_name (".imu.buffer.high_water", knowledge);
+  imu_capacity_.set_name (".imu.buffer.capacity", knowledge);
+
+  pose_.set_name (".localization.pose", knowledge, 3);
+  match_score_.set_name (".localization.score", knowledge);
+  match_time_.set_name (".localization.match_time", knowledge);
+
+  particles_per_second_.set_name (
+    ".localization.particles_per_second", knowledge);
+  effective_particles_.set_name (
+    ".localization.effective_particles", knowledge);
+
+  fused_position_.set_name (".estimation.position", knowledge, 3);
+  fused_velocity_.set_name (".estimation.velocity", knowledge, 3);
+  fused_yaw_.set_name (".estimation.yaw", knowledge);
+  fusion_latency_.set_name (".estimation.latency", knowledge);
+  fusion_replays_.set_name (".estimation.replays", knowledge);
+  fusion_replayed_.set_name (".estimation.replayed", knowledge);
+  fusion_late_drops_.set_name (".estimation.late_drops", knowledge);
+
+  if (knowledge.exists (".estimation.replay_window"))
+    fusion_.replay_window = (int64_t)(1000000000.0 *
+      knowledge.get (".estimation.replay_window").to_double ());
+
+  if (scans_ && map_)
+  {
+    init_localization (knowledge);
+  }
+}
+
+void
+platforms::threads::StateEstimation::init_localization (
+  knowledge::KnowledgeBase & knowledge)
+{
+  // four cores keeps one match per scan at typical scan rates
+  knowledge::KnowledgeRecord::Integer threads = 4;
+  if (knowledge.exists (".localization.threads"))
+    threads = knowledge.get (".localization.threads").to_integer ();
+
+  std::string method = "scan_matcher";
+  if (knowledge.exists (".localization.method"))
+    method = knowledge.get (".localization.method").to_string ();
+
+  // with a shared scheduler, candidates are stolen by whichever workers
+  // are idle instead of a fixed set of threads
+  if (scheduler_)
+    match_pool_.reset (new utility::WorkerPool (*scheduler_));
+  else
+    match_pool_.reset (new utility::WorkerPool ((size_t)threads));
+
+  if (method == "particle_filter")
+  {
+    particle_filter_.reset (
+      new localization::ParticleFilter (match_pool_.get ()));
+
+    if (knowledge.exists (".localization.particles"))
+      particle_count_ = (size_t)
+        knowledge.get (".localization.particles").to_integer ();
+    if (knowledge.exists (".localization.beams"))
+      particle_filter_->max_beams = (size_t)
+        knowledge.get (".localization.beams").to_integer ();
+    if (knowledge.exists (".localization.sigma"))
+      particle_filter_->sigma =
+        knowledge.get (".localization.sigma").to_double ();
+  }
+  else
+  {
+    if (method != "scan_matcher")
+    {
+      madara_logger_ptr_log (gams::loggers::global_logger.get (),
+        gams::loggers::LOG_ERROR,
+        "platforms::threads::StateEstimation::init_localization:" 
+        " unknown .localization.method %s. Using scan_matcher\n",
+        method.c_str ());
+    }
+
+    matcher_.reset (new localization::ScanMatcher (match_pool_.get ()));
+
+    if (knowledge.exists (".localization.linear_window"))
+      matcher_->linear_window =
+        knowledge.get (".localization.linear_window").to_double ();
+    if (knowledge.exists (".localization.angular_window"))
+      matcher_->angular_window =
+        knowledge.get (".localization.angular_window").to_double ();
+    if (knowledge.exists (".localization.min_score"))
+      matcher_->min_score =
+        knowledge.get (".localization.min_score").to_double ();
+  }
+
+  if (knowledge.exists (".localization.map_period"))
+    map_period_ = (int64_t)(1000000000.0 *
+      knowledge.get (".localization.map_period").to_double ());
+}
+
+void
+platforms::threads::StateEstimation::localize (void)
+{
+  uint64_t version;
+
+  std::shared_ptr <const ::containers::OccupancyGrid> map =
+    map_->get (&version);
+
+  // loading a map rebuilds the lookups over every cell, which costs many
+  // matches, so a changed map is loaded at most once per map period
+  const bool had_map = matcher_ ?
+    matcher_->has_map () : particle_filter_->has_map ();
+  const int64_t now = madara::utility::get_time ();
+  if (map && version != map_version_ &&
+    (!had_map || now - last_map_load_ >= map_period_))
+  {
+    map_version_ = version;
+    last_map_load_ = now;
+
+    if (matcher_)
+    {
+      matcher_->set_map (*map);
+    }
+    else
+    {
+      // particles are only spread on the first map. Later maps refine it.
+      const bool first = !particle_filter_->has_map ();
+      particle_filter_->set_map (*map);
+      if (first)
+      {
+        particle_filter_->initialize (particle_count_, pose_estimate_,
+          0.25, 0.1);
+      }
+    }
+  }
+
+  std::shared_ptr <const ::containers::LaserScan> scan =
+    scans_->get (&version);
+  const bool has_map = matcher_ ?
+    matcher_->has_map () : particle_filter_->has_map ();
+  if (!scan || version == scan_version_ || !has_map)
+  {
+    return;
+  }
+  scan_version_ = version;
+
+  // start from the fused estimate at the time the scan was taken, which
+  // accounts for motion since the last match
+  localization::FusedState fused;
+  if (fusion_.has_fix () && fusion_.get_state_at (scan->timestamp, fused))
+  {
+    pose_estimate_.x = fused.position[0];
+    pose_estimate_.y = fused.position[1];
+    pose_estimate_.yaw = fused.yaw;
+  }
+
+  int64_t start = madara::utility::get_time ();
+
+  double score = 0.0;
+
+  if (matcher_)
+  {
+    localization::Pose2D result;
+    score = matcher_->match (*scan, pose_estimate_, result);
+
+    if (score > 0)
+    {
+      pose_estimate_ = result;
+    }
+  }
+  else
+  {
+    // move the particles by the fused motion since the last scan, in the
+    // frame of the pose at that scan
+    localization::FusedState previous, current;
+    double motion[3] = {0.0, 0.0, 0.0};
+    if (last_scan_time_ != 0 &&
+      fusion_.get_state_at (last_scan_time_, previous) &&
+      fusion_.get_state_at (scan->timestamp, current))
+    {
+      const double dx = current.position[0] - previous.position[0];
+      const double dy = current.position[1] - previous.position[1];
+      const double c = std::cos (previous.yaw);
+      const double s = std::sin (previous.yaw);
+
+      motion[0] = c * dx + s * dy;
+      motion[1] = -s * dx + c * dy;
+      motion[2] = std::remainder (current.yaw - previous.yaw, 2 * M_PI);
+    }
+    last_scan_time_ = scan->timestamp;
+
+    particle_filter_->predict (motion[0], motion[1], motion[2]);
+
+    particle_filter_->update (*scan);
+    pose_estimate_ = particle_filter_->estimate ();
+    score = particle_filter_->effective_size () / particle_filter_->size ();
+  }
+
+  int64_t end = madara::utility::get_time ();
+
+  // the result describes where the scan was taken, not where we are now
+  if (score > 0)
+  {
+    ::containers::PositionFix fix = {};
+    fix.timestamp = scan->timestamp;
+    fix.position[0] = pose_estimate_.x;
+    fix.position[1] = pose_estimate_.y;
+    fix.yaw = pose_estimate_.yaw;
+    fix.axes = ::containers::PositionFix::X | ::containers::PositionFix::Y |
+      ::containers::PositionFix::YAW;
+    fusion_.add_fix (fix);
+  }
+
+  // lock the context so the pose is applied as a single transaction
+  utility::ProfiledGuard guard (data_,
+    UTILITY_LOCK_SITE ("StateEstimation::localize"));
+
+  pose_.set (0, pose_estimate_.x);
+  pose_.set (1, pose_estimate_.y);
+  pose_.set (2, pose_estimate_.yaw);
+  match_score_ = score;
+  match_time_ = (end - start) / 1000000000.0;
+
+  if (particle_filter_)
+  {
+    particles_per_second_ = particle_filter_->get_particles_per_second ();
+    effective_particles_ = particle_filter_->effective_size ();
+  }
+}
+
+/**
+ * Pre-integrates every buffered IMU sample with the trapezoidal rule. The
+ * last sample of each update is kept so the interval spanning two updates
+ * is not lost. The knowledge base is locked once per update, not once per
+ * sample.
+ **/
+void
+platforms::threads::StateEstimation::preintegrate_imu (void)
+{
+  double dv[3] = {0.0, 0.0, 0.0};
+  double dp[3] = {0.0, 0.0, 0.0};
+  double dtheta[3] = {0.0, 0.0, 0.0};
+  double total_dt = 0.0;
+  int64_t samples = 0;
+
+  size_t count;
+  while ((count = imu_buffer_->pop_batch (
+    imu_batch_.data (), imu_batch_.size ())) > 0)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      const ::containers::ImuSample & current = imu_batch_[i];
+
+      if (have_last_imu_sample_)
+      {
+        const double dt =
+          (current.timestamp - last_imu_sample_.timestamp) / 1000000000.0;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+          const double accel =
+            (last_imu_sample_.accel[axis] + current.accel[axis]) / 2;
+          const double rate =
+            (last_imu_sample_.gyro[axis] + current.gyro[axis]) / 2;
+
+          dp[axis] += dv[axis] * dt + accel * dt * dt / 2;
+          dv[axis] += accel * dt;
+          dtheta[axis] += rate * dt;
+        }
+
+        total_dt += dt;
+      }
+
+      last_imu_sample_ = current;
+      have_last_imu_sample_ = true;
+
+      fusion_.add_imu (current);
+    }
+
+    samples += (int64_t)count;
+  }
+
+  // lock the context so the deltas are applied as a single transaction
+  utility::ProfiledGuard guard (data_,
+    UTILITY_LOCK_SITE ("StateEstimation::preintegrate_imu"));
+
+  for (size_t axis = 0; axis < 3; ++axis)
+  {
+    delta_velocity_.set (axis, dv[axis]);
+    delta_position_.set (axis, dp[axis]);
+    delta_angle_.set (axis, dtheta[axis]);
+  }
+
+  preintegrated_dt_ = total_dt;
+  preintegrated_samples_ = samples;
+  imu_overflows_ = (knowledge::KnowledgeRecord::Integer)
+    imu_buffer_->get_overflows ();
+  imu_drops_ = (knowledge::KnowledgeRecord::Integer)
+    imu_buffer_->get_drops ();
+  imu_high_water_ = (knowledge::KnowledgeRecord::Integer)
+    imu_buffer_->get_high_water ();
+  imu_capacity_ = (knowledge::KnowledgeRecord::Integer)
+    imu_buffer_->capacity ();
+}
+
+void
+platforms::threads::StateEstimation::fuse (void)
+{
+  if (fixes_)
+  {
+    fixes_->drain (fix_batch_);
+    for (size_t i = 0; i < fix_batch_.size (); ++i)
+    {
+      fusion_.add_fix (fix_batch_[i]);
+    }
+  }
+
+  if (fusion_.update () == 0)
+  {
+    return;
+  }
+
+  const localization::FusedState & state = fusion_.get_state ();
+  const double latency =
+    (madara::utility::get_time () - state.timestamp) / 1000000000.0;
+
+  // lock the context so the state is applied as a single transaction
+  utility::ProfiledGuard guard (data_,
+    UTILITY_LOCK_SITE ("StateEstimation::fuse"));
+
+  for (size_t axis = 0; axis < 3; ++axis)
+  {
+    fused_position_.set (axis, state.position[axis]);
+    fused_velocity_.set (axis, state.velocity[axis]);
+  }
+
+  fused_yaw_ = state.yaw;
+  fusion_latency_ = latency;
+  fusion_replays_ = (knowledge::KnowledgeRecord::Integer)
+    fusion_.get_replays ();
+  fusion_replayed_ = (knowledge::KnowledgeRecord::Integer)
+    fusion_.get_replayed ();
+  fusion_late_drops_ = (knowledge::KnowledgeRecord::Integer)
+    fusion_.get_late_drops ();
 }
 
 /**
@@ -46,4 +412,16 @@ platforms::threads::StateEstimation::run (void)
     gams::loggers::LOG_MAJOR,
     "platforms::threads::StateEstimation::run:" 
     " executing\n");
+
+  if (imu_buffer_)
+  {
+    preintegrate_imu ();
+  }
+
+  if (matcher_ || particle_filter_)
+  {
+    localize ();
+  }
+
+  fuse ();
 }
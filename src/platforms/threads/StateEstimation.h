@@ -2,9 +2,25 @@
 #ifndef   _PLATFORM_THREAD_STATEESTIMATION_H_
 #define   _PLATFORM_THREAD_STATEESTIMATION_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "madara/threads/BaseThread.h"
+#include "madara/knowledge/containers/Integer.h"
+#include "madara/knowledge/containers/Double.h"
+#include "madara/knowledge/containers/NativeDoubleVector.h"
+#include "../../containers/ImuBuffer.h"
+#include "../../containers/LaserScan.h"
+#include "../../containers/Mailbox.h"
+#include "../../containers/MeasurementQueue.h"
+#include "../../containers/OccupancyGrid.h"
+#include "../../containers/PositionFix.h"
+#include "../../localization/ParticleFilter.h"
+#include "../../localization/ScanMatcher.h"
+#include "../../localization/SensorFusion.h"
+#include "../../utility/TaskScheduler.h"
+#include "../../utility/WorkerPool.h"
 
 namespace platforms
 {
@@ -17,9 +33,23 @@ namespace platforms
     {
     public:
       /**
-       * Default constructor
+       * Constructor
+       * @param  imu_buffer  IMU samples produced by the platform's sensor
+       *                     path. This thread is the only consumer. May be
+       *                     null if the platform has no IMU.
+       * @param  scans       latest scan from the platform's sensor path
+       * @param  map         map snapshots published by the Mapping thread
+       * @param  fixes       absolute position fixes from the platform
+       * @param  scheduler   shared scheduler the localizer forks work
+       *                     into. If null, a dedicated pool of
+       *                     .localization.threads is created.
        **/
-      StateEstimation ();
+      StateEstimation (::containers::ImuBuffer * imu_buffer = 0,
+        ::containers::Mailbox < ::containers::LaserScan> * scans = 0,
+        ::containers::Mailbox < ::containers::OccupancyGrid> * map = 0,
+        ::containers::MeasurementQueue < ::containers::PositionFix> *
+          fixes = 0,
+        utility::TaskScheduler * scheduler = 0);
       
       /**
        * Destructor
@@ -38,8 +68,153 @@ namespace platforms
       virtual void run (void);
 
     private:
+      /**
+        * Drains the IMU buffer in batches and pre-integrates the samples
+        * into velocity, position and angle deltas since the last update
+        **/
+      void preintegrate_imu (void);
+
+      /**
+        * Localizes the latest scan against the latest map snapshot
+        **/
+      void localize (void);
+
+      /**
+        * Fuses new IMU samples, position fixes and scan poses in time order
+        * and publishes the fused state
+        **/
+      void fuse (void);
+
+      /**
+        * Reads localization settings and creates the configured localizer
+        * @param   knowledge the knowledge base holding the settings
+        **/
+      void init_localization (madara::knowledge::KnowledgeBase & knowledge);
+
       /// data plane if we want to access the knowledge base
       madara::knowledge::KnowledgeBase data_;
+
+      /// IMU samples from the platform. Not owned.
+      ::containers::ImuBuffer * imu_buffer_;
+
+      /// preallocated scratch space for draining the IMU buffer
+      std::vector <::containers::ImuSample> imu_batch_;
+
+      /// last sample integrated, carried over between updates
+      ::containers::ImuSample last_imu_sample_;
+
+      /// true once last_imu_sample_ holds a real sample
+      bool have_last_imu_sample_;
+
+      /// velocity change since the last update (m/s)
+      madara::knowledge::containers::NativeDoubleArray delta_velocity_;
+
+      /// position change since the last update (m)
+      madara::knowledge::containers::NativeDoubleArray delta_position_;
+
+      /// angle change since the last update (rad)
+      madara::knowledge::containers::NativeDoubleArray delta_angle_;
+
+      /// time covered by the pre-integrated deltas (s)
+      madara::knowledge::containers::Double preintegrated_dt_;
+
+      /// number of samples integrated in the last update
+      madara::knowledge::containers::Integer preintegrated_samples_;
+
+      /// total samples rejected by a full IMU buffer
+      madara::knowledge::containers::Integer imu_overflows_;
+
+      /// total samples discarded as out of order
+      madara::knowledge::containers::Integer imu_drops_;
+
+      /// highest IMU buffer occupancy seen
+      madara::knowledge::containers::Integer imu_high_water_;
+
+      /// IMU buffer capacity, for comparison against the high water mark
+      madara::knowledge::containers::Integer imu_capacity_;
+
+      /// latest scan from the platform. Not owned.
+      ::containers::Mailbox < ::containers::LaserScan> * scans_;
+
+      /// map snapshots from the Mapping thread. Not owned.
+      ::containers::Mailbox < ::containers::OccupancyGrid> * map_;
+
+      /// versions of the last scan matched and map loaded
+      uint64_t scan_version_;
+      uint64_t map_version_;
+
+      /// nanoseconds between map loads, from .localization.map_period
+      int64_t map_period_;
+
+      /// time of the last map load in nanoseconds
+      int64_t last_map_load_;
+
+      /// shared scheduler, if any. Not owned.
+      utility::TaskScheduler * scheduler_;
+
+      /// cores for the localizer
+      std::unique_ptr <utility::WorkerPool> match_pool_;
+
+      /// scan-to-map matcher, if .localization.method is scan_matcher
+      std::unique_ptr <localization::ScanMatcher> matcher_;
+
+      /// particle filter, if .localization.method is particle_filter
+      std::unique_ptr <localization::ParticleFilter> particle_filter_;
+
+      /// number of particles to spread when a map arrives
+      size_t particle_count_;
+
+      /// time of the last scan the particles were moved to, 0 for none
+      int64_t last_scan_time_;
+
+      /// current pose estimate
+      localization::Pose2D pose_estimate_;
+
+      /// pose estimate (x, y, yaw) in the knowledge base
+      madara::knowledge::containers::NativeDoubleArray pose_;
+
+      /// absolute position fixes from the platform. Not owned.
+      ::containers::MeasurementQueue < ::containers::PositionFix> * fixes_;
+
+      /// preallocated scratch space for draining fixes_
+      std::vector < ::containers::PositionFix> fix_batch_;
+
+      /// time-aligned fusion of IMU, fixes and scan poses
+      localization::SensorFusion fusion_;
+
+      /// fused position x, y, z (m)
+      madara::knowledge::containers::NativeDoubleArray fused_position_;
+
+      /// fused velocity x, y, z (m/s)
+      madara::knowledge::containers::NativeDoubleArray fused_velocity_;
+
+      /// fused heading (rad)
+      madara::knowledge::containers::Double fused_yaw_;
+
+      /// age of the fused state when published (s)
+      madara::knowledge::containers::Double fusion_latency_;
+
+      /// rollbacks caused by late measurements
+      madara::knowledge::containers::Integer fusion_replays_;
+
+      /// measurements reapplied during rollbacks
+      madara::knowledge::containers::Integer fusion_replayed_;
+
+      /// measurements too old for the replay window
+      madara::knowledge::containers::Integer fusion_late_drops_;
+
+      /// score of the last scan match in [0, 1], or the effective fraction
+      /// of particles for the particle filter
+      madara::knowledge::containers::Double match_score_;
+
+      /// duration of the last scan match in seconds
+      madara::knowledge::containers::Double match_time_;
+
+      /// particle filter likelihood throughput
+      madara::knowledge::containers::Double particles_per_second_;
+
+      /// particle filter effective sample size
+      madara::knowledge::containers::Double effective_particles_;
     };
   } // end namespace threads
 } // end namespace platforms
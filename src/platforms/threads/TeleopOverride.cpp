@@ -1,11 +1,17 @@
 
 #include "gams/loggers/GlobalLogger.h"
+#include "madara/utility/Utility.h"
 #include "TeleopOverride.h"
+#include "../../utility/LockProfiler.h"
 
 namespace knowledge = madara::knowledge;
 
 // constructor
-platforms::threads::TeleopOverride::TeleopOverride ()
+platforms::threads::TeleopOverride::TeleopOverride (
+  ::containers::Mailbox < ::containers::TeleopCommand> * commands,
+  utility::TaskScheduler * scheduler, const std::string & controls)
+: commands_ (commands), scheduler_ (scheduler), controls_ (controls),
+  last_timestamp_ (0)
 {
 }
 
@@ -25,6 +31,28 @@ platforms::threads::TeleopOverride::init (knowledge::KnowledgeBase & knowledge)
 {
   // point our data plane to the knowledge base initializing the thread
   data_ = knowledge;
+
+  const std::string prefix (knowledge.expand_statement ("agent.{.id}.teleop"));
+
+  enabled_.set_name (prefix + ".enabled", knowledge);
+  command_.set_name (prefix + ".command", knowledge, 4);
+  sequence_.set_name (prefix + ".sequence", knowledge);
+  timestamp_.set_name (prefix + ".timestamp", knowledge);
+  last_enabled_.set_name (".teleop.last_enabled", knowledge);
+  last_sequence_.set_name (".teleop.last_sequence", knowledge);
+
+  changed_ = knowledge.compile (
+    prefix + ".enabled != .teleop.last_enabled || " +
+    prefix + ".sequence != .teleop.last_sequence");
+
+  /**
+   * A poll frequency of zero blocks on the context's change signal rather
+   * than sleeping between evaluations, so an operator update wakes this
+   * thread as soon as it is applied. The wait is only rechecked on a
+   * change or signal, so it has no timeout. The platform signals the
+   * context on shutdown so a wait does not hold up termination.
+   **/
+  wait_settings_.poll_frequency = 0.0;
 }
 
 /**
@@ -36,14 +64,58 @@ platforms::threads::TeleopOverride::init (knowledge::KnowledgeBase & knowledge)
 void
 platforms::threads::TeleopOverride::run (void)
 {
-  /**
-   * the MADARA logger is thread-safe, fast, and allows for specifying
-   * various options like output files and multiple output targets (
-   * e.g., std::cerr, a system log, and a thread_output.txt file). You
-   * can create your own custom log levels or loggers as well.
-   **/
+  if (!data_.wait (changed_, wait_settings_).is_true ())
+  {
+    return;
+  }
+
+  const int64_t woken = (int64_t)madara::utility::get_time ();
+
+  ::containers::TeleopCommand update;
+
+  {
+    // read the operator's update as one consistent snapshot
+    utility::ProfiledGuard guard (data_,
+      UTILITY_LOCK_SITE ("TeleopOverride::run"));
+
+    update.enabled = *enabled_ != 0;
+    update.sequence = *sequence_;
+    for (size_t i = 0; i < 4; ++i)
+    {
+      update.command[i] = command_[i];
+    }
+
+    // a timestamp left from an earlier command would overstate latency
+    const int64_t timestamp = *timestamp_;
+    if (timestamp <= 0)
+      update.issued = woken;
+    else if (timestamp != last_timestamp_)
+      update.issued = timestamp;
+    else
+      update.issued = 0;
+    last_timestamp_ = timestamp;
+
+    last_enabled_ = *enabled_;
+    last_sequence_ = *sequence_;
+  }
+
+  if (commands_)
+  {
+    commands_->publish (
+      std::make_shared <const ::containers::TeleopCommand> (update));
+  }
+
+  // apply the command now instead of up to a control period later
+  if (scheduler_)
+  {
+    scheduler_->trigger (controls_);
+  }
+
   madara_logger_ptr_log (gams::loggers::global_logger.get (),
     gams::loggers::LOG_MAJOR,
     "platforms::threads::TeleopOverride::run:" 
-    " executing\n");
+    " override %s, command %d = [%.2f, %.2f, %.2f, %.2f]\n",
+    update.enabled ? "enabled" : "disabled", (int)update.sequence,
+    update.command[0], update.command[1], update.command[2],
+    update.command[3]);
 }
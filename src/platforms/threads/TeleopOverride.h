@@ -5,27 +5,49 @@
 #include <string>
 
 #include "madara/threads/BaseThread.h"
+#include "madara/knowledge/containers/Integer.h"
+#include "madara/knowledge/containers/NativeDoubleVector.h"
+#include "../../containers/Mailbox.h"
+#include "../../containers/TeleopCommand.h"
+#include "../../utility/TaskScheduler.h"
 
 namespace platforms
 {
   namespace threads
   {
     /**
-     * Provides teleoperation override for RISLab quadcopter platforms
+     * Provides teleoperation override for RISLab quadcopter platforms.
+     *
+     * Rather than polling, run blocks in a knowledge base wait that is
+     * signaled whenever the operator changes agent.{.id}.teleop.enabled or
+     * bumps agent.{.id}.teleop.sequence, and hands the new command to
+     * Controls through a Mailbox. If Controls runs on a TaskScheduler, it
+     * is triggered to apply the command at once rather than on its next
+     * period. The operator sets
+     * agent.{.id}.teleop.command to [vx, vy, vz, yaw_rate] and may stamp
+     * agent.{.id}.teleop.timestamp (ns) for end-to-end latency. Latency
+     * is only measured for commands that came with a new timestamp.
      **/
     class TeleopOverride : public madara::threads::BaseThread
     {
     public:
       /**
-       * Default constructor
+       * Constructor
+       * @param  commands   where operator commands are handed to Controls
+       * @param  scheduler  scheduler running Controls, or null if Controls
+       *                    has its own thread. Not owned.
+       * @param  controls   name of the Controls job on the scheduler
        **/
-      TeleopOverride ();
-      
+      TeleopOverride (
+        ::containers::Mailbox < ::containers::TeleopCommand> * commands = 0,
+        utility::TaskScheduler * scheduler = 0,
+        const std::string & controls = "Controls");
+
       /**
        * Destructor
        **/
       virtual ~TeleopOverride ();
-      
+
       /**
         * Initializes thread with MADARA context
         * @param   context   context for querying current program state
@@ -40,6 +62,40 @@ namespace platforms
     private:
       /// data plane if we want to access the knowledge base
       madara::knowledge::KnowledgeBase data_;
+
+      /// operator commands handed to Controls. Not owned.
+      ::containers::Mailbox < ::containers::TeleopCommand> * commands_;
+
+      /// scheduler running Controls, if any. Not owned.
+      utility::TaskScheduler * scheduler_;
+
+      /// name of the Controls job on scheduler_
+      std::string controls_;
+
+      /// true while the operator is in control
+      madara::knowledge::containers::Integer enabled_;
+
+      /// operator command [vx, vy, vz, yaw_rate]
+      madara::knowledge::containers::NativeDoubleArray command_;
+
+      /// bumped by the operator on every new command
+      madara::knowledge::containers::Integer sequence_;
+
+      /// optional operator timestamp of the command (ns)
+      madara::knowledge::containers::Integer timestamp_;
+
+      /// last enabled and sequence values handed to Controls
+      madara::knowledge::containers::Integer last_enabled_;
+      madara::knowledge::containers::Integer last_sequence_;
+
+      /// operator timestamp of the last command handed to Controls
+      int64_t last_timestamp_;
+
+      /// wakes when the operator changes anything
+      madara::knowledge::CompiledExpression changed_;
+
+      /// waits on the context's change signal, without a timeout
+      madara::knowledge::WaitSettings wait_settings_;
     };
   } // end namespace threads
 } // end namespace platforms
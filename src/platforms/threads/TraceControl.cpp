@@ -0,0 +1,51 @@
+
+#include "gams/loggers/GlobalLogger.h"
+#include "TraceControl.h"
+#include "../../utility/Trace.h"
+
+namespace knowledge = madara::knowledge;
+
+// constructor
+platforms::threads::TraceControl::TraceControl ()
+{
+}
+
+// destructor
+platforms::threads::TraceControl::~TraceControl ()
+{
+}
+
+void
+platforms::threads::TraceControl::init (knowledge::KnowledgeBase & knowledge)
+{
+  // an unset variable reads as "0", so check before binding it
+  const bool has_file = knowledge.exists (".trace.file");
+
+  enabled_.set_name (".trace.enabled", knowledge);
+  dump_.set_name (".trace.dump", knowledge);
+  file_.set_name (".trace.file", knowledge);
+
+  if (!has_file)
+    file_ = "trace.json";
+}
+
+void
+platforms::threads::TraceControl::run (void)
+{
+  const bool enable = *enabled_ != 0;
+  if (enable != utility::Trace::enabled ())
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_MAJOR,
+      "platforms::threads::TraceControl::run:"
+      " tracing %s\n", enable ? "started" : "stopped");
+
+    utility::Trace::set_enabled (enable);
+  }
+
+  if (*dump_ != 0)
+  {
+    utility::Trace::write (*file_);
+    dump_ = 0;
+  }
+}
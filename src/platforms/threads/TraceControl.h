@@ -0,0 +1,55 @@
+#ifndef   _PLATFORM_THREAD_TRACECONTROL_H_
+#define   _PLATFORM_THREAD_TRACECONTROL_H_
+
+#include <string>
+
+#include "madara/threads/BaseThread.h"
+#include "madara/knowledge/containers/Integer.h"
+#include "madara/knowledge/containers/String.h"
+
+namespace platforms
+{
+  namespace threads
+  {
+    /**
+    * Starts and stops utility::Trace from the knowledge base while the
+    * agent runs:
+    *
+    *   .trace.enabled   nonzero to record
+    *   .trace.dump      set nonzero to write the trace. Reset to 0 after.
+    *   .trace.file      file to write, default trace.json
+    **/
+    class TraceControl : public madara::threads::BaseThread
+    {
+    public:
+      /**
+       * Constructor
+       **/
+      TraceControl ();
+
+      /**
+       * Destructor
+       **/
+      virtual ~TraceControl ();
+
+      /**
+        * Initializes thread with MADARA context
+        * @param   context   context for querying current program state
+        **/
+      virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+      /**
+        * Executes the main thread logic
+        **/
+      virtual void run (void);
+
+    private:
+      /// control variables
+      madara::knowledge::containers::Integer enabled_;
+      madara::knowledge::containers::Integer dump_;
+      madara::knowledge::containers::String file_;
+    };
+  } // end namespace threads
+} // end namespace platforms
+
+#endif // _PLATFORM_THREAD_TRACECONTROL_H_
@@ -0,0 +1,28 @@
+
+#include "ChunkFlush.h"
+
+namespace knowledge = madara::knowledge;
+
+// constructor
+threads::ChunkFlush::ChunkFlush (filters::ChunkSendFilter * chunker)
+: chunker_ (chunker)
+{
+}
+
+// destructor
+threads::ChunkFlush::~ChunkFlush ()
+{
+}
+
+void
+threads::ChunkFlush::init (knowledge::KnowledgeBase & knowledge)
+{
+  // point our data plane to the knowledge base initializing the thread
+  data_ = knowledge;
+}
+
+void
+threads::ChunkFlush::run (void)
+{
+  chunker_->flush (data_);
+}
@@ -0,0 +1,50 @@
+#ifndef   _THREAD_CHUNKFLUSH_H_
+#define   _THREAD_CHUNKFLUSH_H_
+
+#include <string>
+
+#include "madara/threads/BaseThread.h"
+#include "../filters/ChunkSendFilter.h"
+
+namespace threads
+{
+  /**
+  * Sends the chunks a filters::ChunkSendFilter has waiting when nothing
+  * else sends. Its rate, times .chunk.per_send, bounds how fast large
+  * records go out.
+  **/
+  class ChunkFlush : public madara::threads::BaseThread
+  {
+  public:
+    /**
+     * Constructor
+     * @param   chunker    the send filter to flush
+     **/
+    ChunkFlush (filters::ChunkSendFilter * chunker);
+
+    /**
+     * Destructor
+     **/
+    virtual ~ChunkFlush ();
+
+    /**
+      * Initializes thread with MADARA context
+      * @param   context   context for querying current program state
+      **/
+    virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+      * Executes the main thread logic
+      **/
+    virtual void run (void);
+
+  private:
+    /// the send filter
+    filters::ChunkSendFilter * chunker_;
+
+    /// data plane if we want to access the knowledge base
+    madara::knowledge::KnowledgeBase data_;
+  };
+} // end namespace threads
+
+#endif // _THREAD_CHUNKFLUSH_H_
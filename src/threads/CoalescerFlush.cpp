@@ -0,0 +1,28 @@
+
+#include "CoalescerFlush.h"
+
+namespace knowledge = madara::knowledge;
+
+// constructor
+threads::CoalescerFlush::CoalescerFlush (filters::SendCoalescer * coalescer)
+: coalescer_ (coalescer)
+{
+}
+
+// destructor
+threads::CoalescerFlush::~CoalescerFlush ()
+{
+}
+
+void
+threads::CoalescerFlush::init (knowledge::KnowledgeBase & knowledge)
+{
+  // point our data plane to the knowledge base initializing the thread
+  data_ = knowledge;
+}
+
+void
+threads::CoalescerFlush::run (void)
+{
+  coalescer_->flush (data_);
+}
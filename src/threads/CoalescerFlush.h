@@ -0,0 +1,50 @@
+#ifndef   _THREAD_COALESCERFLUSH_H_
+#define   _THREAD_COALESCERFLUSH_H_
+
+#include <string>
+
+#include "madara/threads/BaseThread.h"
+#include "../filters/SendCoalescer.h"
+
+namespace threads
+{
+  /**
+  * Sends the records a filters::SendCoalescer holds when nothing else
+  * sends before their window ends. Run it at least once per window; it
+  * does nothing while no records are held.
+  **/
+  class CoalescerFlush : public madara::threads::BaseThread
+  {
+  public:
+    /**
+     * Constructor
+     * @param   coalescer  the send filter to flush
+     **/
+    CoalescerFlush (filters::SendCoalescer * coalescer);
+
+    /**
+     * Destructor
+     **/
+    virtual ~CoalescerFlush ();
+
+    /**
+      * Initializes thread with MADARA context
+      * @param   context   context for querying current program state
+      **/
+    virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+      * Executes the main thread logic
+      **/
+    virtual void run (void);
+
+  private:
+    /// the send filter
+    filters::SendCoalescer * coalescer_;
+
+    /// data plane if we want to access the knowledge base
+    madara::knowledge::KnowledgeBase data_;
+  };
+} // end namespace threads
+
+#endif // _THREAD_COALESCERFLUSH_H_
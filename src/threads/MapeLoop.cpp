@@ -0,0 +1,29 @@
+
+#include "MapeLoop.h"
+
+namespace knowledge = madara::knowledge;
+
+// constructor
+threads::MapeLoop::MapeLoop (gams::controllers::BaseController * controller)
+: controller_ (controller)
+{
+}
+
+// destructor
+threads::MapeLoop::~MapeLoop ()
+{
+}
+
+void
+threads::MapeLoop::init (knowledge::KnowledgeBase & knowledge)
+{
+  // point our data plane to the knowledge base initializing the thread
+  data_ = knowledge;
+}
+
+void
+threads::MapeLoop::run (void)
+{
+  // monitor, analyze, plan and execute, then send modifieds
+  controller_->run_once ();
+}
@@ -0,0 +1,51 @@
+#ifndef   _THREAD_MAPELOOP_H_
+#define   _THREAD_MAPELOOP_H_
+
+#include <string>
+
+#include "madara/threads/BaseThread.h"
+#include "gams/controllers/BaseController.h"
+
+namespace threads
+{
+  /**
+  * Runs one iteration of an agent's MAPE loop, and sends its updates,
+  * per run. Lets the loops of agents hosted in one process share the
+  * workers of a utility::TaskScheduler instead of each blocking a thread
+  * in BaseController::run.
+  **/
+  class MapeLoop : public madara::threads::BaseThread
+  {
+  public:
+    /**
+     * Constructor
+     * @param   controller  the agent's controller. Must outlive the thread.
+     **/
+    MapeLoop (gams::controllers::BaseController * controller);
+
+    /**
+     * Destructor
+     **/
+    virtual ~MapeLoop ();
+
+    /**
+      * Initializes thread with MADARA context
+      * @param   context   context for querying current program state
+      **/
+    virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+      * Executes the main thread logic
+      **/
+    virtual void run (void);
+
+  private:
+    /// the agent's controller
+    gams::controllers::BaseController * controller_;
+
+    /// data plane if we want to access the knowledge base
+    madara::knowledge::KnowledgeBase data_;
+  };
+} // end namespace threads
+
+#endif // _THREAD_MAPELOOP_H_
@@ -0,0 +1,28 @@
+
+#include "ShaperFlush.h"
+
+namespace knowledge = madara::knowledge;
+
+// constructor
+threads::ShaperFlush::ShaperFlush (filters::IntelligentSendFilter * shaper)
+: shaper_ (shaper)
+{
+}
+
+// destructor
+threads::ShaperFlush::~ShaperFlush ()
+{
+}
+
+void
+threads::ShaperFlush::init (knowledge::KnowledgeBase & knowledge)
+{
+  // point our data plane to the knowledge base initializing the thread
+  data_ = knowledge;
+}
+
+void
+threads::ShaperFlush::run (void)
+{
+  shaper_->flush (data_);
+}
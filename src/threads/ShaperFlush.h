@@ -0,0 +1,51 @@
+#ifndef   _THREAD_SHAPERFLUSH_H_
+#define   _THREAD_SHAPERFLUSH_H_
+
+#include <string>
+
+#include "madara/threads/BaseThread.h"
+#include "../filters/IntelligentSendFilter.h"
+
+namespace threads
+{
+  /**
+  * Sends the records a filters::IntelligentSendFilter deferred when
+  * nothing else sends, so their latest values do not wait for the next
+  * update. Its rate bounds how long a deferred value waits once budget
+  * is available.
+  **/
+  class ShaperFlush : public madara::threads::BaseThread
+  {
+  public:
+    /**
+     * Constructor
+     * @param   shaper    the send filter to flush
+     **/
+    ShaperFlush (filters::IntelligentSendFilter * shaper);
+
+    /**
+     * Destructor
+     **/
+    virtual ~ShaperFlush ();
+
+    /**
+      * Initializes thread with MADARA context
+      * @param   context   context for querying current program state
+      **/
+    virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+      * Executes the main thread logic
+      **/
+    virtual void run (void);
+
+  private:
+    /// the send filter
+    filters::IntelligentSendFilter * shaper_;
+
+    /// data plane if we want to access the knowledge base
+    madara::knowledge::KnowledgeBase data_;
+  };
+} // end namespace threads
+
+#endif // _THREAD_SHAPERFLUSH_H_
@@ -0,0 +1,220 @@
+
+#include "InProcessTransport.h"
+
+#include <algorithm>
+#include <map>
+
+#include "madara/transport/MessageHeader.h"
+#include "gams/loggers/GlobalLogger.h"
+
+namespace knowledge = madara::knowledge;
+
+struct transports::InProcessTransport::Member
+{
+  /// held while delivering to agent
+  std::mutex mutex;
+
+  /// the agent, or 0 once it has left the bus
+  InProcessTransport * agent;
+};
+
+typedef std::vector <std::shared_ptr <
+  transports::InProcessTransport::Member> > Members;
+
+// the agents on each bus, by bus name. A list is never changed once it
+// is on the map, so senders can use it after releasing the lock.
+static std::mutex buses_mutex;
+static std::map <std::string, std::shared_ptr <const Members> > buses;
+
+// constructor
+transports::InProcessTransport::InProcessTransport (
+  const std::string & id,
+  madara::transport::TransportSettings & new_settings,
+  knowledge::KnowledgeBase & knowledge,
+  utility::TaskScheduler & scheduler)
+: madara::transport::Base (id, new_settings, knowledge.get_context ()),
+  bus_ ("inproc"), member_ (new Member),
+  scheduler_ (scheduler), knowledge_ (knowledge),
+  inbox_bytes_ (0), draining_ (false), closed_ (false), drops_ (0)
+{
+  // populate variables like buffer_ based on transport settings
+  Base::setup ();
+
+  if (settings_.hosts.size () > 0 && settings_.hosts[0] != "")
+    bus_ = settings_.hosts[0];
+
+  if (settings_.on_data_received_logic.length () != 0)
+    on_data_received_ = knowledge_.compile (settings_.on_data_received_logic);
+
+  member_->agent = this;
+
+  std::lock_guard <std::mutex> guard (buses_mutex);
+  std::shared_ptr <const Members> & members = buses[bus_];
+  std::shared_ptr <Members> joined (
+    members ? new Members (*members) : new Members ());
+  joined->push_back (member_);
+  members = joined;
+}
+
+// destructor
+transports::InProcessTransport::~InProcessTransport ()
+{
+  close ();
+}
+
+void
+transports::InProcessTransport::close (void)
+{
+  this->invalidate_transport ();
+
+  // once off the bus, new sends do not see us
+  {
+    std::lock_guard <std::mutex> guard (buses_mutex);
+    std::shared_ptr <const Members> & members = buses[bus_];
+    if (members)
+    {
+      std::shared_ptr <Members> left (new Members (*members));
+      left->erase (std::remove (left->begin (), left->end (), member_),
+        left->end ());
+      members = left;
+    }
+  }
+
+  // and once a send in flight with an older snapshot is done with us, no
+  // other agent can deliver to us
+  {
+    std::lock_guard <std::mutex> guard (member_->mutex);
+    member_->agent = 0;
+  }
+
+  std::unique_lock <std::mutex> lock (mutex_);
+  closed_ = true;
+  while (draining_)
+  {
+    drained_.wait (lock);
+  }
+  inbox_.clear ();
+  inbox_bytes_ = 0;
+}
+
+bool
+transports::InProcessTransport::deliver (const Message & message)
+{
+  bool schedule = false;
+  {
+    std::lock_guard <std::mutex> guard (mutex_);
+    if (closed_)
+      return false;
+
+    if (inbox_bytes_ + message->size () > settings_.queue_length &&
+      !inbox_.empty ())
+    {
+      ++drops_;
+      return false;
+    }
+
+    inbox_.push_back (message);
+    inbox_bytes_ += message->size ();
+
+    if (!draining_)
+    {
+      draining_ = true;
+      schedule = true;
+    }
+  }
+
+  if (schedule)
+    scheduler_.submit ([this] () { drain (); });
+
+  return true;
+}
+
+void
+transports::InProcessTransport::drain (void)
+{
+  const char * print_prefix = "InProcessTransport::drain";
+
+  std::deque <Message> messages;
+  for (;;)
+  {
+    {
+      std::lock_guard <std::mutex> guard (mutex_);
+      if (inbox_.empty () || closed_)
+      {
+        draining_ = false;
+        drained_.notify_all ();
+        return;
+      }
+
+      messages.swap (inbox_);
+      inbox_bytes_ = 0;
+    }
+
+    for (size_t i = 0; i < messages.size (); ++i)
+    {
+      // every agent on the bus hears every other directly, so there is
+      // nothing to rebroadcast
+      madara::transport::MessageHeader * header = 0;
+      knowledge::KnowledgeMap rebroadcast_records;
+
+      madara::transport::process_received_update (messages[i]->data (),
+        (uint32_t)messages[i]->size (), id_, knowledge_.get_context (),
+        settings_, send_monitor_, receive_monitor_, rebroadcast_records,
+        on_data_received_, print_prefix, "inproc", header);
+
+      delete header;
+    }
+    messages.clear ();
+  }
+}
+
+uint64_t
+transports::InProcessTransport::get_drops (void) const
+{
+  return drops_;
+}
+
+long
+transports::InProcessTransport::send_data (
+  const knowledge::KnowledgeRecords & orig_updates)
+{
+  const char * print_prefix = "InProcessTransport::send_data";
+
+  // filters and serializes the updates into buffer_
+  long result = prep_send (orig_updates, print_prefix);
+
+  if (result > 0)
+  {
+    const Message message (
+      new std::vector <char> (buffer_.get_ptr (), buffer_.get_ptr () + result));
+
+    std::shared_ptr <const Members> members;
+    {
+      std::lock_guard <std::mutex> guard (buses_mutex);
+      members = buses[bus_];
+    }
+
+    size_t dropped = 0;
+    for (size_t i = 0; members && i < members->size (); ++i)
+    {
+      Member & member = *(*members)[i];
+      if (&member == member_.get ())
+        continue;
+
+      std::lock_guard <std::mutex> guard (member.mutex);
+      if (member.agent && !member.agent->deliver (message))
+        ++dropped;
+    }
+    send_monitor_.add ((uint32_t)result);
+
+    if (dropped > 0)
+    {
+      madara_logger_ptr_log (gams::loggers::global_logger.get (),
+        gams::loggers::LOG_MINOR,
+        "transports::InProcessTransport::send_data:"
+        " %d inboxes were full\n", (int)dropped);
+    }
+  }
+
+  return result;
+}
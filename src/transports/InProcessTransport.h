@@ -0,0 +1,135 @@
+#ifndef   _TRANSPORT_INPROCESSTRANSPORT_H_
+#define   _TRANSPORT_INPROCESSTRANSPORT_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeBase.h"
+#include "madara/transport/Transport.h"
+#include "../utility/TaskScheduler.h"
+
+namespace transports
+{
+  /**
+  * Transport between agents hosted in one process. Updates are serialized
+  * once per send and the same buffer is queued to every other agent on
+  * the bus, named by settings.hosts[0]. Nothing is copied or sent through
+  * the kernel.
+  *
+  * There is no read thread: the first message queued to an empty inbox
+  * submits a task to the shared scheduler that processes the inbox until
+  * it is empty, so hundreds of agents need no threads of their own. Each
+  * inbox holds up to settings.queue_length bytes, and messages that do
+  * not fit are dropped, as with a full socket buffer.
+  *
+  * Senders take a snapshot of the bus and deliver outside the bus lock,
+  * so a slow inbox does not hold up other agents joining, leaving or
+  * sending.
+  **/
+  class InProcessTransport : public madara::transport::Base
+  {
+  public:
+    /**
+     * A serialized update, shared by every inbox it is queued to
+     **/
+    typedef std::shared_ptr <const std::vector <char> > Message;
+
+    /**
+     * An agent's place on a bus. Senders hold it while delivering, so an
+     * agent can leave the bus while a send is in flight.
+     **/
+    struct Member;
+
+    /**
+     * Constructor
+     * @param   id                unique identifier (generally host:port)
+     * @param   new_settings      settings to apply to the transport
+     * @param   knowledge         the knowledge base
+     * @param   scheduler         runs the processing of received updates.
+     *                            Must outlive the transport.
+     **/
+    InProcessTransport (const std::string & id,
+      madara::transport::TransportSettings & new_settings,
+      madara::knowledge::KnowledgeBase & knowledge,
+      utility::TaskScheduler & scheduler);
+
+    /**
+     * Destructor
+     **/
+    virtual ~InProcessTransport ();
+
+    /**
+     * Sends a list of updates to the other agents on the bus
+     * @param  modifieds  a list of keys to values of all records that have
+     *          been updated and could be sent.
+     * @return  bytes sent, or -1 if we are shutting down
+     **/
+    virtual long send_data (
+      const madara::knowledge::KnowledgeRecords & modifieds);
+
+    /**
+     * Leaves the bus and waits for received updates being processed
+     **/
+    virtual void close (void);
+
+    /**
+     * Queues a message to our inbox. Called by other agents' sends.
+     * @param  message   the message
+     * @return false if the inbox was full or closed
+     **/
+    bool deliver (const Message & message);
+
+    /**
+     * Returns the messages dropped because our inbox was full
+     * @return drops
+     **/
+    uint64_t get_drops (void) const;
+
+  protected:
+    /**
+     * Processes queued messages until the inbox is empty
+     **/
+    void drain (void);
+
+    /// name of the bus
+    std::string bus_;
+
+    /// our place on the bus
+    std::shared_ptr <Member> member_;
+
+    /// runs drain
+    utility::TaskScheduler & scheduler_;
+
+    /// the knowledge base updates are applied to
+    madara::knowledge::KnowledgeBase knowledge_;
+
+    /// logic to run when data is received
+    madara::knowledge::CompiledExpression on_data_received_;
+
+    /// protects the inbox, and signals the end of a drain
+    std::mutex mutex_;
+    std::condition_variable drained_;
+
+    /// received messages and their total bytes
+    std::deque <Message> inbox_;
+    size_t inbox_bytes_;
+
+    /// true while a drain is queued or running
+    bool draining_;
+
+    /// true once closed
+    bool closed_;
+
+    /// messages dropped for a full inbox
+    std::atomic <uint64_t> drops_;
+  };
+} // end namespace transports
+
+#endif // _TRANSPORT_INPROCESSTRANSPORT_H_
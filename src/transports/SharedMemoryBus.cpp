@@ -0,0 +1,467 @@
+
+#include "SharedMemoryBus.h"
+
+#include <chrono>
+#include <thread>
+#include <string.h>
+
+#if defined (__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "gams/loggers/GlobalLogger.h"
+
+// identifies a bus segment and its layout version
+static const uint32_t MAGIC (0x52424d53);
+static const uint32_t VERSION (1);
+
+// length of the marker that sends the reader back to the ring start
+static const uint32_t WRAP (0xffffffff);
+
+// permissions of the segment: its owner only
+static const int MODE (0600);
+
+// inbox states
+enum
+{
+  UNUSED = 0,
+  CLAIMING = 1,
+  ACTIVE = 2,
+  CLOSED = 3
+};
+
+/**
+ * Rounds a size up to a multiple of 8
+ **/
+static inline uint64_t
+align (uint64_t size)
+{
+  return (size + 7) & ~(uint64_t)7;
+}
+
+struct transports::SharedMemoryBus::Header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slots;
+  uint32_t ring_bytes;
+
+  /// set once the creator has written the layout
+  std::atomic <uint32_t> ready;
+};
+
+struct transports::SharedMemoryBus::Ring
+{
+  /// inbox state and the process that owns it
+  std::atomic <uint32_t> state;
+  std::atomic <int32_t> pid;
+
+#if defined (__linux__)
+  /// serializes writers
+  pthread_mutex_t mutex;
+#endif
+
+  /// bytes ever written and read. Only the owner moves tail.
+  std::atomic <uint64_t> head;
+  std::atomic <uint64_t> tail;
+
+  /// futex word bumped by every write, and whether the owner sleeps on it
+  std::atomic <uint32_t> signal;
+  std::atomic <uint32_t> waiting;
+
+  /// start of the messages, each a uint32 length and its bytes
+  unsigned char * data (void)
+  {
+    return (unsigned char *)this + align (sizeof (Ring));
+  }
+};
+
+#if defined (__linux__)
+
+/**
+ * Returns true if a process exists
+ **/
+static bool
+is_alive (int32_t pid)
+{
+  return pid > 0 && (kill (pid, 0) == 0 || errno == EPERM);
+}
+
+/**
+ * Takes a robust mutex, recovering it if its holder died
+ **/
+static void
+lock (pthread_mutex_t * mutex)
+{
+  // writers only publish a message by moving head, so a dead writer
+  // leaves the ring consistent
+  if (pthread_mutex_lock (mutex) == EOWNERDEAD)
+    pthread_mutex_consistent (mutex);
+}
+
+#endif
+
+transports::SharedMemoryBus::SharedMemoryBus ()
+: header_ (0), size_ (0), slots_ (0), ring_bytes_ (0), stride_ (0),
+  slot_ (0), peeked_ (0), drops_ (0)
+{
+}
+
+transports::SharedMemoryBus::~SharedMemoryBus ()
+{
+  close ();
+}
+
+transports::SharedMemoryBus::Ring *
+transports::SharedMemoryBus::get_ring (uint32_t slot) const
+{
+  return (Ring *)((char *)header_ + align (sizeof (Header)) +
+    (size_t)slot * stride_);
+}
+
+bool
+transports::SharedMemoryBus::is_open (void) const
+{
+  return header_ != 0;
+}
+
+uint64_t
+transports::SharedMemoryBus::get_drops (void) const
+{
+  return drops_;
+}
+
+bool
+transports::SharedMemoryBus::open (const std::string & name,
+  uint32_t slots, uint32_t ring_bytes, uint32_t slot)
+{
+  close ();
+
+#if defined (__linux__)
+  if (slot >= slots)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "transports::SharedMemoryBus::open:"
+      " slot %d is not below the %d slots of %s\n",
+      (int)slot, (int)slots, name.c_str ());
+    return false;
+  }
+
+  slots_ = slots;
+  ring_bytes_ = (uint32_t)align (ring_bytes);
+  slot_ = slot;
+  stride_ = align (sizeof (Ring)) + ring_bytes_;
+  size_ = align (sizeof (Header)) + slots_ * stride_;
+
+  const std::string path = "/" + name;
+  bool creator = true;
+  int fd = shm_open (path.c_str (), O_RDWR | O_CREAT | O_EXCL, MODE);
+  if (fd < 0 && errno == EEXIST)
+  {
+    creator = false;
+    fd = shm_open (path.c_str (), O_RDWR, MODE);
+  }
+
+  struct stat status;
+  if (fd < 0 || (creator && ftruncate (fd, size_) != 0) ||
+    fstat (fd, &status) != 0)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "transports::SharedMemoryBus::open:"
+      " unable to open %s: %s\n", path.c_str (), strerror (errno));
+    if (fd >= 0)
+      ::close (fd);
+    return false;
+  }
+
+  // a segment left by an older build may be open to everyone
+  if ((status.st_mode & 0777) != MODE && status.st_uid == geteuid ())
+    fchmod (fd, MODE);
+
+  // the creator may not have sized it yet
+  for (int i = 0; i < 100 && (size_t)status.st_size < size_; ++i)
+  {
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    fstat (fd, &status);
+  }
+
+  void * address = MAP_FAILED;
+  if ((size_t)status.st_size >= size_)
+    address = mmap (0, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close (fd);
+
+  if (address == MAP_FAILED)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "transports::SharedMemoryBus::open:"
+      " %s is smaller than %d slots of %d bytes\n",
+      path.c_str (), (int)slots_, (int)ring_bytes_);
+    return false;
+  }
+
+  header_ = (Header *)address;
+
+  if (creator)
+  {
+    header_->magic = MAGIC;
+    header_->version = VERSION;
+    header_->slots = slots_;
+    header_->ring_bytes = ring_bytes_;
+    header_->ready.store (1, std::memory_order_release);
+  }
+  else
+  {
+    for (int i = 0; i < 100 && !header_->ready.load (); ++i)
+    {
+      std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    }
+  }
+
+  if (!header_->ready.load (std::memory_order_acquire) ||
+    header_->magic != MAGIC || header_->version != VERSION ||
+    header_->slots != slots_ || header_->ring_bytes != ring_bytes_)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "transports::SharedMemoryBus::open:"
+      " %s has a different layout. Remove it from /dev/shm or use"
+      " another name.\n", path.c_str ());
+    munmap (header_, size_);
+    header_ = 0;
+    return false;
+  }
+
+  if (!claim ())
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "transports::SharedMemoryBus::open:"
+      " slot %d of %s belongs to running process %d\n",
+      (int)slot_, path.c_str (), (int)get_ring (slot_)->pid.load ());
+    munmap (header_, size_);
+    header_ = 0;
+    return false;
+  }
+
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_MAJOR,
+    "transports::SharedMemoryBus::open:"
+    " claimed slot %d of %s (%d slots of %d bytes)\n",
+    (int)slot_, path.c_str (), (int)slots_, (int)ring_bytes_);
+
+  return true;
+#else
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_ERROR,
+    "transports::SharedMemoryBus::open:"
+    " shared memory transport is only available on Linux\n");
+  return false;
+#endif
+}
+
+bool
+transports::SharedMemoryBus::claim (void)
+{
+#if defined (__linux__)
+  Ring * ring = get_ring (slot_);
+
+  uint32_t state = ring->state.load ();
+  if (state == ACTIVE && is_alive (ring->pid))
+    return false;
+
+  // another process may be claiming it at the same time
+  if (state == CLAIMING ||
+    !ring->state.compare_exchange_strong (state, CLAIMING))
+    return false;
+
+  if (state == UNUSED)
+  {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init (&attributes);
+    pthread_mutexattr_setpshared (&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust (&attributes, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init (&ring->mutex, &attributes);
+    pthread_mutexattr_destroy (&attributes);
+  }
+
+  // drop what was sent to the last owner
+  lock (&ring->mutex);
+  ring->head.store (0);
+  ring->tail.store (0);
+  ring->waiting.store (0);
+  ring->pid.store (getpid ());
+  ring->state.store (ACTIVE);
+  pthread_mutex_unlock (&ring->mutex);
+
+  peeked_ = 0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+transports::SharedMemoryBus::close (void)
+{
+#if defined (__linux__)
+  if (header_)
+  {
+    Ring * ring = get_ring (slot_);
+    if (ring->pid.load () == getpid ())
+      ring->state.store (CLOSED);
+
+    munmap (header_, size_);
+    header_ = 0;
+  }
+#endif
+}
+
+size_t
+transports::SharedMemoryBus::send (const char * buffer, uint32_t size)
+{
+  size_t result = 0;
+
+#if defined (__linux__)
+  if (!header_)
+    return 0;
+
+  const uint64_t bytes = align (sizeof (uint32_t) + size);
+
+  for (uint32_t i = 0; i < slots_; ++i)
+  {
+    Ring * ring = get_ring (i);
+    if (i == slot_ || ring->state.load () != ACTIVE)
+      continue;
+
+    lock (&ring->mutex);
+
+    // the inbox may have closed while we waited
+    if (ring->state.load () != ACTIVE)
+    {
+      pthread_mutex_unlock (&ring->mutex);
+      continue;
+    }
+
+    uint64_t head = ring->head.load (std::memory_order_relaxed);
+    const uint64_t used = head - ring->tail.load (std::memory_order_acquire);
+    const uint64_t offset = head % ring_bytes_;
+
+    // messages are contiguous, so one that would cross the end starts
+    // over at the beginning
+    const uint64_t skip = ring_bytes_ - offset < bytes ?
+      ring_bytes_ - offset : 0;
+
+    if (used + skip + bytes > ring_bytes_)
+    {
+      pthread_mutex_unlock (&ring->mutex);
+      ++drops_;
+      continue;
+    }
+
+    unsigned char * data = ring->data ();
+    if (skip)
+    {
+      memcpy (data + offset, &WRAP, sizeof (uint32_t));
+      head += skip;
+    }
+
+    const uint64_t start = head % ring_bytes_;
+    memcpy (data + start, &size, sizeof (uint32_t));
+    memcpy (data + start + sizeof (uint32_t), buffer, size);
+    ring->head.store (head + bytes, std::memory_order_release);
+
+    pthread_mutex_unlock (&ring->mutex);
+
+    ring->signal.fetch_add (1);
+    if (ring->waiting.load ())
+      syscall (SYS_futex, &ring->signal, FUTEX_WAKE, 1, 0, 0, 0);
+
+    ++result;
+  }
+#endif
+
+  return result;
+}
+
+const char *
+transports::SharedMemoryBus::peek (uint32_t & size)
+{
+  if (!header_)
+    return 0;
+
+  Ring * ring = get_ring (slot_);
+  unsigned char * data = ring->data ();
+
+  uint64_t tail = ring->tail.load (std::memory_order_relaxed);
+  const uint64_t head = ring->head.load (std::memory_order_acquire);
+
+  while (tail != head)
+  {
+    const uint64_t offset = tail % ring_bytes_;
+    memcpy (&size, data + offset, sizeof (uint32_t));
+
+    if (size != WRAP)
+    {
+      peeked_ = align (sizeof (uint32_t) + size);
+      return (const char *)data + offset + sizeof (uint32_t);
+    }
+
+    tail += ring_bytes_ - offset;
+    ring->tail.store (tail, std::memory_order_release);
+  }
+
+  return 0;
+}
+
+void
+transports::SharedMemoryBus::pop (void)
+{
+  if (!header_ || !peeked_)
+    return;
+
+  Ring * ring = get_ring (slot_);
+  ring->tail.store (ring->tail.load (std::memory_order_relaxed) + peeked_,
+    std::memory_order_release);
+  peeked_ = 0;
+}
+
+bool
+transports::SharedMemoryBus::wait (int64_t timeout)
+{
+  if (!header_)
+    return false;
+
+  Ring * ring = get_ring (slot_);
+
+#if defined (__linux__)
+  // a write after the head check changes the signal, so the futex does
+  // not sleep through it
+  ring->waiting.store (1);
+  const uint32_t signal = ring->signal.load ();
+
+  if (ring->head.load () == ring->tail.load (std::memory_order_relaxed))
+  {
+    timespec duration;
+    duration.tv_sec = (time_t)(timeout / 1000000000);
+    duration.tv_nsec = (long)(timeout % 1000000000);
+    syscall (SYS_futex, &ring->signal, FUTEX_WAIT, signal, &duration, 0, 0);
+  }
+
+  ring->waiting.store (0);
+#endif
+
+  return ring->head.load (std::memory_order_acquire) !=
+    ring->tail.load (std::memory_order_relaxed);
+}
@@ -0,0 +1,136 @@
+#ifndef   _TRANSPORT_SHAREDMEMORYBUS_H_
+#define   _TRANSPORT_SHAREDMEMORYBUS_H_
+
+#include <atomic>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace transports
+{
+  /**
+  * A named POSIX shared memory segment holding one inbox ring per agent
+  * on the host. Any agent can append a message to every other agent's
+  * ring, and only the owner reads its own, in place. Writers to a ring
+  * take its process-shared robust mutex, so a writer that dies is
+  * recovered from. The reader sleeps on a futex that writers wake only
+  * when it is waiting. A message that does not fit in a ring is dropped
+  * for that ring, as with a full socket buffer.
+  *
+  * The slot is the agent id, so every agent on a bus needs a distinct id
+  * below the number of slots. Slots of agents that exited without
+  * closing are reclaimed once their process is gone. The segment stays
+  * in /dev/shm after the last agent closes, and is reused if its layout
+  * matches. It is readable and writable by its owner only, since anyone
+  * who can open it can read and forge every agent's messages, so every
+  * agent on a bus must run as the same user. Only available on Linux.
+  **/
+  class SharedMemoryBus
+  {
+  public:
+    /// slots of a bus unless configured
+    static const uint32_t DEFAULT_SLOTS = 64;
+
+    /**
+     * Constructor
+     **/
+    SharedMemoryBus ();
+
+    /**
+     * Destructor, which closes the bus
+     **/
+    ~SharedMemoryBus ();
+
+    /**
+     * Opens or creates a bus and claims a slot in it
+     * @param  name        segment name, without the leading /
+     * @param  slots       number of agents the bus holds
+     * @param  ring_bytes  bytes of each inbox
+     * @param  slot        our slot
+     * @return true if the slot was claimed
+     **/
+    bool open (const std::string & name, uint32_t slots,
+      uint32_t ring_bytes, uint32_t slot);
+
+    /**
+     * Releases our slot and unmaps the bus
+     **/
+    void close (void);
+
+    /**
+     * Appends a message to the inbox of every other agent
+     * @param  buffer  the message
+     * @param  size    bytes of the message
+     * @return number of inboxes it was appended to
+     **/
+    size_t send (const char * buffer, uint32_t size);
+
+    /**
+     * Returns the oldest message in our inbox without copying it. It
+     * stays valid until pop.
+     * @param  size    bytes of the message
+     * @return the message, or 0 if the inbox is empty
+     **/
+    const char * peek (uint32_t & size);
+
+    /**
+     * Removes the message returned by peek
+     **/
+    void pop (void);
+
+    /**
+     * Waits for a message in our inbox
+     * @param  timeout  most nanoseconds to wait
+     * @return true if the inbox is not empty
+     **/
+    bool wait (int64_t timeout);
+
+    /**
+     * Returns true if a slot is claimed
+     **/
+    bool is_open (void) const;
+
+    /**
+     * Returns messages that did not fit in another agent's inbox
+     **/
+    uint64_t get_drops (void) const;
+
+  protected:
+    /// the bus header and an inbox, which live in shared memory
+    struct Header;
+    struct Ring;
+
+    /**
+     * Returns the inbox of a slot
+     * @param  slot    the slot
+     **/
+    Ring * get_ring (uint32_t slot) const;
+
+    /**
+     * Claims our inbox, reclaiming it if its last owner is gone
+     * @return true if the slot was claimed
+     **/
+    bool claim (void);
+
+    /// the mapped segment and its size
+    Header * header_;
+    size_t size_;
+
+    /// layout
+    uint32_t slots_;
+    uint32_t ring_bytes_;
+    size_t stride_;
+
+    /// our slot
+    uint32_t slot_;
+
+    /// the size of the message returned by peek, in the ring
+    uint64_t peeked_;
+
+    /// messages that did not fit in an inbox
+    std::atomic <uint64_t> drops_;
+  };
+
+} // end transports namespace
+
+#endif // _TRANSPORT_SHAREDMEMORYBUS_H_
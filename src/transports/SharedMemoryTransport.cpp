@@ -0,0 +1,102 @@
+
+#include "SharedMemoryTransport.h"
+#include "SharedMemoryTransportReadThread.h"
+
+#include <sstream>
+
+#include "gams/loggers/GlobalLogger.h"
+
+namespace knowledge = madara::knowledge;
+
+// constructor
+transports::SharedMemoryTransport::SharedMemoryTransport (
+  const std::string & id,
+  madara::transport::TransportSettings & new_settings,
+  knowledge::KnowledgeBase & knowledge)
+: madara::transport::Base (id, new_settings, knowledge.get_context ())
+{
+  // populate variables like buffer_ based on transport settings
+  Base::setup ();
+
+  // the bus is name[:slots]
+  std::string name ("madara_shm");
+  uint32_t slots (SharedMemoryBus::DEFAULT_SLOTS);
+  if (settings_.hosts.size () > 0 && settings_.hosts[0] != "")
+  {
+    name = settings_.hosts[0];
+
+    const size_t colon = name.find (':');
+    if (colon != std::string::npos)
+    {
+      std::stringstream buffer (name.substr (colon + 1));
+      buffer >> slots;
+      name.resize (colon);
+    }
+  }
+
+  if (!bus_.open (name, slots, settings_.queue_length, settings_.id))
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "transports::SharedMemoryTransport:"
+      " unable to join bus %s as agent %d. Not sending or receiving.\n",
+      name.c_str (), (int)settings_.id);
+    return;
+  }
+
+  // set the data plane for the read thread
+  threader_.set_data_plane (knowledge);
+
+  // the read thread waits on the bus, so it runs as fast as it is woken
+  threader_.run (0.0, "read",
+    new SharedMemoryTransportReadThread (
+      id_, settings_, bus_, send_monitor_, receive_monitor_));
+}
+
+// destructor
+transports::SharedMemoryTransport::~SharedMemoryTransport ()
+{
+  close ();
+}
+
+void
+transports::SharedMemoryTransport::close (void)
+{
+  this->invalidate_transport ();
+
+  threader_.terminate ();
+  threader_.wait ();
+
+  bus_.close ();
+}
+
+long
+transports::SharedMemoryTransport::send_data (
+  const knowledge::KnowledgeRecords & orig_updates)
+{
+  const char * print_prefix = "SharedMemoryTransport::send_data";
+
+  if (!bus_.is_open ())
+    return -1;
+
+  // filters and serializes the updates into buffer_
+  long result = prep_send (orig_updates, print_prefix);
+
+  if (result > 0)
+  {
+    const uint64_t drops = bus_.get_drops ();
+    bus_.send (buffer_.get_ptr (), (uint32_t)result);
+    send_monitor_.add ((uint32_t)result);
+
+    if (bus_.get_drops () != drops)
+    {
+      madara_logger_ptr_log (gams::loggers::global_logger.get (),
+        gams::loggers::LOG_MINOR,
+        "transports::SharedMemoryTransport::send_data:"
+        " %d inboxes were full, %d messages dropped so far\n",
+        (int)(bus_.get_drops () - drops), (int)bus_.get_drops ());
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,63 @@
+#ifndef   _TRANSPORT_SHAREDMEMORYTRANSPORT_H_
+#define   _TRANSPORT_SHAREDMEMORYTRANSPORT_H_
+
+#include <string>
+
+#include "madara/knowledge/KnowledgeBase.h"
+#include "madara/threads/Threader.h"
+#include "madara/transport/Transport.h"
+#include "SharedMemoryBus.h"
+
+namespace transports
+{
+  /**
+  * Transport for agents on one host, over a SharedMemoryBus instead of
+  * the network stack. Updates are serialized once per send and appended
+  * to every other agent's inbox, and a read thread processes its own
+  * inbox in place. The bus is named by settings.hosts[0], optionally
+  * followed by :slots, and each inbox holds settings.queue_length bytes.
+  * Our slot is settings.id.
+  **/
+  class SharedMemoryTransport : public madara::transport::Base
+  {
+  public:
+    /**
+     * Constructor
+     * @param   id                unique identifier (generally host:port)
+     * @param   new_settings      settings to apply to the transport
+     * @param   knowledge         the knowledge base
+     **/
+    SharedMemoryTransport (const std::string & id,
+      madara::transport::TransportSettings & new_settings,
+      madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+     * Destructor
+     **/
+    virtual ~SharedMemoryTransport ();
+
+    /**
+     * Sends a list of updates to the other agents on the bus
+     * @param  modifieds  a list of keys to values of all records that have
+     *          been updated and could be sent.
+     * @return  bytes sent, or -1 if we are shutting down or the bus is
+     *          not open
+     **/
+    virtual long send_data (
+      const madara::knowledge::KnowledgeRecords & modifieds);
+
+    /**
+     * Stops the read thread and releases our inbox
+     **/
+    virtual void close (void);
+
+  protected:
+    /// the bus
+    SharedMemoryBus bus_;
+
+    /// runs the read thread
+    madara::threads::Threader threader_;
+  };
+} // end namespace transports
+
+#endif // _TRANSPORT_SHAREDMEMORYTRANSPORT_H_
@@ -0,0 +1,62 @@
+
+#include "SharedMemoryTransportReadThread.h"
+
+#include "madara/transport/MessageHeader.h"
+
+namespace knowledge = madara::knowledge;
+
+// nanoseconds to wait for a message before checking for termination
+static const int64_t WAIT_TIMEOUT (100000000);
+
+// constructor
+transports::SharedMemoryTransportReadThread::SharedMemoryTransportReadThread (
+  const std::string & id,
+  const madara::transport::QoSTransportSettings & settings,
+  SharedMemoryBus & bus,
+  madara::transport::BandwidthMonitor & send_monitor,
+  madara::transport::BandwidthMonitor & receive_monitor)
+: id_ (id), settings_ (settings), bus_ (bus),
+  send_monitor_ (send_monitor), receive_monitor_ (receive_monitor)
+{
+}
+
+// destructor
+transports::SharedMemoryTransportReadThread::~SharedMemoryTransportReadThread ()
+{
+}
+
+void
+transports::SharedMemoryTransportReadThread::init (
+  knowledge::KnowledgeBase & knowledge)
+{
+  // point our data plane to the knowledge base initializing the thread
+  data_ = knowledge;
+
+  if (settings_.on_data_received_logic.length () != 0)
+    on_data_received_ = data_.compile (settings_.on_data_received_logic);
+}
+
+void
+transports::SharedMemoryTransportReadThread::run (void)
+{
+  const char * print_prefix = "SharedMemoryTransportReadThread::run";
+
+  if (!bus_.wait (WAIT_TIMEOUT))
+    return;
+
+  uint32_t size;
+  while (const char * buffer = bus_.peek (size))
+  {
+    // every agent on the bus hears every other directly, so there is
+    // nothing to rebroadcast
+    madara::transport::MessageHeader * header = 0;
+    knowledge::KnowledgeMap rebroadcast_records;
+
+    madara::transport::process_received_update (buffer, size, id_,
+      data_.get_context (), settings_, send_monitor_, receive_monitor_,
+      rebroadcast_records, on_data_received_, print_prefix, "shm", header);
+
+    delete header;
+    bus_.pop ();
+  }
+}
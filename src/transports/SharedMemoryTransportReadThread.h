@@ -0,0 +1,73 @@
+#ifndef   _TRANSPORT_SHAREDMEMORYTRANSPORTREADTHREAD_H_
+#define   _TRANSPORT_SHAREDMEMORYTRANSPORTREADTHREAD_H_
+
+#include <string>
+
+#include "madara/knowledge/KnowledgeBase.h"
+#include "madara/threads/BaseThread.h"
+#include "madara/transport/Transport.h"
+#include "SharedMemoryBus.h"
+
+namespace transports
+{
+  /**
+  * Processes the updates in our SharedMemoryBus inbox, in place. Each run
+  * drains the inbox, then sleeps until a message arrives or a tenth of a
+  * second passes, so termination is noticed.
+  **/
+  class SharedMemoryTransportReadThread : public madara::threads::BaseThread
+  {
+  public:
+    /**
+     * Constructor
+     * @param    id                unique identifier of the transport
+     * @param    settings          transport settings, including filters
+     * @param    bus               the bus to read from
+     * @param    send_monitor      monitor for enforcing send limits
+     * @param    receive_monitor   monitor for enforcing receive limits
+     **/
+    SharedMemoryTransportReadThread (const std::string & id,
+      const madara::transport::QoSTransportSettings & settings,
+      SharedMemoryBus & bus,
+      madara::transport::BandwidthMonitor & send_monitor,
+      madara::transport::BandwidthMonitor & receive_monitor);
+
+    /**
+     * Destructor
+     **/
+    virtual ~SharedMemoryTransportReadThread ();
+
+    /**
+      * Initializes thread with MADARA context
+      * @param   knowledge   context for querying current program state
+      **/
+    virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+      * Executes the main thread logic
+      **/
+    virtual void run (void);
+
+  protected:
+    /// unique identifier of the transport
+    const std::string id_;
+
+    /// transport settings, including filters
+    const madara::transport::QoSTransportSettings settings_;
+
+    /// the bus
+    SharedMemoryBus & bus_;
+
+    /// data plane if we want to access the knowledge base
+    madara::knowledge::KnowledgeBase data_;
+
+    /// logic to run when data is received
+    madara::knowledge::CompiledExpression on_data_received_;
+
+    /// monitors for enforcing bandwidth limits
+    madara::transport::BandwidthMonitor & send_monitor_;
+    madara::transport::BandwidthMonitor & receive_monitor_;
+  };
+} // end namespace transports
+
+#endif // _TRANSPORT_SHAREDMEMORYTRANSPORTREADTHREAD_H_
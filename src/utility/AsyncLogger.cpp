@@ -0,0 +1,316 @@
+
+#include "AsyncLogger.h"
+#include "Clock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+std::atomic <bool> utility::AsyncLogger::running_ (false);
+
+/**
+ * The queued records of one thread. The owning thread advances head and
+ * the background thread advances tail.
+ **/
+struct LogRing
+{
+  std::vector <utility::LogRecord> records;
+  std::atomic <uint64_t> head;
+  std::atomic <uint64_t> tail;
+  std::atomic <uint64_t> drops;
+};
+
+// every ring ever created. Rings are never freed, so a thread may exit
+// with records still queued.
+static std::mutex rings_mutex;
+static std::vector <std::unique_ptr <LogRing> > rings;
+
+// records per ring, and seconds between drains
+static std::atomic <size_t> capacity (1024);
+static double period (0.01);
+
+// the background thread
+static std::mutex thread_mutex;
+static std::thread writer;
+static std::atomic <bool> stopping (false);
+
+// the calling thread's ring
+static thread_local LogRing * local_ring (0);
+
+// drops already reported
+static uint64_t reported_drops (0);
+
+/**
+ * Returns the calling thread's ring, creating it on first use
+ **/
+static LogRing &
+get_ring (void)
+{
+  if (!local_ring)
+  {
+    std::unique_ptr <LogRing> ring (new LogRing ());
+    ring->records.resize (std::max (capacity.load (), (size_t)1));
+    ring->head = 0;
+    ring->tail = 0;
+    ring->drops = 0;
+
+    std::lock_guard <std::mutex> guard (rings_mutex);
+    local_ring = ring.get ();
+    rings.push_back (std::move (ring));
+  }
+
+  return *local_ring;
+}
+
+/**
+ * Formats and writes every queued record, oldest first
+ **/
+static void
+drain (void)
+{
+  std::vector <utility::LogRecord> records;
+  uint64_t drops = 0;
+
+  {
+    std::lock_guard <std::mutex> guard (rings_mutex);
+    for (size_t i = 0; i < rings.size (); ++i)
+    {
+      LogRing & ring = *rings[i];
+      const uint64_t head = ring.head.load (std::memory_order_acquire);
+      uint64_t tail = ring.tail.load (std::memory_order_relaxed);
+
+      for (; tail < head; ++tail)
+      {
+        records.push_back (ring.records[tail % ring.records.size ()]);
+      }
+
+      // free the slots for the owning thread
+      ring.tail.store (tail, std::memory_order_release);
+      drops += ring.drops.load (std::memory_order_relaxed);
+    }
+  }
+
+  std::stable_sort (records.begin (), records.end (),
+    [] (const utility::LogRecord & lhs, const utility::LogRecord & rhs)
+    {
+      return lhs.timestamp < rhs.timestamp;
+    });
+
+  for (size_t i = 0; i < records.size (); ++i)
+  {
+    gams::loggers::global_logger->log (records[i].level, "%s",
+      records[i].to_string ().c_str ());
+  }
+
+  if (drops > reported_drops)
+  {
+    gams::loggers::global_logger->log (gams::loggers::LOG_WARNING,
+      "utility::AsyncLogger::drain:"
+      " dropped %llu records (%llu total). Rings were full.\n",
+      (unsigned long long)(drops - reported_drops),
+      (unsigned long long)drops);
+    reported_drops = drops;
+  }
+}
+
+/**
+ * Drains the rings until stopped
+ **/
+static void
+write_loop (void)
+{
+  const std::chrono::nanoseconds sleep_time ((int64_t)(period * 1e9));
+
+  while (!stopping)
+  {
+    std::this_thread::sleep_for (sleep_time);
+    drain ();
+  }
+}
+
+std::string
+utility::LogRecord::to_string (void) const
+{
+  std::string result;
+  int index = 0;
+  char buffer[512];
+
+  for (const char * cursor = format; *cursor; )
+  {
+    if (*cursor != '%')
+    {
+      result += *cursor++;
+      continue;
+    }
+
+    if (cursor[1] == '%')
+    {
+      result += '%';
+      cursor += 2;
+      continue;
+    }
+
+    // copy flags, width and precision, dropping length modifiers so the
+    // stored argument type can supply its own
+    char spec[32];
+    size_t length = 0;
+    spec[length++] = *cursor++;
+    while (*cursor && strchr ("-+ #0123456789.", *cursor) &&
+      length < sizeof (spec) - 4)
+    {
+      spec[length++] = *cursor++;
+    }
+    while (*cursor && strchr ("hljztL", *cursor))
+    {
+      ++cursor;
+    }
+
+    const char conversion = *cursor;
+    if (!conversion)
+      break;
+    ++cursor;
+
+    if (index >= count)
+    {
+      result += "(missing)";
+      continue;
+    }
+
+    const Arg & arg = args[index++];
+    if (strchr ("diouxXc", conversion))
+    {
+      if (conversion != 'c')
+      {
+        spec[length++] = 'l';
+        spec[length++] = 'l';
+      }
+      spec[length++] = conversion;
+      spec[length] = 0;
+
+      if (conversion == 'c')
+        snprintf (buffer, sizeof (buffer), spec, (int)arg.value.i);
+      else if (arg.type == 'd')
+        snprintf (buffer, sizeof (buffer), spec, (long long)arg.value.d);
+      else
+        snprintf (buffer, sizeof (buffer), spec, arg.value.i);
+    }
+    else if (strchr ("fFeEgGaA", conversion))
+    {
+      spec[length++] = conversion;
+      spec[length] = 0;
+
+      double value = arg.value.d;
+      if (arg.type == 'i')
+        value = (double)arg.value.i;
+      else if (arg.type == 'u')
+        value = (double)arg.value.u;
+      snprintf (buffer, sizeof (buffer), spec, value);
+    }
+    else if (conversion == 's')
+    {
+      spec[length++] = conversion;
+      spec[length] = 0;
+      snprintf (buffer, sizeof (buffer), spec,
+        arg.type == 's' ? text + arg.value.u : "(not a string)");
+    }
+    else if (conversion == 'p')
+    {
+      snprintf (buffer, sizeof (buffer), "%p", arg.value.p);
+    }
+    else
+    {
+      snprintf (buffer, sizeof (buffer), "(bad conversion %%%c)", conversion);
+    }
+
+    result += buffer;
+  }
+
+  return result;
+}
+
+void
+utility::AsyncLogger::start (double drain_period, size_t ring_capacity)
+{
+  std::lock_guard <std::mutex> guard (thread_mutex);
+  if (running_)
+    return;
+
+  period = drain_period > 0 ? drain_period : 0.01;
+  capacity = ring_capacity;
+  stopping = false;
+  writer = std::thread (write_loop);
+  running_ = true;
+}
+
+void
+utility::AsyncLogger::stop (void)
+{
+  std::lock_guard <std::mutex> guard (thread_mutex);
+  if (!running_)
+    return;
+
+  // later calls log synchronously. Drain after the join to catch calls
+  // that were queueing while the thread stopped. The fence pairs with
+  // publish: a call either sees running_ false and flushes, or its record
+  // is visible to the drain below.
+  running_ = false;
+  std::atomic_thread_fence (std::memory_order_seq_cst);
+  stopping = true;
+  writer.join ();
+  drain ();
+}
+
+uint64_t
+utility::AsyncLogger::get_drops (void)
+{
+  std::lock_guard <std::mutex> guard (rings_mutex);
+
+  uint64_t result = 0;
+  for (size_t i = 0; i < rings.size (); ++i)
+  {
+    result += rings[i]->drops;
+  }
+
+  return result;
+}
+
+utility::LogRecord *
+utility::AsyncLogger::acquire (void)
+{
+  LogRing & ring = get_ring ();
+  const uint64_t head = ring.head.load (std::memory_order_relaxed);
+
+  if (head - ring.tail.load (std::memory_order_acquire) >=
+    ring.records.size ())
+  {
+    ring.drops.fetch_add (1, std::memory_order_relaxed);
+    return 0;
+  }
+
+  LogRecord * record = &ring.records[head % ring.records.size ()];
+  record->timestamp = utility::now ();
+  return record;
+}
+
+void
+utility::AsyncLogger::publish (void)
+{
+  // only this thread writes head, so no read-modify-write is needed
+  local_ring->head.store (
+    local_ring->head.load (std::memory_order_relaxed) + 1,
+    std::memory_order_release);
+  std::atomic_thread_fence (std::memory_order_seq_cst);
+}
+
+void
+utility::AsyncLogger::flush (void)
+{
+  // waits for a stop in progress, whose drain may already have the record
+  std::lock_guard <std::mutex> guard (thread_mutex);
+  if (!running_)
+    drain ();
+}
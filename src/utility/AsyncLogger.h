@@ -0,0 +1,298 @@
+
+#ifndef   _UTILITY_ASYNCLOGGER_H_
+#define   _UTILITY_ASYNCLOGGER_H_
+
+#include <atomic>
+#include <string>
+#include <type_traits>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gams/loggers/GlobalLogger.h"
+
+/**
+ * Logs like madara_logger_ptr_log to the GAMS global logger. While the
+ * AsyncLogger is running, the format and raw arguments are queued and
+ * formatted by its thread instead. format must be a string literal.
+ * @param  level   GAMS log level
+ **/
+#define utility_async_log(level, ...) \
+  do { \
+    if (utility::AsyncLogger::running ()) \
+    { \
+      if ((level) <= gams::loggers::global_logger->get_level ()) \
+        utility::AsyncLogger::log ((level), __VA_ARGS__); \
+    } \
+    else \
+    { \
+      madara_logger_ptr_log (gams::loggers::global_logger.get (), \
+        (level), __VA_ARGS__); \
+    } \
+  } while (0)
+
+namespace utility
+{
+  /**
+  * One queued log call. The format string is stored by address, and
+  * arguments are stored raw. String arguments are copied into text.
+  **/
+  struct LogRecord
+  {
+    /// most arguments a record can hold
+    static const int MAX_ARGS = 16;
+
+    /// bytes of string arguments a record can hold
+    static const size_t MAX_TEXT = 128;
+
+    /**
+    * A raw argument
+    **/
+    struct Arg
+    {
+      /// 'i' signed, 'u' unsigned, 'd' floating point, 's' text offset,
+      /// 'p' pointer
+      char type;
+
+      union
+      {
+        long long i;
+        unsigned long long u;
+        double d;
+        const void * p;
+      } value;
+    };
+
+    /// the format, which identifies the call site
+    const char * format;
+
+    /// log level
+    int level;
+
+    /// arguments used
+    int count;
+
+    /// bytes of text used
+    size_t text_used;
+
+    /// nanoseconds when logged
+    int64_t timestamp;
+
+    /// the arguments
+    Arg args[MAX_ARGS];
+
+    /// copies of string arguments
+    char text[MAX_TEXT];
+
+    /**
+     * Stores a signed integer
+     **/
+    template <typename T>
+    void add (T value, std::true_type, std::true_type)
+    {
+      args[count].type = 'i';
+      args[count].value.i = (long long)value;
+      ++count;
+    }
+
+    /**
+     * Stores an unsigned integer
+     **/
+    template <typename T>
+    void add (T value, std::true_type, std::false_type)
+    {
+      args[count].type = 'u';
+      args[count].value.u = (unsigned long long)value;
+      ++count;
+    }
+
+    /**
+     * Stores a floating point number
+     **/
+    template <typename T>
+    void add (T value, std::false_type, std::true_type)
+    {
+      args[count].type = 'd';
+      args[count].value.d = (double)value;
+      ++count;
+    }
+
+    /**
+     * Stores a pointer
+     **/
+    template <typename T>
+    void add (T value, std::false_type, std::false_type)
+    {
+      args[count].type = 'p';
+      args[count].value.p = (const void *)value;
+      ++count;
+    }
+
+    /**
+     * Copies a string. Truncated if text is full.
+     **/
+    void add (const char * value)
+    {
+      if (!value)
+        value = "(null)";
+
+      const size_t available = MAX_TEXT - text_used;
+      size_t length = strlen (value);
+      if (length >= available)
+        length = available ? available - 1 : 0;
+
+      args[count].type = 's';
+      args[count].value.u = text_used;
+      if (available)
+      {
+        memcpy (text + text_used, value, length);
+        text[text_used + length] = 0;
+        text_used += length + 1;
+      }
+      else
+      {
+        args[count].value.u = MAX_TEXT - 1;
+      }
+      ++count;
+    }
+
+    void add (char * value)
+    {
+      add ((const char *)value);
+    }
+
+    void add (const std::string & value)
+    {
+      add (value.c_str ());
+    }
+
+    /**
+     * Stores any other scalar
+     **/
+    template <typename T>
+    void add (const T & value)
+    {
+      add (value,
+        std::integral_constant <bool,
+          std::is_integral <T>::value || std::is_enum <T>::value> (),
+        std::integral_constant <bool,
+          std::is_floating_point <T>::value ||
+          (std::is_integral <T>::value && std::is_signed <T>::value) ||
+          std::is_enum <T>::value> ());
+    }
+
+    /**
+     * Stores each argument
+     **/
+    void add_all (void)
+    {
+    }
+
+    template <typename T, typename... Args>
+    void add_all (const T & first, const Args &... rest)
+    {
+      add (first);
+      add_all (rest...);
+    }
+
+    /**
+     * Formats the record as printf would have
+     * @return the formatted message
+     **/
+    std::string to_string (void) const;
+  };
+
+  /**
+  * A logger backend for hot paths. log copies the format address and raw
+  * arguments into a ring owned by the calling thread, without locks or
+  * formatting. A background thread formats the records in time order and
+  * writes them through the GAMS global logger, so files and terminal
+  * output are unchanged. Records that do not fit in a full ring are
+  * dropped and counted.
+  **/
+  class AsyncLogger
+  {
+  public:
+    /**
+     * Starts the background thread
+     * @param  period    seconds between drains of the rings
+     * @param  capacity  records each thread can queue. Only affects
+     *                   threads that have not logged yet.
+     **/
+    static void start (double period = 0.01, size_t capacity = 1024);
+
+    /**
+     * Writes every queued record, and stops the background thread. Later
+     * log calls are written synchronously.
+     **/
+    static void stop (void);
+
+    /**
+     * Returns true if log calls are queued
+     * @return true if running
+     **/
+    static inline bool running (void)
+    {
+      return running_.load (std::memory_order_relaxed);
+    }
+
+    /**
+     * Queues a log call. Use utility_async_log, which checks the level.
+     * @param  level   GAMS log level
+     * @param  format  printf format. Must outlive the logger.
+     * @param  args    scalar or string arguments
+     **/
+    template <typename... Args>
+    static void log (int level, const char * format, const Args &... args)
+    {
+      static_assert (sizeof... (Args) <= LogRecord::MAX_ARGS,
+        "utility::AsyncLogger::log: too many arguments");
+
+      LogRecord * record = acquire ();
+      if (record)
+      {
+        record->format = format;
+        record->level = level;
+        record->count = 0;
+        record->text_used = 0;
+        record->add_all (args...);
+        publish ();
+
+        // stop may have drained the rings before the record was
+        // published. Write it now rather than leave it queued.
+        if (!running ())
+          flush ();
+      }
+    }
+
+    /**
+     * Returns the number of records dropped because a ring was full
+     * @return dropped records
+     **/
+    static uint64_t get_drops (void);
+
+  private:
+    /**
+     * Returns the calling thread's next free record, or null if its ring
+     * is full
+     **/
+    static LogRecord * acquire (void);
+
+    /**
+     * Makes the record returned by acquire visible to the background
+     * thread
+     **/
+    static void publish (void);
+
+    /**
+     * Writes the queued records if the logger has stopped
+     **/
+    static void flush (void);
+
+    /// true while log calls are queued
+    static std::atomic <bool> running_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_ASYNCLOGGER_H_
@@ -0,0 +1,363 @@
+
+#include "CaptureLog.h"
+
+#include <chrono>
+#include <string.h>
+
+#if defined (__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "gams/loggers/GlobalLogger.h"
+
+// the file header, including its terminating null
+static const char MAGIC[8] = "RISCAP1";
+
+// bytes the file starts with and grows by at least
+static const size_t INITIAL_CAPACITY (16 * 1024 * 1024);
+
+/**
+ * Copies a value to a cursor and advances it
+ **/
+template <typename T>
+static inline void
+put (char *& cursor, const T & value)
+{
+  memcpy (cursor, &value, sizeof (T));
+  cursor += sizeof (T);
+}
+
+/**
+ * Copies a value from a cursor and advances it, if the end allows
+ **/
+template <typename T>
+static inline bool
+take (const char *& cursor, const char * end, T & value)
+{
+  if ((size_t)(end - cursor) < sizeof (T))
+    return false;
+  memcpy (&value, cursor, sizeof (T));
+  cursor += sizeof (T);
+  return true;
+}
+
+utility::CaptureWriter::CaptureWriter ()
+: fd_ (-1), data_ (0), used_ (0), capacity_ (0), entries_ (0)
+{
+}
+
+utility::CaptureWriter::~CaptureWriter ()
+{
+  close ();
+}
+
+bool
+utility::CaptureWriter::open (const std::string & path)
+{
+  close ();
+
+  std::lock_guard <std::mutex> guard (mutex_);
+
+#if defined (__linux__)
+  fd_ = ::open (path.c_str (), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "utility::CaptureWriter::open:"
+      " unable to open %s: %s\n", path.c_str (), strerror (errno));
+    return false;
+  }
+
+  entries_ = 0;
+  used_ = 0;
+  if (!reserve (sizeof (MAGIC)))
+    return false;
+
+  memcpy (data_, MAGIC, sizeof (MAGIC));
+  used_ = sizeof (MAGIC);
+
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_MAJOR,
+    "utility::CaptureWriter::open:"
+    " capturing received packets to %s\n", path.c_str ());
+
+  return true;
+#else
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_ERROR,
+    "utility::CaptureWriter::open:"
+    " capture is only available on Linux\n");
+  return false;
+#endif
+}
+
+bool
+utility::CaptureWriter::reserve (size_t bytes)
+{
+#if defined (__linux__)
+  if (fd_ < 0)
+    return false;
+
+  if (used_ + bytes <= capacity_)
+    return true;
+
+  size_t capacity = capacity_ ? capacity_ * 2 : INITIAL_CAPACITY;
+  while (capacity < used_ + bytes)
+  {
+    capacity *= 2;
+  }
+
+  if (data_)
+    munmap (data_, capacity_);
+  data_ = 0;
+
+  void * address = MAP_FAILED;
+  if (ftruncate (fd_, capacity) == 0)
+    address = mmap (0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+
+  if (address == MAP_FAILED)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "utility::CaptureWriter::reserve:"
+      " unable to grow the capture to %d bytes, closing it: %s\n",
+      (int)capacity, strerror (errno));
+    ::close (fd_);
+    fd_ = -1;
+    capacity_ = 0;
+    return false;
+  }
+
+  data_ = (char *)address;
+  capacity_ = capacity;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+utility::CaptureWriter::close (void)
+{
+  std::lock_guard <std::mutex> guard (mutex_);
+
+#if defined (__linux__)
+  if (data_)
+    munmap (data_, capacity_);
+
+  if (fd_ >= 0)
+  {
+    if (ftruncate (fd_, used_) != 0)
+    {
+      madara_logger_ptr_log (gams::loggers::global_logger.get (),
+        gams::loggers::LOG_ERROR,
+        "utility::CaptureWriter::close:"
+        " unable to trim the capture: %s\n", strerror (errno));
+    }
+    ::close (fd_);
+  }
+#endif
+
+  data_ = 0;
+  fd_ = -1;
+  capacity_ = 0;
+}
+
+uint64_t
+utility::CaptureWriter::get_entries (void) const
+{
+  return entries_.load (std::memory_order_relaxed);
+}
+
+void
+utility::CaptureWriter::append (
+  const madara::knowledge::KnowledgeMap & records,
+  const madara::transport::TransportContext & context)
+{
+  const int64_t time = std::chrono::duration_cast <std::chrono::nanoseconds> (
+    std::chrono::system_clock::now ().time_since_epoch ()).count ();
+
+  const std::string & domain = context.get_domain ();
+  const std::string & originator = context.get_originator ();
+
+  // an upper bound, since the exact size is only known once written
+  size_t bytes = 4 + 8 * 4 + 2 + domain.size () + 2 + originator.size () + 4;
+  for (madara::knowledge::KnowledgeMap::const_iterator i = records.begin ();
+    i != records.end (); ++i)
+  {
+    bytes += 8 + 4 + 64 + i->first.size () +
+      (size_t)i->second.get_encoded_size ();
+  }
+
+  std::lock_guard <std::mutex> guard (mutex_);
+
+  if (!reserve (bytes))
+    return;
+
+  char * start = data_ + used_;
+  char * cursor = start + sizeof (uint32_t);
+
+  put (cursor, time);
+  put (cursor, context.get_message_time ());
+  put (cursor, context.get_receive_bandwidth ());
+  put (cursor, context.get_send_bandwidth ());
+  put (cursor, (uint16_t)domain.size ());
+  memcpy (cursor, domain.c_str (), domain.size ());
+  cursor += domain.size ();
+  put (cursor, (uint16_t)originator.size ());
+  memcpy (cursor, originator.c_str (), originator.size ());
+  cursor += originator.size ();
+  put (cursor, (uint32_t)records.size ());
+
+  for (madara::knowledge::KnowledgeMap::const_iterator i = records.begin ();
+    i != records.end (); ++i)
+  {
+    put (cursor, (uint64_t)i->second.clock);
+    put (cursor, (uint32_t)i->second.quality);
+
+    int64_t remaining = (int64_t)(bytes - (cursor - start));
+    cursor = i->second.write (cursor, i->first, remaining);
+
+    // the rest of the mapping is still zero, which ends the log
+    if (!cursor)
+      return;
+  }
+
+  // the size goes last, so a reader never sees a partial entry
+  const uint32_t size = (uint32_t)(cursor - start);
+  memcpy (start, &size, sizeof (uint32_t));
+  used_ += size;
+  ++entries_;
+}
+
+utility::CaptureReader::CaptureReader ()
+: data_ (0), size_ (0), position_ (0)
+{
+}
+
+utility::CaptureReader::~CaptureReader ()
+{
+  close ();
+}
+
+bool
+utility::CaptureReader::open (const std::string & path)
+{
+  close ();
+
+#if defined (__linux__)
+  const int fd = ::open (path.c_str (), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat (fd, &status) != 0 ||
+    (size_t)status.st_size < sizeof (MAGIC))
+  {
+    if (fd >= 0)
+      ::close (fd);
+    return false;
+  }
+
+  void * address = mmap (0, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close (fd);
+
+  if (address == MAP_FAILED)
+    return false;
+
+  data_ = (const char *)address;
+  size_ = status.st_size;
+  position_ = sizeof (MAGIC);
+
+  if (memcmp (data_, MAGIC, sizeof (MAGIC)) != 0)
+  {
+    close ();
+    return false;
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+utility::CaptureReader::close (void)
+{
+#if defined (__linux__)
+  if (data_)
+    munmap ((void *)data_, size_);
+#endif
+
+  data_ = 0;
+  size_ = 0;
+  position_ = 0;
+}
+
+void
+utility::CaptureReader::rewind (void)
+{
+  if (data_)
+    position_ = sizeof (MAGIC);
+}
+
+bool
+utility::CaptureReader::next (CaptureEntry & entry)
+{
+  if (!data_)
+    return false;
+
+  const char * cursor = data_ + position_;
+  uint32_t size = 0;
+  if (!take (cursor, data_ + size_, size) || size == 0 ||
+    size > size_ - position_)
+    return false;
+
+  const char * end = data_ + position_ + size;
+
+  uint16_t length;
+  uint32_t count;
+  if (!take (cursor, end, entry.time) ||
+    !take (cursor, end, entry.message_time) ||
+    !take (cursor, end, entry.receive_bandwidth) ||
+    !take (cursor, end, entry.send_bandwidth) ||
+    !take (cursor, end, length) || (size_t)(end - cursor) < length)
+    return false;
+
+  entry.domain.assign (cursor, length);
+  cursor += length;
+
+  if (!take (cursor, end, length) || (size_t)(end - cursor) < length)
+    return false;
+
+  entry.originator.assign (cursor, length);
+  cursor += length;
+
+  if (!take (cursor, end, count))
+    return false;
+
+  entry.records.clear ();
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    uint64_t clock;
+    uint32_t quality;
+    if (!take (cursor, end, clock) || !take (cursor, end, quality))
+      return false;
+
+    std::string key;
+    madara::knowledge::KnowledgeRecord record;
+    int64_t remaining = end - cursor;
+    cursor = record.read (cursor, key, remaining);
+    if (!cursor)
+      return false;
+
+    record.clock = clock;
+    record.quality = quality;
+    entry.records[key] = record;
+  }
+
+  position_ += size;
+  return true;
+}
@@ -0,0 +1,155 @@
+#ifndef   _UTILITY_CAPTURELOG_H_
+#define   _UTILITY_CAPTURELOG_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeRecord.h"
+#include "madara/transport/TransportContext.h"
+
+namespace utility
+{
+  /**
+  * One received packet of a capture
+  **/
+  struct CaptureEntry
+  {
+    /// wall clock nanoseconds when it was received
+    int64_t time;
+
+    /// the transport context it arrived with
+    uint64_t message_time;
+    uint64_t receive_bandwidth;
+    uint64_t send_bandwidth;
+    std::string domain;
+    std::string originator;
+
+    /// its records, as they arrived
+    madara::knowledge::KnowledgeMap records;
+  };
+
+  /**
+  * Appends received packets to a memory mapped file. The file is grown
+  * by doubling, and trimmed to its contents on close. Each entry is:
+  *
+  *   uint32 entry bytes, int64 time, uint64 message time, uint64 receive
+  *   and send bandwidth, uint16 size and domain, uint16 size and
+  *   originator, uint32 record count, and per record uint64 clock,
+  *   uint32 quality and KnowledgeRecord::write
+  *
+  * after an 8 byte "RISCAP1" header. A zero entry size ends the log, so
+  * a capture cut short by a crash is still readable. Only available on
+  * Linux.
+  **/
+  class CaptureWriter
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    CaptureWriter ();
+
+    /**
+     * Destructor, which closes the file
+     **/
+    ~CaptureWriter ();
+
+    /**
+     * Creates or truncates a capture file
+     * @param  path    the file
+     * @return true if the file was opened
+     **/
+    bool open (const std::string & path);
+
+    /**
+     * Trims and closes the file
+     **/
+    void close (void);
+
+    /**
+     * Appends a packet. Safe to call from several threads.
+     * @param  records  the packet
+     * @param  context  the transport context it arrived with
+     **/
+    void append (const madara::knowledge::KnowledgeMap & records,
+      const madara::transport::TransportContext & context);
+
+    /**
+     * Returns the number of packets appended. Safe to call while
+     * other threads append.
+     **/
+    uint64_t get_entries (void) const;
+
+  protected:
+    /**
+     * Makes room for more bytes, remapping the file if needed
+     * @param  bytes   bytes to append
+     * @return true if there is room
+     **/
+    bool reserve (size_t bytes);
+
+    /// guards the mapping
+    std::mutex mutex_;
+
+    /// the file, its mapping, and the bytes used and mapped
+    int fd_;
+    char * data_;
+    size_t used_;
+    size_t capacity_;
+
+    /// packets appended. Atomic so get_entries needs no lock.
+    std::atomic <uint64_t> entries_;
+  };
+
+  /**
+  * Reads the packets of a capture written by CaptureWriter
+  **/
+  class CaptureReader
+  {
+  public:
+    /**
+     * Constructor
+     **/
+    CaptureReader ();
+
+    /**
+     * Destructor, which closes the file
+     **/
+    ~CaptureReader ();
+
+    /**
+     * Maps a capture file
+     * @param  path    the file
+     * @return true if the file is a capture
+     **/
+    bool open (const std::string & path);
+
+    /**
+     * Unmaps the file
+     **/
+    void close (void);
+
+    /**
+     * Reads the next packet
+     * @param  entry   the packet
+     * @return false at the end of the capture
+     **/
+    bool next (CaptureEntry & entry);
+
+    /**
+     * Starts reading from the first packet again
+     **/
+    void rewind (void);
+
+  protected:
+    /// the mapping, its size and the read position
+    const char * data_;
+    size_t size_;
+    size_t position_;
+  };
+}
+
+#endif // _UTILITY_CAPTURELOG_H_
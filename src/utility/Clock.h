@@ -0,0 +1,60 @@
+
+#ifndef   _UTILITY_CLOCK_H_
+#define   _UTILITY_CLOCK_H_
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace utility
+{
+  /**
+   * Returns monotonic time in nanoseconds
+   * @return nanoseconds since an arbitrary fixed point
+   **/
+  inline int64_t now (void)
+  {
+    return std::chrono::duration_cast <std::chrono::nanoseconds> (
+      std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+  }
+
+  /**
+  * The time the filters run their rates, windows and timers by. It
+  * follows utility::now unless set, e.g., by a replay to the time each
+  * packet was captured, so the filters behave as they did live at any
+  * replay speed. Durations being measured use utility::now.
+  **/
+  class Clock
+  {
+  public:
+    /**
+     * Returns the set time, or utility::now if none is set
+     * @return nanoseconds
+     **/
+    static inline int64_t now (void)
+    {
+      const int64_t time = set_time ().load (std::memory_order_relaxed);
+      return time ? time : utility::now ();
+    }
+
+    /**
+     * Sets the time until the next call. Time must not go backwards
+     * while filters are in use.
+     * @param  time    nanoseconds, or 0 to follow utility::now again
+     **/
+    static inline void set (int64_t time)
+    {
+      set_time ().store (time, std::memory_order_relaxed);
+    }
+
+  private:
+    /// the set time, 0 if none
+    static inline std::atomic <int64_t> & set_time (void)
+    {
+      static std::atomic <int64_t> time (0);
+      return time;
+    }
+  };
+} // end utility namespace
+
+#endif // _UTILITY_CLOCK_H_
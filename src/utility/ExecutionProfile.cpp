@@ -0,0 +1,174 @@
+
+#include "ExecutionProfile.h"
+#include "Clock.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gams/loggers/GlobalLogger.h"
+
+utility::ExecutionProfile::ExecutionProfile (size_t window)
+: durations_ (std::max (window, (size_t)1), 0),
+  intervals_ (std::max (window, (size_t)1), 0),
+  runs_ (0), interval_count_ (0), overruns_ (0), consecutive_ (0),
+  watchdogs_ (0), started_ (0), last_started_ (0), published_ (0),
+  budget_ (0), publish_period_ (1000000000), watchdog_limit_ (3),
+  trace_name_ ("unnamed"), tracing_ (false)
+{
+  sorted_.reserve (durations_.size ());
+}
+
+void
+utility::ExecutionProfile::init (const std::string & name,
+  madara::knowledge::KnowledgeBase & knowledge, double budget)
+{
+  name_ = name;
+  trace_name_ = Trace::intern (name);
+  data_ = knowledge;
+
+  const std::string prefix (".perf." + name);
+
+  if (knowledge.exists (prefix + ".budget"))
+    budget = knowledge.get (prefix + ".budget").to_double ();
+  if (knowledge.exists (".perf.publish_period"))
+    publish_period_ = (int64_t)(1e9 *
+      knowledge.get (".perf.publish_period").to_double ());
+  if (knowledge.exists (".perf.watchdog.limit"))
+    watchdog_limit_ = (uint64_t)
+      knowledge.get (".perf.watchdog.limit").to_integer ();
+
+  budget_ = (int64_t)(budget * 1e9);
+
+  p50_.set_name (prefix + ".p50", knowledge);
+  p99_.set_name (prefix + ".p99", knowledge);
+  max_.set_name (prefix + ".max", knowledge);
+  period_.set_name (prefix + ".period", knowledge);
+  jitter_.set_name (prefix + ".jitter", knowledge);
+  runs_export_.set_name (prefix + ".runs", knowledge);
+  overruns_export_.set_name (prefix + ".overruns", knowledge);
+  watchdog_export_.set_name (prefix + ".watchdog", knowledge);
+
+  knowledge.set (prefix + ".budget", budget);
+}
+
+void
+utility::ExecutionProfile::start (void)
+{
+  tracing_ = Trace::enabled ();
+  if (tracing_)
+    Trace::begin (trace_name_);
+
+  started_ = utility::now ();
+
+  if (last_started_ > 0)
+  {
+    intervals_[interval_count_ % intervals_.size ()] =
+      started_ - last_started_;
+    ++interval_count_;
+  }
+  last_started_ = started_;
+}
+
+bool
+utility::ExecutionProfile::stop (void)
+{
+  const int64_t stopped = utility::now ();
+  const int64_t duration = stopped - started_;
+
+  if (tracing_)
+    Trace::end (trace_name_);
+
+  durations_[runs_ % durations_.size ()] = duration;
+  ++runs_;
+
+  const bool overrun = budget_ > 0 && duration > budget_;
+  if (overrun)
+  {
+    ++overruns_;
+    ++consecutive_;
+
+    if (consecutive_ == watchdog_limit_ && !name_.empty ())
+    {
+      ++watchdogs_;
+
+      madara_logger_ptr_log (gams::loggers::global_logger.get (),
+        gams::loggers::LOG_ERROR,
+        "utility::ExecutionProfile::stop:"
+        " watchdog: %s over its %.6f s budget %d times in a row (%.6f s)\n",
+        name_.c_str (), budget_ / 1e9, (int)consecutive_, duration / 1e9);
+
+      watchdog_export_ = (madara::knowledge::KnowledgeRecord::Integer)
+        watchdogs_;
+      data_.set (".perf.watchdog.thread", name_);
+      data_.evaluate (".perf.watchdog.events += 1");
+    }
+  }
+  else
+  {
+    consecutive_ = 0;
+  }
+
+  if (!name_.empty () && stopped - published_ >= publish_period_)
+  {
+    published_ = stopped;
+    publish ();
+  }
+
+  return overrun;
+}
+
+void
+utility::ExecutionProfile::publish (void)
+{
+  const size_t count = (size_t)std::min ((uint64_t)durations_.size (), runs_);
+  if (count == 0 || name_.empty ())
+  {
+    return;
+  }
+
+  sorted_.assign (durations_.begin (), durations_.begin () + count);
+
+  const size_t median = count / 2;
+  const size_t tail = std::min (count - 1, (size_t)(count * 0.99));
+
+  std::nth_element (sorted_.begin (), sorted_.begin () + median,
+    sorted_.end ());
+  const int64_t p50 = sorted_[median];
+  std::nth_element (sorted_.begin (), sorted_.begin () + tail,
+    sorted_.end ());
+  const int64_t p99 = sorted_[tail];
+  const int64_t max = *std::max_element (sorted_.begin (), sorted_.end ());
+
+  double mean = 0, deviation = 0;
+  const size_t intervals =
+    (size_t)std::min ((uint64_t)intervals_.size (), interval_count_);
+  if (intervals > 0)
+  {
+    for (size_t i = 0; i < intervals; ++i)
+    {
+      mean += intervals_[i];
+    }
+    mean /= intervals;
+
+    for (size_t i = 0; i < intervals; ++i)
+    {
+      deviation += (intervals_[i] - mean) * (intervals_[i] - mean);
+    }
+    deviation = std::sqrt (deviation / intervals);
+  }
+
+  p50_ = p50 / 1e9;
+  p99_ = p99 / 1e9;
+  max_ = max / 1e9;
+  period_ = mean / 1e9;
+  jitter_ = deviation / 1e9;
+  runs_export_ = (madara::knowledge::KnowledgeRecord::Integer)runs_;
+  overruns_export_ = (madara::knowledge::KnowledgeRecord::Integer)overruns_;
+}
+
+double
+utility::ExecutionProfile::get_budget (void) const
+{
+  return budget_ / 1e9;
+}
@@ -0,0 +1,158 @@
+
+#ifndef   _UTILITY_EXECUTIONPROFILE_H_
+#define   _UTILITY_EXECUTIONPROFILE_H_
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeBase.h"
+#include "madara/knowledge/containers/Double.h"
+#include "madara/knowledge/containers/Integer.h"
+
+namespace utility
+{
+  /**
+  * Rolling execution time statistics of a periodic piece of code, exported
+  * to .perf.{name}.* local variables:
+  *
+  *   p50, p99, max    execution time over the window, in seconds
+  *   period, jitter   mean and standard deviation of the start interval
+  *   runs, overruns   totals. An overrun is a run longer than the budget.
+  *   watchdog         watchdog events
+  *
+  * start and stop only read the clock and write a preallocated window, so
+  * they are cheap enough for the control path. Statistics are computed
+  * and exported from stop at most once per .perf.publish_period seconds
+  * (default 1). When .perf.watchdog.limit (default 3) runs in a row exceed
+  * .perf.{name}.budget, a watchdog event is logged, counted and recorded
+  * in .perf.watchdog.thread. A budget of 0 disables overruns.
+  *
+  * A profile must only be used by one thread at a time.
+  **/
+  class ExecutionProfile
+  {
+  public:
+    /**
+     * Constructor
+     * @param  window   number of runs statistics are computed over
+     **/
+    ExecutionProfile (size_t window = 256);
+
+    /**
+     * Binds the profile to its .perf variables. Reads the budget from
+     * .perf.{name}.budget, if set.
+     * @param  name     name of the profiled code
+     * @param  knowledge the knowledge base to export to
+     * @param  budget   default budget in seconds if none is set
+     **/
+    void init (const std::string & name,
+      madara::knowledge::KnowledgeBase & knowledge, double budget = 0);
+
+    /**
+     * Marks the start of a run
+     **/
+    void start (void);
+
+    /**
+     * Marks the end of a run, and publishes statistics if they are due
+     * @return true if the run exceeded the budget
+     **/
+    bool stop (void);
+
+    /**
+     * Computes and exports statistics now
+     **/
+    void publish (void);
+
+    /**
+     * Returns the budget
+     * @return budget in seconds
+     **/
+    double get_budget (void) const;
+
+  private:
+    /// name of the profiled code
+    std::string name_;
+
+    /// knowledge base for watchdog events
+    madara::knowledge::KnowledgeBase data_;
+
+    /// execution times and start intervals in nanoseconds, as rings
+    std::vector <int64_t> durations_;
+    std::vector <int64_t> intervals_;
+
+    /// scratch space for percentiles
+    std::vector <int64_t> sorted_;
+
+    /// runs recorded, and intervals recorded
+    uint64_t runs_;
+    uint64_t interval_count_;
+
+    /// overruns in total and in a row
+    uint64_t overruns_;
+    uint64_t consecutive_;
+
+    /// watchdog events
+    uint64_t watchdogs_;
+
+    /// start of the current and previous runs in nanoseconds
+    int64_t started_;
+    int64_t last_started_;
+
+    /// last publish in nanoseconds
+    int64_t published_;
+
+    /// budget, publish period and watchdog limit
+    int64_t budget_;
+    int64_t publish_period_;
+    uint64_t watchdog_limit_;
+
+    /// exported statistics
+    madara::knowledge::containers::Double p50_;
+    madara::knowledge::containers::Double p99_;
+    madara::knowledge::containers::Double max_;
+    madara::knowledge::containers::Double period_;
+    madara::knowledge::containers::Double jitter_;
+    madara::knowledge::containers::Integer runs_export_;
+    madara::knowledge::containers::Integer overruns_export_;
+    madara::knowledge::containers::Integer watchdog_export_;
+
+    /// name_ for the trace, and whether the current run is traced
+    const char * trace_name_;
+    bool tracing_;
+  };
+
+  /**
+  * Times a scope with an ExecutionProfile
+  **/
+  class ScopedProfile
+  {
+  public:
+    /**
+     * Constructor. Starts a run.
+     * @param  profile  the profile
+     **/
+    ScopedProfile (ExecutionProfile & profile)
+    : profile_ (profile)
+    {
+      profile_.start ();
+    }
+
+    /**
+     * Destructor. Stops the run.
+     **/
+    ~ScopedProfile ()
+    {
+      profile_.stop ();
+    }
+
+  private:
+    /// the profile
+    ExecutionProfile & profile_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_EXECUTIONPROFILE_H_
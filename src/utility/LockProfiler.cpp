@@ -0,0 +1,161 @@
+
+#include "LockProfiler.h"
+#include "Clock.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <stdio.h>
+
+#include "gams/loggers/GlobalLogger.h"
+
+// head of the registered sites. Sites are never removed.
+static std::atomic <utility::LockSite *> sites (0);
+
+/**
+ * Raises an atomic maximum
+ **/
+static void
+raise_max (std::atomic <int64_t> & maximum, int64_t value)
+{
+  int64_t current = maximum.load (std::memory_order_relaxed);
+  while (value > current &&
+    !maximum.compare_exchange_weak (current, value, std::memory_order_relaxed))
+  {
+  }
+}
+
+utility::LockSite::LockSite (const char * site_name, const char * site_file,
+  int site_line)
+: name (site_name), file (site_file), line (site_line),
+  acquisitions (0), contended (0), wait_total (0), wait_max (0),
+  hold_total (0), hold_max (0), next (0)
+{
+  LockProfiler::add (*this);
+}
+
+void
+utility::LockSite::record (int64_t wait, int64_t hold)
+{
+  acquisitions.fetch_add (1, std::memory_order_relaxed);
+  hold_total.fetch_add (hold, std::memory_order_relaxed);
+  raise_max (hold_max, hold);
+
+  if (wait > 0)
+  {
+    contended.fetch_add (1, std::memory_order_relaxed);
+    wait_total.fetch_add (wait, std::memory_order_relaxed);
+    raise_max (wait_max, wait);
+  }
+}
+
+void
+utility::LockProfiler::add (LockSite & site)
+{
+  LockSite * head = sites.load ();
+  do
+  {
+    site.next = head;
+  } while (!sites.compare_exchange_weak (head, &site));
+}
+
+std::string
+utility::LockProfiler::report (void)
+{
+  std::vector <LockSite *> ranked;
+  for (LockSite * site = sites.load (); site; site = site->next)
+  {
+    if (site->acquisitions > 0)
+    {
+      ranked.push_back (site);
+    }
+  }
+
+  std::sort (ranked.begin (), ranked.end (),
+    [] (const LockSite * lhs, const LockSite * rhs)
+    {
+      if (lhs->wait_total != rhs->wait_total)
+        return lhs->wait_total > rhs->wait_total;
+      return lhs->hold_total > rhs->hold_total;
+    });
+
+  std::ostringstream buffer;
+  buffer << "rank site acquisitions contended"
+    " wait_total_ms wait_max_us hold_total_ms hold_mean_us hold_max_us\n";
+
+  for (size_t i = 0; i < ranked.size (); ++i)
+  {
+    const LockSite & site = *ranked[i];
+    const uint64_t acquisitions = site.acquisitions;
+
+    char line[256];
+    snprintf (line, sizeof (line),
+      "%d %s (%s:%d) %llu %llu %.3f %.1f %.3f %.1f %.1f\n",
+      (int)i + 1, site.name, site.file, site.line,
+      (unsigned long long)acquisitions,
+      (unsigned long long)site.contended.load (),
+      site.wait_total / 1e6, site.wait_max / 1e3,
+      site.hold_total / 1e6, site.hold_total / 1e3 / acquisitions,
+      site.hold_max / 1e3);
+    buffer << line;
+  }
+
+  return buffer.str ();
+}
+
+void
+utility::LockProfiler::log_report (int level)
+{
+  madara_logger_ptr_log (gams::loggers::global_logger.get (), level,
+    "utility::LockProfiler::log_report:"
+    " knowledge base lock contention by call site\n%s",
+    report ().c_str ());
+}
+
+utility::ProfiledGuard::ProfiledGuard (
+  madara::knowledge::ThreadSafeContext & context, LockSite & site)
+: context_ (context), site_ (site), wait_ (0)
+{
+  acquire ();
+}
+
+utility::ProfiledGuard::ProfiledGuard (
+  madara::knowledge::KnowledgeBase & knowledge, LockSite & site)
+: context_ (knowledge.get_context ()), site_ (site), wait_ (0)
+{
+  acquire ();
+}
+
+void
+utility::ProfiledGuard::acquire (void)
+{
+  // only time the wait when someone else holds the lock
+  if (context_.try_lock ())
+  {
+    acquired_ = utility::now ();
+  }
+  else
+  {
+    const int64_t start = utility::now ();
+    context_.lock ();
+    acquired_ = utility::now ();
+    wait_ = std::max (acquired_ - start, (int64_t)1);
+  }
+
+  // the span covers the hold, so lock handoffs line up across threads
+  tracing_ = Trace::enabled ();
+  if (tracing_)
+    Trace::begin (site_.name);
+}
+
+utility::ProfiledGuard::~ProfiledGuard ()
+{
+  const int64_t released = utility::now ();
+  if (tracing_)
+    Trace::end (site_.name);
+  context_.unlock ();
+
+  site_.record (wait_, released - acquired_);
+}
@@ -0,0 +1,147 @@
+
+#ifndef   _UTILITY_LOCKPROFILER_H_
+#define   _UTILITY_LOCKPROFILER_H_
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeBase.h"
+#include "madara/knowledge/ThreadSafeContext.h"
+
+/**
+ * Returns the LockSite of the calling code, created on first use
+ * @param  name   name of the call site, e.g., "ControlVariables::read"
+ **/
+#define UTILITY_LOCK_SITE(name) \
+  ([] () -> utility::LockSite & { \
+    static utility::LockSite site (name, __FILE__, __LINE__); \
+    return site; } ())
+
+namespace utility
+{
+  /**
+  * Knowledge base lock statistics of one call site. Sites register
+  * themselves with LockProfiler and live until the program exits.
+  **/
+  class LockSite
+  {
+  public:
+    /**
+     * Constructor
+     * @param  name   name of the call site
+     * @param  file   source file
+     * @param  line   source line
+     **/
+    LockSite (const char * name, const char * file, int line);
+
+    /**
+     * Records one acquisition
+     * @param  wait   nanoseconds spent waiting for the lock
+     * @param  hold   nanoseconds the lock was held
+     **/
+    void record (int64_t wait, int64_t hold);
+
+    /// name, file and line of the call site
+    const char * name;
+    const char * file;
+    int line;
+
+    /// acquisitions, and acquisitions that had to wait
+    std::atomic <uint64_t> acquisitions;
+    std::atomic <uint64_t> contended;
+
+    /// totals and maximums in nanoseconds
+    std::atomic <int64_t> wait_total;
+    std::atomic <int64_t> wait_max;
+    std::atomic <int64_t> hold_total;
+    std::atomic <int64_t> hold_max;
+
+    /// next registered site
+    LockSite * next;
+  };
+
+  /**
+  * Registry of every LockSite, and the contention report
+  **/
+  class LockProfiler
+  {
+  public:
+    /**
+     * Adds a site to the registry. Called by LockSite.
+     * @param  site   the site
+     **/
+    static void add (LockSite & site);
+
+    /**
+     * Formats every site that has been acquired, ranked by total wait
+     * time, then total hold time
+     * @return the report, one line per site
+     **/
+    static std::string report (void);
+
+    /**
+     * Logs the report
+     * @param  level  GAMS log level to log at
+     **/
+    static void log_report (int level);
+  };
+
+  /**
+  * A drop-in replacement for madara::knowledge::ContextGuard that records
+  * how long it waited for and held the lock at its call site:
+  *
+  *   utility::ProfiledGuard guard (data_,
+  *     UTILITY_LOCK_SITE ("StateEstimation::fuse"));
+  *
+  * An uncontended acquisition costs a try_lock and two clock reads.
+  **/
+  class ProfiledGuard
+  {
+  public:
+    /**
+     * Constructor. Locks the context.
+     * @param  context   the context to lock
+     * @param  site      the call site
+     **/
+    ProfiledGuard (madara::knowledge::ThreadSafeContext & context,
+      LockSite & site);
+
+    /**
+     * Constructor. Locks the knowledge base's context.
+     * @param  knowledge the knowledge base to lock
+     * @param  site      the call site
+     **/
+    ProfiledGuard (madara::knowledge::KnowledgeBase & knowledge,
+      LockSite & site);
+
+    /**
+     * Destructor. Unlocks the context and records the acquisition.
+     **/
+    ~ProfiledGuard ();
+
+  private:
+    /**
+     * Locks the context, timing the wait if it was contended
+     **/
+    void acquire (void);
+
+    /// the locked context
+    madara::knowledge::ThreadSafeContext & context_;
+
+    /// the call site
+    LockSite & site_;
+
+    /// nanoseconds spent waiting
+    int64_t wait_;
+
+    /// when the lock was acquired
+    int64_t acquired_;
+
+    /// true if the hold is traced
+    bool tracing_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_LOCKPROFILER_H_
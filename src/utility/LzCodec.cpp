@@ -0,0 +1,211 @@
+
+#include "LzCodec.h"
+
+#include <string.h>
+
+// shortest and farthest match
+static const size_t MIN_MATCH (4);
+static const size_t MAX_OFFSET (65535);
+
+// most output bytes one input byte can stand for, as a 255 length byte
+static const size_t MAX_EXPANSION (255);
+
+// hash table size as a power of two
+static const int HASH_BITS (12);
+
+/**
+ * Reads 4 bytes for hashing and comparison
+ **/
+static inline uint32_t
+read32 (const unsigned char * source)
+{
+  uint32_t result;
+  memcpy (&result, source, 4);
+  return result;
+}
+
+/**
+ * Hashes 4 bytes into the table
+ **/
+static inline uint32_t
+hash (uint32_t value)
+{
+  return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/**
+ * Writes a length that did not fit in its token nibble
+ **/
+static inline unsigned char *
+write_length (unsigned char * output, size_t length)
+{
+  for (; length >= 255; length -= 255)
+  {
+    *output++ = 255;
+  }
+  *output++ = (unsigned char)length;
+  return output;
+}
+
+/**
+ * Writes a sequence of literals and, if match_length is nonzero, a match
+ **/
+static inline unsigned char *
+write_sequence (unsigned char * output, const unsigned char * literals,
+  size_t literal_length, size_t match_length, size_t offset)
+{
+  unsigned char * token = output++;
+  const size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+
+  *token = (unsigned char)(
+    ((literal_length < 15 ? literal_length : 15) << 4) |
+    (match_code < 15 ? match_code : 15));
+
+  if (literal_length >= 15)
+    output = write_length (output, literal_length - 15);
+
+  // an empty input has no literals to point at
+  if (literal_length)
+    memcpy (output, literals, literal_length);
+  output += literal_length;
+
+  if (match_length)
+  {
+    *output++ = (unsigned char)(offset & 0xff);
+    *output++ = (unsigned char)(offset >> 8);
+
+    if (match_code >= 15)
+      output = write_length (output, match_code - 15);
+  }
+
+  return output;
+}
+
+size_t
+utility::LzCodec::bound (size_t size)
+{
+  return size + size / 255 + 16;
+}
+
+void
+utility::LzCodec::compress (const unsigned char * source, size_t size,
+  std::vector <unsigned char> & target)
+{
+  target.resize (bound (size));
+  unsigned char * output = target.empty () ? 0 : &target[0];
+
+  uint32_t table[1 << HASH_BITS];
+  memset (table, 0, sizeof (table));
+
+  const unsigned char * end = source + size;
+  const unsigned char * anchor = source;
+  const unsigned char * cursor = source;
+
+  while (size >= MIN_MATCH && cursor + MIN_MATCH <= end)
+  {
+    const uint32_t value = read32 (cursor);
+    const uint32_t slot = hash (value);
+    const unsigned char * candidate = source + table[slot];
+    table[slot] = (uint32_t)(cursor - source);
+
+    if (candidate >= cursor || cursor - candidate > (ptrdiff_t)MAX_OFFSET ||
+      read32 (candidate) != value)
+    {
+      ++cursor;
+      continue;
+    }
+
+    size_t length = MIN_MATCH;
+    while (cursor + length < end && candidate[length] == cursor[length])
+    {
+      ++length;
+    }
+
+    output = write_sequence (output, anchor, cursor - anchor, length,
+      cursor - candidate);
+    cursor += length;
+    anchor = cursor;
+  }
+
+  output = write_sequence (output, anchor, end - anchor, 0, 0);
+  target.resize (output - &target[0]);
+}
+
+bool
+utility::LzCodec::decompress (const unsigned char * source, size_t size,
+  std::vector <unsigned char> & target, size_t original_size)
+{
+  if (original_size / MAX_EXPANSION > size)
+    return false;
+
+  target.resize (original_size);
+
+  const unsigned char * input = source;
+  const unsigned char * input_end = source + size;
+  size_t written = 0;
+
+  while (input < input_end)
+  {
+    const unsigned char token = *input++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == 15)
+    {
+      unsigned char extra;
+      do
+      {
+        if (input >= input_end)
+          return false;
+        extra = *input++;
+        literal_length += extra;
+      } while (extra == 255);
+    }
+
+    if ((size_t)(input_end - input) < literal_length ||
+      original_size - written < literal_length)
+      return false;
+
+    if (literal_length)
+      memcpy (&target[written], input, literal_length);
+    input += literal_length;
+    written += literal_length;
+
+    // the last sequence has no match
+    if (input == input_end)
+      break;
+
+    if (input_end - input < 2)
+      return false;
+    const size_t offset = input[0] | (input[1] << 8);
+    input += 2;
+
+    size_t match_length = (token & 0x0f);
+    if (match_length == 15)
+    {
+      unsigned char extra;
+      do
+      {
+        if (input >= input_end)
+          return false;
+        extra = *input++;
+        match_length += extra;
+      } while (extra == 255);
+    }
+    match_length += MIN_MATCH;
+
+    if (offset == 0 || offset > written ||
+      original_size - written < match_length)
+      return false;
+
+    // byte by byte, since a match may overlap its own output
+    unsigned char * output = &target[written];
+    const unsigned char * match = output - offset;
+    for (size_t i = 0; i < match_length; ++i)
+    {
+      output[i] = match[i];
+    }
+    written += match_length;
+  }
+
+  return written == original_size;
+}
@@ -0,0 +1,56 @@
+
+#ifndef   _UTILITY_LZCODEC_H_
+#define   _UTILITY_LZCODEC_H_
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utility
+{
+  /**
+  * A small, fast LZ77 block codec in the style of LZ4. Each sequence is
+  * a token (literal length in the high nibble, match length - 4 in the
+  * low nibble, 15 meaning more length bytes follow), the literals, and a
+  * 2 byte little endian offset back into the output. The last sequence
+  * has literals only. Matches are found with a single-probe hash table,
+  * trading ratio for speed.
+  **/
+  class LzCodec
+  {
+  public:
+    /**
+     * Returns the largest compressed size of an input
+     * @param  size    input bytes
+     * @return worst case output bytes
+     **/
+    static size_t bound (size_t size);
+
+    /**
+     * Compresses a block
+     * @param  source  input
+     * @param  size    input bytes
+     * @param  target  output. Resized to the compressed size, keeping
+     *                 its capacity for reuse.
+     **/
+    static void compress (const unsigned char * source, size_t size,
+      std::vector <unsigned char> & target);
+
+    /**
+     * Decompresses a block
+     * @param  source  compressed input
+     * @param  size    compressed bytes
+     * @param  target  output, resized to original_size
+     * @param  original_size  bytes the block decompresses to. Sizes no
+     *                 block of this many bytes could expand to are
+     *                 rejected before target is resized, but callers
+     *                 reading it from the wire should still cap it.
+     * @return true if the block was well formed and had that size
+     **/
+    static bool decompress (const unsigned char * source, size_t size,
+      std::vector <unsigned char> & target, size_t original_size);
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_LZCODEC_H_
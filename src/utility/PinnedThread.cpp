@@ -0,0 +1,46 @@
+
+#include "PinnedThread.h"
+#include "ThreadPlacement.h"
+#include "Trace.h"
+
+utility::PinnedThread::PinnedThread (madara::threads::BaseThread * thread,
+  const std::vector <int> & cores)
+: thread_ (thread), cores_ (cores), pinned_ (false)
+{
+}
+
+utility::PinnedThread::~PinnedThread ()
+{
+}
+
+void
+utility::PinnedThread::init (madara::knowledge::KnowledgeBase & knowledge)
+{
+  data_ = knowledge;
+
+  // the wrapped thread reports and logs under the same name
+  thread_->name = name;
+  thread_->init (knowledge);
+}
+
+void
+utility::PinnedThread::run (void)
+{
+  if (!pinned_)
+  {
+    pinned_ = true;
+    Trace::set_thread_name (name);
+    if (!cores_.empty ())
+    {
+      ThreadPlacement::pin (name, cores_, &data_);
+    }
+  }
+
+  thread_->run ();
+}
+
+void
+utility::PinnedThread::cleanup (void)
+{
+  thread_->cleanup ();
+}
@@ -0,0 +1,67 @@
+
+#ifndef   _UTILITY_PINNEDTHREAD_H_
+#define   _UTILITY_PINNEDTHREAD_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "madara/threads/BaseThread.h"
+
+namespace utility
+{
+  /**
+  * Runs another BaseThread after pinning the OS thread that runs it.
+  * madara::threads::Threader does not expose its threads, so the pin
+  * happens on the first run, from inside the thread. Only use this with a
+  * dedicated thread (e.g., Threader), never on a shared TaskScheduler.
+  **/
+  class PinnedThread : public madara::threads::BaseThread
+  {
+  public:
+    /**
+     * Constructor
+     * @param  thread   the thread to run. Takes ownership.
+     * @param  cores    cores to pin to. If empty, the thread is not moved.
+     **/
+    PinnedThread (madara::threads::BaseThread * thread,
+      const std::vector <int> & cores);
+
+    /**
+     * Destructor
+     **/
+    virtual ~PinnedThread ();
+
+    /**
+      * Initializes the wrapped thread with MADARA context
+      * @param   context   context for querying current program state
+      **/
+    virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+      * Pins on the first call, then runs the wrapped thread
+      **/
+    virtual void run (void);
+
+    /**
+      * Cleans up the wrapped thread
+      **/
+    virtual void cleanup (void);
+
+  private:
+    /// data plane for the placement report
+    madara::knowledge::KnowledgeBase data_;
+
+    /// the wrapped thread
+    std::unique_ptr <madara::threads::BaseThread> thread_;
+
+    /// cores to pin to
+    std::vector <int> cores_;
+
+    /// true once the pin was attempted
+    bool pinned_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_PINNEDTHREAD_H_
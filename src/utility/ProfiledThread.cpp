@@ -0,0 +1,35 @@
+
+#include "ProfiledThread.h"
+
+utility::ProfiledThread::ProfiledThread (madara::threads::BaseThread * thread,
+  double hertz)
+: thread_ (thread), hertz_ (hertz)
+{
+}
+
+utility::ProfiledThread::~ProfiledThread ()
+{
+}
+
+void
+utility::ProfiledThread::init (madara::knowledge::KnowledgeBase & knowledge)
+{
+  thread_->name = name;
+  thread_->init (knowledge);
+
+  profile_.init (name, knowledge, hertz_ > 0 ? 1.0 / hertz_ : 0.0);
+}
+
+void
+utility::ProfiledThread::run (void)
+{
+  ScopedProfile timing (profile_);
+  thread_->run ();
+}
+
+void
+utility::ProfiledThread::cleanup (void)
+{
+  profile_.publish ();
+  thread_->cleanup ();
+}
@@ -0,0 +1,61 @@
+
+#ifndef   _UTILITY_PROFILEDTHREAD_H_
+#define   _UTILITY_PROFILEDTHREAD_H_
+
+#include <memory>
+
+#include "madara/threads/BaseThread.h"
+#include "ExecutionProfile.h"
+
+namespace utility
+{
+  /**
+  * Runs another BaseThread and times every run with an ExecutionProfile
+  * exported under .perf.{name}. Works on a Threader or a TaskScheduler.
+  **/
+  class ProfiledThread : public madara::threads::BaseThread
+  {
+  public:
+    /**
+     * Constructor
+     * @param  thread   the thread to run. Takes ownership.
+     * @param  hertz    rate the thread is run at. The budget defaults to
+     *                  one period.
+     **/
+    ProfiledThread (madara::threads::BaseThread * thread, double hertz);
+
+    /**
+     * Destructor
+     **/
+    virtual ~ProfiledThread ();
+
+    /**
+      * Initializes the wrapped thread and the profile
+      * @param   context   context for querying current program state
+      **/
+    virtual void init (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+      * Runs the wrapped thread once, timed
+      **/
+    virtual void run (void);
+
+    /**
+      * Cleans up the wrapped thread
+      **/
+    virtual void cleanup (void);
+
+  private:
+    /// the wrapped thread
+    std::unique_ptr <madara::threads::BaseThread> thread_;
+
+    /// rate the thread is run at
+    double hertz_;
+
+    /// execution statistics
+    ExecutionProfile profile_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_PROFILEDTHREAD_H_
@@ -0,0 +1,683 @@
+
+#include "TaskScheduler.h"
+#include "ThreadPlacement.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <time.h>
+
+#include "gams/loggers/GlobalLogger.h"
+
+// the scheduler and worker index of the calling thread, if it is a worker
+static thread_local const utility::TaskScheduler * current_scheduler (0);
+static thread_local size_t current_worker (0);
+
+// the lane of the task the calling thread is running
+static thread_local int current_priority (utility::TaskScheduler::NORMAL);
+
+// the scheduler of every agent hosted in this process, if any
+static std::atomic <utility::TaskScheduler *> shared_scheduler (0);
+
+/**
+ * Returns the CPU time used by the calling thread in nanoseconds, or wall
+ * time where per-thread CPU clocks are not available
+ **/
+static int64_t
+thread_cpu_time (void)
+{
+#if defined (CLOCK_THREAD_CPUTIME_ID)
+  timespec now;
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+  return std::chrono::duration_cast <std::chrono::nanoseconds> (
+    std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+#endif
+}
+
+/**
+ * Converts a rate to a period. Rates <= 0 have no period.
+ **/
+static std::chrono::steady_clock::duration
+to_period (double hertz)
+{
+  return std::chrono::duration_cast <std::chrono::steady_clock::duration> (
+    std::chrono::duration <double> (hertz > 0 ? 1.0 / hertz : 0.0));
+}
+
+utility::TaskScheduler::TaskScheduler (size_t workers)
+: queued_ (0), low_running_ (0), steals_ (0), terminated_ (false),
+  stopping_ (false)
+{
+  if (workers == 0)
+  {
+    workers = std::thread::hardware_concurrency ();
+  }
+  workers = std::max (workers, (size_t)2);
+
+  low_limit_ = workers - 1;
+
+  for (size_t i = 0; i < workers; ++i)
+  {
+    workers_.push_back (std::unique_ptr <Worker> (new Worker ()));
+  }
+
+  // start threads only once every deque exists, since workers steal
+  for (size_t i = 0; i < workers; ++i)
+  {
+    workers_[i]->thread = std::thread (&TaskScheduler::work, this, i);
+  }
+
+  timer_ = std::thread (&TaskScheduler::time, this);
+}
+
+utility::TaskScheduler::~TaskScheduler ()
+{
+  terminate ();
+}
+
+void
+utility::TaskScheduler::set_data_plane (
+  madara::knowledge::KnowledgeBase & knowledge)
+{
+  data_ = knowledge;
+}
+
+void
+utility::TaskScheduler::run (double hertz, const std::string & name,
+  madara::threads::BaseThread * thread, Priority priority, double min_hertz,
+  madara::knowledge::KnowledgeBase * knowledge)
+{
+  thread->name = name;
+  thread->init (knowledge ? *knowledge : data_);
+
+  std::unique_ptr <Job> job (new Job ());
+  job->thread = thread;
+  job->name = name;
+  job->priority = priority;
+  job->once = hertz <= 0;
+  job->hertz = hertz;
+  job->target_hertz = hertz;
+  job->min_hertz = min_hertz > 0 && min_hertz < hertz ? min_hertz : hertz;
+  job->period = to_period (hertz);
+  job->next = std::chrono::steady_clock::now ();
+  job->triggered = false;
+  job->running = false;
+  job->runs = 0;
+  job->overruns = 0;
+  job->last_duration = 0;
+  job->max_duration = 0;
+  job->misses = 0;
+  job->cpu_time = 0;
+
+  {
+    std::lock_guard <std::mutex> guard (jobs_mutex_);
+    jobs_.push_back (std::move (job));
+  }
+  jobs_changed_.notify_all ();
+}
+
+void
+utility::TaskScheduler::submit (const Task & task, Priority priority)
+{
+  if (current_scheduler == this)
+  {
+    Worker & worker = *workers_[current_worker];
+    std::lock_guard <std::mutex> guard (worker.mutex);
+    worker.lanes[priority].push_back (task);
+  }
+  else
+  {
+    std::lock_guard <std::mutex> guard (injection_mutex_);
+    injection_[priority].push_back (task);
+  }
+
+  ++queued_;
+
+  // taking the lock orders this with a worker checking queued_ to sleep
+  {
+    std::lock_guard <std::mutex> guard (sleep_mutex_);
+  }
+  wake_.notify_one ();
+}
+
+bool
+utility::TaskScheduler::take (size_t self, size_t lane, Task & task)
+{
+  if (self < workers_.size ())
+  {
+    Worker & worker = *workers_[self];
+    std::lock_guard <std::mutex> guard (worker.mutex);
+    if (!worker.lanes[lane].empty ())
+    {
+      task = std::move (worker.lanes[lane].back ());
+      worker.lanes[lane].pop_back ();
+      return true;
+    }
+  }
+
+  {
+    std::lock_guard <std::mutex> guard (injection_mutex_);
+    if (!injection_[lane].empty ())
+    {
+      task = std::move (injection_[lane].front ());
+      injection_[lane].pop_front ();
+      return true;
+    }
+  }
+
+  // steal the oldest task, which is usually the largest remaining range
+  for (size_t i = 1; i <= workers_.size (); ++i)
+  {
+    const size_t victim = (self + i) % workers_.size ();
+    if (victim == self)
+    {
+      continue;
+    }
+
+    Worker & worker = *workers_[victim];
+    std::lock_guard <std::mutex> guard (worker.mutex);
+    if (!worker.lanes[lane].empty ())
+    {
+      task = std::move (worker.lanes[lane].front ());
+      worker.lanes[lane].pop_front ();
+      ++steals_;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool
+utility::TaskScheduler::try_run (size_t self, Priority lowest)
+{
+  if (queued_ == 0)
+  {
+    return false;
+  }
+
+  // a LOW task helping with its own subtasks already holds a LOW slot
+  const bool holds_low = current_priority == LOW;
+
+  for (size_t lane = HIGH; lane <= (size_t)lowest; ++lane)
+  {
+    const bool reserve = lane == LOW && !holds_low;
+
+    // reserve a LOW slot before taking a LOW task
+    if (reserve)
+    {
+      size_t running = low_running_;
+      do
+      {
+        if (running >= low_limit_)
+        {
+          return false;
+        }
+      } while (!low_running_.compare_exchange_weak (running, running + 1));
+    }
+
+    Task task;
+    if (take (self, lane, task))
+    {
+      --queued_;
+
+      const int previous = current_priority;
+      current_priority = (int)lane;
+      task ();
+      current_priority = previous;
+
+      if (reserve)
+      {
+        --low_running_;
+      }
+      return true;
+    }
+
+    if (reserve)
+    {
+      --low_running_;
+    }
+  }
+
+  return false;
+}
+
+void
+utility::TaskScheduler::parallel_for (size_t count, const RangeFunction & body)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  // a few ranges per worker lets stealing even out uneven ranges
+  const size_t ranges = std::min (count, workers_.size () * 4);
+  if (ranges == 1)
+  {
+    body (0, count);
+    return;
+  }
+
+  /**
+   * Ranges are claimed from a shared counter, by the caller and by helper
+   * tasks, so the caller only ever runs this call's own ranges. Helpers
+   * that start after every range was claimed return at once. They may
+   * outlive the call, so the group is shared.
+   **/
+  struct Group
+  {
+    std::atomic <size_t> next;
+    size_t finished;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+
+  std::shared_ptr <Group> group (std::make_shared <Group> ());
+  group->next = 0;
+  group->finished = 0;
+
+  // body is only called while ranges are unclaimed, so before we return
+  const RangeFunction * range_body = &body;
+  const Task claim = [group, range_body, count, ranges] ()
+  {
+    size_t ran = 0;
+    for (size_t i = group->next++; i < ranges; i = group->next++)
+    {
+      (*range_body) (count * i / ranges, count * (i + 1) / ranges);
+      ++ran;
+    }
+
+    if (ran > 0)
+    {
+      std::lock_guard <std::mutex> guard (group->mutex);
+      group->finished += ran;
+      if (group->finished == ranges)
+      {
+        group->done.notify_all ();
+      }
+    }
+  };
+
+  const Priority priority = (Priority)current_priority;
+  for (size_t i = 1; i < ranges; ++i)
+  {
+    submit (claim, priority);
+  }
+
+  claim ();
+
+  // the rest are running on other workers
+  std::unique_lock <std::mutex> lock (group->mutex);
+  while (group->finished < ranges)
+  {
+    group->done.wait (lock);
+  }
+}
+
+void
+utility::TaskScheduler::dispatch (Job & job)
+{
+  Job * target = &job;
+
+  submit ([this, target] () {
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now ();
+    const int64_t cpu_start = thread_cpu_time ();
+
+    target->thread->run ();
+
+    const std::chrono::steady_clock::duration elapsed =
+      std::chrono::steady_clock::now () - start;
+    const int64_t duration = std::chrono::duration_cast <
+      std::chrono::nanoseconds> (elapsed).count ();
+
+    // subtasks stolen by other workers are not counted here
+    target->cpu_time += thread_cpu_time () - cpu_start;
+
+    target->last_duration = duration;
+    if (duration > target->max_duration)
+    {
+      target->max_duration = duration;
+    }
+    ++target->runs;
+
+    {
+      std::lock_guard <std::mutex> guard (jobs_mutex_);
+      if (!target->once && elapsed > target->period)
+      {
+        ++target->misses;
+      }
+      target->running = false;
+    }
+    jobs_changed_.notify_all ();
+  }, job.priority);
+}
+
+void
+utility::TaskScheduler::time (void)
+{
+  Trace::set_thread_name ("scheduler.timer");
+
+  std::unique_lock <std::mutex> lock (jobs_mutex_);
+
+  while (!stopping_)
+  {
+    const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now ();
+    std::chrono::steady_clock::time_point wake =
+      now + std::chrono::seconds (1);
+
+    for (size_t i = 0; i < jobs_.size (); ++i)
+    {
+      Job & job = *jobs_[i];
+
+      if (job.once && (job.runs > 0 || job.running))
+      {
+        continue;
+      }
+
+      if (job.next <= now)
+      {
+        if (job.running)
+        {
+          ++job.overruns;
+        }
+        else
+        {
+          job.triggered = false;
+          job.running = true;
+          dispatch (job);
+          UTILITY_TRACE_COUNTER ("scheduler.queued", queued_.load ());
+        }
+
+        // stay on the original schedule unless a whole period was lost
+        job.next += job.period;
+        if (job.next <= now)
+        {
+          job.next = now + job.period;
+        }
+      }
+      else if (job.triggered && !job.running)
+      {
+        // an extra run, which leaves the schedule as it was
+        job.triggered = false;
+        job.running = true;
+        dispatch (job);
+      }
+
+      if (!job.once)
+      {
+        wake = std::min (wake, job.next);
+      }
+    }
+
+    jobs_changed_.wait_until (lock, wake);
+  }
+}
+
+void
+utility::TaskScheduler::work (size_t index)
+{
+  current_scheduler = this;
+  current_worker = index;
+  Trace::set_thread_name ("scheduler." + std::to_string (index));
+
+  for (;;)
+  {
+    if (try_run (index, LOW))
+    {
+      continue;
+    }
+
+    std::unique_lock <std::mutex> lock (sleep_mutex_);
+    if (terminated_)
+    {
+      return;
+    }
+
+    if (queued_ == 0)
+    {
+      wake_.wait (lock);
+    }
+    else
+    {
+      // only LOW tasks beyond their worker limit are left
+      wake_.wait_for (lock, std::chrono::milliseconds (1));
+    }
+  }
+}
+
+void
+utility::TaskScheduler::terminate (void)
+{
+  {
+    std::unique_lock <std::mutex> lock (jobs_mutex_);
+    if (stopping_)
+    {
+      return;
+    }
+    stopping_ = true;
+  }
+  jobs_changed_.notify_all ();
+  timer_.join ();
+
+  {
+    std::unique_lock <std::mutex> lock (jobs_mutex_);
+    for (size_t i = 0; i < jobs_.size (); ++i)
+    {
+      while (jobs_[i]->running)
+      {
+        jobs_changed_.wait (lock);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < jobs_.size (); ++i)
+  {
+    jobs_[i]->thread->cleanup ();
+    delete jobs_[i]->thread;
+  }
+
+  // so a later stop has nothing left to delete
+  const size_t jobs = jobs_.size ();
+  {
+    std::lock_guard <std::mutex> guard (jobs_mutex_);
+    jobs_.clear ();
+  }
+
+  {
+    std::lock_guard <std::mutex> guard (sleep_mutex_);
+    terminated_ = true;
+  }
+  wake_.notify_all ();
+
+  for (size_t i = 0; i < workers_.size (); ++i)
+  {
+    workers_[i]->thread.join ();
+  }
+
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_MAJOR,
+    "utility::TaskScheduler::terminate:"
+    " stopped %d jobs on %d workers, %d tasks stolen\n",
+    (int)jobs, (int)workers_.size (), (int)steals_);
+}
+
+size_t
+utility::TaskScheduler::stop (const std::string & prefix)
+{
+  std::vector <std::unique_ptr <Job> > stopped;
+
+  {
+    std::unique_lock <std::mutex> lock (jobs_mutex_);
+
+    // once out of jobs_, the timer cannot dispatch them again
+    for (size_t i = 0; i < jobs_.size (); )
+    {
+      if (jobs_[i]->name.compare (0, prefix.size (), prefix) == 0)
+      {
+        stopped.push_back (std::move (jobs_[i]));
+        jobs_.erase (jobs_.begin () + i);
+      }
+      else
+      {
+        ++i;
+      }
+    }
+
+    for (size_t i = 0; i < stopped.size (); ++i)
+    {
+      while (stopped[i]->running)
+      {
+        jobs_changed_.wait (lock);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < stopped.size (); ++i)
+  {
+    stopped[i]->thread->cleanup ();
+    delete stopped[i]->thread;
+  }
+
+  return stopped.size ();
+}
+
+void
+utility::TaskScheduler::set_shared (TaskScheduler * scheduler)
+{
+  shared_scheduler = scheduler;
+}
+
+utility::TaskScheduler *
+utility::TaskScheduler::get_shared (void)
+{
+  return shared_scheduler;
+}
+
+size_t
+utility::TaskScheduler::size (void) const
+{
+  return workers_.size ();
+}
+
+uint64_t
+utility::TaskScheduler::get_steals (void) const
+{
+  return steals_;
+}
+
+bool
+utility::TaskScheduler::get_job_stats (
+  const std::string & name, JobStats & stats) const
+{
+  std::lock_guard <std::mutex> guard (jobs_mutex_);
+
+  for (size_t i = 0; i < jobs_.size (); ++i)
+  {
+    if (jobs_[i]->name == name)
+    {
+      stats.runs = jobs_[i]->runs;
+      stats.overruns = jobs_[i]->overruns;
+      stats.last_duration = jobs_[i]->last_duration / 1000000000.0;
+      stats.max_duration = jobs_[i]->max_duration / 1000000000.0;
+      stats.misses = jobs_[i]->misses;
+      stats.cpu_time = jobs_[i]->cpu_time / 1000000000.0;
+      stats.priority = jobs_[i]->priority;
+      stats.hertz = jobs_[i]->hertz;
+      stats.target_hertz = jobs_[i]->target_hertz;
+      stats.min_hertz = jobs_[i]->min_hertz;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool
+utility::TaskScheduler::set_rate (const std::string & name, double hertz)
+{
+  {
+    std::lock_guard <std::mutex> guard (jobs_mutex_);
+
+    Job * job = 0;
+    for (size_t i = 0; i < jobs_.size () && !job; ++i)
+    {
+      if (jobs_[i]->name == name && !jobs_[i]->once)
+      {
+        job = jobs_[i].get ();
+      }
+    }
+
+    if (!job)
+    {
+      return false;
+    }
+
+    job->hertz = std::max (job->min_hertz, std::min (hertz, job->target_hertz));
+    job->period = to_period (job->hertz);
+
+    // a faster rate takes effect now rather than after the old period
+    job->next = std::min (job->next,
+      std::chrono::steady_clock::now () + job->period);
+  }
+  jobs_changed_.notify_all ();
+
+  return true;
+}
+
+bool
+utility::TaskScheduler::trigger (const std::string & name)
+{
+  {
+    std::lock_guard <std::mutex> guard (jobs_mutex_);
+
+    Job * job = 0;
+    for (size_t i = 0; i < jobs_.size () && !job; ++i)
+    {
+      if (jobs_[i]->name == name && !jobs_[i]->once)
+      {
+        job = jobs_[i].get ();
+      }
+    }
+
+    if (!job)
+    {
+      return false;
+    }
+
+    // the timer dispatches it, or does once the current run finishes
+    job->triggered = true;
+  }
+  jobs_changed_.notify_all ();
+
+  return true;
+}
+
+void
+utility::TaskScheduler::get_job_names (std::vector <std::string> & names) const
+{
+  std::lock_guard <std::mutex> guard (jobs_mutex_);
+
+  names.resize (jobs_.size ());
+  for (size_t i = 0; i < jobs_.size (); ++i)
+  {
+    names[i] = jobs_[i]->name;
+  }
+}
+
+bool
+utility::TaskScheduler::pin (const std::string & name,
+  const std::vector <int> & cores, madara::knowledge::KnowledgeBase * report)
+{
+  bool result = ThreadPlacement::pin (name + ".timer", timer_, cores, report);
+
+  for (size_t i = 0; i < workers_.size (); ++i)
+  {
+    result = ThreadPlacement::pin (name + "." + std::to_string (i),
+      workers_[i]->thread, cores, report) && result;
+  }
+
+  return result;
+}
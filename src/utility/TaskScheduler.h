@@ -0,0 +1,357 @@
+
+#ifndef   _UTILITY_TASKSCHEDULER_H_
+#define   _UTILITY_TASKSCHEDULER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "madara/knowledge/KnowledgeBase.h"
+#include "madara/threads/BaseThread.h"
+
+namespace utility
+{
+  /**
+  * A work-stealing pool shared by every platform thread.
+  *
+  * Periodic jobs (BaseThreads, as with madara::threads::Threader) are
+  * submitted to the pool at their rate instead of each owning an OS
+  * thread. Tasks may fork parallel subtasks with parallel_for, and idle
+  * workers steal them, so heavy jobs use whatever cores are free.
+  *
+  * Every task has a priority lane. Workers always take HIGH before NORMAL
+  * before LOW, and LOW tasks may occupy at most size () - 1 workers. A
+  * running task is never interrupted, but HIGH jobs (e.g., Controls)
+  * always find a worker within one LOW subtask, so LOW work (e.g.,
+  * Mapping) should be split into subtasks.
+  **/
+  class TaskScheduler
+  {
+  public:
+    /**
+     * Priority lanes, highest first
+     **/
+    enum Priority
+    {
+      HIGH = 0,
+      NORMAL = 1,
+      LOW = 2,
+      NUM_PRIORITIES = 3
+    };
+
+    /**
+     * A unit of work
+     **/
+    typedef std::function <void (void)> Task;
+
+    /**
+     * The body of a parallel loop. Processes indices [begin, end).
+     **/
+    typedef std::function <void (size_t begin, size_t end)> RangeFunction;
+
+    /**
+     * Statistics of a periodic job
+     **/
+    struct JobStats
+    {
+      /// completed runs
+      uint64_t runs;
+
+      /// periods skipped because the previous run had not finished
+      uint64_t overruns;
+
+      /// duration of the last run in seconds
+      double last_duration;
+
+      /// longest run in seconds
+      double max_duration;
+
+      /// runs that took longer than their period
+      uint64_t misses;
+
+      /// CPU time used by all runs in seconds
+      double cpu_time;
+
+      /// the job's lane
+      Priority priority;
+
+      /// current rate
+      double hertz;
+
+      /// rate the job was started at
+      double target_hertz;
+
+      /// lowest rate the job may be slowed to
+      double min_hertz;
+    };
+
+    /**
+     * Constructor
+     * @param  workers   number of worker threads. 0 uses all hardware
+     *                   threads. At least two are always created so that
+     *                   one is kept from LOW tasks.
+     **/
+    TaskScheduler (size_t workers = 0);
+
+    /**
+     * Destructor. Calls terminate.
+     **/
+    ~TaskScheduler ();
+
+    /**
+     * Sets the knowledge base passed to BaseThread::init
+     * @param  knowledge  the data plane
+     **/
+    void set_data_plane (madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+     * Initializes a BaseThread and runs it periodically. If a run is still
+     * going when the next is due, that period is skipped and counted as an
+     * overrun rather than queueing runs up.
+     * @param  hertz     target runs per second. If <= 0, runs once.
+     * @param  name      unique name of the job
+     * @param  thread    the job. The scheduler takes ownership.
+     * @param  priority  lane that runs of the job are submitted to
+     * @param  min_hertz lowest rate set_rate may slow the job to. If 0 or
+     *                   not below hertz, the rate is fixed.
+     * @param  knowledge knowledge base passed to BaseThread::init, so
+     *                   jobs of several agents can share one scheduler.
+     *                   If null, the one from set_data_plane is used.
+     **/
+    void run (double hertz, const std::string & name,
+      madara::threads::BaseThread * thread, Priority priority = NORMAL,
+      double min_hertz = 0, madara::knowledge::KnowledgeBase * knowledge = 0);
+
+    /**
+     * Stops the periodic jobs whose names start with a prefix, waits for
+     * their runs to finish, and calls cleanup on and deletes them. The
+     * workers and other jobs keep running.
+     * @param  prefix    prefix of the job names, e.g., "agent.3."
+     * @return number of jobs stopped
+     **/
+    size_t stop (const std::string & prefix);
+
+    /**
+     * Changes the rate of a periodic job, clamped to its minimum and
+     * target rates
+     * @param  name      the job's name
+     * @param  hertz     the new rate
+     * @return false if no periodic job has that name
+     **/
+    bool set_rate (const std::string & name, double hertz);
+
+    /**
+     * Runs a periodic job as soon as possible, outside its schedule. If
+     * the job is running, it runs again once that run finishes. Lets an
+     * event, such as a teleop command, be handled without waiting for
+     * the job's next period.
+     * @param  name      the job's name
+     * @return false if no periodic job has that name
+     **/
+    bool trigger (const std::string & name);
+
+    /**
+     * Queues a task. Tasks submitted from a worker go on that worker's
+     * own deque, where other workers may steal them.
+     * @param  task      the task
+     * @param  priority  the lane to queue on
+     **/
+    void submit (const Task & task, Priority priority = NORMAL);
+
+    /**
+     * Splits [0, count) into ranges, runs body on each range in parallel
+     * and returns when every range is done. The caller runs ranges too,
+     * so this may be called from inside a task. While it waits, it only
+     * runs ranges of this call, never other queued tasks, then blocks
+     * until ranges taken by other workers finish. Subtasks inherit the
+     * caller's priority.
+     * @param  count     number of indices
+     * @param  body      function called once per range
+     **/
+    void parallel_for (size_t count, const RangeFunction & body);
+
+    /**
+     * Stops periodic jobs, waits for running jobs, calls cleanup on and
+     * deletes every BaseThread, and joins the workers. Queued tasks that
+     * have not started are discarded.
+     **/
+    void terminate (void);
+
+    /**
+     * Returns the number of worker threads
+     * @return worker count
+     **/
+    size_t size (void) const;
+
+    /**
+     * Returns the number of tasks taken from another worker's deque
+     * @return steal count
+     **/
+    uint64_t get_steals (void) const;
+
+    /**
+     * Returns statistics of a periodic job
+     * @param  name      the job's name
+     * @param  stats     the job's statistics
+     * @return false if no job has that name
+     **/
+    bool get_job_stats (const std::string & name, JobStats & stats) const;
+
+    /**
+     * Returns the names of all jobs, in the order they were started
+     * @param  names     the job names
+     **/
+    void get_job_names (std::vector <std::string> & names) const;
+
+    /**
+     * Pins every worker and the timer thread to a set of cores
+     * @param  name      prefix of the names to report the placement under,
+     *                   e.g., name.0 for the first worker
+     * @param  cores     the cores
+     * @param  report    where to export the applied placement. May be null.
+     * @return true if every thread was pinned
+     **/
+    bool pin (const std::string & name, const std::vector <int> & cores,
+      madara::knowledge::KnowledgeBase * report = 0);
+
+    /**
+     * Sets the scheduler shared by every agent hosted in this process.
+     * Platforms use it, instead of starting their own, while it is set.
+     * @param  scheduler the shared scheduler, or null for none. Must
+     *                   outlive the agents using it.
+     **/
+    static void set_shared (TaskScheduler * scheduler);
+
+    /**
+     * Returns the scheduler shared by every agent hosted in this process
+     * @return the shared scheduler, or null if each platform has its own
+     **/
+    static TaskScheduler * get_shared (void);
+
+  private:
+    /**
+     * A worker and the deques it owns, one per lane
+     **/
+    struct Worker
+    {
+      /// protects lanes
+      std::mutex mutex;
+
+      /// owner pushes and pops at the back, thieves take from the front
+      std::deque <Task> lanes[NUM_PRIORITIES];
+
+      /// the OS thread
+      std::thread thread;
+    };
+
+    /**
+     * A periodic BaseThread
+     **/
+    struct Job
+    {
+      madara::threads::BaseThread * thread;
+      std::string name;
+      Priority priority;
+      bool once;
+      double hertz;
+      double target_hertz;
+      double min_hertz;
+      std::chrono::steady_clock::duration period;
+      std::chrono::steady_clock::time_point next;
+      bool triggered;
+      std::atomic <bool> running;
+      std::atomic <uint64_t> runs;
+      std::atomic <uint64_t> overruns;
+      std::atomic <int64_t> last_duration;
+      std::atomic <int64_t> max_duration;
+      std::atomic <uint64_t> misses;
+      std::atomic <int64_t> cpu_time;
+    };
+
+    /**
+     * Takes a task of priority lowest or higher and runs it
+     * @param  self      index of the calling worker, or size () if the
+     *                   caller is not a worker
+     * @param  lowest    lowest priority lane to take from
+     * @return true if a task was run
+     **/
+    bool try_run (size_t self, Priority lowest);
+
+    /**
+     * Takes a task from a lane: own deque, then the injection queue, then
+     * other workers' deques
+     **/
+    bool take (size_t self, size_t lane, Task & task);
+
+    /**
+     * Submits one run of a periodic job
+     **/
+    void dispatch (Job & job);
+
+    /**
+     * Worker thread loop
+     **/
+    void work (size_t index);
+
+    /**
+     * Timer thread loop that dispatches periodic jobs when due
+     **/
+    void time (void);
+
+    /// worker threads and their deques
+    std::vector <std::unique_ptr <Worker> > workers_;
+
+    /// tasks submitted from outside the pool, per lane
+    std::deque <Task> injection_[NUM_PRIORITIES];
+
+    /// protects injection_
+    std::mutex injection_mutex_;
+
+    /// idle workers sleep here until tasks are queued
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+
+    /// tasks queued but not yet started, across all lanes
+    std::atomic <size_t> queued_;
+
+    /// workers currently running LOW tasks
+    std::atomic <size_t> low_running_;
+
+    /// most workers that LOW tasks may occupy
+    size_t low_limit_;
+
+    /// tasks stolen from other workers
+    std::atomic <uint64_t> steals_;
+
+    /// true once the workers should exit
+    std::atomic <bool> terminated_;
+
+    /// periodic jobs
+    std::vector <std::unique_ptr <Job> > jobs_;
+
+    /// protects jobs_ and stopping_, and signals job completion
+    mutable std::mutex jobs_mutex_;
+    std::condition_variable jobs_changed_;
+
+    /// true once periodic jobs should stop being dispatched
+    bool stopping_;
+
+    /// dispatches periodic jobs
+    std::thread timer_;
+
+    /// knowledge base for BaseThread::init
+    madara::knowledge::KnowledgeBase data_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_TASKSCHEDULER_H_
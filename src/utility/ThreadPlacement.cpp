@@ -0,0 +1,317 @@
+
+#include "ThreadPlacement.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+#if defined (__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "gams/loggers/GlobalLogger.h"
+
+/**
+ * Reads the cores of a NUMA node from sysfs
+ **/
+static bool
+get_numa_cores (int node, std::vector <int> & cores)
+{
+  std::ostringstream path;
+  path << "/sys/devices/system/node/node" << node << "/cpulist";
+
+  std::ifstream file (path.str ().c_str ());
+  std::string list;
+
+  return file && std::getline (file, list) &&
+    utility::ThreadPlacement::parse_cpu_list (list, cores) && !cores.empty ();
+}
+
+#if defined (__linux__)
+/**
+ * Sets a thread's mask and reads back the mask the OS applied
+ **/
+static bool
+set_affinity (pthread_t thread, const std::vector <int> & cores,
+  std::vector <int> & applied)
+{
+  cpu_set_t mask;
+  CPU_ZERO (&mask);
+  for (size_t i = 0; i < cores.size (); ++i)
+  {
+    if (cores[i] >= 0 && cores[i] < CPU_SETSIZE)
+    {
+      CPU_SET (cores[i], &mask);
+    }
+  }
+
+  if (pthread_setaffinity_np (thread, sizeof (mask), &mask) != 0 ||
+    pthread_getaffinity_np (thread, sizeof (mask), &mask) != 0)
+  {
+    return false;
+  }
+
+  applied.clear ();
+  for (int i = 0; i < CPU_SETSIZE; ++i)
+  {
+    if (CPU_ISSET (i, &mask))
+    {
+      applied.push_back (i);
+    }
+  }
+
+  return true;
+}
+#endif
+
+/**
+ * Logs and exports the result of pinning a thread
+ **/
+static bool
+report (const std::string & name, bool pinned,
+  const std::vector <int> & requested, const std::vector <int> & applied,
+  madara::knowledge::KnowledgeBase * knowledge)
+{
+  if (!pinned)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "utility::ThreadPlacement::pin:"
+      " unable to place %s on cores %s\n", name.c_str (),
+      utility::ThreadPlacement::to_cpu_list (requested).c_str ());
+    return false;
+  }
+
+  const std::string list (utility::ThreadPlacement::to_cpu_list (applied));
+
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_ALWAYS,
+    "utility::ThreadPlacement::pin:"
+    " %s running on cores %s\n", name.c_str (), list.c_str ());
+
+  if (knowledge)
+  {
+    knowledge->set (".affinity." + name + ".applied", list);
+  }
+
+  return true;
+}
+
+utility::ThreadPlacement::ThreadPlacement ()
+: loaded_ (false)
+{
+}
+
+bool
+utility::ThreadPlacement::load (
+  const madara::knowledge::KnowledgeBase & knowledge)
+{
+  const std::string prefix (".affinity.");
+  const madara::knowledge::KnowledgeMap settings (knowledge.to_map (prefix));
+
+  placements_.clear ();
+  isolated_.clear ();
+  shared_.clear ();
+  loaded_ = false;
+
+  for (madara::knowledge::KnowledgeMap::const_iterator i = settings.begin ();
+    i != settings.end (); ++i)
+  {
+    const std::string key (i->first.substr (prefix.size ()));
+    const size_t dot = key.rfind ('.');
+
+    std::vector <int> cores;
+    bool valid = true;
+
+    if (key == "isolated")
+    {
+      valid = parse_cpu_list (i->second.to_string (), isolated_);
+    }
+    else if (dot != std::string::npos && key.substr (dot + 1) == "cores")
+    {
+      valid = parse_cpu_list (i->second.to_string (), cores);
+      if (valid)
+        placements_[key.substr (0, dot)] = cores;
+    }
+    else if (dot != std::string::npos && key.substr (dot + 1) == "numa")
+    {
+      // an explicit .cores wins over .numa
+      valid = get_numa_cores ((int)i->second.to_integer (), cores);
+      if (valid && placements_.find (key.substr (0, dot)) == placements_.end ())
+        placements_[key.substr (0, dot)] = cores;
+    }
+    else
+    {
+      // e.g., our own .applied reports
+      continue;
+    }
+
+    if (!valid)
+    {
+      madara_logger_ptr_log (gams::loggers::global_logger.get (),
+        gams::loggers::LOG_ERROR,
+        "utility::ThreadPlacement::load:"
+        " ignoring invalid %s\n", i->first.c_str ());
+      continue;
+    }
+
+    loaded_ = true;
+  }
+
+  const int online = (int)std::thread::hardware_concurrency ();
+  for (int core = 0; core < online; ++core)
+  {
+    if (!std::binary_search (isolated_.begin (), isolated_.end (), core))
+    {
+      shared_.push_back (core);
+    }
+  }
+
+  return loaded_;
+}
+
+bool
+utility::ThreadPlacement::empty (void) const
+{
+  return !loaded_;
+}
+
+bool
+utility::ThreadPlacement::has_placement (const std::string & name) const
+{
+  return placements_.find (name) != placements_.end ();
+}
+
+bool
+utility::ThreadPlacement::get_cores (
+  const std::string & name, std::vector <int> & cores) const
+{
+  if (!loaded_)
+  {
+    return false;
+  }
+
+  std::map <std::string, std::vector <int> >::const_iterator found =
+    placements_.find (name);
+
+  cores = found != placements_.end () ? found->second : shared_;
+  return true;
+}
+
+const std::vector <int> &
+utility::ThreadPlacement::get_isolated (void) const
+{
+  return isolated_;
+}
+
+bool
+utility::ThreadPlacement::apply (const std::string & name,
+  madara::knowledge::KnowledgeBase * report) const
+{
+  std::vector <int> cores;
+  return get_cores (name, cores) && pin (name, cores, report);
+}
+
+bool
+utility::ThreadPlacement::pin (const std::string & name,
+  const std::vector <int> & cores, madara::knowledge::KnowledgeBase * knowledge)
+{
+  std::vector <int> applied;
+#if defined (__linux__)
+  const bool pinned = set_affinity (pthread_self (), cores, applied);
+#else
+  const bool pinned = false;
+#endif
+
+  return report (name, pinned, cores, applied, knowledge);
+}
+
+bool
+utility::ThreadPlacement::pin (const std::string & name, std::thread & thread,
+  const std::vector <int> & cores, madara::knowledge::KnowledgeBase * knowledge)
+{
+  std::vector <int> applied;
+#if defined (__linux__)
+  const bool pinned = set_affinity (thread.native_handle (), cores, applied);
+#else
+  const bool pinned = false;
+#endif
+
+  return report (name, pinned, cores, applied, knowledge);
+}
+
+bool
+utility::ThreadPlacement::parse_cpu_list (const std::string & list,
+  std::vector <int> & cores)
+{
+  std::vector <int> result;
+  std::istringstream stream (list);
+  std::string range;
+
+  while (std::getline (stream, range, ','))
+  {
+    // allow spaces around ranges
+    range.erase (0, range.find_first_not_of (" \t"));
+    range.erase (range.find_last_not_of (" \t\n") + 1);
+    if (range.empty ())
+    {
+      continue;
+    }
+
+    char * end;
+    const long first = strtol (range.c_str (), &end, 10);
+    long last = first;
+
+    if (*end == '-')
+    {
+      last = strtol (end + 1, &end, 10);
+    }
+
+    if (*end != '\0' || first < 0 || last < first)
+    {
+      return false;
+    }
+
+    for (long core = first; core <= last; ++core)
+    {
+      result.push_back ((int)core);
+    }
+  }
+
+  std::sort (result.begin (), result.end ());
+  result.erase (std::unique (result.begin (), result.end ()), result.end ());
+  cores.swap (result);
+
+  return true;
+}
+
+std::string
+utility::ThreadPlacement::to_cpu_list (const std::vector <int> & cores)
+{
+  std::ostringstream list;
+
+  for (size_t i = 0; i < cores.size (); )
+  {
+    size_t last = i;
+    while (last + 1 < cores.size () && cores[last + 1] == cores[last] + 1)
+    {
+      ++last;
+    }
+
+    if (i > 0)
+    {
+      list << ",";
+    }
+    list << cores[i];
+    if (last > i)
+    {
+      list << "-" << cores[last];
+    }
+
+    i = last + 1;
+  }
+
+  return list.str ();
+}
@@ -0,0 +1,137 @@
+
+#ifndef   _UTILITY_THREADPLACEMENT_H_
+#define   _UTILITY_THREADPLACEMENT_H_
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "madara/knowledge/KnowledgeBase.h"
+
+namespace utility
+{
+  /**
+  * A CPU placement profile for named threads, usually loaded from a MADARA
+  * file passed with -M:
+  *
+  *   .affinity.Controls.cores = "3";
+  *   .affinity.scheduler.numa = 0;
+  *   .affinity.isolated = "3";
+  *
+  * A thread is placed on its .cores list (e.g., "0-2,5") if set, else on
+  * the cores of its .numa node. Threads without a placement share every
+  * online core except the .affinity.isolated cores, which only threads
+  * that list them explicitly may use.
+  *
+  * Pinning reads the mask back from the OS, logs it and exports it as
+  * .affinity.{name}.applied. Pinning is only supported on Linux and is a
+  * logged no-op elsewhere.
+  **/
+  class ThreadPlacement
+  {
+  public:
+    /**
+     * Constructor. The profile is empty until loaded.
+     **/
+    ThreadPlacement ();
+
+    /**
+     * Loads every .affinity.* setting from a knowledge base
+     * @param  knowledge  the knowledge base
+     * @return true if the knowledge base had any placement settings
+     **/
+    bool load (const madara::knowledge::KnowledgeBase & knowledge);
+
+    /**
+     * Returns true if no placement settings were loaded
+     * @return true if threads should be left where the OS puts them
+     **/
+    bool empty (void) const;
+
+    /**
+     * Returns true if a thread has its own .cores or .numa setting
+     * @param  name   the thread's name
+     * @return true if explicitly placed
+     **/
+    bool has_placement (const std::string & name) const;
+
+    /**
+     * Returns the cores a thread should run on
+     * @param  name   the thread's name
+     * @param  cores  the cores
+     * @return false if the profile is empty and cores was not set
+     **/
+    bool get_cores (const std::string & name, std::vector <int> & cores) const;
+
+    /**
+     * Returns the isolated cores
+     * @return cores reserved for explicitly placed threads
+     **/
+    const std::vector <int> & get_isolated (void) const;
+
+    /**
+     * Pins the calling thread to its placement. Does nothing if the profile
+     * is empty.
+     * @param  name    the thread's name
+     * @param  report  where to export the applied placement. May be null.
+     * @return true if the thread was pinned
+     **/
+    bool apply (const std::string & name,
+      madara::knowledge::KnowledgeBase * report = 0) const;
+
+    /**
+     * Pins the calling thread to cores and reports the applied mask
+     * @param  name    the thread's name, for the report
+     * @param  cores   the cores
+     * @param  report  where to export the applied placement. May be null.
+     * @return true if the thread was pinned
+     **/
+    static bool pin (const std::string & name, const std::vector <int> & cores,
+      madara::knowledge::KnowledgeBase * report = 0);
+
+    /**
+     * Pins another thread to cores and reports the applied mask
+     * @param  name    the thread's name, for the report
+     * @param  thread  the thread
+     * @param  cores   the cores
+     * @param  report  where to export the applied placement. May be null.
+     * @return true if the thread was pinned
+     **/
+    static bool pin (const std::string & name, std::thread & thread,
+      const std::vector <int> & cores,
+      madara::knowledge::KnowledgeBase * report = 0);
+
+    /**
+     * Parses a Linux style cpu list, e.g., "0-3,6"
+     * @param  list   the list
+     * @param  cores  the cores, sorted and unique
+     * @return false if the list is malformed
+     **/
+    static bool parse_cpu_list (const std::string & list,
+      std::vector <int> & cores);
+
+    /**
+     * Formats cores as a cpu list
+     * @param  cores  sorted cores
+     * @return the list, e.g., "0-3,6"
+     **/
+    static std::string to_cpu_list (const std::vector <int> & cores);
+
+  private:
+    /// explicit placements by thread name
+    std::map <std::string, std::vector <int> > placements_;
+
+    /// cores only explicitly placed threads may use
+    std::vector <int> isolated_;
+
+    /// online cores minus the isolated cores
+    std::vector <int> shared_;
+
+    /// true once any setting was loaded
+    bool loaded_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_THREADPLACEMENT_H_
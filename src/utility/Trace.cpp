@@ -0,0 +1,285 @@
+
+#include "Trace.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <vector>
+
+#include "gams/loggers/GlobalLogger.h"
+
+std::atomic <bool> utility::Trace::enabled_ (false);
+
+/**
+ * One recorded event
+ **/
+struct TraceEvent
+{
+  /// name of the span or counter
+  const char * name;
+
+  /// Chrome trace phase: 'B', 'E' or 'C'
+  char phase;
+
+  /// nanoseconds since the trace origin
+  int64_t timestamp;
+
+  /// counter value
+  double value;
+};
+
+/**
+ * The newest events of one thread, in a ring. Only the owning thread
+ * appends. count is the number of events ever recorded, and event i is
+ * at i & mask until event i + events.size () overwrites it.
+ **/
+struct TraceBuffer
+{
+  std::vector <TraceEvent> events;
+  size_t mask;
+  std::atomic <size_t> count;
+  std::string name;
+  int id;
+};
+
+// every buffer ever created. Buffers are never freed, so a thread may
+// exit before the trace is written.
+static std::mutex buffers_mutex;
+static std::vector <std::unique_ptr <TraceBuffer> > buffers;
+
+// interned names
+static std::mutex names_mutex;
+static std::set <std::string> names;
+
+// events per thread buffer
+static std::atomic <size_t> capacity (1 << 16);
+
+// steady clock time that timestamps are relative to
+static const int64_t origin (
+  std::chrono::duration_cast <std::chrono::nanoseconds> (
+    std::chrono::steady_clock::now ().time_since_epoch ()).count ());
+
+// the calling thread's buffer
+static thread_local TraceBuffer * local_buffer (0);
+
+// the calling thread's name, if set before it recorded
+static thread_local const char * local_name (0);
+
+/**
+ * Returns the calling thread's buffer, creating it on first use
+ **/
+static TraceBuffer &
+get_buffer (void)
+{
+  if (!local_buffer)
+  {
+    size_t size = 1;
+    while (size < capacity)
+    {
+      size <<= 1;
+    }
+
+    std::unique_ptr <TraceBuffer> buffer (new TraceBuffer ());
+    buffer->events.resize (size);
+    buffer->mask = size - 1;
+    buffer->count = 0;
+
+    std::lock_guard <std::mutex> guard (buffers_mutex);
+    buffer->id = (int)buffers.size () + 1;
+    buffer->name = local_name ? local_name :
+      "thread " + std::to_string (buffer->id);
+    local_buffer = buffer.get ();
+    buffers.push_back (std::move (buffer));
+  }
+
+  return *local_buffer;
+}
+
+/**
+ * Appends an event to the calling thread's buffer
+ **/
+static void
+record (const char * name, char phase, double value)
+{
+  TraceBuffer & buffer = get_buffer ();
+  const size_t index = buffer.count.load (std::memory_order_relaxed);
+
+  // orders the previous count before the overwrite, for write
+  std::atomic_thread_fence (std::memory_order_release);
+
+  TraceEvent & event = buffer.events[index & buffer.mask];
+  event.name = name;
+  event.phase = phase;
+  event.timestamp = std::chrono::duration_cast <std::chrono::nanoseconds> (
+    std::chrono::steady_clock::now ().time_since_epoch ()).count () - origin;
+  event.value = value;
+
+  // publish the event to writers
+  buffer.count.store (index + 1, std::memory_order_release);
+}
+
+/**
+ * Writes a JSON string, escaping quotes, backslashes and control characters
+ **/
+static void
+write_string (FILE * file, const char * text)
+{
+  fputc ('"', file);
+  for (; *text; ++text)
+  {
+    if (*text == '"' || *text == '\\')
+    {
+      fputc ('\\', file);
+      fputc (*text, file);
+    }
+    else if ((unsigned char)*text < 0x20)
+    {
+      fprintf (file, "\\u%04x", (unsigned char)*text);
+    }
+    else
+    {
+      fputc (*text, file);
+    }
+  }
+  fputc ('"', file);
+}
+
+void
+utility::Trace::set_enabled (bool enable)
+{
+  enabled_.store (enable);
+}
+
+void
+utility::Trace::set_capacity (size_t events)
+{
+  capacity = events;
+}
+
+void
+utility::Trace::set_thread_name (const std::string & name)
+{
+  local_name = intern (name);
+
+  if (local_buffer)
+  {
+    std::lock_guard <std::mutex> guard (buffers_mutex);
+    local_buffer->name = name;
+  }
+}
+
+const char *
+utility::Trace::intern (const std::string & name)
+{
+  std::lock_guard <std::mutex> guard (names_mutex);
+  return names.insert (name).first->c_str ();
+}
+
+void
+utility::Trace::begin (const char * name)
+{
+  record (name, 'B', 0.0);
+}
+
+void
+utility::Trace::end (const char * name)
+{
+  record (name, 'E', 0.0);
+}
+
+void
+utility::Trace::counter (const char * name, double value)
+{
+  record (name, 'C', value);
+}
+
+bool
+utility::Trace::write (const std::string & filename)
+{
+  FILE * file = fopen (filename.c_str (), "w");
+  if (!file)
+  {
+    madara_logger_ptr_log (gams::loggers::global_logger.get (),
+      gams::loggers::LOG_ERROR,
+      "utility::Trace::write:"
+      " unable to open %s\n", filename.c_str ());
+    return false;
+  }
+
+  std::lock_guard <std::mutex> guard (buffers_mutex);
+
+  size_t written = 0;
+  fprintf (file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  for (size_t i = 0; i < buffers.size (); ++i)
+  {
+    const TraceBuffer & buffer = *buffers[i];
+
+    fprintf (file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+      "\"tid\":%d,\"args\":{\"name\":", written++ ? "," : "", buffer.id);
+    write_string (file, buffer.name.c_str ());
+    fprintf (file, "}}");
+
+    const size_t size = buffer.events.size ();
+    const size_t count = buffer.count.load (std::memory_order_acquire);
+
+    // spans open at the oldest event kept
+    size_t depth = 0;
+    for (size_t j = count > size ? count - size : 0; j < count; ++j)
+    {
+      const TraceEvent event = buffer.events[j & buffer.mask];
+
+      // the thread may have started overwriting it since count was read
+      std::atomic_thread_fence (std::memory_order_acquire);
+      if (j + size <= buffer.count.load (std::memory_order_relaxed))
+        continue;
+
+      if (event.phase == 'B')
+        ++depth;
+      else if (event.phase == 'E' && depth == 0)
+        continue;
+      else if (event.phase == 'E')
+        --depth;
+
+      fprintf (file, ",\n{\"name\":");
+      write_string (file, event.name);
+      fprintf (file, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+        event.phase, event.timestamp / 1000.0, buffer.id);
+      if (event.phase == 'C')
+      {
+        fprintf (file, ",\"args\":{\"value\":%.9g}", event.value);
+      }
+      fprintf (file, "}");
+      ++written;
+    }
+  }
+
+  fprintf (file, "\n]}\n");
+  const bool result = fclose (file) == 0;
+
+  madara_logger_ptr_log (gams::loggers::global_logger.get (),
+    gams::loggers::LOG_MAJOR,
+    "utility::Trace::write:"
+    " wrote %d entries from %d threads to %s\n",
+    (int)written, (int)buffers.size (), filename.c_str ());
+
+  return result;
+}
+
+uint64_t
+utility::Trace::get_drops (void)
+{
+  std::lock_guard <std::mutex> guard (buffers_mutex);
+
+  uint64_t result = 0;
+  for (size_t i = 0; i < buffers.size (); ++i)
+  {
+    const size_t count = buffers[i]->count.load (std::memory_order_relaxed);
+    if (count > buffers[i]->events.size ())
+      result += count - buffers[i]->events.size ();
+  }
+
+  return result;
+}
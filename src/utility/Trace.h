@@ -0,0 +1,148 @@
+
+#ifndef   _UTILITY_TRACE_H_
+#define   _UTILITY_TRACE_H_
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+/**
+ * Records a span named name from here to the end of the scope. name must
+ * outlive the trace, e.g., a string literal or Trace::intern.
+ **/
+#define UTILITY_TRACE_SCOPE(name) \
+  utility::TraceScope utility_trace_scope_ (name)
+
+/**
+ * Records a counter value. name must outlive the trace.
+ **/
+#define UTILITY_TRACE_COUNTER(name, value) \
+  do { \
+    if (utility::Trace::enabled ()) \
+      utility::Trace::counter (name, (double)(value)); \
+  } while (0)
+
+namespace utility
+{
+  /**
+  * A timeline of spans and counters across threads, written as Chrome
+  * trace JSON (chrome://tracing or ui.perfetto.dev).
+  *
+  * Every thread records into its own preallocated buffer, so recording
+  * takes no locks. Each buffer is a ring that keeps the thread's newest
+  * events, so a trace written on demand shows what just happened. Older
+  * events are overwritten and counted. While tracing is disabled, each
+  * call site costs one branch.
+  **/
+  class Trace
+  {
+  public:
+    /**
+     * Returns true if events are being recorded
+     * @return true if enabled
+     **/
+    static inline bool enabled (void)
+    {
+      return enabled_.load (std::memory_order_relaxed);
+    }
+
+    /**
+     * Starts or stops recording
+     * @param  enable   true to record
+     **/
+    static void set_enabled (bool enable);
+
+    /**
+     * Sets the number of events each thread keeps, rounded up to a power
+     * of two. Only affects threads that have not recorded yet.
+     * @param  events   events per thread
+     **/
+    static void set_capacity (size_t events);
+
+    /**
+     * Names the calling thread in the timeline
+     * @param  name     the name
+     **/
+    static void set_thread_name (const std::string & name);
+
+    /**
+     * Returns a copy of name that lives as long as the program
+     * @param  name     the name
+     * @return a stable pointer to the name
+     **/
+    static const char * intern (const std::string & name);
+
+    /**
+     * Records the start of a span on the calling thread
+     * @param  name     name of the span
+     **/
+    static void begin (const char * name);
+
+    /**
+     * Records the end of the calling thread's innermost span
+     * @param  name     name of the span
+     **/
+    static void end (const char * name);
+
+    /**
+     * Records a counter value
+     * @param  name     name of the counter
+     * @param  value    the value
+     **/
+    static void counter (const char * name, double value);
+
+    /**
+     * Writes the events each thread keeps as Chrome trace JSON. Threads
+     * may keep recording while this runs. Events overwritten while being
+     * written are left out, as are ends of spans whose beginnings were.
+     * @param  filename the file to write
+     * @return true if the file was written
+     **/
+    static bool write (const std::string & filename);
+
+    /**
+     * Returns the number of events overwritten by newer ones
+     * @return overwritten events
+     **/
+    static uint64_t get_drops (void);
+
+  private:
+    /// true while recording
+    static std::atomic <bool> enabled_;
+  };
+
+  /**
+  * Records a span for the lifetime of the object, if tracing was enabled
+  * when it was created
+  **/
+  class TraceScope
+  {
+  public:
+    /**
+     * Constructor. Begins the span.
+     * @param  name     name of the span. Must outlive the trace.
+     **/
+    TraceScope (const char * name)
+    : name_ (Trace::enabled () ? name : 0)
+    {
+      if (name_)
+        Trace::begin (name_);
+    }
+
+    /**
+     * Destructor. Ends the span.
+     **/
+    ~TraceScope ()
+    {
+      if (name_)
+        Trace::end (name_);
+    }
+
+  private:
+    /// name of the span, or null if not recording
+    const char * name_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_TRACE_H_
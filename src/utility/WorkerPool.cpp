@@ -0,0 +1,144 @@
+
+#include "WorkerPool.h"
+#include "TaskScheduler.h"
+
+utility::WorkerPool::WorkerPool (size_t concurrency)
+: scheduler_ (0), body_ (0), count_ (0), generation_ (0), pending_ (0), terminated_ (false)
+{
+  if (concurrency == 0)
+  {
+    concurrency = std::thread::hardware_concurrency ();
+  }
+
+  // the caller always takes the first range
+  for (size_t i = 1; i < concurrency; ++i)
+  {
+    workers_.push_back (std::thread (&WorkerPool::work, this, i));
+  }
+}
+
+utility::WorkerPool::WorkerPool (TaskScheduler & scheduler)
+: scheduler_ (&scheduler), body_ (0), count_ (0), generation_ (0),
+  pending_ (0), terminated_ (false)
+{
+}
+
+utility::WorkerPool::~WorkerPool ()
+{
+  {
+    std::lock_guard <std::mutex> guard (mutex_);
+    terminated_ = true;
+  }
+  start_.notify_all ();
+
+  for (size_t i = 0; i < workers_.size (); ++i)
+  {
+    workers_[i].join ();
+  }
+}
+
+size_t
+utility::WorkerPool::size (void) const
+{
+  if (scheduler_)
+  {
+    return scheduler_->size ();
+  }
+
+  return workers_.size () + 1;
+}
+
+/**
+ * Returns the range of indices that a participant handles
+ **/
+static void
+get_range (size_t count, size_t participants, size_t index,
+  size_t & begin, size_t & end)
+{
+  begin = count * index / participants;
+  end = count * (index + 1) / participants;
+}
+
+void
+utility::WorkerPool::parallel_for (size_t count, const RangeFunction & body)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  if (scheduler_)
+  {
+    scheduler_->parallel_for (count, body);
+    return;
+  }
+
+  // small jobs are not worth waking anyone up
+  if (workers_.empty () || count == 1)
+  {
+    body (0, count);
+    return;
+  }
+
+  {
+    std::lock_guard <std::mutex> guard (mutex_);
+    body_ = &body;
+    count_ = count;
+    pending_ = workers_.size ();
+    ++generation_;
+  }
+  start_.notify_all ();
+
+  size_t begin, end;
+  get_range (count, size (), 0, begin, end);
+  if (begin < end)
+  {
+    body (begin, end);
+  }
+
+  std::unique_lock <std::mutex> lock (mutex_);
+  while (pending_ > 0)
+  {
+    done_.wait (lock);
+  }
+  body_ = 0;
+}
+
+void
+utility::WorkerPool::work (size_t index)
+{
+  uint64_t seen_generation = 0;
+
+  std::unique_lock <std::mutex> lock (mutex_);
+
+  for (;;)
+  {
+    while (!terminated_ && generation_ == seen_generation)
+    {
+      start_.wait (lock);
+    }
+
+    if (terminated_)
+    {
+      return;
+    }
+
+    seen_generation = generation_;
+    const RangeFunction * body = body_;
+
+    size_t begin, end;
+    get_range (count_, size (), index, begin, end);
+
+    lock.unlock ();
+    if (begin < end)
+    {
+      (*body) (begin, end);
+    }
+    lock.lock ();
+
+    if (--pending_ == 0)
+    {
+      done_.notify_one ();
+    }
+  }
+}
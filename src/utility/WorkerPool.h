@@ -0,0 +1,107 @@
+
+#ifndef   _UTILITY_WORKERPOOL_H_
+#define   _UTILITY_WORKERPOOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utility
+{
+  class TaskScheduler;
+
+  /**
+  * A fixed set of worker threads for fork-join parallelism inside a single
+  * platform thread iteration (e.g., scoring scan match candidates). The
+  * calling thread participates, so a pool of size N uses N - 1 workers.
+  **/
+  class WorkerPool
+  {
+  public:
+    /**
+     * The body of a parallel loop. Processes indices [begin, end).
+     **/
+    typedef std::function <void (size_t begin, size_t end)> RangeFunction;
+
+    /**
+     * Constructor
+     * @param  concurrency  number of threads to split work across, including
+     *                      the caller. 0 uses all hardware threads.
+     **/
+    WorkerPool (size_t concurrency = 0);
+
+    /**
+     * Constructor that owns no threads and forwards parallel_for to a
+     * shared scheduler, so ranges run at the caller's priority and may be
+     * stolen by any idle scheduler worker
+     * @param  scheduler    the scheduler to run ranges on. Must outlive
+     *                      the pool.
+     **/
+    WorkerPool (TaskScheduler & scheduler);
+
+    /**
+     * Destructor. Stops and joins all workers.
+     **/
+    ~WorkerPool ();
+
+    /**
+     * Returns the number of threads work is split across
+     * @return concurrency including the calling thread
+     **/
+    size_t size (void) const;
+
+    /**
+     * Splits [0, count) into contiguous ranges, runs body on each range in
+     * parallel and returns when every range is done. Without a scheduler
+     * this is not reentrant: only one thread may call parallel_for on a
+     * pool at a time.
+     * @param  count   number of indices
+     * @param  body    function called once per range
+     **/
+    void parallel_for (size_t count, const RangeFunction & body);
+
+  private:
+    /**
+     * Worker thread loop
+     * @param  index   worker index, 1 to size () - 1
+     **/
+    void work (size_t index);
+
+    /// if non-null, runs all work and workers_ is empty
+    TaskScheduler * scheduler_;
+
+    /// worker threads
+    std::vector <std::thread> workers_;
+
+    /// protects all fields below
+    std::mutex mutex_;
+
+    /// signals workers that a new job or shutdown is available
+    std::condition_variable start_;
+
+    /// signals the caller that a worker finished its range
+    std::condition_variable done_;
+
+    /// the current job's body
+    const RangeFunction * body_;
+
+    /// the current job's index count
+    size_t count_;
+
+    /// incremented for every job so workers can detect new work
+    uint64_t generation_;
+
+    /// workers still running the current job
+    size_t pending_;
+
+    /// true when the pool is shutting down
+    bool terminated_;
+  };
+
+} // end utility namespace
+
+#endif // _UTILITY_WORKERPOOL_H_